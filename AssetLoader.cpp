@@ -0,0 +1,294 @@
+//--------------------------------------------------------------------------------------
+// Asynchronous asset loader
+//--------------------------------------------------------------------------------------
+
+#include "AssetLoader.h"
+#include "MeshCache.h"
+#include "MeshQuantization.h"
+#include "MeshClusters.h"
+#include "Common.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+namespace
+{
+    // Read a byte from each page of some mapped file data, so the file is read from disk now, on a loading thread,
+    // rather than when the main thread first uses the data
+    void TouchPages(const unsigned char* data, size_t size)
+    {
+        const size_t PAGE_SIZE = 4096;
+        volatile unsigned char touched = 0;
+        for (size_t offset = 0; offset < size; offset += PAGE_SIZE)  touched = touched + data[offset];
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Construction / Usage
+//--------------------------------------------------------------------------------------
+
+// Start the given number of loading threads, at least one
+AssetLoader::AssetLoader(int numThreads /*= -1*/)
+{
+    if (numThreads < 0)  numThreads = static_cast<int>(std::thread::hardware_concurrency()) - 1;
+    mJobs = std::make_unique<JobSystem>(std::max(1, numThreads));
+}
+
+// Waits for any loads in progress. Textures taken from the texture cache for assets not created are given back
+AssetLoader::~AssetLoader()
+{
+    WaitForAll();
+    for (uint32_t id = mFirstPending; id < mAssets.size(); ++id)
+    {
+        if (!mAssets[id].created)  gTextureCache.Release(mAssets[id].cachedTexture);
+    }
+}
+
+
+// Start loading a mesh or texture file in the background. Returns the asset's id
+uint32_t AssetLoader::LoadMesh(const std::string& fileName, bool requireTangents /*= false*/, bool quantize /*= false*/,
+                               bool splitClusters /*= false*/)
+{
+    return Load(AssetType::Mesh, fileName, requireTangents, quantize, splitClusters);
+}
+
+uint32_t AssetLoader::LoadTexture(const std::string& fileName)
+{
+    return Load(AssetType::Texture, fileName, false, false, false);
+}
+
+
+// Create the GPU resources of the assets that have finished loading, in the order they were requested. Returns the
+// number of assets added to the list
+int AssetLoader::CreateLoaded(std::vector<LoadedAsset>& created)
+{
+    int numCreated = 0;
+    for (uint32_t id = mFirstPending; id < mAssets.size(); ++id)
+    {
+        Asset& asset = mAssets[id];
+        if (asset.created || !asset.loaded.load(std::memory_order_acquire))  continue;
+        if (asset.sameAs != NO_ASSET && !mAssets[asset.sameAs].created)     continue;
+
+        LoadedAsset loadedAsset;
+        loadedAsset.id    = id;
+        loadedAsset.type  = asset.type;
+        loadedAsset.error = asset.error;
+        if (loadedAsset.error.empty())
+        {
+            if (asset.type == AssetType::Mesh)
+            {
+                try
+                {
+                    loadedAsset.mesh = std::make_unique<Mesh>(asset.meshData, asset.fileName);
+                }
+                catch (const std::runtime_error& e)
+                {
+                    loadedAsset.error = e.what();
+                }
+            }
+            else if (asset.cachedTexture != nullptr)
+            {
+                loadedAsset.texture = asset.cachedTexture;
+            }
+            else if (asset.sameAs != NO_ASSET)
+            {
+                // The earlier load of this file was created before this one, in this call or an earlier one
+                loadedAsset.texture = gTextureCache.AcquireIfCached(asset.fileName);
+                if (loadedAsset.texture == nullptr)  loadedAsset.error = "Error loading texture " + asset.fileName;
+            }
+            else
+            {
+                loadedAsset.texture = gTextureCache.AcquireFromMemory(asset.fileName, asset.textureFile->Data(),
+                                                                      asset.textureFile->Size(), asset.textureHash);
+                if (loadedAsset.texture == nullptr)  loadedAsset.error = gLastError;
+            }
+        }
+        created.push_back(std::move(loadedAsset));
+        ++numCreated;
+
+        // The loaded data isn't needed any more
+        asset.created  = true;
+        asset.meshData = MeshData();
+        asset.textureFile.reset();
+        if (asset.type == AssetType::Texture && asset.sameAs == NO_ASSET && asset.cachedTexture == nullptr)
+        {
+            mTextureLoads.erase(asset.fileName);
+        }
+        --mNumPending;
+    }
+
+    while (mFirstPending < mAssets.size() && mAssets[mFirstPending].created)  ++mFirstPending;
+    return numCreated;
+}
+
+
+// Wait until every asset requested has finished loading. The calling thread helps load
+void AssetLoader::WaitForAll()
+{
+    mJobs->Wait(mLoading);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Private functions
+//--------------------------------------------------------------------------------------
+
+// Add an asset to the list and start a job to load it
+uint32_t AssetLoader::Load(AssetType type, const std::string& fileName, bool requireTangents, bool quantize, bool splitClusters)
+{
+    mAssets.emplace_back();
+    Asset& asset = mAssets.back();
+    asset.type            = type;
+    asset.fileName        = fileName;
+    asset.requireTangents = requireTangents;
+    asset.quantize        = quantize;
+    asset.splitClusters   = splitClusters;
+    ++mNumPending;
+    uint32_t id = static_cast<uint32_t>(mAssets.size() - 1);
+
+    // Textures the cache already has, or that are already loading, don't need their file read again
+    if (type == AssetType::Texture)
+    {
+        auto loading = mTextureLoads.find(fileName);
+        if (loading != mTextureLoads.end())
+        {
+            asset.sameAs = loading->second;
+        }
+        else
+        {
+            asset.cachedTexture = gTextureCache.AcquireIfCached(fileName);
+            if (asset.cachedTexture == nullptr)  mTextureLoads[fileName] = id;
+        }
+        if (asset.sameAs != NO_ASSET || asset.cachedTexture != nullptr)
+        {
+            asset.loaded.store(true, std::memory_order_relaxed);
+            return id;
+        }
+    }
+
+    // The asset is passed by pointer, the deque doesn't move its elements as more are added
+    Asset* loading = &asset;
+    mJobs->Run([loading]() { LoadAsset(*loading); }, &mLoading);
+    return id;
+}
+
+
+// Load an asset's data, run on a loading thread. Jobs can't throw exceptions, so errors are stored with the asset
+void AssetLoader::LoadAsset(Asset& asset)
+{
+    try
+    {
+        if (asset.type == AssetType::Mesh)
+        {
+            asset.meshData = LoadMeshData(asset.fileName, asset.requireTangents);
+            if (asset.splitClusters && !Fits16BitIndices(asset.meshData))
+            {
+                asset.meshData = SplitMeshClusters(asset.meshData);
+            }
+
+            // Quantizing copies the mesh into memory of its own, reading all of it here. Otherwise a mesh loaded from its
+            // cache file points into the mapped file (an imported one is already in memory)
+            if (asset.quantize)
+            {
+                asset.meshData = QuantizeMeshData(asset.meshData);
+            }
+            else
+            {
+                TouchPages(asset.meshData.vertices, static_cast<size_t>(asset.meshData.numVertices) * asset.meshData.vertexSize);
+                TouchPages(reinterpret_cast<const unsigned char*>(asset.meshData.indices), asset.meshData.numIndices * sizeof(uint32_t));
+            }
+        }
+        else
+        {
+            asset.textureFile = std::make_unique<MappedFile>(asset.fileName);
+            // For the texture cache to find the same content under another name. Reading every byte also brings the
+            // whole file in from disk here rather than on the main thread
+            asset.textureHash = HashData(asset.textureFile->Data(), asset.textureFile->Size());
+        }
+    }
+    catch (const std::exception& e)
+    {
+        asset.error = e.what();
+    }
+    asset.loaded.store(true, std::memory_order_release);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Placeholders
+//--------------------------------------------------------------------------------------
+
+// Mesh data for a box from -1 to 1 on each axis, with four vertices on each face so each face has its own normal
+MeshData PlaceholderMeshData(bool requireTangents)
+{
+    MeshData meshData;
+
+    // Same vertex layout as a mesh imported with MeshData.cpp: position, normal, tangent if required, uv
+    uint32_t offset = 0;
+    meshData.vertexElements.push_back( { VertexSemantic::Position, VertexFormat::Float3, offset } );  offset += 12;
+    meshData.vertexElements.push_back( { VertexSemantic::Normal,   VertexFormat::Float3, offset } );  offset += 12;
+    if (requireTangents)
+    {
+        meshData.vertexElements.push_back( { VertexSemantic::Tangent, VertexFormat::Float3, offset } );  offset += 12;
+    }
+    meshData.vertexElements.push_back( { VertexSemantic::UV, VertexFormat::Float2, offset } );  offset += 8;
+    meshData.vertexSize = offset;
+
+    const unsigned int NUM_FACES = 6;
+    meshData.numVertices = NUM_FACES * 4;
+    meshData.numIndices  = NUM_FACES * 6;
+    meshData.subMeshes   = { { 0, meshData.numIndices, 0, 0 } };
+    meshData.boundsMin   = { -1, -1, -1 };
+    meshData.boundsMax   = {  1,  1,  1 };
+
+    size_t verticesSize = meshData.numVertices * meshData.vertexSize;
+    meshData.ownedData = std::make_unique<unsigned char[]>(verticesSize + meshData.numIndices * sizeof(uint32_t));
+    unsigned char* vertex  = meshData.ownedData.get();
+    uint32_t*      indices = reinterpret_cast<uint32_t*>(vertex + verticesSize);
+    meshData.vertices = vertex;
+    meshData.indices  = indices;
+
+    // Each face from its normal and two axes across it (tangent then bitangent), clockwise winding seen from outside
+    const CVector3 faces[NUM_FACES][3] =
+    {
+        { {  1, 0, 0 }, { 0, 0,  1 }, { 0, 1, 0 } },
+        { { -1, 0, 0 }, { 0, 0, -1 }, { 0, 1, 0 } },
+        { { 0,  1, 0 }, { 1, 0, 0 }, { 0, 0,  1 } },
+        { { 0, -1, 0 }, { 1, 0, 0 }, { 0, 0, -1 } },
+        { { 0, 0,  1 }, { -1, 0, 0 }, { 0, 1, 0 } },
+        { { 0, 0, -1 }, {  1, 0, 0 }, { 0, 1, 0 } },
+    };
+    const float corners[4][2] = { { -1, -1 }, { -1, 1 }, { 1, 1 }, { 1, -1 } };
+    for (unsigned int face = 0; face < NUM_FACES; ++face)
+    {
+        const CVector3& normal    = faces[face][0];
+        const CVector3& tangent   = faces[face][1];
+        const CVector3& bitangent = faces[face][2];
+        for (auto& corner : corners)
+        {
+            CVector3 position = normal + tangent * corner[0] + bitangent * corner[1];
+            float    uv[2]    = { (corner[0] + 1) * 0.5f, (1 - corner[1]) * 0.5f };
+
+            unsigned char* element = vertex;
+            std::memcpy(element, &position, 12);  element += 12;
+            std::memcpy(element, &normal,   12);  element += 12;
+            if (requireTangents)  { std::memcpy(element, &tangent, 12);  element += 12; }
+            std::memcpy(element, uv, 8);
+            vertex += meshData.vertexSize;
+        }
+
+        uint32_t first = face * 4;
+        const uint32_t quad[6] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+        std::memcpy(indices, quad, sizeof(quad));
+        indices += 6;
+    }
+
+    return meshData;
+}
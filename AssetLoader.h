@@ -0,0 +1,167 @@
+//--------------------------------------------------------------------------------------
+// Asynchronous asset loader
+//--------------------------------------------------------------------------------------
+// Loads meshes and textures in the background, several at once, so the app can start before every file has loaded.
+// The slow parts of loading run on the loader's own threads: reading the files, importing meshes with assimp (or
+// reading their mesh cache, see MeshCache.h) and packing their vertices. GPU resources are only created on the main
+// thread, so finished assets wait in the loader until the main thread calls CreateLoaded, which creates all the assets
+// ready at that moment in one batch - e.g. once a frame. Until then the app shows a placeholder in their place.
+//
+// Texture files are only read on the loading threads (mapped into memory, see MappedFile.h, so they aren't copied),
+// decoding a .jpg or .png into pixels is done by the renderer when the texture is created (see
+// RenderDevice::CreateTextureFromMemory). DDS files need no decoding. Textures come from the texture cache (see
+// TextureCache.h): one the cache already has isn't read again, and the content of each file read is hashed on the loading
+// thread so the cache can find a copy of it under another name. A texture requested again while it is still loading
+// waits for the first load rather than reading the file twice.
+//
+// The loader has its own job system (see JobSystem.h) rather than sharing the scene's, which is waited for every frame -
+// a frame would otherwise wait for any file being loaded to finish.
+
+#ifndef _ASSET_LOADER_H_INCLUDED_
+#define _ASSET_LOADER_H_INCLUDED_
+
+#include "Mesh.h"
+#include "MeshData.h"
+#include "Renderer.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "TextureCache.h"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Loaded assets
+//--------------------------------------------------------------------------------------
+
+enum class AssetType
+{
+    Mesh,
+    Texture,
+};
+
+// An asset created by AssetLoader::CreateLoaded. The caller owns the mesh. The texture is shared from gTextureCache, give
+// it back with gTextureCache.Release. If the asset failed to load both are null and error says why
+struct LoadedAsset
+{
+    uint32_t              id; // As returned when the asset was requested
+    AssetType             type;
+    std::unique_ptr<Mesh> mesh;
+    GpuTexture*           texture = nullptr;
+    std::string           error;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Asset loader class
+//--------------------------------------------------------------------------------------
+
+class AssetLoader
+{
+public:
+    //-------------------------------------
+    // Construction / Usage
+    //-------------------------------------
+
+    // Start the given number of loading threads. Pass a negative number for one fewer than the number of CPU cores, but
+    // there is always at least one so loading never waits for the main thread.
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors).
+    AssetLoader(int numThreads = -1);
+
+    // Waits for any loads in progress. Assets loaded but not created are discarded
+    ~AssetLoader();
+
+    // Prevent copying - the loading threads refer to this object
+    AssetLoader(const AssetLoader&) = delete;
+    AssetLoader& operator=(const AssetLoader&) = delete;
+
+
+    // Start loading a mesh or texture file in the background. Returns the asset's id, which numbers assets from 0 in the
+    // order they are requested. Meshes can be quantized and split into clusters as they load (see MeshQuantization.h
+    // and MeshClusters.h)
+    uint32_t LoadMesh(const std::string& fileName, bool requireTangents = false, bool quantize = false,
+                      bool splitClusters = false);
+    uint32_t LoadTexture(const std::string& fileName);
+
+    // Create the GPU resources of the assets that have finished loading and not been created yet, adding them to the
+    // given list. Call on the main thread. Returns the number of assets added, including any that failed to load
+    int CreateLoaded(std::vector<LoadedAsset>& created);
+
+    // Wait until every asset requested has finished loading, ready for CreateLoaded. The calling thread helps load
+    void WaitForAll();
+
+
+    //-------------------------------------
+    // Data access
+    //-------------------------------------
+
+    // Number of assets requested that CreateLoaded hasn't returned yet
+    int NumPending()  { return mNumPending; }
+
+    // Number of threads loading assets
+    int NumThreads()  { return mJobs->NumThreads() - 1; }
+
+
+    //-------------------------------------
+    // Private data / members
+    //-------------------------------------
+private:
+    static const uint32_t NO_ASSET = ~0u;
+
+    struct Asset
+    {
+        AssetType   type;
+        std::string fileName;
+        bool        requireTangents = false;
+        bool        quantize        = false;
+        bool        splitClusters   = false;
+
+        // Written by the loading thread before setting loaded, only read by the main thread after seeing it set
+        std::atomic<bool>           loaded{ false };
+        MeshData                    meshData;
+        std::unique_ptr<MappedFile> textureFile;
+        uint64_t                    textureHash = 0; // HashData of the texture file
+        std::string                 error;
+
+        // A texture already in the cache, or the id of an earlier asset loading the same texture file, when not loaded
+        GpuTexture* cachedTexture = nullptr;
+        uint32_t    sameAs        = NO_ASSET;
+
+        bool created = false; // Returned by CreateLoaded
+    };
+
+    // Add an asset to the list and start a job to load it
+    uint32_t Load(AssetType type, const std::string& fileName, bool requireTangents, bool quantize, bool splitClusters);
+
+    // Load an asset's data, run on a loading thread
+    static void LoadAsset(Asset& asset);
+
+    // A deque so assets being loaded don't move when more are added
+    std::deque<Asset> mAssets;
+    uint32_t          mFirstPending = 0; // All assets before this have been created
+    int               mNumPending   = 0;
+
+    // Id of the asset loading each texture file, until it is created
+    std::unordered_map<std::string, uint32_t> mTextureLoads;
+
+    std::unique_ptr<JobSystem> mJobs;
+    JobCounter                 mLoading;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Placeholders
+//--------------------------------------------------------------------------------------
+
+// Mesh data for a box from -1 to 1 on each axis, to draw in place of a mesh that is still loading. Has tangents if
+// requested, so it has the same vertex layout as the mesh it stands in for
+MeshData PlaceholderMeshData(bool requireTangents);
+
+
+#endif //_ASSET_LOADER_H_INCLUDED_
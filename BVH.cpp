@@ -0,0 +1,429 @@
+//--------------------------------------------------------------------------------------
+// Bounding volume hierarchy
+//--------------------------------------------------------------------------------------
+
+#include "BVH.h"
+
+#include <algorithm>
+#include <numeric>
+#include <cfloat>
+
+#ifdef CMATRIX4X4_SSE
+#include <immintrin.h>
+#endif
+
+
+namespace
+{
+    // Number of bins each axis is divided into when looking for the best split
+    const int SAH_BINS = 16;
+
+    // A box that contains nothing, so adding any box to it gives that box
+    const BoundingBox EMPTY_BOX = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+    void AddToBox(BoundingBox& box, const BoundingBox& other)
+    {
+        box.min = { std::min(box.min.x, other.min.x), std::min(box.min.y, other.min.y), std::min(box.min.z, other.min.z) };
+        box.max = { std::max(box.max.x, other.max.x), std::max(box.max.y, other.max.y), std::max(box.max.z, other.max.z) };
+    }
+
+    // Half the surface area of a box, which is all the surface area heuristic needs. 0 for an empty box
+    float HalfArea(const BoundingBox& box)
+    {
+        CVector3 size = { std::max(0.0f, box.max.x - box.min.x), std::max(0.0f, box.max.y - box.min.y), std::max(0.0f, box.max.z - box.min.z) };
+        return size.x * size.y + size.y * size.z + size.z * size.x;
+    }
+
+    float Axis(const CVector3& v, int axis)
+    {
+        return (axis == 0) ? v.x : (axis == 1) ? v.y : v.z;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Construction / Usage
+//--------------------------------------------------------------------------------------
+
+// Build the tree over the given boxes, replacing any tree built before. Item i is boxes[i]
+void BVH::Build(const BoundingBox* boxes, uint32_t count)
+{
+    Clear();
+    if (count == 0)  return;
+
+    BuildRange root = { 0, count, EMPTY_BOX };
+    mItems.resize(count);
+    std::iota(mItems.begin(), mItems.end(), 0);
+    mCentres.resize(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        mCentres[i] = (boxes[i].min + boxes[i].max) * 0.5f;
+        AddToBox(root.bounds, boxes[i]);
+    }
+
+    // Each node has up to four children, around a third of the items are nodes
+    mNodes.reserve(count / 3 + 1);
+    BuildNode(root, boxes);
+
+    std::vector<CVector3>().swap(mCentres);
+}
+
+
+// Update the tree for new boxes for the same items, keeping its shape
+void BVH::Refit(const BoundingBox* boxes)
+{
+    // Children come after their parents, so going backwards each node's children are done before it
+    for (size_t nodeIndex = mNodes.size(); nodeIndex-- > 0;)
+    {
+        Node& node = mNodes[nodeIndex];
+        for (int i = 0; i < 4; ++i)
+        {
+            if (node.count[i] == 0)  continue;
+
+            BoundingBox bounds = EMPTY_BOX;
+            if (node.child[i] == NO_CHILD_NODE)
+            {
+                bounds = boxes[mItems[node.first[i]]];
+            }
+            else
+            {
+                // Unused children of the child have empty boxes, which leave the bounds unchanged
+                const Node& child = mNodes[node.child[i]];
+                for (int j = 0; j < 4; ++j)
+                {
+                    AddToBox(bounds, { { child.minX[j], child.minY[j], child.minZ[j] }, { child.maxX[j], child.maxY[j], child.maxZ[j] } });
+                }
+            }
+            node.minX[i] = bounds.min.x;  node.minY[i] = bounds.min.y;  node.minZ[i] = bounds.min.z;
+            node.maxX[i] = bounds.max.x;  node.maxY[i] = bounds.max.y;  node.maxZ[i] = bounds.max.z;
+        }
+    }
+}
+
+
+// Remove all items
+void BVH::Clear()
+{
+    mNodes.clear();
+    mItems.clear();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Queries
+//--------------------------------------------------------------------------------------
+// Each query walks the tree with a stack of nodes still to visit. For each node a mask is made with a bit for each
+// child that passes the test, four children at once with SIMD. Children that are single items and pass are results,
+// child nodes that pass are visited
+
+// Items whose box may be inside the frustum. The same as testing every box with AABBInFrustum (see Frustum.h)
+void BVH::FrustumQuery(const Frustum& frustum, std::vector<uint32_t>& results) const
+{
+    if (mNodes.empty())  return;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const Node& node = mNodes[stack.back()];
+        stack.pop_back();
+
+        // For each plane, test the corner of each box furthest along the plane normal, as AABBInFrustum does - if that is
+        // outside, the whole box is. Also test the opposite corner - if that is inside every plane, the whole box is
+        int outsideMask  = 0;
+        int crossingMask = 0;
+#ifdef CMATRIX4X4_SSE
+        __m128 minX = _mm_loadu_ps(node.minX), minY = _mm_loadu_ps(node.minY), minZ = _mm_loadu_ps(node.minZ);
+        __m128 maxX = _mm_loadu_ps(node.maxX), maxY = _mm_loadu_ps(node.maxY), maxZ = _mm_loadu_ps(node.maxZ);
+        __m128 zero = _mm_setzero_ps();
+        for (auto& plane : frustum.planes)
+        {
+            __m128 nx = _mm_set1_ps(plane.normal.x), ny = _mm_set1_ps(plane.normal.y), nz = _mm_set1_ps(plane.normal.z);
+            __m128 d  = _mm_set1_ps(plane.d);
+            __m128 farX  = plane.normal.x >= 0 ? maxX : minX,  nearX = plane.normal.x >= 0 ? minX : maxX;
+            __m128 farY  = plane.normal.y >= 0 ? maxY : minY,  nearY = plane.normal.y >= 0 ? minY : maxY;
+            __m128 farZ  = plane.normal.z >= 0 ? maxZ : minZ,  nearZ = plane.normal.z >= 0 ? minZ : maxZ;
+
+            __m128 farDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, farX), _mm_mul_ps(ny, farY)), _mm_mul_ps(nz, farZ)), d);
+            __m128 nearDistance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nearX), _mm_mul_ps(ny, nearY)), _mm_mul_ps(nz, nearZ)), d);
+            outsideMask  |= _mm_movemask_ps(_mm_cmplt_ps(farDistance,  zero));
+            crossingMask |= _mm_movemask_ps(_mm_cmplt_ps(nearDistance, zero));
+        }
+#else
+        for (int i = 0; i < 4; ++i)
+        {
+            for (auto& plane : frustum.planes)
+            {
+                bool px = plane.normal.x >= 0, py = plane.normal.y >= 0, pz = plane.normal.z >= 0;
+                float farDistance  = plane.normal.x * (px ? node.maxX[i] : node.minX[i]) + plane.normal.y * (py ? node.maxY[i] : node.minY[i]) +
+                                     plane.normal.z * (pz ? node.maxZ[i] : node.minZ[i]) + plane.d;
+                float nearDistance = plane.normal.x * (px ? node.minX[i] : node.maxX[i]) + plane.normal.y * (py ? node.minY[i] : node.maxY[i]) +
+                                     plane.normal.z * (pz ? node.minZ[i] : node.maxZ[i]) + plane.d;
+                if (farDistance  < 0)  outsideMask  |= 1 << i;
+                if (nearDistance < 0)  crossingMask |= 1 << i;
+            }
+        }
+#endif
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (node.count[i] == 0 || (outsideMask & (1 << i)))  continue;
+
+            // A child entirely inside the frustum adds all its items without testing them
+            if (node.child[i] == NO_CHILD_NODE || !(crossingMask & (1 << i)))
+            {
+                results.insert(results.end(), mItems.begin() + node.first[i], mItems.begin() + node.first[i] + node.count[i]);
+            }
+            else
+            {
+                stack.push_back(node.child[i]);
+            }
+        }
+    }
+}
+
+
+// Items whose box the ray passes through between origin and origin + direction * maxDistance
+void BVH::RayQuery(const CVector3& origin, const CVector3& direction, float maxDistance, std::vector<uint32_t>& results) const
+{
+    if (mNodes.empty())  return;
+
+    // The slab test: the distances along the ray where it enters and leaves each pair of box faces. It is inside the box
+    // where it is between all three pairs. A zero direction component is replaced with a tiny one so the divide gives a
+    // very large number rather than infinity (which would give 0 x infinity at the box faces)
+    auto inverse = [](float d) { return 1.0f / (d != 0 ? d : 1e-30f); };
+    CVector3 invDirection = { inverse(direction.x), inverse(direction.y), inverse(direction.z) };
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const Node& node = mNodes[stack.back()];
+        stack.pop_back();
+
+        int hitMask = 0;
+#ifdef CMATRIX4X4_SSE
+        __m128 ox = _mm_set1_ps(origin.x),       oy = _mm_set1_ps(origin.y),       oz = _mm_set1_ps(origin.z);
+        __m128 ix = _mm_set1_ps(invDirection.x), iy = _mm_set1_ps(invDirection.y), iz = _mm_set1_ps(invDirection.z);
+        __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), ox), ix), t2x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), ox), ix);
+        __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), oy), iy), t2y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), oy), iy);
+        __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), oz), iz), t2z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), oz), iz);
+        __m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t1x, t2x), _mm_min_ps(t1y, t2y)), _mm_max_ps(_mm_min_ps(t1z, t2z), _mm_setzero_ps()));
+        __m128 leave = _mm_min_ps(_mm_min_ps(_mm_max_ps(t1x, t2x), _mm_max_ps(t1y, t2y)), _mm_min_ps(_mm_max_ps(t1z, t2z), _mm_set1_ps(maxDistance)));
+        hitMask = _mm_movemask_ps(_mm_cmple_ps(enter, leave));
+#else
+        for (int i = 0; i < 4; ++i)
+        {
+            float t1x = (node.minX[i] - origin.x) * invDirection.x, t2x = (node.maxX[i] - origin.x) * invDirection.x;
+            float t1y = (node.minY[i] - origin.y) * invDirection.y, t2y = (node.maxY[i] - origin.y) * invDirection.y;
+            float t1z = (node.minZ[i] - origin.z) * invDirection.z, t2z = (node.maxZ[i] - origin.z) * invDirection.z;
+            float enter = std::max({ std::min(t1x, t2x), std::min(t1y, t2y), std::min(t1z, t2z), 0.0f });
+            float leave = std::min({ std::max(t1x, t2x), std::max(t1y, t2y), std::max(t1z, t2z), maxDistance });
+            if (enter <= leave)  hitMask |= 1 << i;
+        }
+#endif
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (node.count[i] == 0 || !(hitMask & (1 << i)))  continue;
+
+            if (node.child[i] == NO_CHILD_NODE)  results.push_back(mItems[node.first[i]]);
+            else                                 stack.push_back(node.child[i]);
+        }
+    }
+}
+
+
+// Items whose box overlaps the given box (touching counts)
+void BVH::BoxQuery(const BoundingBox& box, std::vector<uint32_t>& results) const
+{
+    if (mNodes.empty())  return;
+
+    std::vector<uint32_t> stack;
+    stack.reserve(64);
+    stack.push_back(0);
+    while (!stack.empty())
+    {
+        const Node& node = mNodes[stack.back()];
+        stack.pop_back();
+
+        // Boxes overlap if they overlap on every axis. A child entirely inside the query box adds all its items
+        int overlapMask = 0;
+        int insideMask  = 0;
+#ifdef CMATRIX4X4_SSE
+        __m128 minX = _mm_loadu_ps(node.minX), minY = _mm_loadu_ps(node.minY), minZ = _mm_loadu_ps(node.minZ);
+        __m128 maxX = _mm_loadu_ps(node.maxX), maxY = _mm_loadu_ps(node.maxY), maxZ = _mm_loadu_ps(node.maxZ);
+        __m128 queryMinX = _mm_set1_ps(box.min.x), queryMinY = _mm_set1_ps(box.min.y), queryMinZ = _mm_set1_ps(box.min.z);
+        __m128 queryMaxX = _mm_set1_ps(box.max.x), queryMaxY = _mm_set1_ps(box.max.y), queryMaxZ = _mm_set1_ps(box.max.z);
+        __m128 overlap = _mm_and_ps(_mm_and_ps(_mm_cmple_ps(minX, queryMaxX), _mm_cmpge_ps(maxX, queryMinX)),
+                                    _mm_and_ps(_mm_cmple_ps(minY, queryMaxY), _mm_cmpge_ps(maxY, queryMinY)));
+        overlap = _mm_and_ps(overlap, _mm_and_ps(_mm_cmple_ps(minZ, queryMaxZ), _mm_cmpge_ps(maxZ, queryMinZ)));
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(minX, queryMinX), _mm_cmple_ps(maxX, queryMaxX)),
+                                   _mm_and_ps(_mm_cmpge_ps(minY, queryMinY), _mm_cmple_ps(maxY, queryMaxY)));
+        inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(minZ, queryMinZ), _mm_cmple_ps(maxZ, queryMaxZ)));
+        overlapMask = _mm_movemask_ps(overlap);
+        insideMask  = _mm_movemask_ps(inside);
+#else
+        for (int i = 0; i < 4; ++i)
+        {
+            if (node.minX[i] <= box.max.x && node.maxX[i] >= box.min.x && node.minY[i] <= box.max.y && node.maxY[i] >= box.min.y &&
+                node.minZ[i] <= box.max.z && node.maxZ[i] >= box.min.z)  overlapMask |= 1 << i;
+            if (node.minX[i] >= box.min.x && node.maxX[i] <= box.max.x && node.minY[i] >= box.min.y && node.maxY[i] <= box.max.y &&
+                node.minZ[i] >= box.min.z && node.maxZ[i] <= box.max.z)  insideMask |= 1 << i;
+        }
+#endif
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (node.count[i] == 0 || !(overlapMask & (1 << i)))  continue;
+
+            if (node.child[i] == NO_CHILD_NODE || (insideMask & (1 << i)))
+            {
+                results.insert(results.end(), mItems.begin() + node.first[i], mItems.begin() + node.first[i] + node.count[i]);
+            }
+            else
+            {
+                stack.push_back(node.child[i]);
+            }
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Private functions
+//--------------------------------------------------------------------------------------
+
+// Create the node for the given range of items and (recursively) its children. Returns the node's index
+uint32_t BVH::BuildNode(const BuildRange& range, const BoundingBox* boxes)
+{
+    // Split the range in two, then keep splitting the part with the largest surface area (the one queries are most
+    // likely to visit) until there are four parts or every part is a single item
+    BuildRange children[4] = { range };
+    int numChildren = 1;
+    while (numChildren < 4)
+    {
+        int largest = -1;
+        float largestArea = -1;
+        for (int i = 0; i < numChildren; ++i)
+        {
+            float area = HalfArea(children[i].bounds);
+            if (children[i].count > 1 && area > largestArea)
+            {
+                largest = i;
+                largestArea = area;
+            }
+        }
+        if (largest < 0)  break;
+
+        BuildRange left, right;
+        SplitRange(children[largest], boxes, left, right);
+        children[largest] = left;
+        children[numChildren++] = right;
+    }
+
+    // Add this node before building its children so parents come before children in the array. The array may grow
+    // while the children are built, so the node is found by index each time rather than kept as a reference
+    uint32_t nodeIndex = static_cast<uint32_t>(mNodes.size());
+    mNodes.emplace_back();
+    for (int i = 0; i < 4; ++i)
+    {
+        BoundingBox bounds = (i < numChildren) ? children[i].bounds : EMPTY_BOX;
+        Node& node = mNodes[nodeIndex];
+        node.minX[i] = bounds.min.x;  node.minY[i] = bounds.min.y;  node.minZ[i] = bounds.min.z;
+        node.maxX[i] = bounds.max.x;  node.maxY[i] = bounds.max.y;  node.maxZ[i] = bounds.max.z;
+        node.first[i] = (i < numChildren) ? children[i].first : 0;
+        node.count[i] = (i < numChildren) ? children[i].count : 0;
+        node.child[i] = NO_CHILD_NODE;
+    }
+    for (int i = 0; i < numChildren; ++i)
+    {
+        if (children[i].count > 1)
+        {
+            uint32_t childIndex = BuildNode(children[i], boxes);
+            mNodes[nodeIndex].child[i] = childIndex;
+        }
+    }
+    return nodeIndex;
+}
+
+
+// Split a range of items in two with the surface area heuristic, reordering the items in the range
+void BVH::SplitRange(const BuildRange& range, const BoundingBox* boxes, BuildRange& left, BuildRange& right)
+{
+    uint32_t* items = mItems.data() + range.first;
+
+    // Items are binned by the centre of their box, over the range of the centres
+    BoundingBox centreBounds = EMPTY_BOX;
+    for (uint32_t i = 0; i < range.count; ++i)  AddToBox(centreBounds, { mCentres[items[i]], mCentres[items[i]] });
+
+    // Try the splits between bins along each axis, keep the one with the lowest cost
+    float bestCost  = FLT_MAX;
+    int   bestAxis  = -1;
+    int   bestSplit = 0; // Bins up to and including this one go on the left
+    float bestScale = 0;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float axisMin = Axis(centreBounds.min, axis);
+        float extent  = Axis(centreBounds.max, axis) - axisMin;
+        if (extent <= 0)  continue; // All centres the same along this axis
+
+        // Scale slightly under SAH_BINS / extent so the largest centre goes in the last bin
+        float scale = SAH_BINS / extent * 0.9999f;
+        BoundingBox binBounds[SAH_BINS];
+        uint32_t    binCounts[SAH_BINS] = {};
+        for (auto& bounds : binBounds)  bounds = EMPTY_BOX;
+        for (uint32_t i = 0; i < range.count; ++i)
+        {
+            int bin = std::min(SAH_BINS - 1, static_cast<int>((Axis(mCentres[items[i]], axis) - axisMin) * scale));
+            AddToBox(binBounds[bin], boxes[items[i]]);
+            ++binCounts[bin];
+        }
+
+        // Cost of everything right of each split, sweeping from the right, then sweep from the left adding the left side
+        float    rightCost[SAH_BINS];
+        BoundingBox sideBounds = EMPTY_BOX;
+        uint32_t sideCount = 0;
+        for (int bin = SAH_BINS - 1; bin > 0; --bin)
+        {
+            AddToBox(sideBounds, binBounds[bin]);
+            sideCount += binCounts[bin];
+            rightCost[bin - 1] = HalfArea(sideBounds) * sideCount;
+        }
+        sideBounds = EMPTY_BOX;
+        sideCount  = 0;
+        for (int split = 0; split < SAH_BINS - 1; ++split)
+        {
+            AddToBox(sideBounds, binBounds[split]);
+            sideCount += binCounts[split];
+            float cost = HalfArea(sideBounds) * sideCount + rightCost[split];
+            if (sideCount > 0 && sideCount < range.count && cost < bestCost)
+            {
+                bestCost  = cost;
+                bestAxis  = axis;
+                bestSplit = split;
+                bestScale = scale;
+            }
+        }
+    }
+
+    // Put the items of the chosen bins first. If no split was found (all the centres are in the same place) split the
+    // items in half in their current order
+    uint32_t numLeft = range.count / 2;
+    if (bestAxis >= 0)
+    {
+        float axisMin = Axis(centreBounds.min, bestAxis);
+        uint32_t* middle = std::partition(items, items + range.count, [&](uint32_t item)
+        {
+            return std::min(SAH_BINS - 1, static_cast<int>((Axis(mCentres[item], bestAxis) - axisMin) * bestScale)) <= bestSplit;
+        });
+        numLeft = static_cast<uint32_t>(middle - items);
+    }
+
+    left  = { range.first,           numLeft,               EMPTY_BOX };
+    right = { range.first + numLeft, range.count - numLeft, EMPTY_BOX };
+    for (uint32_t i = 0;       i < numLeft;     ++i)  AddToBox(left.bounds,  boxes[items[i]]);
+    for (uint32_t i = numLeft; i < range.count; ++i)  AddToBox(right.bounds, boxes[items[i]]);
+}
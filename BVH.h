@@ -0,0 +1,131 @@
+//--------------------------------------------------------------------------------------
+// Bounding volume hierarchy
+//--------------------------------------------------------------------------------------
+// A tree of axis-aligned boxes over a set of items (e.g. the models in a scene that don't move), so questions like
+// "which items may the camera see" or "which items does this ray pass through" only look at the items near the answer
+// rather than testing every one. Each node holds the boxes of up to four children, each child being another node or a
+// single item. A query tests all four boxes of a node at once with SIMD (one box per lane) and only visits the
+// children that pass. Items are referred to by their index in the array of boxes the tree was built from.
+//
+// The tree is built by splitting the items in two again and again, each time choosing the split with the surface area
+// heuristic (SAH): the chance of a query visiting a child is roughly its surface area, so the best split has the least
+// total of (surface area x items) over its two sides. Rather than trying every possible split, the items are sorted
+// into a few bins along each axis by the centre of their box and only splits between bins are tried. Each node's four
+// children come from splitting the largest part again until there are four.
+//
+// If the items move a little, Refit updates the boxes in the tree without changing its shape, which is much faster
+// than building again but gives a less efficient tree the further the items move from where they were. For items that
+// move rarely, refit when they do and rebuild now and then.
+//
+// The nodes are in an array with each parent before its children, so refitting is one pass backwards through it. The
+// items under any node are together in the tree's item list, so a node entirely inside the frustum adds its items
+// without visiting its children.
+
+#ifndef _BVH_H_INCLUDED_
+#define _BVH_H_INCLUDED_
+
+#include "CVector3.h"
+#include "Frustum.h"
+
+#include <vector>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Bounding box
+//--------------------------------------------------------------------------------------
+
+struct BoundingBox
+{
+    CVector3 min;
+    CVector3 max;
+};
+
+
+//--------------------------------------------------------------------------------------
+// BVH class
+//--------------------------------------------------------------------------------------
+
+class BVH
+{
+public:
+    //-------------------------------------
+    // Construction / Usage
+    //-------------------------------------
+
+    // Build the tree over the given boxes, replacing any tree built before. Item i is boxes[i]
+    void Build(const BoundingBox* boxes, uint32_t count);
+
+    // Update the tree for new boxes for the same items, keeping its shape. Pass the same number of boxes as Build
+    void Refit(const BoundingBox* boxes);
+
+    // Remove all items
+    void Clear();
+
+
+    //-------------------------------------
+    // Queries
+    //-------------------------------------
+    // Each adds the indices of the items found to the end of the results, in no particular order. They only read the
+    // tree, so can be run on several threads at once (but not while building or refitting)
+
+    // Items whose box may be inside the frustum. The same as testing every box with AABBInFrustum (see Frustum.h)
+    void FrustumQuery(const Frustum& frustum, std::vector<uint32_t>& results) const;
+
+    // Items whose box the ray passes through between origin and origin + direction * maxDistance. The direction need
+    // not be normalised, maxDistance is in multiples of its length
+    void RayQuery(const CVector3& origin, const CVector3& direction, float maxDistance, std::vector<uint32_t>& results) const;
+
+    // Items whose box overlaps the given box (touching counts)
+    void BoxQuery(const BoundingBox& box, std::vector<uint32_t>& results) const;
+
+
+    //-------------------------------------
+    // Data access
+    //-------------------------------------
+
+    uint32_t NumItems() const  { return static_cast<uint32_t>(mItems.size()); }
+    uint32_t NumNodes() const  { return static_cast<uint32_t>(mNodes.size()); }
+
+    // Memory used by the tree in bytes
+    size_t MemoryUsed() const  { return mNodes.size() * sizeof(Node) + mItems.size() * sizeof(uint32_t); }
+
+
+    //-------------------------------------
+    // Private data / members
+    //-------------------------------------
+private:
+    // Up to four children. The boxes are stored a coordinate at a time so each can be loaded into one SIMD register.
+    // Unused children have count 0 and an empty box (min greater than max)
+    struct Node
+    {
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+        uint32_t child[4]; // Index of the child node, or NO_CHILD_NODE if the child is a single item
+        uint32_t first[4]; // The child's items are mItems[first] to mItems[first + count - 1]
+        uint32_t count[4];
+    };
+    static const uint32_t NO_CHILD_NODE = 0xffffffff;
+
+    // A range of mItems being split while building, and the box around its items
+    struct BuildRange
+    {
+        uint32_t    first;
+        uint32_t    count;
+        BoundingBox bounds;
+    };
+
+    // Create the node for the given range of items and (recursively) its children. Returns the node's index
+    uint32_t BuildNode(const BuildRange& range, const BoundingBox* boxes);
+
+    // Split a range of items in two with the surface area heuristic, reordering the items in the range
+    void SplitRange(const BuildRange& range, const BoundingBox* boxes, BuildRange& left, BuildRange& right);
+
+    std::vector<Node>     mNodes; // The root is mNodes[0]
+    std::vector<uint32_t> mItems; // Item indices in tree order, the items under each node are together
+
+    std::vector<CVector3> mCentres; // Working space while building: the centre of each item's box
+};
+
+
+#endif //_BVH_H_INCLUDED_
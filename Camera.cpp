@@ -4,11 +4,19 @@
 // Holds position, rotation, near/far clip and field of view. These to a view and projection matrices as required
 
 #include "Camera.h"
+#include "FrameStats.h"
 
 // Control the camera's position and rotation using keys provided
 void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,
                                       KeyCode moveForward, KeyCode moveBackward, KeyCode moveLeft, KeyCode moveRight)
 {
+	// Any key used here will move the camera, so the view matrix must be rebuilt next time it is needed
+	if (KeyHeld(turnUp)      || KeyHeld(turnDown)     || KeyHeld(turnLeft) || KeyHeld(turnRight) ||
+	    KeyHeld(moveForward) || KeyHeld(moveBackward) || KeyHeld(moveLeft) || KeyHeld(moveRight))
+	{
+		mViewDirty = true;
+	}
+
 	//**** ROTATION ****
 	if (KeyHeld(turnDown))
 	{
@@ -28,55 +36,76 @@ void Camera::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode
 	}
 
 	//**** LOCAL MOVEMENT ****
+	if (!KeyHeld(moveForward) && !KeyHeld(moveBackward) && !KeyHeld(moveLeft) && !KeyHeld(moveRight))  return;
+
+	// The local X and Z axes are the first and third rows of the world matrix. Rather than rebuilding the matrices here
+	// (they will be rebuilt once when rendering) work out those two rows directly from the rotation
+	float sX = std::sin(mRotation.x);  float cX = std::cos(mRotation.x);
+	float sY = std::sin(mRotation.y);  float cY = std::cos(mRotation.y);
+	float sZ = std::sin(mRotation.z);  float cZ = std::cos(mRotation.z);
+	CVector3 localX = { cZ*cY + sZ*sX*sY, sZ*cX, sZ*sX*cY - cZ*sY };
+	CVector3 localZ = { cX*sY, -sX, cX*cY };
+
 	if (KeyHeld(moveRight))
 	{
-		mPosition.x += MOVEMENT_SPEED * frameTime * mWorldMatrix.e00; // See comments on local movement in UpdateCube code above
-		mPosition.y += MOVEMENT_SPEED * frameTime * mWorldMatrix.e01; 
-		mPosition.z += MOVEMENT_SPEED * frameTime * mWorldMatrix.e02; 
+		mPosition += localX * MOVEMENT_SPEED * frameTime; // See comments on local movement in UpdateCube code above
 	}
 	if (KeyHeld(moveLeft))
 	{
-		mPosition.x -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e00;
-		mPosition.y -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e01;
-		mPosition.z -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e02;
+		mPosition -= localX * MOVEMENT_SPEED * frameTime;
 	}
 	if (KeyHeld(moveForward))
 	{
-		mPosition.x += MOVEMENT_SPEED * frameTime * mWorldMatrix.e20;
-		mPosition.y += MOVEMENT_SPEED * frameTime * mWorldMatrix.e21;
-		mPosition.z += MOVEMENT_SPEED * frameTime * mWorldMatrix.e22;
+		mPosition += localZ * MOVEMENT_SPEED * frameTime;
 	}
 	if (KeyHeld(moveBackward))
 	{
-		mPosition.x -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e20;
-		mPosition.y -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e21;
-		mPosition.z -= MOVEMENT_SPEED * frameTime * mWorldMatrix.e22;
+		mPosition -= localZ * MOVEMENT_SPEED * frameTime;
 	}
 }
 
 
-// Update the matrices used for the camera in the rendering pipeline
+// Update the matrices used for the camera in the rendering pipeline, only those affected by changes since the last update
 void Camera::UpdateMatrices()
 {
-    // "World" matrix for the camera - treat it like a model at first
-    mWorldMatrix = MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
+    if (!mViewDirty && !mProjectionDirty)  return;
 
-    // View matrix is the usual matrix used for the camera in shaders, it is the inverse of the world matrix (see lectures)
-    mViewMatrix = InverseAffine(mWorldMatrix);
+    if (mViewDirty)
+    {
+        // "World" matrix for the camera - treat it like a model at first
+        mWorldMatrix = MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
 
-    // Projection matrix, how to flatten the 3D world onto the screen (needs field of view, near and far clip, aspect ratio)
-    float tanFOVx = std::tan(mFOVx * 0.5f);
-    float scaleX = 1.0f / tanFOVx;
-    float scaleY = mAspectRatio / tanFOVx;
-    float scaleZa = mFarClip / (mFarClip - mNearClip);
-    float scaleZb = -mNearClip * scaleZa;
+        // View matrix is the usual matrix used for the camera in shaders, it is the inverse of the world matrix (see lectures)
+        mViewMatrix = InverseAffine(mWorldMatrix);
 
-    mProjectionMatrix = CMatrix4x4{ scaleX,   0.0f,    0.0f,   0.0f,
-                                      0.0f, scaleY,    0.0f,   0.0f,
-                                      0.0f,   0.0f, scaleZa,   1.0f,
-                                      0.0f,   0.0f, scaleZb,   0.0f };
+        mViewDirty = false;
+        ++mNumViewUpdates;
+        ++gFrameStats.cameraViewUpdates;
+    }
+
+    if (mProjectionDirty)
+    {
+        // Projection matrix, how to flatten the 3D world onto the screen (needs field of view, near and far clip, aspect ratio)
+        float tanFOVx = std::tan(mFOVx * 0.5f);
+        float scaleX = 1.0f / tanFOVx;
+        float scaleY = mAspectRatio / tanFOVx;
+        float scaleZa = mFarClip / (mFarClip - mNearClip);
+        float scaleZb = -mNearClip * scaleZa;
+
+        mProjectionMatrix = CMatrix4x4{ scaleX,   0.0f,    0.0f,   0.0f,
+                                          0.0f, scaleY,    0.0f,   0.0f,
+                                          0.0f,   0.0f, scaleZa,   1.0f,
+                                          0.0f,   0.0f, scaleZb,   0.0f };
+
+        mProjectionDirty = false;
+        ++mNumProjectionUpdates;
+        ++gFrameStats.cameraProjectionUpdates;
+    }
 
     // The view-projection matrix combines the two matrices usually used for the camera into one, which can save a multiply in the shaders (optional)
     mViewProjectionMatrix = mViewMatrix * mProjectionMatrix;
+
+    // The frustum planes come straight from the view-projection matrix so also change whenever it does
+    mFrustum = FrustumFromMatrix(mViewProjectionMatrix);
 }
 
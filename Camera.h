@@ -2,11 +2,14 @@
 // Class encapsulating a camera
 //--------------------------------------------------------------------------------------
 // Holds position, rotation, near/far clip and field of view. These to a view and projection matrices as required
+// The view matrix is only recalculated after the position or rotation change, and the projection matrix only after
+// the field of view, aspect ratio or clip distances change. So reading the matrices many times in a frame is cheap
 
 #include "Common.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
 #include "MathHelpers.h"
+#include "Frustum.h"
 #include "Input.h"
 
 #ifndef _CAMERA_H_INCLUDED_
@@ -40,28 +43,37 @@ public:
 	// Getters / setters
 	CVector3 Position()  { return mPosition; }
 	CVector3 Rotation()  { return mRotation;	}
-	void SetPosition(CVector3 position)  { mPosition = position; }
-	void SetRotation(CVector3 rotation)  { mRotation = rotation; }
+	void SetPosition(CVector3 position)  { mPosition = position;  mViewDirty = true; }
+	void SetRotation(CVector3 rotation)  { mRotation = rotation;  mViewDirty = true; }
 
-	float FOV()       { return mFOVx;     }
-	float NearClip()  { return mNearClip; }
-	float FarClip()   { return mFarClip;  }
+	float FOV()          { return mFOVx;        }
+	float AspectRatio()  { return mAspectRatio; }
+	float NearClip()     { return mNearClip;    }
+	float FarClip()      { return mFarClip;     }
 
-	void SetFOV     (float fov     )  { mFOVx     = fov;      }
-	void SetNearClip(float nearClip)  { mNearClip = nearClip; }
-	void SetFarClip (float farClip )  { mFarClip  = farClip;  }
+	void SetFOV        (float fov        )  { mFOVx        = fov;          mProjectionDirty = true; }
+	void SetAspectRatio(float aspectRatio)  { mAspectRatio = aspectRatio;  mProjectionDirty = true; }
+	void SetNearClip   (float nearClip   )  { mNearClip    = nearClip;     mProjectionDirty = true; }
+	void SetFarClip    (float farClip    )  { mFarClip     = farClip;      mProjectionDirty = true; }
 
-	// Read only access to camera matrices, updated on request from position, rotation and camera settings
+	// Read only access to camera matrices, updated on request from position, rotation and camera settings if they have changed
 	CMatrix4x4 ViewMatrix()            { UpdateMatrices(); return mViewMatrix;           }
 	CMatrix4x4 ProjectionMatrix()      { UpdateMatrices(); return mProjectionMatrix;     }
 	CMatrix4x4 ViewProjectionMatrix()  { UpdateMatrices(); return mViewProjectionMatrix; }
 
+	// The volume the camera can see in world space, updated along with the matrices. Used to skip rendering models the camera can't see
+	const Frustum& ViewFrustum()  { UpdateMatrices(); return mFrustum; }
+
+	// Number of times the view and projection matrices have been recalculated since the camera was created
+	int NumViewUpdates()        { return mNumViewUpdates;       }
+	int NumProjectionUpdates()  { return mNumProjectionUpdates; }
+
 	
 //-------------------------------------
 // Private members
 //-------------------------------------
 private:
-	// Update the matrices used for the camera in the rendering pipeline
+	// Update the matrices used for the camera in the rendering pipeline, only those affected by changes since the last update
 	void UpdateMatrices();
 
 	// Postition and rotations for the camera (rarely scale cameras)
@@ -82,6 +94,16 @@ private:
 	CMatrix4x4 mProjectionMatrix;     // Projection matrix holds the field of view and near/far clip distances
 	CMatrix4x4 mViewProjectionMatrix; // Combine (multiply) the view and projection matrices together, which
 	                                  // can sometimes save a matrix multiply in the shader (optional)
+
+	Frustum mFrustum; // World space planes around the visible volume, taken from the view-projection matrix
+
+	// Dirty flags - set when the values the matrices are built from change. Either one also means the
+	// view-projection matrix must be rebuilt
+	bool mViewDirty       = true; // World and view matrices
+	bool mProjectionDirty = true; // Projection matrix
+
+	int mNumViewUpdates       = 0;
+	int mNumProjectionUpdates = 0;
 };
 
 
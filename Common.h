@@ -4,12 +4,15 @@
 #ifndef _COMMON_H_INCLUDED_
 #define _COMMON_H_INCLUDED_
 
-#define NOMINMAX 
+#ifdef _WIN32
+    #define NOMINMAX 
 
-#include <windows.h>
-#include <d3d11.h>
+    #include <windows.h>
+    #include <d3d11.h>
+#endif
 #include <string>
 
+#include "Renderer.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
 
@@ -19,20 +22,22 @@
 //--------------------------------------------------------------------------------------
 // Make global Variables from various files available to other files.
 
-// Windows variables
-extern HWND gHWnd;
-
 // Viewport size
 extern int gViewportWidth;
 extern int gViewportHeight;
 
+#ifdef _WIN32
+// Windows variables
+extern HWND gHWnd;
 
-// Important DirectX variables
+// Important DirectX variables. Only the Direct3D renderer (RendererD3D11.cpp) should use these, the
+// rest of the app renders through gRenderDevice and gRenderContext (Renderer.h)
 extern ID3D11Device*           gD3DDevice;
 extern ID3D11DeviceContext*    gD3DContext;
 extern IDXGISwapChain*         gSwapChain;
 extern ID3D11RenderTargetView* gBackBufferRenderTarget;  
 extern ID3D11DepthStencilView* gDepthStencil;            
+#endif
 
 // Input constsnts
 extern const float ROTATION_SPEED;
@@ -43,6 +48,18 @@ extern const float MOVEMENT_SPEED;
 extern std::string gLastError;
 
 
+//--------------------------------------------------------------------------------------
+// Platform functions
+//--------------------------------------------------------------------------------------
+// Defined by the program's entry point (Main.cpp for the app, or the SceneBench tool when running headless)
+
+// Show the given text in the title bar of the app window
+void SetWindowTitle(const std::string& title);
+
+// Write a line of text to the debugger output or console
+void DebugMessage(const std::string& message);
+
+
 
 //--------------------------------------------------------------------------------------
 // Constant Buffers
@@ -51,13 +68,9 @@ extern std::string gLastError;
 
 // Per Frame Buffers
 // Must match the hlsli file
+// Lighting, the same for every camera so only sent once per frame
 struct PerFrameConstants
 {
-    // These are the matrices used to position the camera
-    CMatrix4x4 viewMatrix;
-    CMatrix4x4 projectionMatrix;
-    CMatrix4x4 viewProjectionMatrix; // The above two matrices multiplied together to combine their effects
-
     CVector3   light1Position; 
     float      padding1;      
     CVector3   light1Colour;
@@ -71,14 +84,27 @@ struct PerFrameConstants
 
     CVector3   ambientColour;
     float      specularPower; 
+};
+
+extern PerFrameConstants gPerFrameConstants;      // This variable holds the CPU-side constant buffer described above
+extern GpuBuffer*        gPerFrameConstantBuffer; // This variable controls the GPU-side constant buffer matching to the above structure
+
+
+
+// Per View Buffers
+// Must match the hlsli file
+// Camera settings, one set for each camera the scene is rendered from each frame (see Scene.cpp)
+struct PerViewConstants
+{
+    // These are the matrices used to position the camera
+    CMatrix4x4 viewMatrix;
+    CMatrix4x4 projectionMatrix;
+    CMatrix4x4 viewProjectionMatrix; // The above two matrices multiplied together to combine their effects
 
     CVector3   cameraPosition;
     float      padding5;
 };
 
-extern PerFrameConstants gPerFrameConstants;      // This variable holds the CPU-side constant buffer described above
-extern ID3D11Buffer*     gPerFrameConstantBuffer; // This variable controls the GPU-side constant buffer matching to the above structure
-
 
 
 // Per Model Buffers
@@ -91,7 +117,20 @@ struct PerModelConstants
     float      textureShiftFactor;
 };
 extern PerModelConstants gPerModelConstants;      // This variable holds the CPU-side constant buffer described above
-extern ID3D11Buffer*     gPerModelConstantBuffer; // This variable controls the GPU-side constant buffer related to the above structure
+extern GpuBuffer*        gPerModelConstantBuffer; // This variable controls the GPU-side constant buffer related to the above structure
+
+
+
+// Per Mesh Buffers
+// Must match the hlsli file
+// Only meshes with quantized vertices have these (see MeshQuantization.h), each holds its own constant buffer
+struct PerMeshConstants
+{
+    CVector3   positionScale;  // Quantized positions (0 to 1) are multiplied by this...
+    float      padding7;
+    CVector3   positionOffset; // ...then this is added to give the position in model space
+    float      padding8;
+};
 
 
 #endif //_COMMON_H_INCLUDED_
@@ -11,6 +11,28 @@ struct BasicVertex
 };
 
 
+// Vertex data of a mesh with quantized vertices (see MeshQuantization.h). The GPU converts each value to floats as it
+// reads it, but the position and normal still need unpacking, use DequantizePosition and DecodeOctahedral below
+struct QuantizedVertex
+{
+    float3 position : position; // 0 to 1 across the mesh's bounding box on each axis
+    float2 normal   : normal;   // Octahedral encoding of the normal
+    float2 uv       : uv;       // Stored as half floats, needs no unpacking
+};
+
+
+// Per-instance data for instanced rendering, read from a second vertex buffer alongside each vertex. Must match
+// InstanceData in Renderer.h. The world matrix arrives as its four rows, use InstanceWorldMatrix below to rebuild it
+struct InstanceData
+{
+    float4 worldRow0 : InstanceWorld0;
+    float4 worldRow1 : InstanceWorld1;
+    float4 worldRow2 : InstanceWorld2;
+    float4 worldRow3 : InstanceWorld3;
+    float3 colour    : InstanceColour;
+};
+
+
 // This structure describes what data the lighting pixel shader receives from the vertex shader.
 struct LightingPixelShaderInput
 {
@@ -29,6 +51,7 @@ struct SimplePixelShaderInput
 {
     float4 projectedPosition : SV_Position;
     float2 uv : uv;
+    float3 colour : colour; // Object colour, from the per-model constants or the instance data
 };
 
 
@@ -38,12 +61,9 @@ struct SimplePixelShaderInput
 
 // Per Frame Buffers
 // These variables must match exactly the gPerFrameConstants structure in Scene.cpp
+// Lighting, the same for every camera
 cbuffer PerFrameConstants : register(b0)
 {
-    float4x4 gViewMatrix;
-    float4x4 gProjectionMatrix;
-    float4x4 gViewProjectionMatrix; // The above two matrices multiplied together to combine their effects
-
     float3   gLight1Position; 
     float    padding1;        
 
@@ -58,10 +78,31 @@ cbuffer PerFrameConstants : register(b0)
 
     float3   gAmbientColour;
     float    gSpecularPower; 
+}
+
+// Per View Buffers
+// These variables must match exactly the PerViewConstants structure in Common.h
+// Camera settings for the camera currently being rendered from
+cbuffer PerViewConstants : register(b2)
+{
+    float4x4 gViewMatrix;
+    float4x4 gProjectionMatrix;
+    float4x4 gViewProjectionMatrix; // The above two matrices multiplied together to combine their effects
 
     float3   gCameraPosition;
     float    padding5;
 }
+// Per Mesh Buffers
+// These variables must match exactly the PerMeshConstants structure in Common.h
+// Only set for meshes with quantized vertices, used by DequantizePosition below
+cbuffer PerMeshConstants : register(b3)
+{
+    float3   gPositionScale;
+    float    padding7;
+    float3   gPositionOffset;
+    float    padding8;
+}
+
 // Note constant buffers are not structs: we don't use the name of the constant buffer, these are really just a collection of global variables (hence the 'g')
 
 
@@ -75,3 +116,33 @@ cbuffer PerModelConstants : register(b1)
     float    padding6; 
     float    textureShiftFactor; // shift factor passed here
 }
+
+
+//--------------------------------------------------------------------------------------
+// Helper functions
+//--------------------------------------------------------------------------------------
+
+// Returns the world matrix of an instance. The rows are the rows of the C++ matrix, so use it as mul(vector, matrix),
+// the opposite order to gWorldMatrix above, which is transposed when sent in the constant buffer
+float4x4 InstanceWorldMatrix(InstanceData instance)
+{
+    return float4x4(instance.worldRow0, instance.worldRow1, instance.worldRow2, instance.worldRow3);
+}
+
+
+// Returns the model space position of a QuantizedVertex, using the current mesh's PerMeshConstants
+float3 DequantizePosition(float3 quantizedPosition)
+{
+    return quantizedPosition * gPositionScale + gPositionOffset;
+}
+
+
+// Returns the unit vector stored in two values by octahedral encoding (see MeshQuantization.h). The values outside the
+// inner diamond are the lower half of the sphere, folded out over the corners, so fold them back
+float3 DecodeOctahedral(float2 encoded)
+{
+    float3 direction = float3(encoded, 1 - abs(encoded.x) - abs(encoded.y));
+    float fold = saturate(-direction.z);
+    direction.xy += (direction.xy >= 0) ? -fold : fold;
+    return normalize(direction);
+}
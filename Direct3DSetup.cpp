@@ -1,9 +1,10 @@
 //--------------------------------------------------------------------------------------
-// Initialisation of Direct3D and main resources (textures, shaders etc.)
+// Initialisation of Direct3D and the Direct3D renderer
 //--------------------------------------------------------------------------------------
 
 #include "Direct3DSetup.h"
-#include "Shader.h"
+#include "RendererD3D11.h"
+#include "State.h"
 #include "Common.h"
 #include <d3d11.h>
 #include <vector>
@@ -26,6 +27,10 @@ ID3D11RenderTargetView* gBackBufferRenderTarget = nullptr;
 ID3D11Texture2D*        gDepthStencilTexture = nullptr; // The texture holding the depth values
 ID3D11DepthStencilView* gDepthStencil        = nullptr; // The depth buffer referencing above texture
 
+// The renderer used by the rest of the app (see Renderer.h), created here using the Direct3D objects above
+RenderDevice*  gRenderDevice  = nullptr;
+RenderContext* gRenderContext = nullptr;
+
 
 
 //--------------------------------------------------------------------------------------
@@ -116,6 +121,19 @@ bool InitDirect3D()
         gLastError = "Error creating depth buffer view";
         return false;
     }
+
+
+    //// Create the renderer used by the rest of the app ////
+
+    // Create all filtering modes, blending modes etc. used by the app, the renderer selects them from these
+    if (!CreateStates())
+    {
+        gLastError = "Error creating states";
+        return false;
+    }
+
+    gRenderDevice  = new D3D11RenderDevice();
+    gRenderContext = new D3D11RenderContext(gD3DContext);
     
     return true;
 }
@@ -127,6 +145,10 @@ void ShutdownDirect3D()
     // Release each Direct3D object to return resources to the system. Missing these out will cause memory
     // leaks. Check documentation to see which objects need to be released when adding new features in your
     // own projects.
+    delete gRenderContext;  gRenderContext = nullptr;
+    delete gRenderDevice;   gRenderDevice  = nullptr;
+    ReleaseStates();
+
     if (gD3DContext)
     {
         gD3DContext->ClearState(); // This line is also needed to reset the GPU before shutting down DirectX
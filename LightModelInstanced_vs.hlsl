@@ -0,0 +1,32 @@
+//--------------------------------------------------------------------------------------
+// Light Model Vertex Shader - Instanced
+//--------------------------------------------------------------------------------------
+// Same as LightModel_vs.hlsl, but the world matrix and colour come from the instance data rather than the
+// per-model constant buffer, so all the lights can be drawn with one draw call. Used with LightModel_ps.hlsl
+
+#include "Common.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// Vertex shader main function
+SimplePixelShaderInput main(BasicVertex modelVertex, InstanceData instance)
+{
+    SimplePixelShaderInput output; // This is the data the pixel shader requires from this vertex shader
+
+    // Input position
+    float4 modelPosition = float4(modelVertex.position, 1); 
+
+    // Matrices - note the world matrix is used the other way round from gWorldMatrix (see InstanceWorldMatrix)
+    float4 worldPosition     = mul(modelPosition,     InstanceWorldMatrix(instance));
+    float4 viewPosition      = mul(gViewMatrix,       worldPosition);
+    output.projectedPosition = mul(gProjectionMatrix, viewPosition);
+
+    // Pass texture coordinates (UVs) and the instance's colour on to the pixel shader
+    output.uv     = modelVertex.uv;
+    output.colour = instance.colour;
+
+    return output; // Output data sent down the pipeline (to the pixel shader)
+}
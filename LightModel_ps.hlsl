@@ -28,7 +28,7 @@ float4 main(SimplePixelShaderInput input) : SV_Target
     float3 diffuseMapColour = DiffuseMap.Sample(TexSampler, input.uv).rgb;
 
     // Blend texture colour with fixed per-object colour
-    float3 finalColour = gObjectColour * diffuseMapColour;
+    float3 finalColour = input.colour * diffuseMapColour;
 
     return float4(finalColour, 1.0f); 
 }
\ No newline at end of file
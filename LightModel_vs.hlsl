@@ -25,5 +25,8 @@ SimplePixelShaderInput main(BasicVertex modelVertex)
     // Pass texture coordinates (UVs) on to the pixel shader, the vertex shader doesn't need them
     output.uv = modelVertex.uv;
 
+    // Pass the per-model colour on as well, so the pixel shader works for both this and the instanced shader
+    output.colour = gObjectColour;
+
     return output; // Output data sent down the pipeline (to the pixel shader)
 }
@@ -4,6 +4,44 @@
 
 #include "CMatrix4x4.h"
 
+#ifdef CMATRIX4X4_SSE
+#include <immintrin.h>
+
+
+/*-----------------------------------------------------------------------------------------
+    SIMD helpers
+-----------------------------------------------------------------------------------------*/
+// Each matrix row is one SIMD register of four floats. The SIMD code does the same multiplies and adds in the
+// same order as the scalar code (just four at a time), so the results match the scalar versions
+
+namespace
+{
+    // Cross product of the x,y,z parts of two registers, w of the result is 0 for finite inputs
+    __m128 CrossSIMD(__m128 a, __m128 b)
+    {
+        __m128 aYZX = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+        __m128 bZXY = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+        __m128 aZXY = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+        __m128 bYZX = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+        return _mm_sub_ps(_mm_mul_ps(aYZX, bZXY), _mm_mul_ps(aZXY, bYZX));
+    }
+
+    // Returns x*row0 + y*row1 + z*row2 (+ row3 if given) as a CVector3
+    CVector3 TransformSIMD(const CMatrix4x4& m, const CVector3& v, bool translate)
+    {
+        const float* elts = &m.e00;
+        __m128 result =                   _mm_mul_ps(_mm_set1_ps(v.x), _mm_loadu_ps(elts + 0));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(v.y), _mm_loadu_ps(elts + 4)));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_set1_ps(v.z), _mm_loadu_ps(elts + 8)));
+        if (translate)  result = _mm_add_ps(result, _mm_loadu_ps(elts + 12));
+
+        float out[4];
+        _mm_storeu_ps(out, result);
+        return CVector3(out);
+    }
+}
+#endif
+
 /*-----------------------------------------------------------------------------------------
     Member functions
 -----------------------------------------------------------------------------------------*/
@@ -79,8 +117,19 @@ CMatrix4x4& CMatrix4x4::operator*=(const CMatrix4x4& m)
     Operators
 -----------------------------------------------------------------------------------------*/
 
-// Matrix-matrix multiplication
+// Matrix-matrix multiplication. Always the plain C++ version, see CMatrix4x4.h
 CMatrix4x4 operator*(const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+    return MultiplyScalar(m1, m2);
+}
+
+
+/*-----------------------------------------------------------------------------------------
+  Scalar reference versions
+-----------------------------------------------------------------------------------------*/
+
+// Matrix-matrix multiplication, plain C++ version
+CMatrix4x4 MultiplyScalar(const CMatrix4x4& m1, const CMatrix4x4& m2)
 {
     CMatrix4x4 mOut;
 
@@ -195,6 +244,56 @@ CMatrix4x4 MatrixScaling(const float s)
 // Return the inverse of given matrix assuming that it is an affine matrix
 // Advanced calulation needed to get the view matrix from the camera's positioning matrix
 CMatrix4x4 InverseAffine(const CMatrix4x4& m)
+{
+#ifdef CMATRIX4X4_SSE
+    const float* elts = &m.e00;
+    __m128 row0 = _mm_loadu_ps(elts + 0);
+    __m128 row1 = _mm_loadu_ps(elts + 4);
+    __m128 row2 = _mm_loadu_ps(elts + 8);
+    __m128 row3 = _mm_loadu_ps(elts + 12);
+
+    // The columns of the inverse of the upper left 3x3 are cross products of its rows, divided by the determinant
+    __m128 column0 = CrossSIMD(row1, row2);
+    __m128 column1 = CrossSIMD(row2, row0);
+    __m128 column2 = CrossSIMD(row0, row1);
+
+    // Determinant is the dot product of row 0 with its cross product column
+    float det0[4], row0Elts[4];
+    _mm_storeu_ps(det0, column0);
+    _mm_storeu_ps(row0Elts, row0);
+    float det = row0Elts[0]*det0[0] + row0Elts[1]*det0[1] + row0Elts[2]*det0[2];
+
+    __m128 invDet = _mm_set1_ps(1.0f / det);
+    column0 = _mm_mul_ps(invDet, column0);
+    column1 = _mm_mul_ps(invDet, column1);
+    column2 = _mm_mul_ps(invDet, column2);
+
+    // Transpose the columns into rows. The fourth column becomes 0 (from the zero register)
+    __m128 unused = _mm_setzero_ps();
+    _MM_TRANSPOSE4_PS(column0, column1, column2, unused);
+
+    // Transform negative translation by inverted 3x3 to get inverse
+    __m128 negRow3 = _mm_xor_ps(row3, _mm_set1_ps(-0.0f)); // Flip sign bits
+    __m128 translation =                        _mm_mul_ps(_mm_shuffle_ps(negRow3, negRow3, 0x00), column0);
+    translation = _mm_sub_ps(translation, _mm_mul_ps(_mm_shuffle_ps(row3, row3, 0x55), column1));
+    translation = _mm_sub_ps(translation, _mm_mul_ps(_mm_shuffle_ps(row3, row3, 0xAA), column2));
+
+    CMatrix4x4 mOut;
+    float* out = &mOut.e00;
+    _mm_storeu_ps(out + 0, column0);
+    _mm_storeu_ps(out + 4, column1);
+    _mm_storeu_ps(out + 8, column2);
+    _mm_storeu_ps(out + 12, translation);
+    mOut.e33 = 1.0f;
+    return mOut;
+#else
+    return InverseAffineScalar(m);
+#endif
+}
+
+
+// Return the inverse of given affine matrix, plain C++ version
+CMatrix4x4 InverseAffineScalar(const CMatrix4x4& m)
 {
     CMatrix4x4 mOut;
 
@@ -233,6 +332,44 @@ CMatrix4x4 InverseAffine(const CMatrix4x4& m)
 }
 
 
+// Transform a point by the given matrix (the point is treated as having w = 1, so it is translated)
+CVector3 TransformPoint(const CMatrix4x4& m, const CVector3& p)
+{
+#ifdef CMATRIX4X4_SSE
+    return TransformSIMD(m, p, true);
+#else
+    return TransformPointScalar(m, p);
+#endif
+}
+
+// Transform a direction vector by the given matrix (the vector is treated as having w = 0, so it is not translated)
+CVector3 TransformVector(const CMatrix4x4& m, const CVector3& v)
+{
+#ifdef CMATRIX4X4_SSE
+    return TransformSIMD(m, v, false);
+#else
+    return TransformVectorScalar(m, v);
+#endif
+}
+
+
+// Transform a point by the given matrix, plain C++ version
+CVector3 TransformPointScalar(const CMatrix4x4& m, const CVector3& p)
+{
+    return { p.x*m.e00 + p.y*m.e10 + p.z*m.e20 + m.e30,
+             p.x*m.e01 + p.y*m.e11 + p.z*m.e21 + m.e31,
+             p.x*m.e02 + p.y*m.e12 + p.z*m.e22 + m.e32 };
+}
+
+// Transform a direction vector by the given matrix, plain C++ version
+CVector3 TransformVectorScalar(const CMatrix4x4& m, const CVector3& v)
+{
+    return { v.x*m.e00 + v.y*m.e10 + v.z*m.e20,
+             v.x*m.e01 + v.y*m.e11 + v.z*m.e21,
+             v.x*m.e02 + v.y*m.e12 + v.z*m.e22 };
+}
+
+
 // Make this matrix an affine 3D transformation matrix to face from current position to given target (in the Z direction)
 // Will retain the matrix's current scaling
 void CMatrix4x4::FaceTarget(const CVector3& target)
@@ -10,6 +10,16 @@
 #include <cmath>
 
 
+// Affine inverse and vector transforms use SSE wherever the compiler targets it (always on x64, and on x86 with
+// /arch:SSE2 - the default). Define CMATRIX4X4_NO_SIMD to use only the plain C++ versions. The plain versions are
+// always available (the ...Scalar functions at the end of this file) as a reference to check the SIMD code against.
+// Matrix multiply stays plain C++: the compiler already turns it into the same SIMD instructions, and the hand
+// written SIMD version measured no faster (Tools/MathBench keeps that version and times the two against each other)
+#if !defined(CMATRIX4X4_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define CMATRIX4X4_SSE
+#endif
+
+
 // Matrix class
 class CMatrix4x4
 {
@@ -99,4 +109,24 @@ CMatrix4x4 MatrixScaling(const float s);
 CMatrix4x4 InverseAffine(const CMatrix4x4& m);
 
 
+// Transform a point by the given matrix (the point is treated as having w = 1, so it is translated)
+CVector3 TransformPoint(const CMatrix4x4& m, const CVector3& p);
+
+// Transform a direction vector by the given matrix (the vector is treated as having w = 0, so it is not translated)
+CVector3 TransformVector(const CMatrix4x4& m, const CVector3& v);
+
+
+/*-----------------------------------------------------------------------------------------
+  Scalar reference versions
+-----------------------------------------------------------------------------------------*/
+// Plain C++ versions of the functions above that have SIMD code. The functions above use these
+// when SIMD is not available. Otherwise they are only used to test and time the SIMD versions.
+// operator* always uses MultiplyScalar
+
+CMatrix4x4 MultiplyScalar(const CMatrix4x4& m1, const CMatrix4x4& m2);
+CMatrix4x4 InverseAffineScalar(const CMatrix4x4& m);
+CVector3   TransformPointScalar(const CMatrix4x4& m, const CVector3& p);
+CVector3   TransformVectorScalar(const CMatrix4x4& m, const CVector3& v);
+
+
 #endif // _CMATRIX4X4_H_DEFINED_
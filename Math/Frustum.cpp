@@ -0,0 +1,121 @@
+//--------------------------------------------------------------------------------------
+// View frustum and visibility tests
+//--------------------------------------------------------------------------------------
+
+#include "Frustum.h"
+
+#ifdef CMATRIX4X4_SSE
+#include <immintrin.h>
+#endif
+
+
+/*-----------------------------------------------------------------------------------------
+    Frustum creation
+-----------------------------------------------------------------------------------------*/
+
+// Returns the frustum for the given view-projection matrix (Direct3D conventions: row vectors, clip z from 0 to 1)
+Frustum FrustumFromMatrix(const CMatrix4x4& m)
+{
+    // A point p transforms to clip space as (x, y, z, w) = p * m, so each clip coordinate is p dotted with one column
+    // of the matrix. The point is inside the frustum when -w <= x <= w, -w <= y <= w and 0 <= z <= w. Each of these
+    // six tests can be rearranged to a plane equation built by adding or subtracting columns of the matrix
+    CVector3 column0 = { m.e00, m.e10, m.e20 };  float d0 = m.e30;
+    CVector3 column1 = { m.e01, m.e11, m.e21 };  float d1 = m.e31;
+    CVector3 column2 = { m.e02, m.e12, m.e22 };  float d2 = m.e32;
+    CVector3 column3 = { m.e03, m.e13, m.e23 };  float d3 = m.e33;
+
+    Frustum frustum;
+    frustum.planes[Frustum::Left]   = { column3 + column0, d3 + d0 }; // x >= -w
+    frustum.planes[Frustum::Right]  = { column3 - column0, d3 - d0 }; // x <=  w
+    frustum.planes[Frustum::Bottom] = { column3 + column1, d3 + d1 }; // y >= -w
+    frustum.planes[Frustum::Top]    = { column3 - column1, d3 - d1 }; // y <=  w
+    frustum.planes[Frustum::Near]   = { column2,           d2      }; // z >=  0
+    frustum.planes[Frustum::Far]    = { column3 - column2, d3 - d2 }; // z <=  w
+
+    // Normalise the planes so the plane equation gives true distances, needed to compare against a sphere radius
+    for (auto& plane : frustum.planes)
+    {
+        float length = Length(plane.normal);
+        if (length > 0)
+        {
+            plane.normal = plane.normal * (1.0f / length);
+            plane.d /= length;
+        }
+    }
+
+    return frustum;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+    Visibility tests
+-----------------------------------------------------------------------------------------*/
+
+// Returns false if the given sphere is entirely outside the frustum
+bool SphereInFrustum(const Frustum& frustum, const CVector3& centre, float radius)
+{
+    for (auto& plane : frustum.planes)
+    {
+        // Distance of the centre from the plane, negative if outside. Outside by more than the radius means the whole sphere is
+        float distance = plane.normal.x * centre.x + plane.normal.y * centre.y + plane.normal.z * centre.z + plane.d;
+        if (distance < -radius)  return false;
+    }
+    return true;
+}
+
+
+// Returns false if the given axis-aligned box is entirely outside the frustum
+bool AABBInFrustum(const Frustum& frustum, const CVector3& boxMin, const CVector3& boxMax)
+{
+    for (auto& plane : frustum.planes)
+    {
+        // Test the corner of the box furthest along the plane normal - if that is outside, the whole box is
+        CVector3 corner = { plane.normal.x >= 0 ? boxMax.x : boxMin.x,
+                            plane.normal.y >= 0 ? boxMax.y : boxMin.y,
+                            plane.normal.z >= 0 ? boxMax.z : boxMin.z };
+        if (plane.normal.x * corner.x + plane.normal.y * corner.y + plane.normal.z * corner.z + plane.d < 0)  return false;
+    }
+    return true;
+}
+
+
+// Test many spheres at once, setting visible[i] to 1 if sphere i may be visible or 0 if it is entirely outside
+void SpheresInFrustum(const Frustum& frustum, const float* centreX, const float* centreY, const float* centreZ,
+                      const float* radius, int count, uint8_t* visible)
+{
+    int i = 0;
+
+#ifdef CMATRIX4X4_SSE
+    // Four spheres at a time, one per SIMD lane. Each plane is tested against all four spheres, the same
+    // sums in the same order as SphereInFrustum
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(centreX + i);
+        __m128 y = _mm_loadu_ps(centreY + i);
+        __m128 z = _mm_loadu_ps(centreZ + i);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radius + i));
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1)); // All lanes start visible
+        for (auto& plane : frustum.planes)
+        {
+            __m128 distance = _mm_mul_ps(_mm_set1_ps(plane.normal.x), x);
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.normal.y), y));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.normal.z), z));
+            distance = _mm_add_ps(distance, _mm_set1_ps(plane.d));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+        }
+
+        int mask = _mm_movemask_ps(inside); // One bit per lane
+        visible[i    ] =  mask       & 1;
+        visible[i + 1] = (mask >> 1) & 1;
+        visible[i + 2] = (mask >> 2) & 1;
+        visible[i + 3] = (mask >> 3) & 1;
+    }
+#endif
+
+    // Remaining spheres (or all of them without SIMD)
+    for (; i < count; ++i)
+    {
+        visible[i] = SphereInFrustum(frustum, { centreX[i], centreY[i], centreZ[i] }, radius[i]) ? 1 : 0;
+    }
+}
@@ -0,0 +1,61 @@
+//--------------------------------------------------------------------------------------
+// View frustum and visibility tests
+//--------------------------------------------------------------------------------------
+// Code in .cpp file
+//
+// The frustum is the volume a camera can see - a pyramid with its top cut off, bounded by six planes. A model
+// whose bounding volume is entirely outside any one of the planes cannot be seen and does not need rendering.
+//
+// The planes are taken directly from a view-projection matrix (Gribb & Hartmann's method). A point p is
+// inside a plane when Dot(normal, p) + d >= 0, so the normals all point into the frustum.
+
+#ifndef _FRUSTUM_H_DEFINED_
+#define _FRUSTUM_H_DEFINED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include <cstdint>
+
+
+struct FrustumPlane
+{
+    CVector3 normal; // Unit length, points into the frustum
+    float    d;      // Distance of the plane from the origin along the normal (negated)
+};
+
+struct Frustum
+{
+    enum { Left, Right, Bottom, Top, Near, Far, NumPlanes };
+    FrustumPlane planes[NumPlanes];
+};
+
+
+/*-----------------------------------------------------------------------------------------
+    Frustum creation
+-----------------------------------------------------------------------------------------*/
+
+// Returns the frustum for the given view-projection matrix (Direct3D conventions: row vectors, clip z from 0 to 1)
+// If the matrix is just a projection matrix the frustum is in camera space, with a view-projection matrix it is in world space
+Frustum FrustumFromMatrix(const CMatrix4x4& viewProjection);
+
+
+/*-----------------------------------------------------------------------------------------
+    Visibility tests
+-----------------------------------------------------------------------------------------*/
+// These tests are conservative - a volume near a corner of the frustum may be reported visible when it is
+// just outside. They never report a visible volume as outside
+
+// Returns false if the given sphere is entirely outside the frustum
+bool SphereInFrustum(const Frustum& frustum, const CVector3& centre, float radius);
+
+// Returns false if the given axis-aligned box is entirely outside the frustum
+bool AABBInFrustum(const Frustum& frustum, const CVector3& boxMin, const CVector3& boxMax);
+
+// Test many spheres at once, setting visible[i] to 1 if sphere i may be visible or 0 if it is entirely outside.
+// Sphere data is passed as separate arrays of x, y and z centre coordinates and radii. Uses SSE to test four
+// spheres at a time when available (see CMatrix4x4.h), giving the same results as SphereInFrustum
+void SpheresInFrustum(const Frustum& frustum, const float* centreX, const float* centreY, const float* centreZ,
+                      const float* radius, int count, uint8_t* visible);
+
+
+#endif // _FRUSTUM_H_DEFINED_
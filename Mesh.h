@@ -2,14 +2,17 @@
 // Class encapsulating a mesh
 //--------------------------------------------------------------------------------------
 // The mesh class splits the mesh into sub-meshes that only use one texture each.
-// ** THIS VERSION WILL ONLY KEEP THE FIRST SUB-MESH OTHER PARTS WILL BE MISSING **
-// ** DO NOT USE THIS VERSION FOR PROJECTS **
+// All sub-meshes share one vertex buffer and one index buffer, so drawing the whole mesh
+// binds the buffers once and issues one draw call per sub-mesh.
 // The class also doesn't load textures, filters or shaders as the outer code is
 // expected to select these things. A later lab will introduce a more robust loader.
 
-#include "common.h"
+#include "Common.h"
+#include "CVector3.h"
+#include "MeshData.h"
 
 #include <string>
+#include <vector>
 
 #ifndef _MESH_H_INCLUDED_
 #define _MESH_H_INCLUDED_
@@ -18,26 +21,91 @@ class Mesh
 {
 public:
     // Pass the name of the mesh file to load. Uses assimp (http://www.assimp.org/) to support many file types
+    // After the first import the mesh is stored in a binary cache file and later runs load that instead (see MeshCache.h)
     // Optionally request tangents to be calculated (for normal and parallax mapping - see later lab)
+    // Optionally quantize the vertices to use less memory (see MeshQuantization.h). The mesh must then be drawn with a
+    // vertex shader that takes a QuantizedVertex (see Common.hlsli)
+    // Optionally split parts with too many vertices for 16-bit indices into clusters that aren't (see MeshClusters.h)
     // Will throw a std::runtime_error exception on failure (since constructors can't return errors).
-    Mesh(const std::string& fileName, bool requireTangents = false);
+    Mesh(const std::string& fileName, bool requireTangents = false, bool quantize = false, bool splitClusters = false);
+
+    // Create the mesh from data already loaded, e.g. by LoadMeshData on another thread (see AssetLoader.h). The name is
+    // only used in error messages. Only creates the GPU resources, so this part must run on the main thread. Mesh data
+    // from QuantizeMeshData gives a quantized mesh
+    Mesh(const MeshData& meshData, const std::string& name);
     ~Mesh();
 
     // The render function assumes shaders, matrices, textures, samplers etc. have been set up already.
-    // It simply draws this mesh with whatever settings the GPU is currently using.
-    void Render();
+    // It simply draws this mesh with whatever settings the GPU is currently using, sending the commands to the given
+    // render context (gRenderContext, or a deferred context when recording on another thread - see Renderer.h).
+    // Pass false for bindBuffers if this mesh was the last one drawn, its vertex and index buffers are still bound
+    void Render(RenderContext& context, bool bindBuffers = true);
+
+    // Draw a single sub-mesh, e.g. to select a different texture for each part before drawing it
+    void RenderSubMesh(RenderContext& context, unsigned int subMesh);
+
+    // Draw many copies of this mesh with one draw call per sub-mesh. Each copy uses its own InstanceData (world matrix
+    // and colour, see Renderer.h) from the given instance buffer, starting at firstInstance. An instanced vertex shader
+    // must be selected. Leaves the instanced vertex layout bound, so the next Render must bind buffers again
+    void RenderInstanced(RenderContext& context, GpuBuffer* instanceBuffer, unsigned int numInstances, unsigned int firstInstance = 0);
+
+    // Get the vertex layout used for instanced rendering now rather than on the first RenderInstanced. Call before the
+    // mesh is rendered on several threads at once, as getting the layout isn't safe from several threads
+    void PrepareInstancing();
+
+    unsigned int NumSubMeshes()  { return static_cast<unsigned int>(mSubMeshes.size()); }
+    const SubMesh& GetSubMesh(unsigned int subMesh)  { return mSubMeshes[subMesh]; }
+
+    // Size in bytes of the GPU-side vertex and index buffers
+    unsigned int GPUMemoryUsed()  { return mNumVertices * mVertexSize + IndexMemoryUsed(); }
+
+    // Size in bytes of the GPU-side index buffer, and the memory saved by using 16-bit indices if the mesh does
+    unsigned int IndexMemoryUsed()   { return mNumIndices * (mIndexFormat == IndexFormat::UInt16 ? 2 : 4); }
+    unsigned int IndexMemorySaved()  { return mNumIndices * 4 - IndexMemoryUsed(); }
+
+    // Axis-aligned bounding box of the mesh in model space
+    CVector3 BoundsMin()  { return mBoundsMin; }
+    CVector3 BoundsMax()  { return mBoundsMax; }
 
+    // Bounding sphere of the mesh in model space, centred on the bounding box. Used for visibility culling
+    CVector3 BoundingCentre()  { return mBoundingCentre; }
+    float    BoundingRadius()  { return mBoundingRadius; }
 
 private:
-    unsigned int       mVertexSize;             // Size in bytes of a single vertex (depends on what it contains, uvs, tangents etc.)
-    ID3D11InputLayout* mVertexLayout = nullptr; // DirectX specification of data held in a single vertex
+    // Bind the vertex and index buffers and input layout, shared by all sub-meshes
+    void BindBuffers(RenderContext& context);
+
+    // Bind the constants used to unpack quantized vertices, if this mesh has them
+    void BindConstants(RenderContext& context);
+
+    // Release the GPU buffers created so far. Used by the destructor, and by the constructor before it throws an
+    // exception, since the destructor isn't called then
+    void ReleaseBuffers();
+
+    unsigned int     mVertexSize;             // Size in bytes of a single vertex (depends on what it contains, uvs, tangents etc.)
+    GpuVertexLayout* mVertexLayout = nullptr; // Specification of data held in a single vertex, shared with other meshes and owned by the renderer
+    GpuVertexLayout* mInstancedVertexLayout = nullptr; // As above plus per-instance data, fetched on the first instanced render
+    std::vector<VertexElement> mVertexElements;       // Vertex description, kept to get the instanced layout
 
     // GPU-side vertex and index buffers
-    unsigned int       mNumVertices;
-    ID3D11Buffer*      mVertexBuffer = nullptr;
+    unsigned int     mNumVertices;
+    GpuBuffer*       mVertexBuffer = nullptr;
+
+    unsigned int     mNumIndices;
+    GpuBuffer*       mIndexBuffer  = nullptr;
+    IndexFormat      mIndexFormat  = IndexFormat::UInt32; // 16-bit whenever all the indices fit
+
+    // PerMeshConstants (see Common.h) to unpack the vertices in the shader, only for meshes with quantized vertices
+    GpuBuffer*       mConstantBuffer = nullptr;
+
+    // Index range of each part of the mesh within the buffers above
+    std::vector<SubMesh> mSubMeshes;
+
+    CVector3 mBoundsMin;
+    CVector3 mBoundsMax;
 
-    unsigned int       mNumIndices;
-    ID3D11Buffer*      mIndexBuffer  = nullptr;
+    CVector3 mBoundingCentre;
+    float    mBoundingRadius;
 };
 
 
@@ -0,0 +1,214 @@
+//--------------------------------------------------------------------------------------
+// Binary mesh cache
+//--------------------------------------------------------------------------------------
+// See MeshCache.h for a description of the file format
+
+#include "MeshCache.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <thread>
+#include <functional>
+#include <cstring>
+#include <cstdio>
+
+
+namespace
+{
+    const char     MESH_CACHE_MAGIC[4] = { 'M', 'S', 'H', 'C' };
+    const uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+    // Round up an offset to the alignment used for the data blocks in the file
+    uint64_t AlignOffset(uint64_t offset)
+    {
+        return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(MESH_CACHE_ALIGNMENT - 1);
+    }
+}
+
+
+// Returns the name of the cache file used for the given source mesh file imported with or without tangents
+std::string MeshCacheFileName(const std::string& sourceFileName, bool requireTangents)
+{
+    return sourceFileName + (requireTangents ? ".t1" : ".t0") + ".meshcache";
+}
+
+
+// Returns a 64-bit hash (FNV-1a) of the content of the given file
+// Will throw a std::runtime_error exception if the file cannot be read
+uint64_t HashFileContent(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary);
+    if (!file.is_open())  throw std::runtime_error("Cannot open file " + fileName);
+
+    uint64_t hash = HASH_START;
+    char block[64 * 1024];
+    while (file)
+    {
+        file.read(block, sizeof(block));
+        hash = HashData(block, static_cast<size_t>(file.gcount()), hash);
+    }
+    return hash;
+}
+
+// Returns the same hash of data already in memory. Pass the hash of the data before to continue it
+uint64_t HashData(const void* data, size_t size, uint64_t hash /*= HASH_START*/)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull; // FNV prime
+    }
+    return hash;
+}
+
+
+// Load mesh data from a cache file. The file is memory mapped and the mesh data points directly into it
+// Returns false if the file is missing, invalid or doesn't match the given key
+bool LoadMeshCache(const std::string& cacheFileName, uint64_t sourceHash, unsigned int importFlags, bool requireTangents,
+                   MeshData& meshData)
+{
+    std::shared_ptr<MappedFile> file;
+    try
+    {
+        file = std::make_shared<MappedFile>(cacheFileName);
+    }
+    catch (const std::runtime_error&)
+    {
+        return false; // No cache file yet
+    }
+
+    // Check the header matches the key given
+    if (file->Size() < sizeof(MeshCacheHeader))  return false;
+    const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(file->Data());
+    if (std::memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0 ||
+        header->version         != MESH_CACHE_VERSION ||
+        header->sourceHash      != sourceHash         ||
+        header->importFlags     != importFlags        ||
+        header->requireTangents != (requireTangents ? 1u : 0u))
+    {
+        return false;
+    }
+
+    // Check all the data blocks are inside the file, in case it was truncated
+    uint64_t elementsEnd = sizeof(MeshCacheHeader) + header->numVertexElements * sizeof(VertexElement)
+                                                   + header->numSubMeshes      * sizeof(SubMesh);
+    uint64_t verticesEnd = header->vertexDataOffset + static_cast<uint64_t>(header->vertexSize) * header->numVertices;
+    uint64_t indicesEnd  = header->indexDataOffset  + static_cast<uint64_t>(header->numIndices) * sizeof(uint32_t);
+    if (elementsEnd > header->vertexDataOffset || verticesEnd > header->indexDataOffset || indicesEnd > file->Size() ||
+        header->vertexDataOffset % MESH_CACHE_ALIGNMENT != 0 || header->indexDataOffset % MESH_CACHE_ALIGNMENT != 0)
+    {
+        return false;
+    }
+
+    // Check every sub-mesh lies inside the vertex and index data
+    const VertexElement* elements  = reinterpret_cast<const VertexElement*>(file->Data() + sizeof(MeshCacheHeader));
+    const SubMesh*       subMeshes = reinterpret_cast<const SubMesh*>(elements + header->numVertexElements);
+    for (uint32_t subMesh = 0; subMesh < header->numSubMeshes; ++subMesh)
+    {
+        if (static_cast<uint64_t>(subMeshes[subMesh].indexOffset) + subMeshes[subMesh].indexCount > header->numIndices ||
+            subMeshes[subMesh].baseVertex >= header->numVertices)
+        {
+            return false;
+        }
+    }
+
+    // Fill in mesh data - the vertex and index data is used directly from the mapped file
+    meshData.vertexElements.assign(elements, elements + header->numVertexElements);
+    meshData.subMeshes.assign(subMeshes, subMeshes + header->numSubMeshes);
+    meshData.vertexSize  = header->vertexSize;
+    meshData.numVertices = header->numVertices;
+    meshData.numIndices  = header->numIndices;
+    meshData.vertices    = file->Data() + header->vertexDataOffset;
+    meshData.indices     = reinterpret_cast<const uint32_t*>(file->Data() + header->indexDataOffset);
+    meshData.boundsMin   = CVector3(header->boundsMin);
+    meshData.boundsMax   = CVector3(header->boundsMax);
+    meshData.ownedData.reset();
+    meshData.mappedFile  = file;
+
+    return true;
+}
+
+
+// Write mesh data to a cache file with the given key. Returns false on failure
+bool SaveMeshCache(const std::string& cacheFileName, uint64_t sourceHash, unsigned int importFlags, bool requireTangents,
+                   const MeshData& meshData)
+{
+    MeshCacheHeader header = {};
+    std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version           = MESH_CACHE_VERSION;
+    header.sourceHash        = sourceHash;
+    header.importFlags       = importFlags;
+    header.requireTangents   = requireTangents ? 1 : 0;
+    header.vertexSize        = meshData.vertexSize;
+    header.numVertices       = meshData.numVertices;
+    header.numIndices        = meshData.numIndices;
+    header.numVertexElements = static_cast<uint32_t>(meshData.vertexElements.size());
+    header.numSubMeshes      = static_cast<uint32_t>(meshData.subMeshes.size());
+    header.boundsMin[0] = meshData.boundsMin.x;  header.boundsMin[1] = meshData.boundsMin.y;  header.boundsMin[2] = meshData.boundsMin.z;
+    header.boundsMax[0] = meshData.boundsMax.x;  header.boundsMax[1] = meshData.boundsMax.y;  header.boundsMax[2] = meshData.boundsMax.z;
+
+    uint64_t vertexDataSize = static_cast<uint64_t>(meshData.vertexSize) * meshData.numVertices;
+    uint64_t tablesEnd = sizeof(MeshCacheHeader) + header.numVertexElements * sizeof(VertexElement) + header.numSubMeshes * sizeof(SubMesh);
+    header.vertexDataOffset = AlignOffset(tablesEnd);
+    header.indexDataOffset  = AlignOffset(header.vertexDataOffset + vertexDataSize);
+
+    // Write to a temporary file then rename it into place, so the cache file is never seen half written, e.g. by another
+    // loading thread importing the same mesh at the same time. Each thread writes its own temporary file
+    std::string tempFileName = cacheFileName + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    std::ofstream file(tempFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())  return false;
+
+    // Write each block, padding with zeros up to the offsets calculated above
+    const char padding[MESH_CACHE_ALIGNMENT] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(meshData.vertexElements.data()), header.numVertexElements * sizeof(VertexElement));
+    file.write(reinterpret_cast<const char*>(meshData.subMeshes.data()), header.numSubMeshes * sizeof(SubMesh));
+    file.write(padding, header.vertexDataOffset - tablesEnd);
+    file.write(reinterpret_cast<const char*>(meshData.vertices), vertexDataSize);
+    file.write(padding, header.indexDataOffset - (header.vertexDataOffset + vertexDataSize));
+    file.write(reinterpret_cast<const char*>(meshData.indices), meshData.numIndices * sizeof(uint32_t));
+    file.close();
+
+    if (file.fail())
+    {
+        std::remove(tempFileName.c_str()); // Don't leave a partial file behind
+        return false;
+    }
+
+    // Renaming doesn't replace an existing file on Windows, so remove the old one first. That fails if the old file is
+    // mapped (e.g. by another thread loading from it), the old file is then kept
+    if (std::rename(tempFileName.c_str(), cacheFileName.c_str()) != 0)
+    {
+        std::remove(cacheFileName.c_str());
+        if (std::rename(tempFileName.c_str(), cacheFileName.c_str()) != 0)
+        {
+            std::remove(tempFileName.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+
+// Load the given mesh file, using the cache file if it is valid. Otherwise import the mesh with assimp and
+// write a new cache file for next time. Optionally returns whether the cache was used
+// Will throw a std::runtime_error exception on failure
+MeshData LoadMeshData(const std::string& fileName, bool requireTangents, bool* loadedFromCache /*= nullptr*/)
+{
+    uint64_t     sourceHash    = HashFileContent(fileName);
+    unsigned int importFlags   = MeshImportFlags(requireTangents);
+    std::string  cacheFileName = MeshCacheFileName(fileName, requireTangents);
+
+    MeshData meshData;
+    if (LoadMeshCache(cacheFileName, sourceHash, importFlags, requireTangents, meshData))
+    {
+        if (loadedFromCache)  *loadedFromCache = true;
+        return meshData;
+    }
+
+    meshData = ImportMeshData(fileName, requireTangents);
+    SaveMeshCache(cacheFileName, sourceHash, importFlags, requireTangents, meshData); // Failing to write the cache is not an error, the import will run again next time
+    if (loadedFromCache)  *loadedFromCache = false;
+    return meshData;
+}
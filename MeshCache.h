@@ -0,0 +1,92 @@
+//--------------------------------------------------------------------------------------
+// Binary mesh cache
+//--------------------------------------------------------------------------------------
+// Importing a mesh with assimp runs many post-processing steps and dominates start-up time. After
+// the first import the result is written to a binary cache file next to the source file, which is
+// loaded directly on later runs. A mesh imported with and without tangents has a cache file for each
+// (e.g. Teapot.x.t0.meshcache and Teapot.x.t1.meshcache), so loading both doesn't rewrite one file.
+//
+// The cache file is designed to be memory mapped and used in place:
+//   MeshCacheHeader                        - fixed size, see below
+//   VertexElement[numVertexElements]       - vertex layout descriptor
+//   SubMesh[numSubMeshes]                  - sub-mesh table, index ranges into the shared buffers
+//   vertex data (vertexSize * numVertices) - interleaved vertices, starts on a 16 byte boundary
+//   index data (4 * numIndices)            - 32-bit indices, starts on a 16 byte boundary
+//
+// A cache file is only used if its version, the hash of the source file content, the assimp import
+// flags and the tangent setting all match. Otherwise the mesh is imported again and the cache rewritten.
+// The file is written under a temporary name and renamed when complete, so meshes can be loaded on
+// several threads at once (see AssetLoader.h), even the same mesh, without seeing a partly written file.
+
+#ifndef _MESH_CACHE_H_INCLUDED_
+#define _MESH_CACHE_H_INCLUDED_
+
+#include "MeshData.h"
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+
+// Increase this whenever the file layout or the import process changes so older cache files are rebuilt
+const uint32_t MESH_CACHE_VERSION = 2;
+
+struct MeshCacheHeader
+{
+    char     magic[4];          // Always "MSHC"
+    uint32_t version;           // MESH_CACHE_VERSION when written
+
+    // Key identifying the import that produced this file
+    uint64_t sourceHash;        // Hash of the content of the source mesh file
+    uint32_t importFlags;       // Assimp post-processing flags used for the import
+    uint32_t requireTangents;   // 1 if the mesh was imported with tangents
+
+    uint32_t vertexSize;
+    uint32_t numVertices;
+    uint32_t numIndices;
+    uint32_t numVertexElements;
+    uint32_t numSubMeshes;
+    uint32_t padding;           // Keeps the 64-bit offsets below aligned
+
+    float    boundsMin[3];
+    float    boundsMax[3];
+
+    // Offsets in bytes from the start of the file
+    uint64_t vertexDataOffset;
+    uint64_t indexDataOffset;
+};
+static_assert(sizeof(MeshCacheHeader) == 88, "Mesh cache header layout must not change without changing MESH_CACHE_VERSION");
+
+
+//--------------------------------------------------------------------------------------
+// Cache access
+//--------------------------------------------------------------------------------------
+
+// Returns the name of the cache file used for the given source mesh file imported with or without tangents
+std::string MeshCacheFileName(const std::string& sourceFileName, bool requireTangents);
+
+// Returns a 64-bit hash (FNV-1a) of the content of the given file
+// Will throw a std::runtime_error exception if the file cannot be read
+uint64_t HashFileContent(const std::string& fileName);
+
+// Returns the same hash of data already in memory, e.g. a mapped file. Pass the hash of the data before to continue it
+const uint64_t HASH_START = 14695981039346656037ull; // FNV offset basis
+uint64_t HashData(const void* data, size_t size, uint64_t hash = HASH_START);
+
+// Load mesh data from a cache file. The file is memory mapped and the mesh data points directly into it
+// Returns false if the file is missing, invalid or doesn't match the given key
+bool LoadMeshCache(const std::string& cacheFileName, uint64_t sourceHash, unsigned int importFlags, bool requireTangents,
+                   MeshData& meshData);
+
+// Write mesh data to a cache file with the given key. Returns false on failure
+bool SaveMeshCache(const std::string& cacheFileName, uint64_t sourceHash, unsigned int importFlags, bool requireTangents,
+                   const MeshData& meshData);
+
+
+// Load the given mesh file, using the cache file if it is valid. Otherwise import the mesh with assimp and
+// write a new cache file for next time. Optionally returns whether the cache was used
+// Will throw a std::runtime_error exception on failure
+MeshData LoadMeshData(const std::string& fileName, bool requireTangents, bool* loadedFromCache = nullptr);
+
+
+#endif //_MESH_CACHE_H_INCLUDED_
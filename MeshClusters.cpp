@@ -0,0 +1,125 @@
+//--------------------------------------------------------------------------------------
+// Mesh clusters for 16-bit indices
+//--------------------------------------------------------------------------------------
+// See MeshClusters.h for a description of how meshes are split
+
+#include "MeshClusters.h"
+
+#include <vector>
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+
+namespace
+{
+    const uint32_t NO_VERTEX = ~0u;
+
+    // Returns the number of vertices a sub-mesh uses from its base vertex, one more than its largest index
+    uint32_t SubMeshVertexCount(const MeshData& meshData, const SubMesh& subMesh)
+    {
+        if (subMesh.indexCount == 0)  return 0;
+        const uint32_t* indices = meshData.indices + subMesh.indexOffset;
+        return *std::max_element(indices, indices + subMesh.indexCount) + 1;
+    }
+}
+
+
+// Returns true if every index of the mesh data fits in 16 bits
+bool Fits16BitIndices(const MeshData& meshData)
+{
+    for (auto& subMesh : meshData.subMeshes)
+    {
+        if (SubMeshVertexCount(meshData, subMesh) > MAX_16BIT_INDEX_VERTICES)  return false;
+    }
+    return true;
+}
+
+
+// Returns a copy of the mesh data with each sub-mesh using more than the given number of vertices split into clusters
+MeshData SplitMeshClusters(const MeshData& meshData, uint32_t maxClusterVertices /*= MAX_16BIT_INDEX_VERTICES*/)
+{
+    if (maxClusterVertices < 3)  throw std::runtime_error("Mesh clusters must hold at least one triangle");
+
+    std::vector<SubMesh>  subMeshes;
+    std::vector<uint32_t> indices;
+    std::vector<uint32_t> vertexSources; // The vertex in meshData each new vertex is copied from
+    std::vector<uint32_t> clusterVertex; // The vertex in the current cluster for each vertex of the sub-mesh being split
+    indices.reserve(meshData.numIndices);
+    vertexSources.reserve(meshData.numVertices);
+
+    for (auto& subMesh : meshData.subMeshes)
+    {
+        const uint32_t* subMeshIndices = meshData.indices + subMesh.indexOffset;
+        uint32_t        numVertices    = SubMeshVertexCount(meshData, subMesh);
+        uint32_t        baseVertex     = static_cast<uint32_t>(vertexSources.size());
+
+        // Small enough already, copy as it is
+        if (numVertices <= maxClusterVertices)
+        {
+            subMeshes.push_back( { static_cast<uint32_t>(indices.size()), subMesh.indexCount, baseVertex, subMesh.materialIndex } );
+            indices.insert(indices.end(), subMeshIndices, subMeshIndices + subMesh.indexCount);
+            for (uint32_t vertex = 0; vertex < numVertices; ++vertex)  vertexSources.push_back(subMesh.baseVertex + vertex);
+            continue;
+        }
+
+        // Add the triangles to clusters in order, starting a new cluster when the next triangle's vertices don't fit
+        clusterVertex.assign(numVertices, NO_VERTEX);
+        SubMesh cluster = { static_cast<uint32_t>(indices.size()), 0, baseVertex, subMesh.materialIndex };
+        for (uint32_t corner = 0; corner + 2 < subMesh.indexCount; corner += 3)
+        {
+            const uint32_t* triangle = subMeshIndices + corner;
+            uint32_t newVertices = (clusterVertex[triangle[0]] == NO_VERTEX) + (clusterVertex[triangle[1]] == NO_VERTEX) +
+                                   (clusterVertex[triangle[2]] == NO_VERTEX);
+            uint32_t clusterSize = static_cast<uint32_t>(vertexSources.size()) - cluster.baseVertex;
+            if (clusterSize + newVertices > maxClusterVertices)
+            {
+                subMeshes.push_back(cluster);
+                for (uint32_t vertex = cluster.baseVertex; vertex < vertexSources.size(); ++vertex)
+                {
+                    clusterVertex[vertexSources[vertex] - subMesh.baseVertex] = NO_VERTEX;
+                }
+                cluster = { static_cast<uint32_t>(indices.size()), 0, static_cast<uint32_t>(vertexSources.size()), subMesh.materialIndex };
+            }
+
+            for (int i = 0; i < 3; ++i)
+            {
+                uint32_t& vertex = clusterVertex[triangle[i]];
+                if (vertex == NO_VERTEX)
+                {
+                    vertex = static_cast<uint32_t>(vertexSources.size()) - cluster.baseVertex;
+                    vertexSources.push_back(subMesh.baseVertex + triangle[i]);
+                }
+                indices.push_back(vertex);
+            }
+            cluster.indexCount += 3;
+        }
+        if (cluster.indexCount > 0)  subMeshes.push_back(cluster);
+    }
+
+
+    //-----------------------------------
+
+    MeshData split;
+    split.vertexElements = meshData.vertexElements;
+    split.vertexSize     = meshData.vertexSize;
+    split.numVertices    = static_cast<unsigned int>(vertexSources.size());
+    split.numIndices     = static_cast<unsigned int>(indices.size());
+    split.subMeshes      = std::move(subMeshes);
+    split.boundsMin      = meshData.boundsMin;
+    split.boundsMax      = meshData.boundsMax;
+
+    // Vertices and indices in one allocation as ImportMeshData does
+    size_t vertexDataSize = static_cast<size_t>(split.numVertices) * split.vertexSize;
+    split.ownedData = std::make_unique<unsigned char[]>(vertexDataSize + indices.size() * sizeof(uint32_t));
+    unsigned char* vertices = split.ownedData.get();
+    for (size_t vertex = 0; vertex < vertexSources.size(); ++vertex)
+    {
+        std::memcpy(vertices + vertex * split.vertexSize, meshData.vertices + static_cast<size_t>(vertexSources[vertex]) * meshData.vertexSize, split.vertexSize);
+    }
+    std::memcpy(vertices + vertexDataSize, indices.data(), indices.size() * sizeof(uint32_t));
+    split.vertices = vertices;
+    split.indices  = reinterpret_cast<const uint32_t*>(vertices + vertexDataSize);
+
+    return split;
+}
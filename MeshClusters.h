@@ -0,0 +1,35 @@
+//--------------------------------------------------------------------------------------
+// Mesh clusters for 16-bit indices
+//--------------------------------------------------------------------------------------
+// A Mesh uses 16-bit indices, half the memory of 32-bit ones, whenever every sub-mesh uses fewer than 65536 vertices
+// (indices are relative to each sub-mesh's base vertex, see SubMesh in MeshData.h). Larger sub-meshes can be split
+// into clusters that each use at most 65536 vertices, so the whole mesh can use 16-bit indices.
+//
+// The triangles are taken in order and added to the current cluster until the next one would take it over the limit,
+// then a new cluster is started. Each cluster gets its own copy of the vertices it uses, numbered in the order they are
+// first used, and becomes a sub-mesh with the same material as the sub-mesh it came from. Vertices used by triangles
+// in two clusters are copied into both, which is only a small part of the mesh as the triangles are ordered for the
+// vertex cache on import (aiProcess_ImproveCacheLocality), so neighbouring triangles are nearly always in the same
+// cluster. Each cluster is one more draw call.
+
+#ifndef _MESH_CLUSTERS_H_INCLUDED_
+#define _MESH_CLUSTERS_H_INCLUDED_
+
+#include "MeshData.h"
+
+#include <cstdint>
+
+
+// Most vertices a sub-mesh can use with 16-bit indices
+const uint32_t MAX_16BIT_INDEX_VERTICES = 65536;
+
+// Returns true if every index of the mesh data fits in 16 bits
+bool Fits16BitIndices(const MeshData& meshData);
+
+// Returns a copy of the mesh data with each sub-mesh using more than the given number of vertices split into clusters
+// as described above. Sub-meshes that don't need splitting are copied unchanged. The vertices and indices are copied,
+// so the mesh data given can be freed afterwards
+MeshData SplitMeshClusters(const MeshData& meshData, uint32_t maxClusterVertices = MAX_16BIT_INDEX_VERTICES);
+
+
+#endif //_MESH_CLUSTERS_H_INCLUDED_
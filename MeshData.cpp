@@ -0,0 +1,251 @@
+//--------------------------------------------------------------------------------------
+// CPU-side mesh data
+//--------------------------------------------------------------------------------------
+// Holds the vertices, indices and vertex layout of a mesh before it is sent to the GPU. The data
+// either comes from an assimp import or from a binary mesh cache file (see MeshCache.h).
+
+#include "MeshData.h"
+#include "CVector2.h"
+#include "CVector3.h"
+
+#include <assimp/Importer.hpp>
+#include <assimp/DefaultLogger.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+
+#include <stdexcept>
+#include <algorithm>
+
+
+// Returns the assimp post-processing flags used to import a mesh. These are part of the key used
+// to decide if a mesh cache file is still valid
+unsigned int MeshImportFlags(bool requireTangents)
+{
+    // Flags for processing the mesh. Assimp provides a huge amount of control - right click any of these
+    // and "Peek Definition" to see documention above each constant
+    unsigned int assimpFlags = aiProcess_MakeLeftHanded |
+                               aiProcess_GenSmoothNormals |
+                               aiProcess_FixInfacingNormals |
+                               aiProcess_GenUVCoords |
+                               aiProcess_TransformUVCoords |
+                               aiProcess_FlipUVs |
+                               aiProcess_FlipWindingOrder |
+                               aiProcess_Triangulate |
+                               aiProcess_PreTransformVertices |
+                               aiProcess_JoinIdenticalVertices |
+                               aiProcess_ImproveCacheLocality |
+                               aiProcess_SortByPType |
+                               aiProcess_FindInvalidData |
+                               aiProcess_OptimizeMeshes |
+                               aiProcess_FindInstances |
+                               aiProcess_FindDegenerates |
+                               aiProcess_RemoveRedundantMaterials |
+                               aiProcess_Debone |
+                               aiProcess_RemoveComponent;
+
+    // Add tangents as required by user
+    if (requireTangents)
+    {
+        assimpFlags |= aiProcess_CalcTangentSpace;
+    }
+
+    return assimpFlags;
+}
+
+
+// Import the given mesh file with assimp (http://www.assimp.org/), which supports many file types
+// Every sub-mesh in the file is imported, all using the same vertex layout
+// Optionally request tangents to be calculated (for normal and parallax mapping)
+// Will throw a std::runtime_error exception on failure
+MeshData ImportMeshData(const std::string& fileName, bool requireTangents)
+{
+    Assimp::Importer importer;
+
+    unsigned int assimpFlags = MeshImportFlags(requireTangents);
+
+    // Flags to specify what mesh data to ignore. Materials are kept so each sub-mesh keeps its material slot
+    int removeComponents = aiComponent_LIGHTS | aiComponent_CAMERAS | aiComponent_TEXTURES | aiComponent_COLORS |
+                           aiComponent_BONEWEIGHTS | aiComponent_ANIMATIONS;
+
+    // Remove tangents if not required by user
+    if (!requireTangents)
+    {
+        removeComponents |= aiComponent_TANGENTS_AND_BITANGENTS;
+    }
+
+    // Other miscellaneous settings
+    importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 80.0f); // Smoothing angle for normals
+    importer.SetPropertyInteger(AI_CONFIG_PP_SBP_REMOVE, aiPrimitiveType_POINT | aiPrimitiveType_LINE);  // Remove points and lines (keep triangles only)
+    importer.SetPropertyBool(AI_CONFIG_PP_FD_REMOVE, true);                 // Remove degenerate triangles
+    importer.SetPropertyBool(AI_CONFIG_PP_DB_ALL_OR_NONE, true);            // Default to removing bones/weights from meshes that don't need skinning
+
+    importer.SetPropertyInteger(AI_CONFIG_PP_RVC_FLAGS, removeComponents);
+
+    // Import mesh with assimp given above requirements - log output
+    Assimp::DefaultLogger::create("", Assimp::DefaultLogger::VERBOSE);
+    const aiScene* scene = importer.ReadFile(fileName, assimpFlags);
+    Assimp::DefaultLogger::kill();
+    if (scene == nullptr)  throw std::runtime_error("Error loading mesh (" + fileName + "). " + importer.GetErrorString());
+    if (scene->mNumMeshes == 0)  throw std::runtime_error("No usable geometry in mesh: " + fileName);
+
+
+    //-----------------------------------
+
+    // All sub-meshes are packed into one vertex buffer so they must share a vertex layout. Position and normal
+    // data is required. Tangents are included if requested, UVs are included if any sub-mesh has them (sub-meshes
+    // without UVs get zeros)
+    bool hasUVs = false;
+    for (unsigned int subMesh = 0; subMesh < scene->mNumMeshes; ++subMesh)
+    {
+        aiMesh* assimpMesh = scene->mMeshes[subMesh];
+        std::string subMeshName = assimpMesh->mName.C_Str();
+
+        if (!assimpMesh->HasPositions())  throw std::runtime_error("No position data for sub-mesh " + subMeshName + " in " + fileName);
+        if (!assimpMesh->HasNormals())    throw std::runtime_error("No normal data for sub-mesh " + subMeshName + " in " + fileName);
+        if (!assimpMesh->HasFaces())      throw std::runtime_error("No face data in " + subMeshName + " in " + fileName);
+        if (requireTangents && !assimpMesh->HasTangentsAndBitangents())  throw std::runtime_error("No tangent data for sub-mesh " + subMeshName + " in " + fileName);
+
+        if (assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0))
+        {
+            if (assimpMesh->mNumUVComponents[0] != 2)  throw std::runtime_error("Unsupported texture coordinates in " + subMeshName + " in " + fileName);
+            hasUVs = true;
+        }
+    }
+
+
+    //-----------------------------------
+
+    MeshData meshData;
+
+    unsigned int offset = 0;
+
+    unsigned int positionOffset = offset;
+    meshData.vertexElements.push_back( { VertexSemantic::Position, VertexFormat::Float3, positionOffset } );
+    offset += 12;
+
+    unsigned int normalOffset = offset;
+    meshData.vertexElements.push_back( { VertexSemantic::Normal, VertexFormat::Float3, normalOffset } );
+    offset += 12;
+
+    unsigned int tangentOffset = offset;
+    if (requireTangents)
+    {
+        meshData.vertexElements.push_back( { VertexSemantic::Tangent, VertexFormat::Float3, tangentOffset } );
+        offset += 12;
+    }
+
+    unsigned int uvOffset = offset;
+    if (hasUVs)
+    {
+        meshData.vertexElements.push_back( { VertexSemantic::UV, VertexFormat::Float2, uvOffset } );
+        offset += 8;
+    }
+
+    meshData.vertexSize = offset;
+
+
+    //-----------------------------------
+
+    // Build the sub-mesh table - each sub-mesh's vertices and indices follow on from the previous one
+    for (unsigned int subMesh = 0; subMesh < scene->mNumMeshes; ++subMesh)
+    {
+        aiMesh* assimpMesh = scene->mMeshes[subMesh];
+        meshData.subMeshes.push_back( { meshData.numIndices, assimpMesh->mNumFaces * 3, meshData.numVertices, assimpMesh->mMaterialIndex } );
+        meshData.numVertices += assimpMesh->mNumVertices;
+        meshData.numIndices  += assimpMesh->mNumFaces * 3;
+    }
+
+    // Create CPU-side buffer to hold current mesh data - exact content is flexible so can't use a structure for a vertex - so just a block of bytes
+    // Vertices and indices are held in one allocation, indices after vertices. Vertex size is always a multiple of 4 so the indices stay aligned
+    // Note: for large arrays a unique_ptr is better than a vector because vectors default-initialise all the values which is a waste of time.
+    size_t vertexDataSize = meshData.numVertices * meshData.vertexSize;
+    meshData.ownedData = std::make_unique<unsigned char[]>(vertexDataSize + meshData.numIndices * sizeof(uint32_t)); // Using 32 bit indexes (4 bytes) for each index
+    unsigned char* vertices = meshData.ownedData.get();
+    uint32_t*      indices  = reinterpret_cast<uint32_t*>(vertices + vertexDataSize);
+    meshData.vertices = vertices;
+    meshData.indices  = indices;
+
+
+    //-----------------------------------
+
+    // Copy mesh data from assimp to our CPU-side vertex buffer, one sub-mesh at a time
+    unsigned int vertexSize = meshData.vertexSize;
+    CVector3 boundsMin = *reinterpret_cast<CVector3*>(scene->mMeshes[0]->mVertices);
+    CVector3 boundsMax = boundsMin;
+
+    for (unsigned int subMesh = 0; subMesh < scene->mNumMeshes; ++subMesh)
+    {
+        aiMesh* assimpMesh = scene->mMeshes[subMesh];
+        unsigned char* subMeshVertices = vertices + meshData.subMeshes[subMesh].baseVertex * vertexSize;
+        unsigned int   numVertices     = assimpMesh->mNumVertices;
+
+        CVector3* assimpPosition = reinterpret_cast<CVector3*>(assimpMesh->mVertices);
+        unsigned char* position = subMeshVertices + positionOffset;
+        unsigned char* positionEnd = position + numVertices * vertexSize;
+        while (position != positionEnd)
+        {
+            *(CVector3*)position = *assimpPosition;
+
+            // Track bounding box of the mesh as the positions are copied
+            boundsMin = { std::min(boundsMin.x, assimpPosition->x), std::min(boundsMin.y, assimpPosition->y), std::min(boundsMin.z, assimpPosition->z) };
+            boundsMax = { std::max(boundsMax.x, assimpPosition->x), std::max(boundsMax.y, assimpPosition->y), std::max(boundsMax.z, assimpPosition->z) };
+
+            position += vertexSize;
+            ++assimpPosition;
+        }
+
+        CVector3* assimpNormal = reinterpret_cast<CVector3*>(assimpMesh->mNormals);
+        unsigned char* normal = subMeshVertices + normalOffset;
+        unsigned char* normalEnd = normal + numVertices * vertexSize;
+        while (normal != normalEnd)
+        {
+            *(CVector3*)normal = *assimpNormal;
+            normal += vertexSize;
+            ++assimpNormal;
+        }
+
+        if (requireTangents)
+        {
+          CVector3* assimpTangent = reinterpret_cast<CVector3*>(assimpMesh->mTangents);
+          unsigned char* tangent =  subMeshVertices + tangentOffset;
+          unsigned char* tangentEnd = tangent + numVertices * vertexSize;
+          while (tangent != tangentEnd)
+          {
+            *(CVector3*)tangent = *assimpTangent;
+            tangent += vertexSize;
+            ++assimpTangent;
+          }
+        }
+
+        if (hasUVs)
+        {
+            bool subMeshHasUVs = assimpMesh->GetNumUVChannels() > 0 && assimpMesh->HasTextureCoords(0);
+            aiVector3D* assimpUV = assimpMesh->mTextureCoords[0];
+            unsigned char* uv = subMeshVertices + uvOffset;
+            unsigned char* uvEnd = uv + numVertices * vertexSize;
+            while (uv != uvEnd)
+            {
+                *(CVector2*)uv = subMeshHasUVs ? CVector2(assimpUV->x, assimpUV->y) : CVector2(0, 0);
+                uv += vertexSize;
+                if (subMeshHasUVs)  ++assimpUV;
+            }
+        }
+
+
+        //-----------------------------------
+
+        // Copy face data from assimp to our CPU-side index buffer. Indices are relative to the sub-mesh's first vertex
+        uint32_t* index = indices + meshData.subMeshes[subMesh].indexOffset;
+        for (unsigned int face = 0; face < assimpMesh->mNumFaces; ++face)
+        {
+            *index++ = assimpMesh->mFaces[face].mIndices[0];
+            *index++ = assimpMesh->mFaces[face].mIndices[1];
+            *index++ = assimpMesh->mFaces[face].mIndices[2];
+        }
+    }
+
+    meshData.boundsMin = boundsMin;
+    meshData.boundsMax = boundsMax;
+
+    return meshData;
+}
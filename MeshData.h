@@ -0,0 +1,104 @@
+//--------------------------------------------------------------------------------------
+// CPU-side mesh data
+//--------------------------------------------------------------------------------------
+// Holds the vertices, indices and vertex layout of a mesh before it is sent to the GPU. The data
+// either comes from an assimp import or from a binary mesh cache file (see MeshCache.h).
+// Nothing in here uses DirectX so the same code is used by the MeshConverter tool.
+
+#ifndef _MESH_DATA_H_INCLUDED_
+#define _MESH_DATA_H_INCLUDED_
+
+#include "CVector3.h"
+#include "MappedFile.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Vertex layout
+//--------------------------------------------------------------------------------------
+// Describes the data held in each vertex without using DirectX types. The numeric values are
+// stored in mesh cache files, so only add new values to the end of these lists
+
+enum class VertexSemantic : uint32_t
+{
+    Position = 0,
+    Normal   = 1,
+    Tangent  = 2,
+    UV       = 3,
+};
+
+enum class VertexFormat : uint32_t
+{
+    Float2    = 0,
+    Float3    = 1,
+    UNorm16x4 = 2, // Four 16-bit values from 0 to 1, used for quantized positions (see MeshQuantization.h)
+    SNorm16x2 = 3, // Two 16-bit values from -1 to 1, used for octahedral normals and tangents
+    Half2     = 4, // Two 16-bit floats, used for quantized UVs
+};
+
+struct VertexElement
+{
+    VertexSemantic semantic;
+    VertexFormat   format;
+    uint32_t       offset; // Offset in bytes from the start of the vertex
+};
+
+
+//--------------------------------------------------------------------------------------
+// Mesh data
+//--------------------------------------------------------------------------------------
+
+// One part of a mesh, usually one per material in the source file. All the sub-meshes of a mesh share a
+// single vertex and index buffer, so they can be drawn with one buffer bind and a draw call each
+struct SubMesh
+{
+    uint32_t indexOffset;   // First index of this sub-mesh in the index buffer
+    uint32_t indexCount;
+    uint32_t baseVertex;    // Added to each index of this sub-mesh to find the vertex in the vertex buffer
+    uint32_t materialIndex; // Material slot of the sub-mesh in the source file
+};
+
+struct MeshData
+{
+    std::vector<VertexElement> vertexElements;
+    unsigned int vertexSize  = 0; // Size in bytes of a single vertex
+    unsigned int numVertices = 0;
+    unsigned int numIndices  = 0;
+
+    std::vector<SubMesh> subMeshes;
+
+    // Vertex and index data (32-bit indices), all sub-meshes packed one after another. These point into ownedData
+    // after an assimp import, or directly into the mapped file after loading from a mesh cache, so no copy is made
+    const unsigned char* vertices = nullptr;
+    const uint32_t*      indices  = nullptr;
+
+    // Axis-aligned bounding box of the vertex positions
+    CVector3 boundsMin = { 0, 0, 0 };
+    CVector3 boundsMax = { 0, 0, 0 };
+
+    // Whichever of these is used keeps the vertex and index data above alive
+    std::unique_ptr<unsigned char[]> ownedData;
+    std::shared_ptr<MappedFile>      mappedFile;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Mesh import
+//--------------------------------------------------------------------------------------
+
+// Returns the assimp post-processing flags used to import a mesh. These are part of the key used
+// to decide if a mesh cache file is still valid
+unsigned int MeshImportFlags(bool requireTangents);
+
+// Import the given mesh file with assimp (http://www.assimp.org/), which supports many file types
+// Every sub-mesh in the file is imported, all using the same vertex layout
+// Optionally request tangents to be calculated (for normal and parallax mapping)
+// Will throw a std::runtime_error exception on failure
+MeshData ImportMeshData(const std::string& fileName, bool requireTangents);
+
+
+#endif //_MESH_DATA_H_INCLUDED_
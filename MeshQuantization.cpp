@@ -0,0 +1,344 @@
+//--------------------------------------------------------------------------------------
+// Vertex quantization
+//--------------------------------------------------------------------------------------
+// See MeshQuantization.h for a description of the quantized vertex layout
+
+#include "MeshQuantization.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+
+namespace
+{
+    const float UNORM16_MAX = 65535.0f;
+    const float SNORM16_MAX = 32767.0f;
+
+    // Size in bytes of a vertex element of the given format
+    unsigned int VertexFormatSize(VertexFormat format)
+    {
+        switch (format)
+        {
+            case VertexFormat::Float2:     return 8;
+            case VertexFormat::Float3:     return 12;
+            case VertexFormat::UNorm16x4:  return 8;
+            case VertexFormat::SNorm16x2:  return 4;
+            case VertexFormat::Half2:      return 4;
+            default:  throw std::runtime_error("Unknown vertex format");
+        }
+    }
+
+    // Returns the format each element is stored in after quantization
+    VertexFormat QuantizedFormat(const VertexElement& element)
+    {
+        switch (element.semantic)
+        {
+            case VertexSemantic::Position:  if (element.format == VertexFormat::Float3)  return VertexFormat::UNorm16x4;  break;
+            case VertexSemantic::Normal:
+            case VertexSemantic::Tangent:   if (element.format == VertexFormat::Float3)  return VertexFormat::SNorm16x2;  break;
+            case VertexSemantic::UV:        if (element.format == VertexFormat::Float2)  return VertexFormat::Half2;      break;
+        }
+        throw std::runtime_error("Vertex format cannot be quantized");
+    }
+
+
+    // A position on one axis as a fraction of the way across the bounding box, in 16 bits
+    uint16_t QuantizeUNorm16(float value, float boundsMin, float boundsSize)
+    {
+        if (boundsSize <= 0)  return 0; // Flat mesh, every position on this axis is the minimum
+        float fraction = std::min(std::max((value - boundsMin) / boundsSize, 0.0f), 1.0f);
+        return static_cast<uint16_t>(std::lround(fraction * UNORM16_MAX));
+    }
+
+    // Signed normalised 16-bit values, the same conversion the GPU uses to read them
+    float SNorm16ToFloat(int16_t value)
+    {
+        return std::max(value / SNORM16_MAX, -1.0f);
+    }
+
+    uint32_t PackSNorm16x2(int x, int y)
+    {
+        return static_cast<uint16_t>(static_cast<int16_t>(x)) | (static_cast<uint32_t>(static_cast<uint16_t>(static_cast<int16_t>(y))) << 16);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Mesh quantization
+//--------------------------------------------------------------------------------------
+
+// Returns true if the mesh data uses the quantized vertex layout
+bool IsQuantized(const MeshData& meshData)
+{
+    for (auto& element : meshData.vertexElements)
+    {
+        if (element.semantic == VertexSemantic::Position)  return element.format == VertexFormat::UNorm16x4;
+    }
+    return false;
+}
+
+
+// Returns a copy of the mesh data with the quantized vertex layout
+MeshData QuantizeMeshData(const MeshData& meshData)
+{
+    bool alreadyQuantized = IsQuantized(meshData);
+
+    MeshData quantized;
+    quantized.subMeshes   = meshData.subMeshes;
+    quantized.numVertices = meshData.numVertices;
+    quantized.numIndices  = meshData.numIndices;
+    quantized.boundsMin   = meshData.boundsMin;
+    quantized.boundsMax   = meshData.boundsMax;
+
+    // New layout, the elements stay in the same order but packed into fewer bytes
+    for (auto& element : meshData.vertexElements)
+    {
+        VertexElement quantizedElement = element;
+        quantizedElement.format = alreadyQuantized ? element.format : QuantizedFormat(element);
+        quantizedElement.offset = alreadyQuantized ? element.offset : quantized.vertexSize;
+        quantized.vertexElements.push_back(quantizedElement);
+        quantized.vertexSize += VertexFormatSize(quantizedElement.format);
+    }
+    if (alreadyQuantized)  quantized.vertexSize = meshData.vertexSize;
+
+    // Vertices and indices in one allocation as ImportMeshData does. Vertex sizes are multiples of 4 so the indices
+    // stay aligned
+    size_t vertexDataSize = static_cast<size_t>(quantized.numVertices) * quantized.vertexSize;
+    size_t indexDataSize  = static_cast<size_t>(quantized.numIndices) * sizeof(uint32_t);
+    quantized.ownedData = std::make_unique<unsigned char[]>(vertexDataSize + indexDataSize);
+    unsigned char* vertices = quantized.ownedData.get();
+    uint32_t*      indices  = reinterpret_cast<uint32_t*>(vertices + vertexDataSize);
+    std::memcpy(indices, meshData.indices, indexDataSize);
+    quantized.vertices = vertices;
+    quantized.indices  = indices;
+
+    if (alreadyQuantized)
+    {
+        std::memcpy(vertices, meshData.vertices, vertexDataSize);
+        return quantized;
+    }
+
+
+    //-----------------------------------
+
+    CVector3 boundsSize = meshData.boundsMax - meshData.boundsMin;
+    for (size_t elt = 0; elt < meshData.vertexElements.size(); ++elt)
+    {
+        const VertexElement& element = meshData.vertexElements[elt];
+        const unsigned char* source  = meshData.vertices + element.offset;
+        unsigned char*       dest    = vertices + quantized.vertexElements[elt].offset;
+
+        for (unsigned int vertex = 0; vertex < meshData.numVertices; ++vertex)
+        {
+            if (element.semantic == VertexSemantic::Position)
+            {
+                CVector3 position;
+                std::memcpy(&position, source, sizeof(position));
+                uint16_t packed[4] = { QuantizeUNorm16(position.x, meshData.boundsMin.x, boundsSize.x),
+                                       QuantizeUNorm16(position.y, meshData.boundsMin.y, boundsSize.y),
+                                       QuantizeUNorm16(position.z, meshData.boundsMin.z, boundsSize.z), 0 };
+                std::memcpy(dest, packed, sizeof(packed));
+            }
+            else if (element.semantic == VertexSemantic::UV)
+            {
+                float uv[2];
+                std::memcpy(uv, source, sizeof(uv));
+                uint16_t packed[2] = { FloatToHalf(uv[0]), FloatToHalf(uv[1]) };
+                std::memcpy(dest, packed, sizeof(packed));
+            }
+            else // Normal or tangent
+            {
+                CVector3 direction;
+                std::memcpy(&direction, source, sizeof(direction));
+                uint32_t packed = EncodeOctahedral(direction);
+                std::memcpy(dest, &packed, sizeof(packed));
+            }
+
+            source += meshData.vertexSize;
+            dest   += quantized.vertexSize;
+        }
+    }
+
+    return quantized;
+}
+
+
+// Returns the scale and offset that turn a quantized position back into model space
+CVector3 QuantizedPositionScale(const MeshData& meshData)
+{
+    return meshData.boundsMax - meshData.boundsMin;
+}
+
+CVector3 QuantizedPositionOffset(const MeshData& meshData)
+{
+    return meshData.boundsMin;
+}
+
+
+// Returns one element of one vertex as floats, whatever its format
+CVector3 ReadVertexElement(const MeshData& meshData, const VertexElement& element, unsigned int vertex)
+{
+    const unsigned char* data = meshData.vertices + static_cast<size_t>(vertex) * meshData.vertexSize + element.offset;
+    switch (element.format)
+    {
+        case VertexFormat::Float2:
+        {
+            float uv[2];
+            std::memcpy(uv, data, sizeof(uv));
+            return { uv[0], uv[1], 0 };
+        }
+
+        case VertexFormat::Float3:
+        {
+            CVector3 value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        case VertexFormat::UNorm16x4:
+        {
+            uint16_t packed[4];
+            std::memcpy(packed, data, sizeof(packed));
+            CVector3 fraction = { packed[0] / UNORM16_MAX, packed[1] / UNORM16_MAX, packed[2] / UNORM16_MAX };
+            CVector3 scale = QuantizedPositionScale(meshData);
+            return CVector3(fraction.x * scale.x, fraction.y * scale.y, fraction.z * scale.z) + QuantizedPositionOffset(meshData);
+        }
+
+        case VertexFormat::SNorm16x2:
+        {
+            uint32_t packed;
+            std::memcpy(&packed, data, sizeof(packed));
+            return DecodeOctahedral(packed);
+        }
+
+        case VertexFormat::Half2:
+        {
+            uint16_t packed[2];
+            std::memcpy(packed, data, sizeof(packed));
+            return { HalfToFloat(packed[0]), HalfToFloat(packed[1]), 0 };
+        }
+    }
+    return { 0, 0, 0 };
+}
+
+
+//--------------------------------------------------------------------------------------
+// Value encoding
+//--------------------------------------------------------------------------------------
+
+// Octahedral encoding of a unit vector as two 16-bit signed normalised values
+uint32_t EncodeOctahedral(const CVector3& direction)
+{
+    // Project onto the octahedron |x|+|y|+|z| = 1. A zero vector (a bad normal) is stored as +z
+    float sum = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (sum <= 0)  return 0;
+    float u = direction.x / sum;
+    float v = direction.y / sum;
+
+    // Fold the lower half of the octahedron out over the corners of the upper half
+    if (direction.z < 0)
+    {
+        float foldedU = (1 - std::abs(v)) * (u >= 0 ? 1.0f : -1.0f);
+        float foldedV = (1 - std::abs(u)) * (v >= 0 ? 1.0f : -1.0f);
+        u = foldedU;
+        v = foldedV;
+    }
+
+    // Rounding each value to the nearest step isn't always the nearest direction once decoded, so try rounding each
+    // value both ways and keep whichever decodes closest to the original
+    CVector3 unitDirection = direction * (1 / Length(direction));
+    int lowU = static_cast<int>(std::floor(u * SNORM16_MAX));
+    int lowV = static_cast<int>(std::floor(v * SNORM16_MAX));
+    uint32_t best = PackSNorm16x2(lowU, lowV);
+    float    bestDot = -2;
+    for (int roundU = 0; roundU < 2; ++roundU)
+    {
+        for (int roundV = 0; roundV < 2; ++roundV)
+        {
+            int candidateU = std::min(lowU + roundU, 32767);
+            int candidateV = std::min(lowV + roundV, 32767);
+            uint32_t candidate = PackSNorm16x2(candidateU, candidateV);
+            float    dot = Dot(DecodeOctahedral(candidate), unitDirection);
+            if (dot > bestDot)
+            {
+                best = candidate;
+                bestDot = dot;
+            }
+        }
+    }
+    return best;
+}
+
+
+CVector3 DecodeOctahedral(uint32_t encoded)
+{
+    // Same steps as DecodeOctahedral in Common.hlsli
+    float u = SNorm16ToFloat(static_cast<int16_t>(encoded & 0xffff));
+    float v = SNorm16ToFloat(static_cast<int16_t>(encoded >> 16));
+    CVector3 direction = { u, v, 1 - std::abs(u) - std::abs(v) };
+
+    // Unfold points outside the inner diamond back onto the lower half
+    float fold = std::max(-direction.z, 0.0f);
+    direction.x += (direction.x >= 0) ? -fold : fold;
+    direction.y += (direction.y >= 0) ? -fold : fold;
+    return Normalise(direction);
+}
+
+
+// Convert a 32-bit float to a 16-bit float, rounding to nearest (ties to even)
+uint16_t FloatToHalf(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign    = (bits >> 16) & 0x8000;
+    uint32_t absBits = bits & 0x7fffffff;
+
+    // Infinity and NaN
+    if (absBits >= 0x7f800000)  return static_cast<uint16_t>(sign | 0x7c00 | (absBits > 0x7f800000 ? 0x200 : 0));
+
+    // Too large for a half. Smaller values that round up past the largest half also become infinity below
+    if (absBits >= 0x47800000)  return static_cast<uint16_t>(sign | 0x7c00);
+
+    // Too small for a normal half, store as a denormal (or zero)
+    if (absBits < 0x38800000)
+    {
+        if (absBits < 0x33000000)  return static_cast<uint16_t>(sign); // Less than half the smallest denormal
+        uint32_t exponent  = absBits >> 23;
+        uint32_t mantissa  = (absBits & 0x7fffff) | 0x800000;
+        uint32_t shift     = 126 - exponent;
+        uint32_t half      = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway   = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1)))  ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Normal half, change the exponent bias from 127 to 15 and drop 13 bits of mantissa. Rounding up can carry into
+    // the exponent, which gives the right result
+    uint32_t half      = (absBits - 0x38000000) >> 13;
+    uint32_t remainder = absBits & 0x1fff;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))  ++half;
+    return static_cast<uint16_t>(sign | half);
+}
+
+
+float HalfToFloat(uint16_t half)
+{
+    uint32_t sign     = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+
+    if (exponent == 0)
+    {
+        float value = std::ldexp(static_cast<float>(mantissa), -24); // Denormal or zero
+        return sign ? -value : value;
+    }
+
+    uint32_t bits = (exponent == 31) ? (sign | 0x7f800000 | (mantissa << 13))
+                                     : (sign | ((exponent + 112) << 23) | (mantissa << 13));
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
@@ -0,0 +1,67 @@
+//--------------------------------------------------------------------------------------
+// Vertex quantization
+//--------------------------------------------------------------------------------------
+// Stores each vertex of a mesh in fewer bytes, trading a little precision for less memory and less bandwidth when the
+// GPU reads the vertices. Each element of the vertex is converted as follows:
+//   Position  Float3 (12 bytes) -> UNorm16x4 (8 bytes) - x, y and z as 16-bit fractions of the way across the mesh's
+//                                                        bounding box, w is unused
+//   Normal    Float3 (12 bytes) -> SNorm16x2 (4 bytes) - octahedral encoding, see below
+//   Tangent   Float3 (12 bytes) -> SNorm16x2 (4 bytes) - octahedral encoding
+//   UV        Float2 (8 bytes)  -> Half2 (4 bytes)     - 16-bit floats
+// So a vertex with a normal and UVs goes from 32 to 16 bytes, and with a tangent as well from 44 to 20 bytes.
+//
+// Octahedral encoding stores a unit vector in two values. The sphere of directions is flattened onto an octahedron
+// (|x|+|y|+|z| = 1), the lower half of which is folded out over the corners of the upper half, so the whole sphere
+// covers a square from -1 to 1. Unlike storing only x and y of the vector, the precision is much the same everywhere.
+//
+// The GPU converts UNorm, SNorm and half values to floats as it reads them, but the shader must still scale the
+// position to the bounding box and decode the octahedral normals, so a quantized mesh needs a vertex shader written
+// for it (see QuantizedVertex in Common.hlsli). The scale and offset of the position are sent to the shader by the
+// Mesh class in a constant buffer of its own (PerMeshConstants in Common.h).
+
+#ifndef _MESH_QUANTIZATION_H_INCLUDED_
+#define _MESH_QUANTIZATION_H_INCLUDED_
+
+#include "MeshData.h"
+#include "CVector3.h"
+
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Mesh quantization
+//--------------------------------------------------------------------------------------
+
+// Returns true if the mesh data uses the quantized vertex layout described above
+bool IsQuantized(const MeshData& meshData);
+
+// Returns a copy of the mesh data with the quantized vertex layout described above. The vertices and indices are
+// copied, so the mesh data given can be freed afterwards. Mesh data that is already quantized is copied unchanged
+// Will throw a std::runtime_error exception if the vertices use a format that can't be quantized
+MeshData QuantizeMeshData(const MeshData& meshData);
+
+// Returns the scale and offset that turn a quantized position (0 to 1 on each axis) back into model space:
+// position * scale + offset. These are taken from the bounding box of the mesh
+CVector3 QuantizedPositionScale(const MeshData& meshData);
+CVector3 QuantizedPositionOffset(const MeshData& meshData);
+
+// Returns one element of one vertex as floats, whatever its format. Quantized positions are returned in model space
+// and octahedral normals and tangents are decoded. UVs are returned in x and y
+CVector3 ReadVertexElement(const MeshData& meshData, const VertexElement& element, unsigned int vertex);
+
+
+//--------------------------------------------------------------------------------------
+// Value encoding
+//--------------------------------------------------------------------------------------
+
+// Octahedral encoding of a unit vector as two 16-bit signed normalised values, x in the low 16 bits and y in the high
+// 16 bits. This is the memory layout of a SNorm16x2 vertex element
+uint32_t EncodeOctahedral(const CVector3& direction);
+CVector3 DecodeOctahedral(uint32_t encoded);
+
+// Convert between 32-bit and 16-bit floats. Rounds to nearest, values too large for a half become infinity
+uint16_t FloatToHalf(float value);
+float    HalfToFloat(uint16_t half);
+
+
+#endif //_MESH_QUANTIZATION_H_INCLUDED_
@@ -1,7 +1,7 @@
 //--------------------------------------------------------------------------------------
 // Class encapsulating a model
 //--------------------------------------------------------------------------------------
-// Holds a pointer to a mesh as well as position, rotation and scaling, which are converted to a world matrix when required
+// Holds a pointer to a mesh and a transform in a transform store, which converts it to a world matrix when required
 // This is more of a convenience class, the Mesh class does most of the difficult work.
 
 #include "Model.h"
@@ -10,70 +10,109 @@
 #include "GraphicsHelpers.h"
 #include "Mesh.h"
 
-void Model::Render()
-{
-    UpdateWorldMatrix();
+#include <algorithm>
+#include <cmath>
 
-    gPerModelConstants.worldMatrix = mWorldMatrix; // Update C++ side constant buffer
+void Model::Render(bool bindMesh /*= true*/)
+{
+    gPerModelConstants.worldMatrix = WorldMatrix(); // Update C++ side constant buffer
     UpdateConstantBuffer(gPerModelConstantBuffer, gPerModelConstants); // Send to GPU
 
     // Indicate that the constant buffer we just updated is for use in the vertex shader (VS) and pixel shader (PS)
-    gD3DContext->VSSetConstantBuffers(1, 1, &gPerModelConstantBuffer); // First parameter must match constant buffer number in the shader
-    gD3DContext->PSSetConstantBuffers(1, 1, &gPerModelConstantBuffer);
+    gRenderContext->SetConstantBuffer(1, gPerModelConstantBuffer); // First parameter must match constant buffer number in the shader
 
-    mMesh->Render();
+    mMesh->Render(*gRenderContext, bindMesh);
 }
 
 
 
+// Bounding sphere of the model in world space. Scaling can be different on each axis so use the largest to keep the
+// whole mesh inside the sphere. The scale is taken from the world matrix so it includes any parents' scaling
+void Model::WorldBoundingSphere(CVector3& centre, float& radius) const
+{
+    const CMatrix4x4& worldMatrix = CurrentWorldMatrix();
+    centre = TransformPoint(worldMatrix, mMesh->BoundingCentre());
+    CVector3 scale = worldMatrix.GetScale();
+    float maxScale = std::max(scale.x, std::max(scale.y, scale.z));
+    radius = mMesh->BoundingRadius() * maxScale;
+}
+
+
+// Axis-aligned box enclosing the model in world space. The mesh bounding box is rotated and scaled with the model, so
+// the world box must enclose that. Each world axis extent is the sum of the box's half-sizes projected onto that axis
+void Model::WorldBounds(CVector3& boundsMin, CVector3& boundsMax) const
+{
+    const CMatrix4x4& worldMatrix = CurrentWorldMatrix();
+    CVector3 localCentre = (mMesh->BoundsMin() + mMesh->BoundsMax()) * 0.5f;
+    CVector3 halfSize    = (mMesh->BoundsMax() - mMesh->BoundsMin()) * 0.5f;
+
+    CVector3 centre = TransformPoint(worldMatrix, localCentre);
+    CVector3 extent = { std::abs(worldMatrix.e00) * halfSize.x + std::abs(worldMatrix.e10) * halfSize.y + std::abs(worldMatrix.e20) * halfSize.z,
+                        std::abs(worldMatrix.e01) * halfSize.x + std::abs(worldMatrix.e11) * halfSize.y + std::abs(worldMatrix.e21) * halfSize.z,
+                        std::abs(worldMatrix.e02) * halfSize.x + std::abs(worldMatrix.e12) * halfSize.y + std::abs(worldMatrix.e22) * halfSize.z };
+    boundsMin = centre - extent;
+    boundsMax = centre + extent;
+}
+
+
 // Control the model's position and rotation using keys provided. Amount of motion performed depends on frame time
 void Model::Control(float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,
                                      KeyCode turnCW, KeyCode turnCCW, KeyCode moveForward, KeyCode moveBackward)
 {
-    UpdateWorldMatrix();
+	// Any key used here will move the model. Only change the transform if one is held, so an unmoved model's world
+	// matrix doesn't need rebuilding
+	if (!KeyHeld( turnUp ) && !KeyHeld( turnDown ) && !KeyHeld( turnLeft ) && !KeyHeld( turnRight ) &&
+	    !KeyHeld( turnCW ) && !KeyHeld( turnCCW ) && !KeyHeld( moveForward ) && !KeyHeld( moveBackward ))
+	{
+		return;
+	}
+
+	// Movement is along the model's Z axis before this frame's rotation. The position is relative to the parent if there
+	// is one, so use the model's local matrix, which gives that axis in the parent's space (the same as the world
+	// matrix if there is no parent)
+	CVector3 position = Position();
+	CVector3 rotation = Rotation();
+	CMatrix4x4 localMatrix = ComposeWorldMatrix(position, rotation, Scale());
 
 	if (KeyHeld( turnDown ))
 	{
-		mRotation.x += ROTATION_SPEED * frameTime;
+		rotation.x += ROTATION_SPEED * frameTime;
 	}
 	if (KeyHeld( turnUp ))
 	{
-		mRotation.x -= ROTATION_SPEED * frameTime;
+		rotation.x -= ROTATION_SPEED * frameTime;
 	}
 	if (KeyHeld( turnRight ))
 	{
-		mRotation.y += ROTATION_SPEED * frameTime;
+		rotation.y += ROTATION_SPEED * frameTime;
 	}
 	if (KeyHeld( turnLeft ))
 	{
-		mRotation.y -= ROTATION_SPEED * frameTime;
+		rotation.y -= ROTATION_SPEED * frameTime;
 	}
 	if (KeyHeld( turnCW ))
 	{
-		mRotation.z += ROTATION_SPEED * frameTime;
+		rotation.z += ROTATION_SPEED * frameTime;
 	}
 	if (KeyHeld( turnCCW ))
 	{
-		mRotation.z -= ROTATION_SPEED * frameTime;
+		rotation.z -= ROTATION_SPEED * frameTime;
 	}
 
-	// Local Z movement - move in the direction of the Z axis, get axis from world matrix
+	// Local Z movement - move in the direction of the Z axis, get axis from local matrix
 	if (KeyHeld( moveForward ))
 	{
-		mPosition.x += mWorldMatrix.e20 * MOVEMENT_SPEED * frameTime;
-		mPosition.y += mWorldMatrix.e21 * MOVEMENT_SPEED * frameTime;
-		mPosition.z += mWorldMatrix.e22 * MOVEMENT_SPEED * frameTime;
+		position.x += localMatrix.e20 * MOVEMENT_SPEED * frameTime;
+		position.y += localMatrix.e21 * MOVEMENT_SPEED * frameTime;
+		position.z += localMatrix.e22 * MOVEMENT_SPEED * frameTime;
 	}
 	if (KeyHeld( moveBackward ))
 	{
-		mPosition.x -= mWorldMatrix.e20 * MOVEMENT_SPEED * frameTime;
-		mPosition.y -= mWorldMatrix.e21 * MOVEMENT_SPEED * frameTime;
-		mPosition.z -= mWorldMatrix.e22 * MOVEMENT_SPEED * frameTime;
+		position.x -= localMatrix.e20 * MOVEMENT_SPEED * frameTime;
+		position.y -= localMatrix.e21 * MOVEMENT_SPEED * frameTime;
+		position.z -= localMatrix.e22 * MOVEMENT_SPEED * frameTime;
 	}
-}
-
 
-void Model::UpdateWorldMatrix()
-{
-    mWorldMatrix = MatrixScaling(mScale) * MatrixRotationZ(mRotation.z) * MatrixRotationX(mRotation.x) * MatrixRotationY(mRotation.y) * MatrixTranslation(mPosition);
-}
\ No newline at end of file
+	SetPosition(position);
+	SetRotation(rotation);
+}
@@ -1,12 +1,17 @@
 //--------------------------------------------------------------------------------------
 // Class encapsulating a model
 //--------------------------------------------------------------------------------------
-// Holds a pointer to a mesh as well as position, rotation and scaling, which are converted to a world matrix when required
+// Holds a pointer to a mesh and the index of the model's position, rotation and scaling in a transform store (see
+// TransformStore.h), which converts them to a world matrix when required. The store keeps the transforms of many models
+// together so their world matrices can be rebuilt in one batch. The model itself is small and can be freely copied,
+// each copy refers to the same transform. It doesn't own the mesh or the transform
+// A model can be attached to another, its position, rotation and scale are then relative to that parent model.
 // This is more of a convenience class, the Mesh class does most of the difficult work.
 
 #include "Common.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
+#include "TransformStore.h"
 #include "Input.h"
 
 #ifndef _MODEL_H_INCLUDED_
@@ -21,19 +26,23 @@ public:
 	// Construction / Usage
 	//-------------------------------------
 
-    Model(Mesh* mesh, CVector3 position = { 0,0,0 }, CVector3 rotation = { 0,0,0 }, float scale = 1)
-        : mMesh(mesh), mPosition(position), mRotation(rotation), mScale({ scale, scale, scale })
+    // Pass the mesh and the store and index of the model's transform (see TransformStore::Add)
+    Model(Mesh* mesh, TransformStore& transforms, uint32_t transform)
+        : mMesh(mesh), mTransforms(&transforms), mTransform(transform)
     {
     }
 
     // The render function sets the world matrix in the per-frame constant buffer and makes that buffer available
     // to vertex & pixel shader. Then it calls Mesh:Render, which renders the geometry with current GPU settings.
     // So all other per-frame constants must have been set already along with shaders, textures, samplers, states etc.
-    void Render();
+    // Pass false for bindMesh if the last model rendered used the same mesh, its buffers are still bound.
+    // Renders on gRenderContext using gPerModelConstants, so only use on the main thread (the render queue sets up each
+    // model's constants itself, so it can render on any thread)
+    void Render(bool bindMesh = true);
 
 
 	// Control the model's position and rotation using keys provided. Amount of motion performed depends on frame time
-	void Control( float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,  
+	void Control( float frameTime, KeyCode turnUp, KeyCode turnDown, KeyCode turnLeft, KeyCode turnRight,
 				  KeyCode turnCW, KeyCode turnCCW, KeyCode moveForward, KeyCode moveBackward );
 
 
@@ -41,37 +50,57 @@ public:
 	// Data access
 	//-------------------------------------
 
-	// Getters / setters
-	CVector3 Position()  { return mPosition; }
-	CVector3 Rotation()  { return mRotation; }
-	CVector3 Scale()     { return mScale;    }
+	// Getters / setters. Position, rotation and scale are relative to the parent model if there is one
+	Mesh*    GetMesh()   { return mMesh; }
+	CVector3 Position()  { return mTransforms->Position(mTransform); }
+	CVector3 Rotation()  { return mTransforms->Rotation(mTransform); }
+	CVector3 Scale()     { return mTransforms->Scale(mTransform);    }
 
-	void SetPosition( CVector3 position )  { mPosition = position; }
-	void SetRotation( CVector3 rotation )  { mRotation = rotation; }
+	// Change the mesh drawn, e.g. to replace a placeholder when the model's own mesh has loaded
+	void SetMesh( Mesh* mesh )  { mMesh = mesh; }
+
+	void SetPosition( CVector3 position )  { mTransforms->SetPosition(mTransform, position); }
+	void SetRotation( CVector3 rotation )  { mTransforms->SetRotation(mTransform, rotation); }
 
 	// Two ways to set scale: x,y,z separately, or all to the same value
-	void SetScale   ( CVector3 scale    )  { mScale = scale;       } 
-	void SetScale   ( float scale       )  { mScale = { scale, scale, scale };}
+	void SetScale   ( CVector3 scale    )  { mTransforms->SetScale(mTransform, scale); }
+	void SetScale   ( float scale       )  { mTransforms->SetScale(mTransform, { scale, scale, scale }); }
+
+	// Attach the model to a parent model in the same transform store, or pass nullptr to detach it. The parent must
+	// have been created first (see TransformStore::SetParent). Returns false if not
+	bool SetParent( Model* parent )
+	{
+		return mTransforms->SetParent(mTransform, parent != nullptr ? parent->mTransform : NO_PARENT_TRANSFORM);
+	}
+
+	// Index of the model's transform in its transform store
+	uint32_t TransformIndex()  { return mTransform; }
+
+	// Read only access to model world matrix, updated on request if the model or its parents have changed. Only use on
+	// the main thread, jobs must use CurrentWorldMatrix (see TransformStore.h)
+	CMatrix4x4 WorldMatrix()  { return mTransforms->WorldMatrix(mTransform); }
 
-	// Read only access to model world matrix, updated on request
-	CMatrix4x4 WorldMatrix()  { UpdateWorldMatrix();  return mWorldMatrix; }
+	// Model world matrix, which must already be up to date (see TransformStore::UpdateWorldMatrices). Safe to use from jobs
+	const CMatrix4x4& CurrentWorldMatrix() const  { return mTransforms->CurrentWorldMatrix(mTransform); }
+
+	// Position of the model in the world, the same as Position() if it has no parent. The world matrix must be up to date
+	CVector3 WorldPosition() const  { return CurrentWorldMatrix().GetPosition(); }
+
+	// Bounding volumes of the model in world space, built from the mesh's bounds and the world matrix. Used for visibility
+	// culling, often from jobs, so the world matrix must already be up to date
+	void WorldBoundingSphere(CVector3& centre, float& radius) const;
+	void WorldBounds(CVector3& boundsMin, CVector3& boundsMax) const; // Axis-aligned box enclosing the rotated mesh bounding box
 
 
 	//-------------------------------------
 	// Private data / members
 	//-------------------------------------
 private:
-    void UpdateWorldMatrix();
-
     Mesh* mMesh;
 
-	// Position, rotation and scaling for the model
-	CVector3 mPosition;
-	CVector3 mRotation;
-	CVector3 mScale;
-
-	// World matrix for the model - built from the above
-	CMatrix4x4 mWorldMatrix;
+	// Position, rotation and scaling for the model, and the world matrix built from them, are in the transform store
+	TransformStore* mTransforms;
+	uint32_t        mTransform;
 };
 
 
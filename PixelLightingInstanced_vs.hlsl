@@ -0,0 +1,38 @@
+//--------------------------------------------------------------------------------------
+// Per-Pixel Lighting Vertex Shader - Instanced
+//--------------------------------------------------------------------------------------
+// Same as PixelLighting_vs.hlsl, but the world matrix comes from the instance data rather than the per-model
+// constant buffer, so many copies of a mesh can be drawn with one draw call. Used with PixelLighting_ps.hlsl
+
+#include "Common.hlsli"
+
+
+//--------------------------------------------------------------------------------------
+// Shader code
+//--------------------------------------------------------------------------------------
+
+// Vertex shader main function
+LightingPixelShaderInput main(BasicVertex modelVertex, InstanceData instance)
+{
+    LightingPixelShaderInput output; 
+
+    // Input position
+    float4 modelPosition = float4(modelVertex.position, 1); 
+
+    // Matrices - note the world matrix is used the other way round from gWorldMatrix (see InstanceWorldMatrix)
+    float4x4 worldMatrix     = InstanceWorldMatrix(instance);
+    float4 worldPosition     = mul(modelPosition,     worldMatrix);
+    float4 viewPosition      = mul(gViewMatrix,       worldPosition);
+    output.projectedPosition = mul(gProjectionMatrix, viewPosition);
+
+    // Transform model normals into world space using world matrix - lighting will be calculated in world space
+    float4 modelNormal = float4(modelVertex.normal, 0);     
+    output.worldNormal = mul(modelNormal, worldMatrix).xyz; 
+                                                           
+    output.worldPosition = worldPosition.xyz; // Also pass world position to pixel shader for lighting
+
+    // Pass texture coordinates (UVs) on to the pixel shader
+    output.uv = modelVertex.uv;
+
+    return output; // Output data sent down the pipeline (to the pixel shader)
+}
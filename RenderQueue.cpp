@@ -0,0 +1,461 @@
+//--------------------------------------------------------------------------------------
+// Render queue
+//--------------------------------------------------------------------------------------
+// See RenderQueue.h
+
+#include "RenderQueue.h"
+
+#include "Model.h"
+#include "Mesh.h"
+#include "Common.h"
+#include "GraphicsHelpers.h"
+
+#include <algorithm>
+#include <cassert>
+
+
+//--------------------------------------------------------------------------------------
+// Sort key layout
+//--------------------------------------------------------------------------------------
+// Number of bits for each field, see the top of RenderQueue.h
+
+namespace
+{
+    const int PASS_BITS    = 2;
+    const int BLEND_BITS   = 2;
+    const int SHADER_BITS  = 12;
+    const int TEXTURE_BITS = 14;
+    const int MESH_BITS    = 14;
+    const int DEPTH_BITS   = 20;
+    static_assert(PASS_BITS + BLEND_BITS + SHADER_BITS + TEXTURE_BITS + MESH_BITS + DEPTH_BITS == 64, "Sort key fields must fill 64 bits");
+
+    enum RenderPass { OpaquePass = 0, BlendedPass = 1 };
+
+    // Smallest size of the instance and constant ring buffers, they grow if an Execute needs more
+    const size_t MIN_RING_SIZE = 64 * 1024;
+
+    uint64_t Mask(int bits)  { return (uint64_t(1) << bits) - 1; }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Materials
+//--------------------------------------------------------------------------------------
+
+// Add a material to the queue, returns the value to pass to Submit to use it
+int RenderQueue::AddMaterial(const RenderMaterial& material)
+{
+    MaterialEntry entry = { material, 0, 0 };
+
+    // Materials sharing shaders or textures with an earlier material get the same number for them, otherwise the next number up
+    uint32_t numShaders = 0, numTextureSets = 0;
+    bool shaderFound = false, texturesFound = false;
+    for (auto& existing : mMaterials)
+    {
+        numShaders     = std::max(numShaders,     existing.shaderId  + 1);
+        numTextureSets = std::max(numTextureSets, existing.textureId + 1);
+
+        if (!shaderFound && existing.material.vertexShader == material.vertexShader &&
+                            existing.material.pixelShader  == material.pixelShader)
+        {
+            entry.shaderId = existing.shaderId;
+            shaderFound = true;
+        }
+        if (!texturesFound && std::equal(material.textures, material.textures + MAX_MATERIAL_TEXTURES, existing.material.textures))
+        {
+            entry.textureId = existing.textureId;
+            texturesFound = true;
+        }
+    }
+    if (!shaderFound)    entry.shaderId  = numShaders;
+    if (!texturesFound)  entry.textureId = numTextureSets;
+    assert(entry.shaderId <= Mask(SHADER_BITS) && entry.textureId <= Mask(TEXTURE_BITS));
+
+    mMaterials.push_back(entry);
+    return static_cast<int>(mMaterials.size()) - 1;
+}
+
+// Use the same materials and mesh numbers as another queue
+void RenderQueue::CopyMaterials(const RenderQueue& source)
+{
+    mMaterials = source.mMaterials;
+    mMeshIds   = source.mMeshIds;
+}
+
+// Change the texture a material uses in one slot. The texture number in the sort keys is kept
+void RenderQueue::SetMaterialTexture(int material, int slot, GpuTexture* texture)
+{
+    assert(material >= 0 && material < static_cast<int>(mMaterials.size()) && slot >= 0 && slot < MAX_MATERIAL_TEXTURES);
+    mMaterials[material].material.textures[slot] = texture;
+}
+
+// Remove all materials and any draws submitted using them, and release the instance and constant buffers
+void RenderQueue::Release()
+{
+    mDraws.clear();
+    mSortItems.clear();
+    mMaterials.clear();
+    mMeshIds.clear();
+    mBatches.clear();
+
+    gRenderDevice->Release(mInstanceRing.buffer);  mInstanceRing = RingBuffer();
+    gRenderDevice->Release(mConstantRing.buffer);  mConstantRing = RingBuffer();
+}
+
+
+// Returns the number used in sort keys for the given mesh, numbering meshes as they are first seen
+uint32_t RenderQueue::MeshId(Mesh* mesh)
+{
+    auto inserted = mMeshIds.insert({ mesh, static_cast<uint32_t>(mMeshIds.size()) });
+    return inserted.first->second & Mask(MESH_BITS); // Meshes beyond the limit share numbers, they just group less well
+}
+
+
+//--------------------------------------------------------------------------------------
+// Drawing
+//--------------------------------------------------------------------------------------
+
+// Start a new list of draws. Pass the furthest distance that will be submitted
+void RenderQueue::Begin(float maxDistance)
+{
+    mMaxDistance = std::max(maxDistance, 0.001f);
+    mDraws.clear();
+    mSortItems.clear();
+}
+
+
+// Add a model to draw with the given material
+void RenderQueue::Submit(Model* model, int material, float distance, const CVector3& objectColour /*= { 1, 1, 1 }*/)
+{
+    assert(material >= 0 && material < static_cast<int>(mMaterials.size()));
+    uint64_t key = SortKey(mMaterials[material], MeshId(model->GetMesh()), distance);
+    mSortItems.push_back({ key, static_cast<uint32_t>(mDraws.size()) });
+    mDraws.push_back({ model, material, objectColour });
+}
+
+
+// Set the total number of draws to be submitted with SubmitAt
+void RenderQueue::Resize(int numDraws)
+{
+    mDraws.resize(numDraws);
+    mSortItems.resize(numDraws);
+}
+
+
+// Fill one of the slots made by Resize, the same as Submit otherwise. Safe to call from several threads at once for
+// different slots, as long as the model's mesh has been numbered with AddMesh
+void RenderQueue::SubmitAt(int index, Model* model, int material, float distance, const CVector3& objectColour /*= { 1, 1, 1 }*/)
+{
+    assert(material >= 0 && material < static_cast<int>(mMaterials.size()));
+    assert(index >= 0 && index < static_cast<int>(mDraws.size()));
+
+    // Only look meshes up here, a mesh not numbered yet shares the last number (it just groups less well)
+    auto meshId = mMeshIds.find(model->GetMesh());
+    uint64_t key = SortKey(mMaterials[material], (meshId != mMeshIds.end()) ? meshId->second & Mask(MESH_BITS) : Mask(MESH_BITS), distance);
+    mSortItems[index] = { key, static_cast<uint32_t>(index) };
+    mDraws[index]     = { model, material, objectColour };
+}
+
+
+// Returns the sort key for a draw with the given material entry, mesh number and distance from the camera
+uint64_t RenderQueue::SortKey(const MaterialEntry& entry, uint32_t meshId, float distance)
+{
+    // Distance as a fixed point value from 0 (at camera) to the largest the field can hold (at or beyond max distance)
+    float    distanceFraction = std::min(std::max(distance / mMaxDistance, 0.0f), 1.0f);
+    uint64_t depth = static_cast<uint64_t>(distanceFraction * Mask(DEPTH_BITS));
+
+    uint64_t blend   = static_cast<uint64_t>(entry.material.blendMode);
+    uint64_t shader  = entry.shaderId;
+    uint64_t texture = entry.textureId;
+    uint64_t mesh    = meshId;
+
+    uint64_t key;
+    if (entry.material.blendMode == BlendMode::None)
+    {
+        key = uint64_t(OpaquePass);
+        key = (key << BLEND_BITS)   | blend;
+        key = (key << SHADER_BITS)  | shader;
+        key = (key << TEXTURE_BITS) | texture;
+        key = (key << MESH_BITS)    | mesh;
+        key = (key << DEPTH_BITS)   | depth;
+    }
+    else
+    {
+        // Furthest first - invert the depth so larger distances sort lower
+        key = uint64_t(BlendedPass);
+        key = (key << DEPTH_BITS)   | (Mask(DEPTH_BITS) - depth);
+        key = (key << BLEND_BITS)   | blend;
+        key = (key << SHADER_BITS)  | shader;
+        key = (key << TEXTURE_BITS) | texture;
+        key = (key << MESH_BITS)    | mesh;
+    }
+    return key;
+}
+
+
+// Sort the submitted draws by their keys. Uses a least-significant-digit radix sort, one byte of the key per pass.
+// Items are placed by counting how many keys have each byte value, so no keys are compared and the time only
+// depends on the number of draws. Draws with equal keys stay in the order submitted
+void RenderQueue::Sort()
+{
+    const int NUM_PASSES = 8;
+    const int NUM_BUCKETS = 256;
+    size_t numItems = mSortItems.size();
+    if (numItems < 2)  return;
+
+    // Count the keys with each value of each byte, all passes at once to read the keys only once
+    uint32_t counts[NUM_PASSES][NUM_BUCKETS] = {};
+    for (auto& item : mSortItems)
+    {
+        for (int pass = 0; pass < NUM_PASSES; ++pass)
+        {
+            ++counts[pass][(item.key >> (pass * 8)) & 0xff];
+        }
+    }
+
+    mSortBuffer.resize(numItems);
+    for (int pass = 0; pass < NUM_PASSES; ++pass)
+    {
+        // If every key has the same value for this byte, the pass wouldn't change the order. Common for the upper
+        // bytes when there are few shaders and textures
+        uint32_t* passCounts = counts[pass];
+        int shift = pass * 8;
+        if (passCounts[(mSortItems[0].key >> shift) & 0xff] == numItems)  continue;
+
+        // Turn the counts into the position of the first item for each byte value
+        uint32_t offset = 0;
+        for (int bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+        {
+            uint32_t count = passCounts[bucket];
+            passCounts[bucket] = offset;
+            offset += count;
+        }
+
+        for (auto& item : mSortItems)
+        {
+            mSortBuffer[passCounts[(item.key >> shift) & 0xff]++] = item;
+        }
+        mSortItems.swap(mSortBuffer);
+    }
+}
+
+
+// Draw everything submitted with the given render context, setting only the GPU states that differ from the previous draw
+const RenderQueueStats& RenderQueue::Execute(RenderContext& context)
+{
+    mStats = RenderQueueStats();
+
+    // Gather the per-model data for every draw first, then send it to the GPU with one write for each buffer
+    BuildBatches(context.SupportsConstantBufferRanges());
+
+    size_t instanceOffset = 0, constantOffset = 0;
+    if (!mInstances.empty())
+    {
+        if (!WriteRing(context, mInstanceRing, BufferType::Instance, mInstances.data(), mInstances.size() * sizeof(InstanceData),
+                       sizeof(InstanceData), instanceOffset))  return mStats;
+        ++mStats.bufferWrites;
+    }
+    if (!mModelConstants.empty())
+    {
+        if (!WriteRing(context, mConstantRing, BufferType::Constant, mModelConstants.data(), mModelConstants.size() * sizeof(ModelConstants),
+                       CONSTANT_BUFFER_ALIGNMENT, constantOffset))  return mStats;
+        ++mStats.bufferWrites;
+    }
+    uint32_t baseInstance = static_cast<uint32_t>(instanceOffset / sizeof(InstanceData));
+
+    bool first = true;
+    Mesh* currentMesh = nullptr;
+    for (auto& batch : mBatches)
+    {
+        const Draw& draw = mDraws[mSortItems[batch.firstItem].draw];
+        const RenderMaterial& material = mMaterials[draw.material].material;
+        Mesh* mesh = draw.model->GetMesh();
+
+        if (batch.type == BatchType::Instanced)
+        {
+            ApplyMaterial(context, material, material.instancedVertexShader, first);
+            mesh->RenderInstanced(context, mInstanceRing.buffer, batch.numItems, baseInstance + batch.first);
+            currentMesh = nullptr; // Instanced layout is bound, the next single draw must bind its mesh again
+
+            ++mStats.meshChanges;
+            ++mStats.instancedDraws;
+        }
+        else
+        {
+            ApplyMaterial(context, material, material.vertexShader, first);
+
+            // Models with the same mesh as the previous draw use the buffers already bound
+            bool bindMesh = (mesh != currentMesh);
+            if (bindMesh)
+            {
+                currentMesh = mesh;
+                ++mStats.meshChanges;
+            }
+
+            if (batch.type == BatchType::RangeConstants)
+            {
+                // Select this model's constants from those already sent (slot must match the shaders' per-model constant buffer)
+                context.SetConstantBufferRange(1, mConstantRing.buffer, constantOffset + batch.first * sizeof(ModelConstants),
+                                               sizeof(ModelConstants));
+                mesh->Render(context, bindMesh);
+            }
+            else
+            {
+                // Send this model's constants on their own. Built in a local copy of the scene's per-model constants so
+                // queues on other threads can do the same at once
+                PerModelConstants constants = gPerModelConstants;
+                constants.worldMatrix  = draw.model->CurrentWorldMatrix();
+                constants.objectColour = draw.objectColour;
+                UpdateConstantBuffer(context, gPerModelConstantBuffer, constants);
+                context.SetConstantBuffer(1, gPerModelConstantBuffer);
+                mesh->Render(context, bindMesh);
+                ++mStats.bufferWrites;
+            }
+        }
+
+        ++mStats.drawCalls;
+        mStats.draws += batch.numItems;
+        first = false;
+    }
+
+    return mStats;
+}
+
+
+// Split the sorted draws into batches and gather the per-model data they need into mInstances and mModelConstants
+void RenderQueue::BuildBatches(bool constantRanges)
+{
+    mBatches.clear();
+    mInstances.clear();
+    mModelConstants.clear();
+
+    for (size_t item = 0; item < mSortItems.size(); )
+    {
+        const Draw& draw = mDraws[mSortItems[item].draw];
+        const RenderMaterial& material = mMaterials[draw.material].material;
+        Mesh* mesh = draw.model->GetMesh();
+
+        // Find the draws that follow with the same material and mesh. If there are any, and the material has an
+        // instanced shader, draw them all at once
+        size_t runEnd = item + 1;
+        if (material.instancedVertexShader != nullptr)
+        {
+            while (runEnd < mSortItems.size() && mDraws[mSortItems[runEnd].draw].material == draw.material &&
+                                                 mDraws[mSortItems[runEnd].draw].model->GetMesh() == mesh)
+            {
+                ++runEnd;
+            }
+        }
+
+        Batch batch = { BatchType::Constants, static_cast<uint32_t>(item), static_cast<uint32_t>(runEnd - item), 0 };
+
+        // Without constant buffer ranges, a single model is also drawn instanced if it can be, to avoid updating the constant buffer
+        if (material.instancedVertexShader != nullptr && (batch.numItems > 1 || !constantRanges))
+        {
+            batch.type  = BatchType::Instanced;
+            batch.first = static_cast<uint32_t>(mInstances.size());
+            for (size_t i = item; i < runEnd; ++i)
+            {
+                const Draw& instanceDraw = mDraws[mSortItems[i].draw];
+                InstanceData instance;
+                instance.worldMatrix  = instanceDraw.model->CurrentWorldMatrix();
+                instance.objectColour = instanceDraw.objectColour;
+                instance.padding      = 0;
+                mInstances.push_back(instance);
+            }
+        }
+        else if (constantRanges)
+        {
+            // Start from the scene's per-model constants so values it sets for all models (e.g. textureShiftFactor) are kept
+            batch.type  = BatchType::RangeConstants;
+            batch.first = static_cast<uint32_t>(mModelConstants.size());
+            mModelConstants.resize(mModelConstants.size() + 1);
+            PerModelConstants& constants = mModelConstants.back().constants;
+            constants = gPerModelConstants;
+            constants.worldMatrix  = draw.model->CurrentWorldMatrix();
+            constants.objectColour = draw.objectColour;
+        }
+
+        mBatches.push_back(batch);
+        item = runEnd;
+    }
+}
+
+
+// Write data to a ring buffer at the next offset that is a multiple of alignment, creating or growing the buffer as needed
+bool RenderQueue::WriteRing(RenderContext& context, RingBuffer& ring, BufferType type, const void* data, size_t size, size_t alignment,
+                            size_t& offset)
+{
+    // If the data won't fit in the whole buffer, replace it with one at least twice the size so this soon stops happening
+    if (size > ring.size)
+    {
+        size_t newSize = std::max({ size, ring.size * 2, MIN_RING_SIZE });
+        gRenderDevice->Release(ring.buffer);
+        ring = RingBuffer();
+        ring.buffer = gRenderDevice->CreateBuffer(type, newSize, nullptr);
+        if (ring.buffer == nullptr)  return false;
+        ring.size = newSize;
+    }
+
+    // Write after the previous data, or back at the start (discarding everything) if there isn't room
+    offset = (ring.head + alignment - 1) / alignment * alignment;
+    if (offset + size > ring.size)  offset = 0;
+
+    context.UpdateBufferRange(ring.buffer, offset, data, size);
+    ring.head = offset + size;
+    return true;
+}
+
+
+// Set the given shader/texture/state if it is different from the current one (or always if forceAll is set)
+void RenderQueue::ApplyMaterial(RenderContext& context, const RenderMaterial& material, GpuVertexShader* vertexShader, bool forceAll)
+{
+    if (forceAll || vertexShader != mVertexShader)
+    {
+        context.SetVertexShader(vertexShader);
+        mVertexShader = vertexShader;
+        ++mStats.shaderChanges;
+    }
+    if (forceAll || material.pixelShader != mPixelShader)
+    {
+        context.SetPixelShader(material.pixelShader);
+        mPixelShader = material.pixelShader;
+        ++mStats.shaderChanges;
+    }
+
+    // Slots the material doesn't use are left as they are
+    for (int slot = 0; slot < MAX_MATERIAL_TEXTURES; ++slot)
+    {
+        if (material.textures[slot] != nullptr && (forceAll || material.textures[slot] != mTextures[slot]))
+        {
+            context.SetTexture(slot, material.textures[slot]);
+            mTextures[slot] = material.textures[slot];
+            ++mStats.textureChanges;
+        }
+    }
+
+    if (forceAll || material.sampler != mSampler)
+    {
+        context.SetSampler(0, material.sampler);
+        mSampler = material.sampler;
+        ++mStats.stateChanges;
+    }
+    if (forceAll || material.blendMode != mBlendMode)
+    {
+        context.SetBlendMode(material.blendMode);
+        mBlendMode = material.blendMode;
+        ++mStats.stateChanges;
+    }
+    if (forceAll || material.depthMode != mDepthMode)
+    {
+        context.SetDepthMode(material.depthMode);
+        mDepthMode = material.depthMode;
+        ++mStats.stateChanges;
+    }
+    if (forceAll || material.cullMode != mCullMode)
+    {
+        context.SetCullMode(material.cullMode);
+        mCullMode = material.cullMode;
+        ++mStats.stateChanges;
+    }
+}
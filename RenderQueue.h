@@ -0,0 +1,262 @@
+//--------------------------------------------------------------------------------------
+// Render queue
+//--------------------------------------------------------------------------------------
+// Rather than drawing each model as soon as it is found to be visible, the scene submits each one to the queue
+// along with its material (shaders, textures and states). When everything has been submitted the queue sorts
+// the draws into an order that needs as few GPU state changes as possible, then draws them, only sending a
+// state to the GPU when it is different from the state already set.
+//
+// The order comes from a 64-bit sort key built for each draw. Things that are expensive to change go in the
+// most significant bits so draws sharing them end up together after sorting. Opaque models are drawn first,
+// grouped by shader, then texture, then mesh, and roughly front-to-back within a group so the depth buffer
+// can reject hidden pixels early. Blended models (e.g. additive lights) are drawn last and must be drawn
+// back-to-front to appear correctly, so for them the depth comes straight after the pass. Key layout, most
+// significant bits first:
+//
+//   Opaque pass:   | pass (2) | blend (2) | shader (12) | texture (14) | mesh (14) | depth (20)          |
+//   Blended pass:  | pass (2) | inverted depth (20)      | blend (2) | shader (12) | texture (14) | mesh (14) |
+//
+// The keys are sorted with a radix sort, which takes the same short time for any order of submission.
+//
+// After sorting, models sharing a mesh and material are next to each other. If the material has an instanced vertex
+// shader, each such run is drawn with a single instanced draw call, the world matrices and colours being copied into
+// an instance buffer rather than a constant buffer update and draw call for each model.
+//
+// The per-model data for every draw is gathered before anything is drawn and sent to the GPU in one write per buffer,
+// rather than a write (a Map/Unmap in Direct3D) per model. Constants for models drawn on their own go into one large
+// constant buffer, each draw selecting its own part of it (SetConstantBufferRange). Both this buffer and the instance
+// buffer are used as rings - each Execute writes after the data of the last, so nothing the GPU may still be reading
+// is overwritten. GPUs without constant buffer ranges (before Direct3D 11.1) draw models that have an instanced shader
+// as single instances, their data read from the instance buffer by instance number, and only models without one need
+// their own constant buffer update.
+//
+// Execute sends its commands to the render context it is given. Each queue keeps its own draws, ring buffers and
+// current states, so several queues can be executed at once on different threads, each to its own deferred context
+// (see Renderer.h), e.g. one queue for each camera view.
+
+#include "Renderer.h"
+#include "Common.h"
+#include "CVector3.h"
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#ifndef _RENDER_QUEUE_H_INCLUDED_
+#define _RENDER_QUEUE_H_INCLUDED_
+
+class Model;
+class Mesh;
+
+
+//--------------------------------------------------------------------------------------
+// Materials
+//--------------------------------------------------------------------------------------
+
+// Number of texture slots a material can use
+const int MAX_MATERIAL_TEXTURES = 2;
+
+// Everything the GPU needs set up to draw a model, apart from its geometry and constants
+struct RenderMaterial
+{
+    GpuVertexShader* vertexShader = nullptr;
+    GpuVertexShader* instancedVertexShader = nullptr; // Optional version of the vertex shader reading InstanceData (see Renderer.h)
+    GpuPixelShader*  pixelShader  = nullptr;
+    GpuTexture*      textures[MAX_MATERIAL_TEXTURES] = {}; // Texture for each slot, nullptr for slots the shaders don't use
+    SamplerMode      sampler      = SamplerMode::Anisotropic4x; // Used in slot 0
+
+    // Any blend mode other than None puts the model in the blended pass, drawn back-to-front after all opaque models
+    BlendMode        blendMode    = BlendMode::None;
+    DepthMode        depthMode    = DepthMode::ReadWrite;
+    CullMode         cullMode     = CullMode::Back;
+};
+
+
+// Counts of the work done by RenderQueue::Execute
+struct RenderQueueStats
+{
+    int draws          = 0; // Models drawn
+    int drawCalls      = 0; // Single or instanced model renders, each is one draw call per sub-mesh
+    int instancedDraws = 0; // Instanced renders, included in drawCalls
+    int bufferWrites   = 0; // Constant and instance buffer writes (Map/Unmap in Direct3D)
+    int shaderChanges  = 0; // Vertex or pixel shader changes
+    int textureChanges = 0; // Texture changes, counting each slot separately
+    int stateChanges   = 0; // Blend, depth, cull or sampler changes
+    int meshChanges    = 0; // Vertex/index buffer changes, a model with the same mesh as the last draw doesn't need any
+};
+
+
+//--------------------------------------------------------------------------------------
+// Render queue class
+//--------------------------------------------------------------------------------------
+
+class RenderQueue
+{
+public:
+    //-------------------------------------
+    // Materials
+    //-------------------------------------
+
+    // Add a material to the queue, returns the value to pass to Submit to use it. Materials should be added at
+    // start-up - the shader and texture combinations are numbered here for the sort keys
+    int AddMaterial(const RenderMaterial& material);
+
+    // Use the same materials and mesh numbers as another queue, so material values from its AddMaterial can be passed to
+    // this queue too. Call once all the materials and meshes have been added to the other queue
+    void CopyMaterials(const RenderQueue& source);
+
+    // Change the texture a material uses in one slot, e.g. to switch between render targets of different sizes. Takes
+    // effect from the next Execute. The material keeps its texture number in the sort keys, so for the best grouping use
+    // a texture no other material uses (draws are correct either way)
+    void SetMaterialTexture(int material, int slot, GpuTexture* texture);
+
+    // Remove all materials and any draws submitted using them, and release the instance and constant buffers. Call before
+    // releasing the shaders and textures used by the materials and before the renderer is shut down
+    void Release();
+
+
+    //-------------------------------------
+    // Drawing
+    //-------------------------------------
+
+    // Start a new list of draws. Pass the furthest distance that will be submitted (e.g. the camera's far clip distance),
+    // distances are stored with limited accuracy relative to this
+    void Begin(float maxDistance);
+
+    // Add a model to draw with the given material. Pass its distance from the camera, used to order draws within a group
+    // (and for all blended models). The object colour is copied into the per-model constants when it is drawn
+    void Submit(Model* model, int material, float distance, const CVector3& objectColour = { 1, 1, 1 });
+
+    // Draws can also be submitted from several threads at once (e.g. jobs, see JobSystem.h): after Begin, set the total
+    // number of draws with Resize, then each thread fills its own slots with SubmitAt, which is the same as Submit
+    // otherwise. Meshes are numbered for the sort keys as they are first seen, which isn't safe from several threads, so
+    // meshes used with SubmitAt must have been numbered with AddMesh (other meshes all share one number)
+    void AddMesh(Mesh* mesh)  { MeshId(mesh); }
+    void Resize(int numDraws);
+    void SubmitAt(int index, Model* model, int material, float distance, const CVector3& objectColour = { 1, 1, 1 });
+
+    // Sort the submitted draws by their keys. Without this, Execute draws in the order submitted
+    void Sort();
+
+    // Draw everything submitted with the given render context, setting only the GPU states that differ from the previous
+    // draw. States are all set for the first draw as other code may have changed them since the last call. Returns the
+    // changes made
+    const RenderQueueStats& Execute(RenderContext& context);
+
+
+    //-------------------------------------
+    // Data access
+    //-------------------------------------
+
+    int NumDraws()  { return static_cast<int>(mDraws.size()); }
+
+    // Stats from the last call to Execute
+    const RenderQueueStats& Stats()  { return mStats; }
+
+
+    //-------------------------------------
+    // Private data / members
+    //-------------------------------------
+private:
+    // Material and the numbers used for it in sort keys
+    struct MaterialEntry
+    {
+        RenderMaterial material;
+        uint32_t       shaderId;  // Same number for materials using the same pair of shaders
+        uint32_t       textureId; // Same number for materials using the same textures
+    };
+
+    // One submitted model
+    struct Draw
+    {
+        Model*   model;
+        int      material;
+        CVector3 objectColour;
+    };
+
+    // Sort key and the draw it is for. Sorted rather than the draws themselves as it is smaller to move around
+    struct SortItem
+    {
+        uint64_t key;
+        uint32_t draw; // Index into mDraws
+    };
+
+    // How a batch of sorted draws is drawn, decided before drawing so the per-model data can be sent to the GPU up front
+    enum class BatchType
+    {
+        Instanced,      // Any number of models sharing a mesh and material in one instanced draw, data in the instance buffer
+        RangeConstants, // One model whose constants are a range of the shared constant buffer
+        Constants,      // One model whose constants are sent with their own update of gPerModelConstantBuffer
+    };
+
+    struct Batch
+    {
+        BatchType type;
+        uint32_t  firstItem; // Index into mSortItems
+        uint32_t  numItems;
+        uint32_t  first;     // First instance, or constant range number, used by the batch
+    };
+
+    // Per-model constants padded to the size of a constant buffer range
+    struct ModelConstants
+    {
+        PerModelConstants constants;
+        uint8_t           padding[CONSTANT_BUFFER_ALIGNMENT - sizeof(PerModelConstants)];
+    };
+
+    // A dynamic buffer written as a ring (see RenderContext::UpdateBufferRange). Created on first use, and replaced with a
+    // larger one when a single Execute needs more space than it has
+    struct RingBuffer
+    {
+        GpuBuffer* buffer = nullptr;
+        size_t     size   = 0;
+        size_t     head   = 0; // Offset of the next write
+    };
+
+    // Returns the number used in sort keys for the given mesh, numbering meshes as they are first seen
+    uint32_t MeshId(Mesh* mesh);
+
+    // Returns the sort key for a draw with the given material entry, mesh number and distance from the camera
+    uint64_t SortKey(const MaterialEntry& entry, uint32_t meshId, float distance);
+
+    // Split the sorted draws into batches and gather the per-model data they need into mInstances and mModelConstants
+    void BuildBatches(bool constantRanges);
+
+    // Write data to a ring buffer at the next offset that is a multiple of alignment, creating or growing the buffer as
+    // needed. The offset used is returned in the last parameter. Returns false on failure
+    bool WriteRing(RenderContext& context, RingBuffer& ring, BufferType type, const void* data, size_t size, size_t alignment,
+                   size_t& offset);
+
+    // Set the given shader/texture/state if it is different from the current one (or always if forceAll is set)
+    void ApplyMaterial(RenderContext& context, const RenderMaterial& material, GpuVertexShader* vertexShader, bool forceAll);
+
+    std::vector<MaterialEntry> mMaterials;
+    std::unordered_map<Mesh*, uint32_t> mMeshIds;
+
+    float mMaxDistance = 1;
+
+    std::vector<Draw>     mDraws;
+    std::vector<SortItem> mSortItems;
+    std::vector<SortItem> mSortBuffer; // Second array for the radix sort to move items between
+
+    // Per-model data for the draws of one Execute is gathered here then copied to the GPU with one write to each ring
+    std::vector<Batch>          mBatches;
+    std::vector<InstanceData>   mInstances;
+    std::vector<ModelConstants> mModelConstants;
+    RingBuffer                  mInstanceRing;
+    RingBuffer                  mConstantRing;
+
+    // GPU state set by the last Execute
+    GpuVertexShader* mVertexShader = nullptr;
+    GpuPixelShader*  mPixelShader  = nullptr;
+    GpuTexture*      mTextures[MAX_MATERIAL_TEXTURES] = {};
+    SamplerMode      mSampler   = SamplerMode::Anisotropic4x;
+    BlendMode        mBlendMode = BlendMode::None;
+    DepthMode        mDepthMode = DepthMode::ReadWrite;
+    CullMode         mCullMode  = CullMode::Back;
+
+    RenderQueueStats mStats;
+};
+
+
+#endif //_RENDER_QUEUE_H_INCLUDED_
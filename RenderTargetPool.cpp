@@ -0,0 +1,126 @@
+//--------------------------------------------------------------------------------------
+// Render target pool
+//--------------------------------------------------------------------------------------
+
+#include "RenderTargetPool.h"
+#include "Common.h"
+#include "FrameStats.h"
+
+#include <cassert>
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+RenderTargetPool gRenderTargetPool;
+
+
+//--------------------------------------------------------------------------------------
+// Construction / Usage
+//--------------------------------------------------------------------------------------
+
+// Returns a render target of at least the given size, rounded up to its bucket. Reuses a released target of that size
+// if there is one, otherwise creates one. Returns nullptr on failure
+GpuRenderTarget* RenderTargetPool::Acquire(int width, int height)
+{
+    width  = BucketSize(width);
+    height = BucketSize(height);
+
+    for (auto& target : mTargets)
+    {
+        if (!target.inUse && target.width == width && target.height == height)
+        {
+            target.inUse = true;
+            mMemoryUnused -= target.memory;
+            mMemoryInUse  += target.memory;
+            ++gFrameStats.renderTargetsReused;
+            return target.renderTarget;
+        }
+    }
+
+    GpuRenderTarget* renderTarget = gRenderDevice->CreateRenderTarget(width, height);
+    if (renderTarget == nullptr)  return nullptr;
+
+    size_t memory = static_cast<size_t>(width) * height * (4 + 4); // RGBA8 colour and D32 depth
+    mTargets.push_back({ renderTarget, width, height, memory, true, mFrame });
+    mMemoryInUse += memory;
+    ++gFrameStats.renderTargetsCreated;
+    return renderTarget;
+}
+
+
+// Give a target from Acquire back to the pool to be reused
+void RenderTargetPool::Release(GpuRenderTarget* renderTarget)
+{
+    if (renderTarget == nullptr)  return;
+
+    for (auto& target : mTargets)
+    {
+        if (target.renderTarget == renderTarget)
+        {
+            assert(target.inUse);
+            target.inUse = false;
+            target.releasedFrame = mFrame;
+            mMemoryInUse  -= target.memory;
+            mMemoryUnused += target.memory;
+            return;
+        }
+    }
+    assert(false && "Render target not from this pool");
+}
+
+
+// Call once per frame. Frees the released targets that haven't been acquired again for more than KeepFrames frames
+void RenderTargetPool::EndFrame()
+{
+    ++mFrame;
+    for (size_t i = 0; i < mTargets.size(); )
+    {
+        PooledTarget& target = mTargets[i];
+        if (!target.inUse && mFrame - target.releasedFrame > mKeepFrames)
+        {
+            gRenderDevice->Release(target.renderTarget);
+            mMemoryUnused -= target.memory;
+            ++gFrameStats.renderTargetsFreed;
+            target = mTargets.back(); // Order doesn't matter, move the last one into the gap
+            mTargets.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+
+// Free all the released targets. All acquired targets must have been released first
+void RenderTargetPool::Clear()
+{
+    for (auto& target : mTargets)
+    {
+        assert(!target.inUse);
+        gRenderDevice->Release(target.renderTarget);
+    }
+    mTargets.clear();
+    mMemoryInUse  = 0;
+    mMemoryUnused = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Data access
+//--------------------------------------------------------------------------------------
+
+// The size a target asked for at the given width or height will actually be. Sizes up to 16 use 16, above that there
+// are four buckets from each power of two up to the next
+int RenderTargetPool::BucketSize(int size)
+{
+    const int MIN_BUCKET = 16;
+    if (size <= MIN_BUCKET)  return MIN_BUCKET;
+
+    int powerOfTwo = MIN_BUCKET;
+    while (powerOfTwo * 2 <= size)  powerOfTwo *= 2;
+    int step = powerOfTwo / 4;
+    return (size + step - 1) / step * step;
+}
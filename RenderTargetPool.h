@@ -0,0 +1,103 @@
+//--------------------------------------------------------------------------------------
+// Render target pool
+//--------------------------------------------------------------------------------------
+// Render targets that change size while the app runs (e.g. the portal, rendered at a size to suit how large it is on
+// screen) would otherwise be created and released each time the size changes, which is slow and fragments GPU memory.
+// Instead they are taken from the pool with Acquire and given back with Release, and the pool keeps released targets to
+// hand out again.
+//
+// Sizes are rounded up to a bucket, so a target asked for at a slightly different size reuses one already made. There
+// are four buckets between each power of two and the next (e.g. 64, 80, 96, 112, 128), so a target is at most 25% larger
+// than asked for in each direction. Targets released to the pool and not acquired again for a while are freed in
+// EndFrame, so memory isn't held forever for sizes that are no longer used.
+//
+// The pool counts the targets created, freed and reused each frame in gFrameStats (see FrameStats.h) to show how often
+// targets are being churned, and reports the memory used by the targets it holds.
+
+#ifndef _RENDER_TARGET_POOL_H_INCLUDED_
+#define _RENDER_TARGET_POOL_H_INCLUDED_
+
+#include "Renderer.h"
+
+#include <vector>
+#include <cstddef>
+
+
+//--------------------------------------------------------------------------------------
+// Render target pool class
+//--------------------------------------------------------------------------------------
+
+class RenderTargetPool
+{
+public:
+    //-------------------------------------
+    // Construction / Usage
+    //-------------------------------------
+
+    // Returns a render target of at least the given size, the size rounded up to its bucket (see BucketSize). Reuses a
+    // target released earlier if there is one of that size, otherwise creates one with gRenderDevice. The content of a
+    // reused target is whatever was last rendered to it. Returns nullptr on failure
+    GpuRenderTarget* Acquire(int width, int height);
+
+    // Give a target from Acquire back to the pool to be reused. Passing nullptr is allowed and does nothing
+    void Release(GpuRenderTarget* renderTarget);
+
+    // Call once per frame. Frees the released targets that haven't been acquired again for more than KeepFrames frames
+    void EndFrame();
+
+    // Free all the released targets. All acquired targets must have been released first. Call before the renderer is
+    // shut down
+    void Clear();
+
+
+    //-------------------------------------
+    // Data access
+    //-------------------------------------
+
+    // The size a target asked for at the given width or height will actually be
+    static int BucketSize(int size);
+
+    // Number of frames a released target is kept for reuse before it is freed
+    int  KeepFrames()                  { return mKeepFrames; }
+    void SetKeepFrames(int keepFrames)  { mKeepFrames = keepFrames; }
+
+    // Estimated GPU memory in bytes of the targets acquired and of those released but kept for reuse. Counts four bytes
+    // a pixel for the colour and four for the depth buffer
+    size_t MemoryInUse()   { return mMemoryInUse; }
+    size_t MemoryUnused()  { return mMemoryUnused; }
+
+    int NumTargets()  { return static_cast<int>(mTargets.size()); }
+
+
+    //-------------------------------------
+    // Private data / members
+    //-------------------------------------
+private:
+    struct PooledTarget
+    {
+        GpuRenderTarget* renderTarget;
+        int    width;
+        int    height;
+        size_t memory;
+        bool   inUse;
+        int    releasedFrame; // Frame it was last released, to free it when it hasn't been used for a while
+    };
+
+    std::vector<PooledTarget> mTargets;
+
+    int    mFrame        = 0;
+    int    mKeepFrames   = 120;
+    size_t mMemoryInUse  = 0;
+    size_t mMemoryUnused = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+// The render targets of the scene (see SceneObjects.h) and any others whose size changes come from this pool
+extern RenderTargetPool gRenderTargetPool;
+
+
+#endif //_RENDER_TARGET_POOL_H_INCLUDED_
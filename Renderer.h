@@ -0,0 +1,270 @@
+//--------------------------------------------------------------------------------------
+// Rendering interface
+//--------------------------------------------------------------------------------------
+// A thin layer between the scene code and the graphics API. The scene, meshes, models and shaders create
+// GPU resources through a RenderDevice and issue rendering commands through a RenderContext, rather than
+// calling Direct3D directly. There are two implementations:
+// - RendererD3D11.h: the Direct3D 11 renderer used by the app on Windows
+// - RendererNull.h:  a renderer that does no GPU work, only records the commands it is given. It runs on
+//                    any platform without a GPU, so the CPU side of the app can be run and timed headless
+//
+// GPU resources are passed around as pointers to the types declared below. These types are never defined
+// outside the renderers - each renderer converts them to its own objects (e.g. a GpuBuffer* from the Direct3D
+// renderer is really an ID3D11Buffer*). So only pass a resource back to the renderer that created it.
+//
+// Rendering commands can be recorded on several threads at once. The context in gRenderContext sends commands
+// straight to the GPU (the "immediate" context), it can create "deferred" contexts that instead record their commands
+// into a command list, which is later run on the immediate context. Each thread records on its own deferred context,
+// then the main thread runs the lists in the order they should be drawn. The device can be used from any thread,
+// a context by only one thread at a time.
+
+#ifndef _RENDERER_H_INCLUDED_
+#define _RENDERER_H_INCLUDED_
+
+#include "MeshData.h"
+#include "CMatrix4x4.h"
+#include "ColourRGBA.h"
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// GPU resources
+//--------------------------------------------------------------------------------------
+
+struct GpuBuffer;       // Vertex, index or constant buffer
+struct GpuTexture;      // Texture that can be used in shaders
+struct GpuRenderTarget; // Texture (and depth buffer) that can be rendered to, or the back buffer
+struct GpuVertexShader;
+struct GpuPixelShader;
+struct GpuVertexLayout; // Description of the data in each vertex, matched to vertex shader inputs
+struct GpuCommandList;  // Commands recorded on a deferred context, see RenderContext::FinishCommandList
+
+enum class BufferType
+{
+    Vertex,
+    Index,
+    Constant, // Constant buffers are always dynamic, the CPU replaces their content with UpdateBuffer
+    Instance, // Per-instance data for instanced drawing (see InstanceData below), also dynamic
+};
+
+enum class IndexFormat
+{
+    UInt16,
+    UInt32,
+};
+
+
+// Constant buffer ranges (see SetConstantBufferRange) must start on a multiple of this many bytes and their sizes are
+// rounded up to it
+const size_t CONSTANT_BUFFER_ALIGNMENT = 256;
+
+
+// The data for each instance when drawing many copies of a mesh in one draw call (DrawIndexedInstanced). An instance
+// buffer holds an array of these, which must match InstanceData in Common.hlsli
+struct InstanceData
+{
+    CMatrix4x4 worldMatrix;
+    CVector3   objectColour;
+    float      padding;
+};
+
+
+//--------------------------------------------------------------------------------------
+// GPU states
+//--------------------------------------------------------------------------------------
+// Fixed set of states used by the app, the renderers create the matching API objects up front
+
+enum class SamplerMode
+{
+    Point,
+    Trilinear,
+    Anisotropic4x,
+};
+
+enum class BlendMode
+{
+    None,
+    Additive,
+    Multiplicative,
+    Alpha,
+};
+
+enum class CullMode
+{
+    Back,
+    Front,
+    None,
+};
+
+enum class DepthMode
+{
+    ReadWrite, // Normal depth buffer use
+    ReadOnly,  // Test against the depth buffer but don't write to it, e.g. for blended models
+    Disabled,
+};
+
+
+//--------------------------------------------------------------------------------------
+// Render device - creates and releases GPU resources
+//--------------------------------------------------------------------------------------
+// Functions that create resources return nullptr on failure
+
+class RenderDevice
+{
+public:
+    virtual ~RenderDevice() {}
+
+    // Create a buffer of the given size in bytes. Vertex and index buffers must be given their initial data, which
+    // can't be changed later. Constant buffer data can be nullptr
+    virtual GpuBuffer* CreateBuffer(BufferType type, size_t size, const void* initialData) = 0;
+
+    // Returns the vertex layout for the given vertex description (see MeshData.h). Layouts are shared between all
+    // meshes with the same description and are owned by the device - do not release them
+    virtual GpuVertexLayout* GetVertexLayout(const std::vector<VertexElement>& vertexElements) = 0;
+
+    // As above, but the layout also reads an InstanceData for each instance from a second buffer (see SetInstanceBuffer).
+    // Used with instanced vertex shaders
+    virtual GpuVertexLayout* GetInstancedVertexLayout(const std::vector<VertexElement>& vertexElements) = 0;
+
+    // Load a texture from a file (.dds, .jpg, .png etc.)
+    virtual GpuTexture* LoadTexture(const std::string& fileName) = 0;
+
+    // As above, from the content of a texture file already read into memory, so the file can be read on another thread
+    // (see AssetLoader.h). The file name is only used to tell the type of file from its extension
+    virtual GpuTexture* CreateTextureFromMemory(const void* data, size_t size, const std::string& fileName) = 0;
+
+    // Create a texture from 32-bit RGBA pixels (red in the lowest byte), e.g. a placeholder used until a texture is loaded
+    virtual GpuTexture* CreateTexture(int width, int height, const uint32_t* pixels) = 0;
+
+    // Estimated GPU memory in bytes used by a texture, including its mip-maps
+    virtual size_t TextureMemory(GpuTexture* texture) = 0;
+
+    // Create a texture that can be rendered to and then used in shaders, with its own depth buffer
+    virtual GpuRenderTarget* CreateRenderTarget(int width, int height) = 0;
+
+    // Returns the texture of a render target to use in shaders. Owned by the render target - do not release it
+    virtual GpuTexture* RenderTargetTexture(GpuRenderTarget* renderTarget) = 0;
+
+    // Returns the render target for the window (back buffer and main depth buffer). Owned by the device
+    virtual GpuRenderTarget* BackBuffer() = 0;
+
+    // Get the size in pixels of a render target (or the back buffer)
+    virtual void RenderTargetSize(GpuRenderTarget* renderTarget, int& width, int& height) = 0;
+
+    // Load a compiled shader (.cso file), pass the name without the extension
+    virtual GpuVertexShader* LoadVertexShader(const std::string& shaderName) = 0;
+    virtual GpuPixelShader*  LoadPixelShader (const std::string& shaderName) = 0;
+
+    // Release resources created above. Passing nullptr is allowed and does nothing
+    virtual void Release(GpuBuffer*       buffer)       = 0;
+    virtual void Release(GpuTexture*      texture)      = 0;
+    virtual void Release(GpuRenderTarget* renderTarget) = 0;
+    virtual void Release(GpuVertexShader* shader)       = 0;
+    virtual void Release(GpuPixelShader*  shader)       = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Render context - rendering commands
+//--------------------------------------------------------------------------------------
+
+class RenderContext
+{
+public:
+    virtual ~RenderContext() {}
+
+    // Select where to render. The viewport is set to cover the whole target
+    virtual void SetRenderTarget(GpuRenderTarget* renderTarget) = 0;
+
+    // Clear the colour and depth buffer of a render target
+    virtual void Clear(GpuRenderTarget* renderTarget, const ColourRGBA& colour) = 0;
+
+    // Select shaders for following draws
+    virtual void SetVertexShader(GpuVertexShader* shader) = 0;
+    virtual void SetPixelShader (GpuPixelShader*  shader) = 0;
+
+    // Select states for following draws
+    virtual void SetBlendMode(BlendMode mode) = 0;
+    virtual void SetDepthMode(DepthMode mode) = 0;
+    virtual void SetCullMode (CullMode  mode) = 0;
+
+    // Select a texture / sampler for the given slot in the pixel shader
+    virtual void SetTexture(int slot, GpuTexture* texture) = 0;
+    virtual void SetSampler(int slot, SamplerMode mode)    = 0;
+
+    // Make a constant buffer available to both the vertex and pixel shader in the given slot
+    virtual void SetConstantBuffer(int slot, GpuBuffer* buffer) = 0;
+
+    // Replace the content of a constant or instance buffer. The size can be less than the buffer size (e.g. to only
+    // send the instances used), any data after that is undefined
+    virtual void UpdateBuffer(GpuBuffer* buffer, const void* data, size_t size) = 0;
+
+    // Returns true if the two functions below can be used with constant buffers, so the constants for many draws can
+    // be sent in one large buffer. Needs Direct3D 11.1, without it each draw's constants need their own UpdateBuffer
+    virtual bool SupportsConstantBufferRanges() = 0;
+
+    // Make part of a constant buffer available to both the vertex and pixel shader in the given slot, the shaders see
+    // it as if it were the whole buffer. The offset must be a multiple of CONSTANT_BUFFER_ALIGNMENT
+    virtual void SetConstantBufferRange(int slot, GpuBuffer* buffer, size_t offset, size_t size) = 0;
+
+    // Write data into part of a constant or instance buffer, leaving the rest unchanged. Used to treat a buffer as a "ring":
+    // the GPU may still be drawing with data written earlier, so each write must go after the last one. When the buffer is
+    // full start again at offset 0, which discards all the old content (the GPU keeps its copy until it has finished with it)
+    virtual void UpdateBufferRange(GpuBuffer* buffer, size_t offset, const void* data, size_t size) = 0;
+
+    // Select geometry for following draws. Always uses triangle lists
+    virtual void SetVertexBuffer(GpuBuffer* buffer, unsigned int vertexSize) = 0;
+    virtual void SetIndexBuffer (GpuBuffer* buffer, IndexFormat format)      = 0;
+    virtual void SetVertexLayout(GpuVertexLayout* layout)                    = 0;
+
+    // Select the instance buffer for following instanced draws, an array of InstanceData
+    virtual void SetInstanceBuffer(GpuBuffer* buffer) = 0;
+
+    // Draw indexed triangles with the current settings. baseVertex is added to each index
+    virtual void DrawIndexed(unsigned int numIndices, unsigned int firstIndex, int baseVertex) = 0;
+
+    // Draw several copies of indexed triangles in one call, using numInstances entries from the instance buffer
+    // starting at firstInstance. Needs an instanced vertex layout and vertex shader
+    virtual void DrawIndexedInstanced(unsigned int numIndices, unsigned int numInstances, unsigned int firstIndex,
+                                      int baseVertex, unsigned int firstInstance) = 0;
+
+    // Show the back buffer in the window, optionally waiting for vsync. Immediate context only
+    virtual void Present(bool vsync) = 0;
+
+
+    //-------------------------------------
+    // Deferred contexts / command lists
+    //-------------------------------------
+
+    // Create a deferred context, which records the commands it is given rather than running them. Its command lists are
+    // run on this context. It starts with nothing selected (no render target, shaders, buffers or states) and reports the
+    // same SupportsConstantBufferRanges as this context. Delete it when finished with. Returns nullptr on failure, or if
+    // this context is itself deferred
+    virtual RenderContext* CreateDeferredContext() = 0;
+
+    // Deferred context only: returns the commands recorded since the context was created or last finished, ready to pass
+    // to ExecuteCommandList. Everything the commands selected is cleared, so the next list starts with nothing selected
+    // again. Returns nullptr on failure or on an immediate context
+    virtual GpuCommandList* FinishCommandList() = 0;
+
+    // Immediate context only: run the commands in a list from FinishCommandList, then release the list. Buffer writes in
+    // the list happen when it runs, in order with the writes made on this context. Everything selected on this context
+    // before the list is cleared, so select again whatever is needed after it
+    virtual void ExecuteCommandList(GpuCommandList* commandList) = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+// The renderer used by the app, created at start-up (see Direct3DSetup.cpp, or the SceneBench tool for headless use)
+
+extern RenderDevice*  gRenderDevice;
+extern RenderContext* gRenderContext;
+
+
+#endif //_RENDERER_H_INCLUDED_
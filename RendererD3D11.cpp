@@ -0,0 +1,791 @@
+//--------------------------------------------------------------------------------------
+// Direct3D 11 renderer
+//--------------------------------------------------------------------------------------
+// See RendererD3D11.h for the Direct3D objects behind each resource type
+
+#include "RendererD3D11.h"
+#include "VertexLayoutCache.h"
+#include "State.h"
+#include "FrameStats.h"
+
+#include <WICTextureLoader.h>
+#include <DDSTextureLoader.h>
+#include <atlbase.h> // C-string to unicode conversion function CA2CT
+
+#include <fstream>
+#include <vector>
+#include <sstream>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------
+// Resource type conversion
+//--------------------------------------------------------------------------------------
+
+namespace
+{
+    ID3D11Buffer*             D3DBuffer      (GpuBuffer*       buffer)       { return reinterpret_cast<ID3D11Buffer*>(buffer); }
+    ID3D11ShaderResourceView* D3DTexture     (GpuTexture*      texture)      { return reinterpret_cast<ID3D11ShaderResourceView*>(texture); }
+    D3D11RenderTarget*        D3DRenderTarget(GpuRenderTarget* renderTarget) { return reinterpret_cast<D3D11RenderTarget*>(renderTarget); }
+    ID3D11VertexShader*       D3DShader      (GpuVertexShader* shader)       { return reinterpret_cast<ID3D11VertexShader*>(shader); }
+    ID3D11PixelShader*        D3DShader      (GpuPixelShader*  shader)       { return reinterpret_cast<ID3D11PixelShader*>(shader); }
+    ID3D11InputLayout*        D3DVertexLayout(GpuVertexLayout* layout)       { return reinterpret_cast<ID3D11InputLayout*>(layout); }
+
+
+    // Read a compiled shader object file (.cso) into a vector of chars, returns false on failure
+    bool LoadShaderByteCode(const std::string& shaderName, std::vector<char>& byteCode)
+    {
+        // Open compiled shader object file
+        std::ifstream shaderFile(shaderName + ".cso", std::ios::in | std::ios::binary | std::ios::ate);
+        if (!shaderFile.is_open())
+        {
+            return false;
+        }
+
+        // Read file into vector of chars
+        std::streamoff fileSize = shaderFile.tellg();
+        shaderFile.seekg(0, std::ios::beg);
+        byteCode.resize(static_cast<size_t>(fileSize));
+        shaderFile.read(byteCode.data(), fileSize);
+        return !shaderFile.fail();
+    }
+
+
+    // True if the file name has a .dds extension (case insensitive). DDS files need different loading functions from
+    // other image files
+    bool IsDDSFile(const std::string& fileName)
+    {
+        std::string dds = ".dds";
+        return fileName.size() >= 4 &&
+               std::equal(dds.rbegin(), dds.rend(), fileName.rbegin(), [](unsigned char a, unsigned char b) { return std::tolower(a) == std::tolower(b); });
+    }
+
+
+    // Bits per pixel of the texture formats the app's textures use, for estimating texture memory. Block compressed
+    // formats are marked, they store blocks of 4x4 pixels. Other formats are assumed to be 32 bits
+    size_t FormatBitsPerPixel(DXGI_FORMAT format, bool& blockCompressed)
+    {
+        blockCompressed = false;
+        switch (format)
+        {
+            case DXGI_FORMAT_BC1_TYPELESS:  case DXGI_FORMAT_BC1_UNORM:  case DXGI_FORMAT_BC1_UNORM_SRGB:
+            case DXGI_FORMAT_BC4_TYPELESS:  case DXGI_FORMAT_BC4_UNORM:  case DXGI_FORMAT_BC4_SNORM:
+                blockCompressed = true;
+                return 4;
+
+            case DXGI_FORMAT_BC2_TYPELESS:  case DXGI_FORMAT_BC2_UNORM:  case DXGI_FORMAT_BC2_UNORM_SRGB:
+            case DXGI_FORMAT_BC3_TYPELESS:  case DXGI_FORMAT_BC3_UNORM:  case DXGI_FORMAT_BC3_UNORM_SRGB:
+            case DXGI_FORMAT_BC5_TYPELESS:  case DXGI_FORMAT_BC5_UNORM:  case DXGI_FORMAT_BC5_SNORM:
+            case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16:  case DXGI_FORMAT_BC6H_SF16:
+            case DXGI_FORMAT_BC7_TYPELESS:  case DXGI_FORMAT_BC7_UNORM:  case DXGI_FORMAT_BC7_UNORM_SRGB:
+                blockCompressed = true;
+                return 8;
+
+            case DXGI_FORMAT_R8_UNORM:  case DXGI_FORMAT_A8_UNORM:
+                return 8;
+
+            case DXGI_FORMAT_R8G8_UNORM:  case DXGI_FORMAT_R16_FLOAT:  case DXGI_FORMAT_R16_UNORM:
+            case DXGI_FORMAT_B5G6R5_UNORM:  case DXGI_FORMAT_B5G5R5A1_UNORM:
+                return 16;
+
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:  case DXGI_FORMAT_R16G16B16A16_UNORM:
+                return 64;
+
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+                return 128;
+
+            default:
+                return 32;
+        }
+    }
+
+
+    // Convert a vertex description into a DirectX description of the data in each vertex, all in input slot 0.
+    // Returns false if the description uses data the renderer doesn't support
+    bool ConvertVertexElements(const std::vector<VertexElement>& vertexElements, std::vector<D3D11_INPUT_ELEMENT_DESC>& d3dElements)
+    {
+        for (auto& element : vertexElements)
+        {
+            const char* semanticName = nullptr;
+            switch (element.semantic)
+            {
+                case VertexSemantic::Position:  semanticName = "Position";  break;
+                case VertexSemantic::Normal:    semanticName = "Normal";    break;
+                case VertexSemantic::Tangent:   semanticName = "Tangent";   break;
+                case VertexSemantic::UV:        semanticName = "UV";        break;
+                default:  return false; // Unsupported vertex data
+            }
+
+            DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+            switch (element.format)
+            {
+                case VertexFormat::Float2:     format = DXGI_FORMAT_R32G32_FLOAT;        break;
+                case VertexFormat::Float3:     format = DXGI_FORMAT_R32G32B32_FLOAT;     break;
+                case VertexFormat::UNorm16x4:  format = DXGI_FORMAT_R16G16B16A16_UNORM;  break;
+                case VertexFormat::SNorm16x2:  format = DXGI_FORMAT_R16G16_SNORM;        break;
+                case VertexFormat::Half2:      format = DXGI_FORMAT_R16G16_FLOAT;        break;
+                default:  return false; // Unsupported vertex format
+            }
+
+            d3dElements.push_back( { semanticName, 0, format, 0, element.offset, D3D11_INPUT_PER_VERTEX_DATA, 0 } );
+        }
+        return true;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Render device
+//--------------------------------------------------------------------------------------
+
+D3D11RenderDevice::D3D11RenderDevice()
+{
+    mBackBuffer.width  = gViewportWidth;
+    mBackBuffer.height = gViewportHeight;
+    mBackBuffer.renderTargetView = gBackBufferRenderTarget;
+    mBackBuffer.depthStencilView = gDepthStencil;
+}
+
+
+D3D11RenderDevice::~D3D11RenderDevice()
+{
+    // Report how much work the vertex layout cache saved - without it every mesh compiles a signature shader
+    std::ostringstream layoutReport;
+    layoutReport << "Vertex layouts: " << gVertexLayoutStats.layoutRequests << " meshes, " << gVertexLayoutStats.layoutsCreated
+                 << " layouts created, " << gVertexLayoutStats.signaturesCompiled << " signatures compiled, "
+                 << gVertexLayoutStats.signaturesReused << " signatures reused\n";
+    DebugMessage(layoutReport.str());
+
+    ReleaseVertexLayouts();
+}
+
+
+// Create a buffer of the given size in bytes. Vertex and index buffers must be given their initial data, which
+// can't be changed later. Constant and instance buffer data can be nullptr
+GpuBuffer* D3D11RenderDevice::CreateBuffer(BufferType type, size_t size, const void* initialData)
+{
+    D3D11_BUFFER_DESC bufferDesc = {};
+    bufferDesc.ByteWidth = static_cast<UINT>(size); // Size of the buffer in bytes
+    bufferDesc.MiscFlags = 0;
+    if (type == BufferType::Constant || type == BufferType::Instance)
+    {
+        bufferDesc.BindFlags = (type == BufferType::Constant) ? D3D11_BIND_CONSTANT_BUFFER : D3D11_BIND_VERTEX_BUFFER;
+        bufferDesc.Usage = D3D11_USAGE_DYNAMIC;             // Indicates that the buffer is frequently updated
+        bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE; // CPU is only going to write to the constants (not read them)
+    }
+    else
+    {
+        bufferDesc.BindFlags = (type == BufferType::Vertex) ? D3D11_BIND_VERTEX_BUFFER : D3D11_BIND_INDEX_BUFFER;
+        bufferDesc.Usage = D3D11_USAGE_DEFAULT; // Content never changes after creation
+        bufferDesc.CPUAccessFlags = 0;
+    }
+
+    D3D11_SUBRESOURCE_DATA initData = {};
+    initData.pSysMem = initialData; // Fill the new buffer with the data given
+
+    ID3D11Buffer* buffer;
+    HRESULT hr = gD3DDevice->CreateBuffer(&bufferDesc, initialData ? &initData : nullptr, &buffer);
+    if (FAILED(hr))
+    {
+        return nullptr;
+    }
+
+    return reinterpret_cast<GpuBuffer*>(buffer);
+}
+
+
+// Returns the vertex layout for the given vertex description. Layouts are shared between all meshes with the
+// same description and are owned by the vertex layout cache
+GpuVertexLayout* D3D11RenderDevice::GetVertexLayout(const std::vector<VertexElement>& vertexElements)
+{
+    std::vector<D3D11_INPUT_ELEMENT_DESC> d3dElements;
+    if (!ConvertVertexElements(vertexElements, d3dElements))  return nullptr;
+
+    return reinterpret_cast<GpuVertexLayout*>(::GetVertexLayout(d3dElements.data(), static_cast<int>(d3dElements.size())));
+}
+
+
+// As above, with an InstanceData read from input slot 1 for each instance. The world matrix is passed as four rows
+GpuVertexLayout* D3D11RenderDevice::GetInstancedVertexLayout(const std::vector<VertexElement>& vertexElements)
+{
+    std::vector<D3D11_INPUT_ELEMENT_DESC> d3dElements;
+    if (!ConvertVertexElements(vertexElements, d3dElements))  return nullptr;
+
+    const UINT worldOffset  = static_cast<UINT>(offsetof(InstanceData, worldMatrix));
+    const UINT colourOffset = static_cast<UINT>(offsetof(InstanceData, objectColour));
+    for (UINT row = 0; row < 4; ++row)
+    {
+        d3dElements.push_back( { "InstanceWorld", row, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, worldOffset + row * 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 } );
+    }
+    d3dElements.push_back( { "InstanceColour", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, colourOffset, D3D11_INPUT_PER_INSTANCE_DATA, 1 } );
+
+    return reinterpret_cast<GpuVertexLayout*>(::GetVertexLayout(d3dElements.data(), static_cast<int>(d3dElements.size())));
+}
+
+
+// Using Microsoft's open source DirectX Tool Kit (DirectXTK) to simplify texture loading
+GpuTexture* D3D11RenderDevice::LoadTexture(const std::string& fileName)
+{
+    ID3D11Resource*           texture    = nullptr;
+    ID3D11ShaderResourceView* textureSRV = nullptr;
+
+    // DDS files need a different function from other files
+    HRESULT hr;
+    if (IsDDSFile(fileName))
+    {
+        hr = DirectX::CreateDDSTextureFromFile(gD3DDevice, CA2CT(fileName.c_str()), &texture, &textureSRV);
+    }
+    else
+    {
+        hr = DirectX::CreateWICTextureFromFile(gD3DDevice, gD3DContext, CA2CT(fileName.c_str()), &texture, &textureSRV);
+    }
+    if (FAILED(hr))
+    {
+        return nullptr;
+    }
+
+    // The shader resource view holds its own reference to the texture, so only the view needs to be kept
+    texture->Release();
+    return reinterpret_cast<GpuTexture*>(textureSRV);
+}
+
+
+// Create a texture from the content of a texture file already in memory. As LoadTexture, but the file has been read
+// already, usually on another thread. WIC decodes the image here, DDS data is used as it is
+GpuTexture* D3D11RenderDevice::CreateTextureFromMemory(const void* data, size_t size, const std::string& fileName)
+{
+    ID3D11Resource*           texture    = nullptr;
+    ID3D11ShaderResourceView* textureSRV = nullptr;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    HRESULT hr;
+    if (IsDDSFile(fileName))
+    {
+        hr = DirectX::CreateDDSTextureFromMemory(gD3DDevice, bytes, size, &texture, &textureSRV);
+    }
+    else
+    {
+        hr = DirectX::CreateWICTextureFromMemory(gD3DDevice, gD3DContext, bytes, size, &texture, &textureSRV);
+    }
+    if (FAILED(hr))
+    {
+        return nullptr;
+    }
+
+    texture->Release();
+    return reinterpret_cast<GpuTexture*>(textureSRV);
+}
+
+
+// Estimated GPU memory of a texture from its description: the size of each mip-map at its format's bits per pixel.
+// Block compressed mip-maps are rounded up to whole 4x4 blocks
+size_t D3D11RenderDevice::TextureMemory(GpuTexture* texture)
+{
+    ID3D11Resource*  resource  = nullptr;
+    ID3D11Texture2D* texture2D = nullptr;
+    D3DTexture(texture)->GetResource(&resource);
+    HRESULT hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&texture2D));
+    resource->Release();
+    if (FAILED(hr))  return 0; // Only 2D textures are used by the app
+
+    D3D11_TEXTURE2D_DESC textureDesc;
+    texture2D->GetDesc(&textureDesc);
+    texture2D->Release();
+
+    bool   blockCompressed;
+    size_t bitsPerPixel = FormatBitsPerPixel(textureDesc.Format, blockCompressed);
+    size_t memory = 0;
+    for (UINT mip = 0; mip < textureDesc.MipLevels; ++mip)
+    {
+        size_t width  = std::max(1u, textureDesc.Width  >> mip);
+        size_t height = std::max(1u, textureDesc.Height >> mip);
+        if (blockCompressed)
+        {
+            width  = (width  + 3) & ~size_t(3);
+            height = (height + 3) & ~size_t(3);
+        }
+        memory += width * height * bitsPerPixel / 8;
+    }
+    return memory * textureDesc.ArraySize;
+}
+
+
+// Create a texture from 32-bit RGBA pixels. A single mip-map, it is only used for small textures such as placeholders
+GpuTexture* D3D11RenderDevice::CreateTexture(int width, int height, const uint32_t* pixels)
+{
+    D3D11_TEXTURE2D_DESC textureDesc = {};
+    textureDesc.Width  = width;
+    textureDesc.Height = height;
+    textureDesc.MipLevels = 1;
+    textureDesc.ArraySize = 1;
+    textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.Usage = D3D11_USAGE_IMMUTABLE; // The pixels never change
+    textureDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    D3D11_SUBRESOURCE_DATA initialData = {};
+    initialData.pSysMem     = pixels;
+    initialData.SysMemPitch = width * sizeof(uint32_t);
+
+    ID3D11Texture2D*          texture    = nullptr;
+    ID3D11ShaderResourceView* textureSRV = nullptr;
+    if (FAILED( gD3DDevice->CreateTexture2D(&textureDesc, &initialData, &texture) ))
+    {
+        return nullptr;
+    }
+    HRESULT hr = gD3DDevice->CreateShaderResourceView(texture, NULL, &textureSRV);
+    texture->Release(); // The view holds its own reference
+    if (FAILED(hr))
+    {
+        return nullptr;
+    }
+    return reinterpret_cast<GpuTexture*>(textureSRV);
+}
+
+
+// Create a texture that can be rendered to and then used in shaders, with its own depth buffer
+GpuRenderTarget* D3D11RenderDevice::CreateRenderTarget(int width, int height)
+{
+    D3D11RenderTarget* renderTarget = new D3D11RenderTarget;
+    renderTarget->width  = width;
+    renderTarget->height = height;
+
+    D3D11_TEXTURE2D_DESC textureDesc = {};
+    textureDesc.Width  = width;  // Size of the texture determines its quality
+    textureDesc.Height = height;
+    textureDesc.MipLevels = 1; // No mip-maps when rendering to textures
+    textureDesc.ArraySize = 1;
+    textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // RGBA texture (8-bits each)
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+    textureDesc.CPUAccessFlags = 0;
+    textureDesc.MiscFlags = 0;
+    if (FAILED( gD3DDevice->CreateTexture2D(&textureDesc, NULL, &renderTarget->texture) ) ||
+        FAILED( gD3DDevice->CreateRenderTargetView(renderTarget->texture, NULL, &renderTarget->renderTargetView) ))
+    {
+        Release(reinterpret_cast<GpuRenderTarget*>(renderTarget));
+        return nullptr;
+    }
+
+    // Create a shader-resource "view" so the texture can be used in shaders
+    D3D11_SHADER_RESOURCE_VIEW_DESC srDesc = {};
+    srDesc.Format = textureDesc.Format;
+    srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srDesc.Texture2D.MostDetailedMip = 0;
+    srDesc.Texture2D.MipLevels = 1;
+    if (FAILED( gD3DDevice->CreateShaderResourceView(renderTarget->texture, &srDesc, &renderTarget->textureSRV) ))
+    {
+        Release(reinterpret_cast<GpuRenderTarget*>(renderTarget));
+        return nullptr;
+    }
+
+
+    //**** Depth Buffer ****//
+
+    textureDesc = {};
+    textureDesc.Width  = width;
+    textureDesc.Height = height;
+    textureDesc.MipLevels = 1;
+    textureDesc.ArraySize = 1;
+    textureDesc.Format = DXGI_FORMAT_D32_FLOAT;
+    textureDesc.SampleDesc.Count = 1;
+    textureDesc.SampleDesc.Quality = 0;
+    textureDesc.Usage = D3D11_USAGE_DEFAULT;
+    textureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+    textureDesc.CPUAccessFlags = 0;
+    textureDesc.MiscFlags = 0;
+
+    // Create the depth stencil view
+    D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+    dsvDesc.Format = textureDesc.Format;
+    dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+    dsvDesc.Texture2D.MipSlice = 0;
+    dsvDesc.Flags = 0;
+    if (FAILED( gD3DDevice->CreateTexture2D(&textureDesc, NULL, &renderTarget->depthTexture) ) ||
+        FAILED( gD3DDevice->CreateDepthStencilView(renderTarget->depthTexture, &dsvDesc, &renderTarget->depthStencilView) ))
+    {
+        Release(reinterpret_cast<GpuRenderTarget*>(renderTarget));
+        return nullptr;
+    }
+
+    return reinterpret_cast<GpuRenderTarget*>(renderTarget);
+}
+
+
+// Returns the texture of a render target to use in shaders. Owned by the render target
+GpuTexture* D3D11RenderDevice::RenderTargetTexture(GpuRenderTarget* renderTarget)
+{
+    return reinterpret_cast<GpuTexture*>(D3DRenderTarget(renderTarget)->textureSRV);
+}
+
+
+// Returns the render target for the window (back buffer and main depth buffer)
+GpuRenderTarget* D3D11RenderDevice::BackBuffer()
+{
+    return reinterpret_cast<GpuRenderTarget*>(&mBackBuffer);
+}
+
+
+// Get the size in pixels of a render target (or the back buffer)
+void D3D11RenderDevice::RenderTargetSize(GpuRenderTarget* renderTarget, int& width, int& height)
+{
+    width  = D3DRenderTarget(renderTarget)->width;
+    height = D3DRenderTarget(renderTarget)->height;
+}
+
+
+// Load a compiled vertex shader (.cso file), pass the name without the extension. Returns nullptr on failure
+GpuVertexShader* D3D11RenderDevice::LoadVertexShader(const std::string& shaderName)
+{
+    std::vector<char> byteCode;
+    if (!LoadShaderByteCode(shaderName, byteCode))
+    {
+        return nullptr;
+    }
+
+    // Create shader object from loaded file (we will use the object later when rendering)
+    ID3D11VertexShader* shader;
+    HRESULT hr = gD3DDevice->CreateVertexShader(byteCode.data(), byteCode.size(), nullptr, &shader);
+    if (FAILED(hr))
+    {
+        return nullptr;
+    }
+
+    return reinterpret_cast<GpuVertexShader*>(shader);
+}
+
+
+// Load a compiled pixel shader (.cso file), pass the name without the extension. Returns nullptr on failure
+// Basically the same code as above but for pixel shaders
+GpuPixelShader* D3D11RenderDevice::LoadPixelShader(const std::string& shaderName)
+{
+    std::vector<char> byteCode;
+    if (!LoadShaderByteCode(shaderName, byteCode))
+    {
+        return nullptr;
+    }
+
+    ID3D11PixelShader* shader;
+    HRESULT hr = gD3DDevice->CreatePixelShader(byteCode.data(), byteCode.size(), nullptr, &shader);
+    if (FAILED(hr))
+    {
+        return nullptr;
+    }
+
+    return reinterpret_cast<GpuPixelShader*>(shader);
+}
+
+
+void D3D11RenderDevice::Release(GpuBuffer* buffer)
+{
+    if (buffer)  D3DBuffer(buffer)->Release();
+}
+
+void D3D11RenderDevice::Release(GpuTexture* texture)
+{
+    if (texture)  D3DTexture(texture)->Release();
+}
+
+void D3D11RenderDevice::Release(GpuRenderTarget* renderTarget)
+{
+    D3D11RenderTarget* target = D3DRenderTarget(renderTarget);
+    if (target == nullptr || target == &mBackBuffer)  return; // Back buffer belongs to Direct3DSetup.cpp
+
+    if (target->depthStencilView)  target->depthStencilView->Release();
+    if (target->depthTexture)      target->depthTexture->Release();
+    if (target->textureSRV)        target->textureSRV->Release();
+    if (target->renderTargetView)  target->renderTargetView->Release();
+    if (target->texture)           target->texture->Release();
+    delete target;
+}
+
+void D3D11RenderDevice::Release(GpuVertexShader* shader)
+{
+    if (shader)  D3DShader(shader)->Release();
+}
+
+void D3D11RenderDevice::Release(GpuPixelShader* shader)
+{
+    if (shader)  D3DShader(shader)->Release();
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Render context
+//--------------------------------------------------------------------------------------
+
+D3D11RenderContext::D3D11RenderContext(ID3D11DeviceContext* context)
+    : mContext(context)
+{
+    mDeferred = (mContext->GetType() == D3D11_DEVICE_CONTEXT_DEFERRED);
+
+    // Binding part of a constant buffer and writing to a constant buffer without discarding it both need Direct3D 11.1
+    // and driver support. Without them the 11.1 context is not kept and SupportsConstantBufferRanges returns false
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+    if (SUCCEEDED(gD3DDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+        options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer)
+    {
+        if (FAILED(mContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&mContext1))))
+        {
+            mContext1 = nullptr;
+        }
+    }
+}
+
+D3D11RenderContext::~D3D11RenderContext()
+{
+    if (mContext1)  mContext1->Release();
+    if (mDeferred)  mContext->Release();
+}
+
+
+// Select where to render. The viewport is set to cover the whole target
+void D3D11RenderContext::SetRenderTarget(GpuRenderTarget* renderTarget)
+{
+    D3D11RenderTarget* target = D3DRenderTarget(renderTarget);
+    mContext->OMSetRenderTargets(1, &target->renderTargetView, target->depthStencilView);
+
+    D3D11_VIEWPORT vp;
+    vp.Width  = static_cast<FLOAT>(target->width);
+    vp.Height = static_cast<FLOAT>(target->height);
+    vp.MinDepth = 0.0f;
+    vp.MaxDepth = 1.0f;
+    vp.TopLeftX = 0;
+    vp.TopLeftY = 0;
+    mContext->RSSetViewports(1, &vp);
+}
+
+
+// Clear the colour buffer of a render target to the given colour and its depth buffer to the far distance
+void D3D11RenderContext::Clear(GpuRenderTarget* renderTarget, const ColourRGBA& colour)
+{
+    D3D11RenderTarget* target = D3DRenderTarget(renderTarget);
+    mContext->ClearRenderTargetView(target->renderTargetView, &colour.r);
+    mContext->ClearDepthStencilView(target->depthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
+}
+
+
+void D3D11RenderContext::SetVertexShader(GpuVertexShader* shader)
+{
+    mContext->VSSetShader(D3DShader(shader), nullptr, 0);
+}
+
+void D3D11RenderContext::SetPixelShader(GpuPixelShader* shader)
+{
+    mContext->PSSetShader(D3DShader(shader), nullptr, 0);
+}
+
+
+// The states themselves are created in State.cpp
+void D3D11RenderContext::SetBlendMode(BlendMode mode)
+{
+    ID3D11BlendState* state = gNoBlendingState;
+    if      (mode == BlendMode::Additive)        state = gAdditiveBlendingState;
+    else if (mode == BlendMode::Multiplicative)  state = gMultiplicativeBlendingState;
+    else if (mode == BlendMode::Alpha)           state = gAlphaBlendingState;
+    mContext->OMSetBlendState(state, nullptr, 0xffffff);
+}
+
+void D3D11RenderContext::SetDepthMode(DepthMode mode)
+{
+    ID3D11DepthStencilState* state = gUseDepthBufferState;
+    if      (mode == DepthMode::ReadOnly)  state = gDepthReadOnlyState;
+    else if (mode == DepthMode::Disabled)  state = gNoDepthBufferState;
+    mContext->OMSetDepthStencilState(state, 0);
+}
+
+void D3D11RenderContext::SetCullMode(CullMode mode)
+{
+    ID3D11RasterizerState* state = gCullBackState;
+    if      (mode == CullMode::Front)  state = gCullFrontState;
+    else if (mode == CullMode::None)   state = gCullNoneState;
+    mContext->RSSetState(state);
+}
+
+
+void D3D11RenderContext::SetTexture(int slot, GpuTexture* texture)
+{
+    ID3D11ShaderResourceView* textureSRV = D3DTexture(texture);
+    mContext->PSSetShaderResources(slot, 1, &textureSRV);
+}
+
+void D3D11RenderContext::SetSampler(int slot, SamplerMode mode)
+{
+    ID3D11SamplerState* sampler = gAnisotropic4xSampler;
+    if      (mode == SamplerMode::Point)      sampler = gPointSampler;
+    else if (mode == SamplerMode::Trilinear)  sampler = gTrilinearSampler;
+    mContext->PSSetSamplers(slot, 1, &sampler);
+}
+
+
+// Make a constant buffer available to both the vertex shader (VS) and pixel shader (PS)
+void D3D11RenderContext::SetConstantBuffer(int slot, GpuBuffer* buffer)
+{
+    ID3D11Buffer* d3dBuffer = D3DBuffer(buffer);
+    mContext->VSSetConstantBuffers(slot, 1, &d3dBuffer); // Slot must match constant buffer number in the shader
+    mContext->PSSetConstantBuffers(slot, 1, &d3dBuffer);
+}
+
+// Replace the content of a constant or instance buffer, the previous content is discarded
+void D3D11RenderContext::UpdateBuffer(GpuBuffer* buffer, const void* data, size_t size)
+{
+    D3D11_MAPPED_SUBRESOURCE cb;
+    if (FAILED(mContext->Map(D3DBuffer(buffer), 0, D3D11_MAP_WRITE_DISCARD, 0, &cb)))  return;
+    std::memcpy(cb.pData, data, size);
+    mContext->Unmap(D3DBuffer(buffer), 0);
+    CountUpload(size);
+}
+
+
+bool D3D11RenderContext::SupportsConstantBufferRanges()
+{
+    return mContext1 != nullptr;
+}
+
+// Shaders see constants in units of 16 bytes, and Direct3D needs the number bound to be a multiple of 16 of them (256 bytes)
+void D3D11RenderContext::SetConstantBufferRange(int slot, GpuBuffer* buffer, size_t offset, size_t size)
+{
+    ID3D11Buffer* d3dBuffer = D3DBuffer(buffer);
+    UINT firstConstant = static_cast<UINT>(offset / 16);
+    UINT numConstants  = static_cast<UINT>((size + CONSTANT_BUFFER_ALIGNMENT - 1) / CONSTANT_BUFFER_ALIGNMENT * (CONSTANT_BUFFER_ALIGNMENT / 16));
+    mContext1->VSSetConstantBuffers1(slot, 1, &d3dBuffer, &firstConstant, &numConstants);
+    mContext1->PSSetConstantBuffers1(slot, 1, &d3dBuffer, &firstConstant, &numConstants);
+}
+
+// Writing at the start of the buffer discards it. Writing further in promises not to overwrite anything the GPU might
+// still be using, so the driver doesn't need to wait for the GPU or copy the buffer. A deferred context must discard a
+// buffer the first time it writes to it in each command list, so it always discards. Nothing earlier in the buffer is
+// used by the list, the draws recorded before were given the data from the buffer's previous discard
+void D3D11RenderContext::UpdateBufferRange(GpuBuffer* buffer, size_t offset, const void* data, size_t size)
+{
+    D3D11_MAP mapType = (offset == 0 || mDeferred) ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+    D3D11_MAPPED_SUBRESOURCE mapped;
+    if (FAILED(mContext->Map(D3DBuffer(buffer), 0, mapType, 0, &mapped)))  return;
+    std::memcpy(static_cast<char*>(mapped.pData) + offset, data, size);
+    mContext->Unmap(D3DBuffer(buffer), 0);
+    CountUpload(size);
+}
+
+
+// Count a write to a constant or instance buffer in the frame stats, or for the command list on a deferred context
+void D3D11RenderContext::CountUpload(size_t size)
+{
+    if (mDeferred)
+    {
+        ++mBufferMaps;
+        mBytesUploaded += static_cast<int>(size);
+    }
+    else
+    {
+        ++gFrameStats.bufferMaps;
+        gFrameStats.bytesUploaded += static_cast<int>(size);
+    }
+}
+
+
+void D3D11RenderContext::SetVertexBuffer(GpuBuffer* buffer, unsigned int vertexSize)
+{
+    ID3D11Buffer* d3dBuffer = D3DBuffer(buffer);
+    UINT stride = vertexSize;
+    UINT offset = 0;
+    mContext->IASetVertexBuffers(0, 1, &d3dBuffer, &stride, &offset);
+
+    // Using triangle lists only
+    mContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void D3D11RenderContext::SetIndexBuffer(GpuBuffer* buffer, IndexFormat format)
+{
+    mContext->IASetIndexBuffer(D3DBuffer(buffer), format == IndexFormat::UInt16 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+}
+
+void D3D11RenderContext::SetVertexLayout(GpuVertexLayout* layout)
+{
+    mContext->IASetInputLayout(D3DVertexLayout(layout));
+}
+
+// Instance data is read from the second input slot, see D3D11RenderDevice::GetInstancedVertexLayout
+void D3D11RenderContext::SetInstanceBuffer(GpuBuffer* buffer)
+{
+    ID3D11Buffer* d3dBuffer = D3DBuffer(buffer);
+    UINT stride = sizeof(InstanceData);
+    UINT offset = 0;
+    mContext->IASetVertexBuffers(1, 1, &d3dBuffer, &stride, &offset);
+}
+
+
+void D3D11RenderContext::DrawIndexed(unsigned int numIndices, unsigned int firstIndex, int baseVertex)
+{
+    mContext->DrawIndexed(numIndices, firstIndex, baseVertex);
+}
+
+void D3D11RenderContext::DrawIndexedInstanced(unsigned int numIndices, unsigned int numInstances, unsigned int firstIndex,
+                                              int baseVertex, unsigned int firstInstance)
+{
+    mContext->DrawIndexedInstanced(numIndices, numInstances, firstIndex, baseVertex, firstInstance);
+}
+
+
+// When drawing to the off-screen back buffer is complete, we "present" the image to the front buffer (the screen)
+void D3D11RenderContext::Present(bool vsync)
+{
+    if (!mDeferred)  gSwapChain->Present(vsync ? 1 : 0, 0);
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Deferred contexts / command lists
+//--------------------------------------------------------------------------------------
+
+// Direct3D deferred contexts can be created from any thread. If the driver can't record command lists itself the
+// Direct3D runtime does it instead, so this only fails if the device was created single threaded
+RenderContext* D3D11RenderContext::CreateDeferredContext()
+{
+    if (mDeferred)  return nullptr;
+
+    ID3D11DeviceContext* deferredContext;
+    if (FAILED(gD3DDevice->CreateDeferredContext(0, &deferredContext)))  return nullptr;
+    return new D3D11RenderContext(deferredContext);
+}
+
+
+// Passing FALSE means the deferred context's state isn't saved and restored around the list, which is faster, and the
+// next list starts with nothing selected
+GpuCommandList* D3D11RenderContext::FinishCommandList()
+{
+    if (!mDeferred)  return nullptr;
+
+    D3D11CommandList* commandList = new D3D11CommandList;
+    if (FAILED(mContext->FinishCommandList(FALSE, &commandList->commandList)))
+    {
+        delete commandList;
+        return nullptr;
+    }
+    commandList->bufferMaps    = mBufferMaps;
+    commandList->bytesUploaded = mBytesUploaded;
+    mBufferMaps    = 0;
+    mBytesUploaded = 0;
+    return reinterpret_cast<GpuCommandList*>(commandList);
+}
+
+
+// As above, FALSE clears this context's state after the list instead of restoring what was selected before it
+void D3D11RenderContext::ExecuteCommandList(GpuCommandList* commandList)
+{
+    D3D11CommandList* d3dCommandList = reinterpret_cast<D3D11CommandList*>(commandList);
+    if (mDeferred || d3dCommandList == nullptr)  return;
+
+    mContext->ExecuteCommandList(d3dCommandList->commandList, FALSE);
+    gFrameStats.bufferMaps    += d3dCommandList->bufferMaps;
+    gFrameStats.bytesUploaded += d3dCommandList->bytesUploaded;
+
+    d3dCommandList->commandList->Release();
+    delete d3dCommandList;
+}
@@ -0,0 +1,150 @@
+//--------------------------------------------------------------------------------------
+// Direct3D 11 renderer
+//--------------------------------------------------------------------------------------
+// Implements the rendering interface in Renderer.h with Direct3D 11, using the device, context and swap chain
+// created in Direct3DSetup.cpp and the states in State.cpp. Windows only.
+//
+// The resource types from Renderer.h are really these Direct3D objects:
+//   GpuBuffer       - ID3D11Buffer
+//   GpuTexture      - ID3D11ShaderResourceView (the view keeps the texture itself alive)
+//   GpuRenderTarget - D3D11RenderTarget below
+//   GpuVertexShader - ID3D11VertexShader
+//   GpuPixelShader  - ID3D11PixelShader
+//   GpuVertexLayout - ID3D11InputLayout, shared and owned by the vertex layout cache (VertexLayoutCache.h)
+//   GpuCommandList  - D3D11CommandList below
+
+#ifndef _RENDERER_D3D11_H_INCLUDED_
+#define _RENDERER_D3D11_H_INCLUDED_
+
+#include "Renderer.h"
+#include "Common.h"
+#include <d3d11.h>
+#include <d3d11_1.h>
+
+
+// A texture that can be rendered to and used in shaders, along with its own depth buffer. Also used for the back
+// buffer, which has no shader resource view and whose views belong to Direct3DSetup.cpp
+struct D3D11RenderTarget
+{
+    int width  = 0;
+    int height = 0;
+
+    ID3D11Texture2D*          texture          = nullptr;
+    ID3D11RenderTargetView*   renderTargetView = nullptr;
+    ID3D11ShaderResourceView* textureSRV       = nullptr;
+
+    ID3D11Texture2D*          depthTexture     = nullptr;
+    ID3D11DepthStencilView*   depthStencilView = nullptr;
+};
+
+
+// Commands recorded on a deferred context. Buffer writes on a deferred context are counted here and added to the frame
+// stats when the list is run, as the deferred context may be recording on another thread
+struct D3D11CommandList
+{
+    ID3D11CommandList* commandList   = nullptr;
+    int                bufferMaps    = 0;
+    int                bytesUploaded = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Direct3D 11 render device
+//--------------------------------------------------------------------------------------
+
+class D3D11RenderDevice : public RenderDevice
+{
+public:
+    // Uses gD3DDevice, which must have been created already
+    D3D11RenderDevice();
+    ~D3D11RenderDevice();
+
+    GpuBuffer*       CreateBuffer(BufferType type, size_t size, const void* initialData) override;
+    GpuVertexLayout* GetVertexLayout(const std::vector<VertexElement>& vertexElements) override;
+    GpuVertexLayout* GetInstancedVertexLayout(const std::vector<VertexElement>& vertexElements) override;
+    GpuTexture*      LoadTexture(const std::string& fileName) override;
+    GpuTexture*      CreateTextureFromMemory(const void* data, size_t size, const std::string& fileName) override;
+    GpuTexture*      CreateTexture(int width, int height, const uint32_t* pixels) override;
+    size_t           TextureMemory(GpuTexture* texture) override;
+
+    GpuRenderTarget* CreateRenderTarget(int width, int height) override;
+    GpuTexture*      RenderTargetTexture(GpuRenderTarget* renderTarget) override;
+    GpuRenderTarget* BackBuffer() override;
+    void             RenderTargetSize(GpuRenderTarget* renderTarget, int& width, int& height) override;
+
+    GpuVertexShader* LoadVertexShader(const std::string& shaderName) override;
+    GpuPixelShader*  LoadPixelShader (const std::string& shaderName) override;
+
+    void Release(GpuBuffer*       buffer)       override;
+    void Release(GpuTexture*      texture)      override;
+    void Release(GpuRenderTarget* renderTarget) override;
+    void Release(GpuVertexShader* shader)       override;
+    void Release(GpuPixelShader*  shader)       override;
+
+private:
+    D3D11RenderTarget mBackBuffer; // Views are owned by Direct3DSetup.cpp
+};
+
+
+//--------------------------------------------------------------------------------------
+// Direct3D 11 render context
+//--------------------------------------------------------------------------------------
+
+class D3D11RenderContext : public RenderContext
+{
+public:
+    // Pass the Direct3D context to send commands to (normally gD3DContext). A deferred context is released along with
+    // this object, the immediate context belongs to Direct3DSetup.cpp
+    D3D11RenderContext(ID3D11DeviceContext* context);
+    ~D3D11RenderContext();
+
+    void SetRenderTarget(GpuRenderTarget* renderTarget) override;
+    void Clear(GpuRenderTarget* renderTarget, const ColourRGBA& colour) override;
+
+    void SetVertexShader(GpuVertexShader* shader) override;
+    void SetPixelShader (GpuPixelShader*  shader) override;
+
+    void SetBlendMode(BlendMode mode) override;
+    void SetDepthMode(DepthMode mode) override;
+    void SetCullMode (CullMode  mode) override;
+
+    void SetTexture(int slot, GpuTexture* texture) override;
+    void SetSampler(int slot, SamplerMode mode)    override;
+
+    void SetConstantBuffer(int slot, GpuBuffer* buffer) override;
+    void UpdateBuffer(GpuBuffer* buffer, const void* data, size_t size) override;
+
+    bool SupportsConstantBufferRanges() override;
+    void SetConstantBufferRange(int slot, GpuBuffer* buffer, size_t offset, size_t size) override;
+    void UpdateBufferRange(GpuBuffer* buffer, size_t offset, const void* data, size_t size) override;
+
+    void SetVertexBuffer(GpuBuffer* buffer, unsigned int vertexSize) override;
+    void SetIndexBuffer (GpuBuffer* buffer, IndexFormat format)      override;
+    void SetVertexLayout(GpuVertexLayout* layout)                    override;
+    void SetInstanceBuffer(GpuBuffer* buffer)                        override;
+
+    void DrawIndexed(unsigned int numIndices, unsigned int firstIndex, int baseVertex) override;
+    void DrawIndexedInstanced(unsigned int numIndices, unsigned int numInstances, unsigned int firstIndex,
+                              int baseVertex, unsigned int firstInstance) override;
+
+    void Present(bool vsync) override;
+
+    RenderContext*  CreateDeferredContext() override;
+    GpuCommandList* FinishCommandList() override;
+    void            ExecuteCommandList(GpuCommandList* commandList) override;
+
+private:
+    // Count a write to a constant or instance buffer in the frame stats, or for the command list on a deferred context
+    void CountUpload(size_t size);
+
+    ID3D11DeviceContext*  mContext;
+    ID3D11DeviceContext1* mContext1 = nullptr; // Direct3D 11.1 version of the context, nullptr if constant buffer ranges aren't supported
+    bool                  mDeferred = false;
+
+    // Deferred contexts only: buffer writes since the last command list was finished
+    int mBufferMaps    = 0;
+    int mBytesUploaded = 0;
+};
+
+
+#endif //_RENDERER_D3D11_H_INCLUDED_
@@ -0,0 +1,510 @@
+//--------------------------------------------------------------------------------------
+// Null renderer
+//--------------------------------------------------------------------------------------
+// See RendererNull.h
+
+#include "RendererNull.h"
+#include "FrameStats.h"
+
+#include <fstream>
+#include <cstring>
+#include <cassert>
+
+
+//--------------------------------------------------------------------------------------
+// Resources
+//--------------------------------------------------------------------------------------
+// The resource types from Renderer.h are really these structures
+
+namespace
+{
+    struct NullBuffer
+    {
+        BufferType type;
+        size_t     size;
+        std::vector<unsigned char> data; // Constant and instance buffers only, UpdateBuffer copies into this like a GPU upload
+    };
+
+    struct NullTexture
+    {
+        std::string name;
+        size_t      memory = 0; // Size of the texture's file or pixels, standing in for its GPU memory
+    };
+
+    struct NullRenderTarget
+    {
+        int         width;
+        int         height;
+        NullTexture texture;
+    };
+
+    struct NullShader
+    {
+        std::string name;
+    };
+
+    // Commands recorded on a deferred context, with the data written to buffers by them one after another
+    struct NullCommandList
+    {
+        std::vector<RenderCommand> commands;
+        std::vector<unsigned char> data;
+    };
+
+    NullBuffer*       ToNull(GpuBuffer*       buffer)       { return reinterpret_cast<NullBuffer*>(buffer); }
+    NullTexture*      ToNull(GpuTexture*      texture)      { return reinterpret_cast<NullTexture*>(texture); }
+    NullRenderTarget* ToNull(GpuRenderTarget* renderTarget) { return reinterpret_cast<NullRenderTarget*>(renderTarget); }
+    NullCommandList*  ToNull(GpuCommandList*  commandList)  { return reinterpret_cast<NullCommandList*>(commandList); }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Render device
+//--------------------------------------------------------------------------------------
+
+NullRenderDevice::NullRenderDevice(int backBufferWidth, int backBufferHeight)
+{
+    mBackBuffer = reinterpret_cast<GpuRenderTarget*>(new NullRenderTarget{ backBufferWidth, backBufferHeight, { "BackBuffer" } });
+}
+
+NullRenderDevice::~NullRenderDevice()
+{
+    delete ToNull(mBackBuffer);
+}
+
+
+GpuBuffer* NullRenderDevice::CreateBuffer(BufferType type, size_t size, const void* initialData)
+{
+    bool dynamic = (type == BufferType::Constant || type == BufferType::Instance);
+    if (size == 0 || (!dynamic && initialData == nullptr))  return nullptr;
+
+    NullBuffer* buffer = new NullBuffer{ type, size, {} };
+    if (dynamic)
+    {
+        buffer->data.resize(size);
+        if (initialData != nullptr)  std::memcpy(buffer->data.data(), initialData, size);
+    }
+
+    ++mLiveResources;
+    mBufferMemory += size;
+    return reinterpret_cast<GpuBuffer*>(buffer);
+}
+
+
+// Layouts are shared between meshes with the same vertex description, like the Direct3D renderer
+GpuVertexLayout* NullRenderDevice::GetVertexLayout(const std::vector<VertexElement>& vertexElements)
+{
+    return GetLayout("", vertexElements);
+}
+
+GpuVertexLayout* NullRenderDevice::GetInstancedVertexLayout(const std::vector<VertexElement>& vertexElements)
+{
+    return GetLayout("Instanced;", vertexElements);
+}
+
+
+// Returns the vertex layout for the given vertex description, creating it the first time. The key prefix
+// separates instanced and non-instanced layouts
+GpuVertexLayout* NullRenderDevice::GetLayout(const std::string& keyPrefix, const std::vector<VertexElement>& vertexElements)
+{
+    if (vertexElements.empty())  return nullptr;
+
+    std::string key = keyPrefix;
+    for (auto& element : vertexElements)
+    {
+        key += std::to_string(static_cast<uint32_t>(element.semantic)) + ":" + std::to_string(static_cast<uint32_t>(element.format)) +
+               ":" + std::to_string(element.offset) + ";";
+    }
+
+    std::lock_guard<std::mutex> lock(mVertexLayoutsMutex);
+    auto& layout = mVertexLayouts[key];
+    if (!layout)  layout = std::make_unique<std::vector<VertexElement>>(vertexElements);
+    return reinterpret_cast<GpuVertexLayout*>(layout.get());
+}
+
+
+// The file is not read, any name gives a valid texture. The file's size is used for its memory if it exists
+GpuTexture* NullRenderDevice::LoadTexture(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+    size_t memory = file.is_open() ? static_cast<size_t>(file.tellg()) : 0;
+
+    ++mLiveResources;
+    return reinterpret_cast<GpuTexture*>(new NullTexture{ fileName, memory });
+}
+
+// The data is not decoded, any data gives a valid texture
+GpuTexture* NullRenderDevice::CreateTextureFromMemory(const void* data, size_t size, const std::string& fileName)
+{
+    if (data == nullptr || size == 0)  return nullptr;
+
+    ++mLiveResources;
+    return reinterpret_cast<GpuTexture*>(new NullTexture{ fileName, size });
+}
+
+GpuTexture* NullRenderDevice::CreateTexture(int width, int height, const uint32_t* pixels)
+{
+    if (width <= 0 || height <= 0 || pixels == nullptr)  return nullptr;
+
+    ++mLiveResources;
+    return reinterpret_cast<GpuTexture*>(new NullTexture{ "Texture", static_cast<size_t>(width) * height * sizeof(uint32_t) });
+}
+
+size_t NullRenderDevice::TextureMemory(GpuTexture* texture)
+{
+    return ToNull(texture)->memory;
+}
+
+
+GpuRenderTarget* NullRenderDevice::CreateRenderTarget(int width, int height)
+{
+    if (width <= 0 || height <= 0)  return nullptr;
+
+    ++mLiveResources;
+    return reinterpret_cast<GpuRenderTarget*>(new NullRenderTarget{ width, height, { "RenderTarget", static_cast<size_t>(width) * height * 4 } });
+}
+
+GpuTexture* NullRenderDevice::RenderTargetTexture(GpuRenderTarget* renderTarget)
+{
+    return reinterpret_cast<GpuTexture*>(&ToNull(renderTarget)->texture);
+}
+
+GpuRenderTarget* NullRenderDevice::BackBuffer()
+{
+    return mBackBuffer;
+}
+
+void NullRenderDevice::RenderTargetSize(GpuRenderTarget* renderTarget, int& width, int& height)
+{
+    width  = ToNull(renderTarget)->width;
+    height = ToNull(renderTarget)->height;
+}
+
+
+// The file is not read, any name gives a valid shader
+GpuVertexShader* NullRenderDevice::LoadVertexShader(const std::string& shaderName)
+{
+    ++mLiveResources;
+    return reinterpret_cast<GpuVertexShader*>(new NullShader{ shaderName });
+}
+
+GpuPixelShader* NullRenderDevice::LoadPixelShader(const std::string& shaderName)
+{
+    ++mLiveResources;
+    return reinterpret_cast<GpuPixelShader*>(new NullShader{ shaderName });
+}
+
+
+void NullRenderDevice::Release(GpuBuffer* buffer)
+{
+    if (buffer == nullptr)  return;
+    mBufferMemory -= ToNull(buffer)->size;
+    --mLiveResources;
+    delete ToNull(buffer);
+}
+
+void NullRenderDevice::Release(GpuTexture* texture)
+{
+    if (texture == nullptr)  return;
+    --mLiveResources;
+    delete ToNull(texture);
+}
+
+void NullRenderDevice::Release(GpuRenderTarget* renderTarget)
+{
+    if (renderTarget == nullptr || renderTarget == mBackBuffer)  return;
+    --mLiveResources;
+    delete ToNull(renderTarget);
+}
+
+void NullRenderDevice::Release(GpuVertexShader* shader)
+{
+    if (shader == nullptr)  return;
+    --mLiveResources;
+    delete reinterpret_cast<NullShader*>(shader);
+}
+
+void NullRenderDevice::Release(GpuPixelShader* shader)
+{
+    if (shader == nullptr)  return;
+    --mLiveResources;
+    delete reinterpret_cast<NullShader*>(shader);
+}
+
+
+
+//--------------------------------------------------------------------------------------
+// Render context
+//--------------------------------------------------------------------------------------
+
+NullRenderContext::NullRenderContext(bool deferred /*= false*/)
+    : mDeferred(deferred)
+{
+}
+
+
+void NullRenderContext::Add(const RenderCommand& command)
+{
+    ++mCommandCounts[static_cast<int>(command.type)];
+    if (mRecording)  mCommands.push_back(command);
+    if (mDeferred)   mListCommands.push_back(command);
+}
+
+
+void NullRenderContext::SetRenderTarget(GpuRenderTarget* renderTarget)
+{
+    assert(renderTarget != nullptr);
+    Add({ RenderCommandType::SetRenderTarget, renderTarget });
+}
+
+void NullRenderContext::Clear(GpuRenderTarget* renderTarget, const ColourRGBA& /*colour*/)
+{
+    assert(renderTarget != nullptr);
+    Add({ RenderCommandType::Clear, renderTarget });
+}
+
+
+void NullRenderContext::SetVertexShader(GpuVertexShader* shader)
+{
+    Add({ RenderCommandType::SetVertexShader, shader });
+}
+
+void NullRenderContext::SetPixelShader(GpuPixelShader* shader)
+{
+    Add({ RenderCommandType::SetPixelShader, shader });
+}
+
+
+void NullRenderContext::SetBlendMode(BlendMode mode)
+{
+    Add({ RenderCommandType::SetBlendMode, nullptr, 0, static_cast<uint32_t>(mode) });
+}
+
+void NullRenderContext::SetDepthMode(DepthMode mode)
+{
+    Add({ RenderCommandType::SetDepthMode, nullptr, 0, static_cast<uint32_t>(mode) });
+}
+
+void NullRenderContext::SetCullMode(CullMode mode)
+{
+    Add({ RenderCommandType::SetCullMode, nullptr, 0, static_cast<uint32_t>(mode) });
+}
+
+
+void NullRenderContext::SetTexture(int slot, GpuTexture* texture)
+{
+    Add({ RenderCommandType::SetTexture, texture, slot });
+}
+
+void NullRenderContext::SetSampler(int slot, SamplerMode mode)
+{
+    Add({ RenderCommandType::SetSampler, nullptr, slot, static_cast<uint32_t>(mode) });
+}
+
+
+void NullRenderContext::SetConstantBuffer(int slot, GpuBuffer* buffer)
+{
+    Add({ RenderCommandType::SetConstantBuffer, buffer, slot });
+}
+
+// Copies the data into the buffer, so the CPU cost is close to a real upload. A deferred context copies it into the
+// command list instead, as Direct3D does, and the buffer is written when the list is run
+void NullRenderContext::UpdateBuffer(GpuBuffer* buffer, const void* data, size_t size)
+{
+    NullBuffer* nullBuffer = ToNull(buffer);
+    assert((nullBuffer->type == BufferType::Constant || nullBuffer->type == BufferType::Instance) && size <= nullBuffer->size);
+    if (mDeferred)
+    {
+        mListData.insert(mListData.end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+    }
+    else
+    {
+        std::memcpy(nullBuffer->data.data(), data, size);
+        ++gFrameStats.bufferMaps;
+        gFrameStats.bytesUploaded += static_cast<int>(size);
+    }
+
+    mBytesUploaded += size;
+    Add({ RenderCommandType::UpdateBuffer, buffer, 0, static_cast<uint32_t>(size) });
+}
+
+
+bool NullRenderContext::SupportsConstantBufferRanges()
+{
+    return mConstantBufferRanges;
+}
+
+// Checks the same rules as Direct3D 11.1
+void NullRenderContext::SetConstantBufferRange(int slot, GpuBuffer* buffer, size_t offset, size_t size)
+{
+    NullBuffer* nullBuffer = ToNull(buffer);
+    assert(mConstantBufferRanges && nullBuffer->type == BufferType::Constant);
+    assert(offset % CONSTANT_BUFFER_ALIGNMENT == 0 && offset + size <= nullBuffer->size);
+    Add({ RenderCommandType::SetConstantBufferRange, buffer, slot, static_cast<uint32_t>(size), static_cast<uint32_t>(offset) });
+}
+
+void NullRenderContext::UpdateBufferRange(GpuBuffer* buffer, size_t offset, const void* data, size_t size)
+{
+    NullBuffer* nullBuffer = ToNull(buffer);
+    assert(nullBuffer->type == BufferType::Instance || (nullBuffer->type == BufferType::Constant && mConstantBufferRanges));
+    assert(offset + size <= nullBuffer->size);
+    if (mDeferred)
+    {
+        mListData.insert(mListData.end(), static_cast<const unsigned char*>(data), static_cast<const unsigned char*>(data) + size);
+    }
+    else
+    {
+        std::memcpy(nullBuffer->data.data() + offset, data, size);
+        ++gFrameStats.bufferMaps;
+        gFrameStats.bytesUploaded += static_cast<int>(size);
+    }
+
+    mBytesUploaded += size;
+    Add({ RenderCommandType::UpdateBufferRange, buffer, 0, static_cast<uint32_t>(size), static_cast<uint32_t>(offset) });
+}
+
+
+void NullRenderContext::SetVertexBuffer(GpuBuffer* buffer, unsigned int vertexSize)
+{
+    Add({ RenderCommandType::SetVertexBuffer, buffer, 0, vertexSize });
+}
+
+void NullRenderContext::SetIndexBuffer(GpuBuffer* buffer, IndexFormat format)
+{
+    Add({ RenderCommandType::SetIndexBuffer, buffer, 0, static_cast<uint32_t>(format) });
+}
+
+void NullRenderContext::SetVertexLayout(GpuVertexLayout* layout)
+{
+    Add({ RenderCommandType::SetVertexLayout, layout });
+}
+
+void NullRenderContext::SetInstanceBuffer(GpuBuffer* buffer)
+{
+    assert(buffer == nullptr || ToNull(buffer)->type == BufferType::Instance);
+    Add({ RenderCommandType::SetInstanceBuffer, buffer });
+}
+
+
+void NullRenderContext::DrawIndexed(unsigned int numIndices, unsigned int firstIndex, int baseVertex)
+{
+    mIndicesDrawn += numIndices;
+    Add({ RenderCommandType::DrawIndexed, nullptr, 0, numIndices, firstIndex, baseVertex });
+}
+
+void NullRenderContext::DrawIndexedInstanced(unsigned int numIndices, unsigned int numInstances, unsigned int firstIndex,
+                                             int baseVertex, unsigned int firstInstance)
+{
+    mIndicesDrawn += static_cast<uint64_t>(numIndices) * numInstances;
+    Add({ RenderCommandType::DrawIndexedInstanced, nullptr, 0, numIndices, firstIndex, baseVertex, numInstances, firstInstance });
+}
+
+
+void NullRenderContext::Present(bool vsync)
+{
+    assert(!mDeferred);
+    Add({ RenderCommandType::Present, nullptr, 0, vsync ? 1u : 0u });
+}
+
+
+//--------------------------------------------------------------------------------------
+// Deferred contexts / command lists
+//--------------------------------------------------------------------------------------
+
+RenderContext* NullRenderContext::CreateDeferredContext()
+{
+    if (mDeferred)  return nullptr;
+
+    NullRenderContext* context = new NullRenderContext(true);
+    context->mConstantBufferRanges = mConstantBufferRanges;
+    return context;
+}
+
+
+GpuCommandList* NullRenderContext::FinishCommandList()
+{
+    if (!mDeferred)  return nullptr;
+
+    NullCommandList* commandList = new NullCommandList;
+    commandList->commands.swap(mListCommands);
+    commandList->data.swap(mListData);
+    return reinterpret_cast<GpuCommandList*>(commandList);
+}
+
+
+// Each command in the list is run as if it had been given to this context, so it is counted and recorded here too
+void NullRenderContext::ExecuteCommandList(GpuCommandList* commandList)
+{
+    assert(!mDeferred && commandList != nullptr);
+    NullCommandList* nullCommandList = ToNull(commandList);
+    Add({ RenderCommandType::ExecuteCommandList, commandList, 0, static_cast<uint32_t>(nullCommandList->commands.size()) });
+
+    const unsigned char* data = nullCommandList->data.data();
+    for (auto& command : nullCommandList->commands)  Run(command, data);
+    delete nullCommandList;
+}
+
+
+// Run a command from a command list. Buffer writes take their data from the given pointer, which is moved past it
+void NullRenderContext::Run(const RenderCommand& command, const unsigned char*& data)
+{
+    void* resource = const_cast<void*>(command.resource);
+    switch (command.type)
+    {
+        case RenderCommandType::SetRenderTarget:   SetRenderTarget(static_cast<GpuRenderTarget*>(resource));  break;
+        case RenderCommandType::Clear:             Clear(static_cast<GpuRenderTarget*>(resource), { 0, 0, 0 });  break; // Colour isn't kept
+        case RenderCommandType::SetVertexShader:   SetVertexShader(static_cast<GpuVertexShader*>(resource));  break;
+        case RenderCommandType::SetPixelShader:    SetPixelShader(static_cast<GpuPixelShader*>(resource));  break;
+        case RenderCommandType::SetBlendMode:      SetBlendMode(static_cast<BlendMode>(command.value));  break;
+        case RenderCommandType::SetDepthMode:      SetDepthMode(static_cast<DepthMode>(command.value));  break;
+        case RenderCommandType::SetCullMode:       SetCullMode(static_cast<CullMode>(command.value));  break;
+        case RenderCommandType::SetTexture:        SetTexture(command.slot, static_cast<GpuTexture*>(resource));  break;
+        case RenderCommandType::SetSampler:        SetSampler(command.slot, static_cast<SamplerMode>(command.value));  break;
+        case RenderCommandType::SetConstantBuffer: SetConstantBuffer(command.slot, static_cast<GpuBuffer*>(resource));  break;
+        case RenderCommandType::SetVertexBuffer:   SetVertexBuffer(static_cast<GpuBuffer*>(resource), command.value);  break;
+        case RenderCommandType::SetIndexBuffer:    SetIndexBuffer(static_cast<GpuBuffer*>(resource), static_cast<IndexFormat>(command.value));  break;
+        case RenderCommandType::SetVertexLayout:   SetVertexLayout(static_cast<GpuVertexLayout*>(resource));  break;
+        case RenderCommandType::SetInstanceBuffer: SetInstanceBuffer(static_cast<GpuBuffer*>(resource));  break;
+        case RenderCommandType::Present:           Present(command.value != 0);  break;
+
+        case RenderCommandType::UpdateBuffer:
+            UpdateBuffer(static_cast<GpuBuffer*>(resource), data, command.value);
+            data += command.value;
+            break;
+
+        case RenderCommandType::UpdateBufferRange:
+            UpdateBufferRange(static_cast<GpuBuffer*>(resource), command.first, data, command.value);
+            data += command.value;
+            break;
+
+        case RenderCommandType::SetConstantBufferRange:
+            SetConstantBufferRange(command.slot, static_cast<GpuBuffer*>(resource), command.first, command.value);
+            break;
+
+        case RenderCommandType::DrawIndexed:
+            DrawIndexed(command.value, command.first, command.baseVertex);
+            break;
+
+        case RenderCommandType::DrawIndexedInstanced:
+            DrawIndexedInstanced(command.value, command.instances, command.first, command.baseVertex, command.firstInstance);
+            break;
+
+        default:
+            assert(false); // Command lists can't be run from inside command lists
+            break;
+    }
+}
+
+
+int NullRenderContext::TotalCommands()
+{
+    int total = 0;
+    for (int count : mCommandCounts)  total += count;
+    return total;
+}
+
+void NullRenderContext::ResetCounts()
+{
+    for (int& count : mCommandCounts)  count = 0;
+    mIndicesDrawn  = 0;
+    mBytesUploaded = 0;
+}
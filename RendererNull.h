@@ -0,0 +1,234 @@
+//--------------------------------------------------------------------------------------
+// Null renderer
+//--------------------------------------------------------------------------------------
+// Implements the rendering interface in Renderer.h without a GPU. Resources are small CPU-side objects
+// (no texture or shader files are read) and rendering commands are counted, and optionally recorded into
+// a list, rather than drawn. Uses only standard C++ so it runs on any platform.
+//
+// Used to run and time the CPU side of the app headless (see Tools/SceneBench), and to check what the
+// scene sends to the renderer each frame, e.g. how many draw calls and state changes it makes.
+//
+// Deferred contexts work like Direct3D's: each command, along with a copy of any data written to a buffer, is kept in
+// a list, then ExecuteCommandList on the immediate context runs the list's commands in order as if they were given to it
+// directly. So the immediate context's counts include every command from the lists it has run, and the same parallel
+// recording code as the Direct3D renderer can be run and checked headless.
+
+#ifndef _RENDERER_NULL_H_INCLUDED_
+#define _RENDERER_NULL_H_INCLUDED_
+
+#include "Renderer.h"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Recorded commands
+//--------------------------------------------------------------------------------------
+
+// One type for each function of RenderContext. Only add new values before NumTypes
+enum class RenderCommandType
+{
+    SetRenderTarget,
+    Clear,
+    SetVertexShader,
+    SetPixelShader,
+    SetBlendMode,
+    SetDepthMode,
+    SetCullMode,
+    SetTexture,
+    SetSampler,
+    SetConstantBuffer,
+    UpdateBuffer,
+    SetVertexBuffer,
+    SetIndexBuffer,
+    SetVertexLayout,
+    DrawIndexed,
+    Present,
+    SetInstanceBuffer,
+    DrawIndexedInstanced,
+    SetConstantBufferRange,
+    UpdateBufferRange,
+    ExecuteCommandList,
+
+    NumTypes
+};
+
+// A single call to the render context. The meaning of the values depends on the type of command:
+// - resource: the buffer, texture, shader etc. passed, if any
+// - slot:     texture, sampler or constant buffer slot
+// - value:    mode (as an integer), vertex size, index format, byte count for UpdateBuffer(Range) and SetConstantBufferRange,
+//             number of indices to draw, or number of commands in a list for ExecuteCommandList
+// - first:    first index to draw, or byte offset for UpdateBufferRange and SetConstantBufferRange
+// - baseVertex: for DrawIndexed and DrawIndexedInstanced
+// - instances, firstInstance: for DrawIndexedInstanced
+struct RenderCommand
+{
+    RenderCommandType type;
+    const void*       resource   = nullptr;
+    int               slot       = 0;
+    uint32_t          value      = 0;
+    uint32_t          first      = 0;
+    int32_t           baseVertex = 0;
+    uint32_t          instances     = 1;
+    uint32_t          firstInstance = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Null render device
+//--------------------------------------------------------------------------------------
+
+// Can be used from several threads at once, like a Direct3D device
+class NullRenderDevice : public RenderDevice
+{
+public:
+    // Pass the size of the back buffer
+    NullRenderDevice(int backBufferWidth, int backBufferHeight);
+    ~NullRenderDevice();
+
+    GpuBuffer*       CreateBuffer(BufferType type, size_t size, const void* initialData) override;
+    GpuVertexLayout* GetVertexLayout(const std::vector<VertexElement>& vertexElements) override;
+    GpuVertexLayout* GetInstancedVertexLayout(const std::vector<VertexElement>& vertexElements) override;
+    GpuTexture*      LoadTexture(const std::string& fileName) override;
+    GpuTexture*      CreateTextureFromMemory(const void* data, size_t size, const std::string& fileName) override;
+    GpuTexture*      CreateTexture(int width, int height, const uint32_t* pixels) override;
+    size_t           TextureMemory(GpuTexture* texture) override;
+
+    GpuRenderTarget* CreateRenderTarget(int width, int height) override;
+    GpuTexture*      RenderTargetTexture(GpuRenderTarget* renderTarget) override;
+    GpuRenderTarget* BackBuffer() override;
+    void             RenderTargetSize(GpuRenderTarget* renderTarget, int& width, int& height) override;
+
+    GpuVertexShader* LoadVertexShader(const std::string& shaderName) override;
+    GpuPixelShader*  LoadPixelShader (const std::string& shaderName) override;
+
+    void Release(GpuBuffer*       buffer)       override;
+    void Release(GpuTexture*      texture)      override;
+    void Release(GpuRenderTarget* renderTarget) override;
+    void Release(GpuVertexShader* shader)       override;
+    void Release(GpuPixelShader*  shader)       override;
+
+    // Number of resources created and not yet released (not counting vertex layouts and the back buffer).
+    // Should be zero after the app has released everything
+    int LiveResources()  { return mLiveResources; }
+
+    // Total size in bytes of the buffers currently created, i.e. the GPU memory the app would be using for them
+    size_t BufferMemory()  { return mBufferMemory; }
+
+private:
+    GpuRenderTarget* mBackBuffer;
+
+    // Returns the vertex layout for the given vertex description, creating it the first time. The key prefix
+    // separates instanced and non-instanced layouts
+    GpuVertexLayout* GetLayout(const std::string& keyPrefix, const std::vector<VertexElement>& vertexElements);
+
+    // Vertex layouts created so far, keyed by the vertex description
+    std::map<std::string, std::unique_ptr<std::vector<VertexElement>>> mVertexLayouts;
+    std::mutex mVertexLayoutsMutex;
+
+    std::atomic<int>    mLiveResources{ 0 };
+    std::atomic<size_t> mBufferMemory { 0 };
+};
+
+
+//--------------------------------------------------------------------------------------
+// Null render context
+//--------------------------------------------------------------------------------------
+
+class NullRenderContext : public RenderContext
+{
+public:
+    // Pass true for a deferred context, which keeps its commands for a command list (see CreateDeferredContext)
+    NullRenderContext(bool deferred = false);
+
+    void SetRenderTarget(GpuRenderTarget* renderTarget) override;
+    void Clear(GpuRenderTarget* renderTarget, const ColourRGBA& colour) override;
+
+    void SetVertexShader(GpuVertexShader* shader) override;
+    void SetPixelShader (GpuPixelShader*  shader) override;
+
+    void SetBlendMode(BlendMode mode) override;
+    void SetDepthMode(DepthMode mode) override;
+    void SetCullMode (CullMode  mode) override;
+
+    void SetTexture(int slot, GpuTexture* texture) override;
+    void SetSampler(int slot, SamplerMode mode)    override;
+
+    void SetConstantBuffer(int slot, GpuBuffer* buffer) override;
+    void UpdateBuffer(GpuBuffer* buffer, const void* data, size_t size) override;
+
+    bool SupportsConstantBufferRanges() override;
+    void SetConstantBufferRange(int slot, GpuBuffer* buffer, size_t offset, size_t size) override;
+    void UpdateBufferRange(GpuBuffer* buffer, size_t offset, const void* data, size_t size) override;
+
+    void SetVertexBuffer(GpuBuffer* buffer, unsigned int vertexSize) override;
+    void SetIndexBuffer (GpuBuffer* buffer, IndexFormat format)      override;
+    void SetVertexLayout(GpuVertexLayout* layout)                    override;
+    void SetInstanceBuffer(GpuBuffer* buffer)                        override;
+
+    void DrawIndexed(unsigned int numIndices, unsigned int firstIndex, int baseVertex) override;
+    void DrawIndexedInstanced(unsigned int numIndices, unsigned int numInstances, unsigned int firstIndex,
+                              int baseVertex, unsigned int firstInstance) override;
+
+    void Present(bool vsync) override;
+
+    RenderContext*  CreateDeferredContext() override;
+    GpuCommandList* FinishCommandList() override;
+    void            ExecuteCommandList(GpuCommandList* commandList) override;
+
+
+    //-------------------------------------
+    // Statistics and recording
+    //-------------------------------------
+
+    // Whether to behave like a Direct3D 11.1 context that can use constant buffer ranges (the default) or an 11.0 one that
+    // can't, to run the code used on older GPUs
+    void SetConstantBufferRangeSupport(bool supported)  { mConstantBufferRanges = supported; }
+
+    // Number of commands of the given type / of all types since the counts were last reset
+    int CommandCount(RenderCommandType type)  { return mCommandCounts[static_cast<int>(type)]; }
+    int TotalCommands();
+
+    // Number of indices drawn (counting every instance) and bytes copied to constant and instance buffers since the
+    // counts were last reset. A deferred context counts the commands it records, the immediate context counts them
+    // again when it runs them
+    uint64_t IndicesDrawn()   { return mIndicesDrawn; }
+    uint64_t BytesUploaded()  { return mBytesUploaded; }
+
+    void ResetCounts();
+
+    // When recording is on, every command is also added to a list, e.g. to compare the commands of two frames
+    void SetRecording(bool record)  { mRecording = record; }
+    const std::vector<RenderCommand>& Commands()  { return mCommands; }
+    void ClearCommands()  { mCommands.clear(); }
+
+private:
+    // Count the given command and record it if recording is on. On a deferred context also add it to the command list
+    void Add(const RenderCommand& command);
+
+    // Run a command from a command list. Buffer writes take their data from the given pointer, which is moved past it
+    void Run(const RenderCommand& command, const unsigned char*& data);
+
+    int      mCommandCounts[static_cast<int>(RenderCommandType::NumTypes)] = {};
+    uint64_t mIndicesDrawn  = 0;
+    uint64_t mBytesUploaded = 0;
+
+    bool mConstantBufferRanges = true;
+
+    bool mRecording = false;
+    std::vector<RenderCommand> mCommands;
+
+    // Deferred contexts only: the commands for the next command list, and the data written to buffers by them in order
+    bool mDeferred = false;
+    std::vector<RenderCommand> mListCommands;
+    std::vector<unsigned char> mListData;
+};
+
+
+#endif //_RENDERER_NULL_H_INCLUDED_
@@ -7,7 +7,11 @@
 #include "Mesh.h"
 #include "Model.h"
 #include "Camera.h"
-#include "State.h"
+#include "RenderQueue.h"
+#include "RenderTargetPool.h"
+#include "TextureCache.h"
+#include "SceneFile.h"
+#include "SceneObjects.h"
 #include "Shader.h"
 #include "Input.h"
 #include "Common.h"
@@ -15,14 +19,20 @@
 #include "CVector2.h" 
 #include "CVector3.h" 
 #include "CMatrix4x4.h"
+#include "Frustum.h"
 #include "MathHelpers.h"     // Helper functions for maths
 #include "GraphicsHelpers.h" // Helper functions to unclutter the code here
+#include "FrameStats.h"      // Counters of work done each frame
+#include "JobSystem.h"       // Worker threads for the scene update and culling
 
 #include "ColourRGBA.h" 
 
 #include <sstream>
 #include <memory>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <limits>
 
 
 //--------------------------------------------------------------------------------------
@@ -34,27 +44,44 @@ const float ROTATION_SPEED = 2.0f;
 const float MOVEMENT_SPEED = 50.0f;
 
 
-// Meshes, models and cameras, same meaning as TL-Engine. Meshes prepared in InitGeometry function, Models & camera in InitScene
-Mesh* gTeapotMesh;
-Mesh* gCubeMesh;
-Mesh* gCrateMesh;
-Mesh* gSphereMesh;
-Mesh* gGroundMesh;
-Mesh* gLightMesh;
-Mesh* gPortalMesh;
-
-Model* gTeapot;
-Model* gCube;
-Model* gCrate;
-Model* gSphere;
-Model* gGround;
-Model* gLight1;
-Model* gLight2;
-Model* gPortal;
+// The scene file loaded, which declares the meshes, textures, shaders, materials, models and cameras (see SceneFile.h)
+std::string gSceneFileName = "Scene.scene";
+
+// Everything declared in the scene file, created in InitGeometry. Same meaning as TL-Engine for meshes, models and cameras
+SceneObjects gScene;
+
+// Objects from the scene the code below controls directly, found by name in InitScene
+ModelHandle gSphere;
+ModelHandle gCube;
+ModelHandle gLight1;
+ModelHandle gLight2;
+ModelHandle gPortal;
 
 // Two cameras - The main camera, and the view through the portal
-Camera* gCamera;
-Camera* gPortalCamera;
+CameraHandle gCamera;
+CameraHandle gPortalCamera;
+
+// The cameras the scene is rendered from each frame, in the order they are rendered
+enum SceneView { PortalView, MainView, NumSceneViews };
+
+// Draws for each view are collected in a queue, which sorts them to reduce state changes (see RenderQueue.h). Each view
+// has its own queue so the views can be recorded at the same time
+RenderQueue gRenderQueues[NumSceneViews];
+
+// Each view's rendering commands are recorded on its own deferred context (see Renderer.h) by a job, so the views are
+// recorded at the same time on different threads, then the command lists are run in order on gRenderContext. Created in
+// InitScene. If the renderer can't create them, or gRecordViewsInParallel is false, the views are rendered one after
+// the other straight to gRenderContext instead
+RenderContext*  gViewContexts[NumSceneViews] = {};
+GpuCommandList* gViewCommandLists[NumSceneViews] = {};
+bool gRecordViewsInParallel = true;
+
+// Worker threads that update the world matrices and bounds of the models, cull them and fill the render queue, each
+// split into jobs (see JobSystem.h). Created in InitScene
+JobSystem* gJobSystem = nullptr;
+
+// Meshes and textures are loaded on other threads while the scene is shown with placeholders (see AssetLoader.h)
+bool gLoadAssetsInBackground = true;
 
 
 // Additional light information
@@ -88,18 +115,41 @@ bool lockFPS = true;
 //--------------------------------------------------------------------------------------
 //**** Portal Texture  ****//
 //--------------------------------------------------------------------------------------
-// Dimensions of portal texture - controls quality of rendered scene in portal
-int gPortalWidth  = 256;
-int gPortalHeight = 256;
-
-// The portal texture - each frame it is rendered to, then it is used as a texture for model
-ID3D11Texture2D*          gPortalTexture      = nullptr; 
-ID3D11RenderTargetView*   gPortalRenderTarget = nullptr; 
-ID3D11ShaderResourceView* gPortalTextureSRV   = nullptr; 
+// The portal render target - the view through the portal is rendered to it (with its own depth buffer), then its
+// texture is used on the portal model. Declared in the scene file along with its size, which controls the quality of the portal's view
+RenderTargetHandle gPortalRenderTarget;
+
+// The portal is rendered at a size to suit how large it appears in the main view, up to the size declared in the scene
+// file, read in InitScene. When the size changes the render target is swapped for one of the new size from the render
+// target pool (see RenderTargetPool.h), which keeps recently used sizes so changing back and forth doesn't create new
+// targets, and its texture is put in slot 0 of the portal model's material. The portal isn't rendered at all when it is
+// outside the main camera's view
+int gPortalMaxWidth  = 0;
+int gPortalMaxHeight = 0;
+
+// Dynamic resolution: the portal's size is also multiplied by this scale, which is lowered while frames take longer than
+// gFrameTimeBudget and raised again while they don't (see UpdatePortalResolution)
+float gFrameTimeBudget       = 1.0f / 60.0f;
+float gPortalResolutionScale = 1.0f;
+const float PORTAL_MIN_RESOLUTION_SCALE = 0.25f;
+
+// When neither the portal camera nor anything it saw in its last render has moved, the portal is only rendered every this
+// many frames, the others reuse the last render. Not never, as the lighting still changes
+int gPortalStillRefreshFrames = 4;
+
+// What the portal's last render saw, to tell whether it needs rendering again (see PortalNeedsRender)
+struct PortalRender
+{
+    GpuRenderTarget* renderTarget = nullptr; // The target rendered to, nullptr before the first render
+    int cameraViewUpdates       = 0;
+    int cameraProjectionUpdates = 0;
+    int framesSinceRender       = 0;
 
-// Also need a depth/stencil buffer for the portal
-ID3D11Texture2D*        gPortalDepthStencil     = nullptr;
-ID3D11DepthStencilView* gPortalDepthStencilView = nullptr;
+    std::vector<uint64_t> modelsSeen; // A bit for each model drawn (see SceneObjects::AnyModelMoved)
+    uint32_t numModelsSeen    = 0;
+    bool     modelsSeenMoved  = false; // Set when any of them moves, checked every frame whether rendered or not
+};
+PortalRender gPortalRender;
 
 
 
@@ -109,287 +159,141 @@ ID3D11DepthStencilView* gPortalDepthStencilView = nullptr;
 // Variables sent over to the GPU each frame
 
 PerFrameConstants gPerFrameConstants;      // The constants that need to be sent to the GPU each frame
-ID3D11Buffer*     gPerFrameConstantBuffer; // The GPU buffer that will recieve the constants above
-
-PerModelConstants gPerModelConstants;      // As above, but constant that change per-model
-ID3D11Buffer*     gPerModelConstantBuffer; 
-
-
-
-//--------------------------------------------------------------------------------------
-// Textures
-//--------------------------------------------------------------------------------------
-
-// DirectX objects controlling textures used
-ID3D11Resource*           gTeapotDiffuseSpecularMap = nullptr;
-ID3D11ShaderResourceView* gTeapotDiffuseSpecularMapSRV = nullptr;
-
-ID3D11Resource*           gCubeStoneDiffuseSpecularMap    = nullptr; 
-ID3D11ShaderResourceView* gCubeStoneDiffuseSpecularMapSRV = nullptr;
-ID3D11Resource*           gCubeWoodDiffuseSpecularMap = nullptr; 
-ID3D11ShaderResourceView* gCubeWoodDiffuseSpecularMapSRV = nullptr;
+GpuBuffer*        gPerFrameConstantBuffer; // The GPU buffer that will recieve the constants above
 
-ID3D11Resource*           gCrateDiffuseSpecularMap    = nullptr;
-ID3D11ShaderResourceView* gCrateDiffuseSpecularMapSRV = nullptr;
-
-ID3D11Resource*           gSphereDiffuseSpecularMap    = nullptr;
-ID3D11ShaderResourceView* gSphereDiffuseSpecularMapSRV = nullptr;
+// Camera constants, one entry for each view. Each is padded to the alignment of a constant buffer range, so all
+// the entries can be sent in one write and each view selects its own entry
+struct PerViewEntry
+{
+    PerViewConstants constants;
+    uint8_t          padding[CONSTANT_BUFFER_ALIGNMENT - sizeof(PerViewConstants)];
+};
+PerViewEntry gPerViewConstants[NumSceneViews];
+GpuBuffer*   gPerViewConstantBuffer;
 
-ID3D11Resource*           gGroundDiffuseSpecularMap    = nullptr;
-ID3D11ShaderResourceView* gGroundDiffuseSpecularMapSRV = nullptr;
+PerModelConstants gPerModelConstants;      // As above, but constant that change per-model
+GpuBuffer*        gPerModelConstantBuffer; 
 
-ID3D11Resource*           gLightDiffuseMap    = nullptr;
-ID3D11ShaderResourceView* gLightDiffuseMapSRV = nullptr;
 
 
 //--------------------------------------------------------------------------------------
-// Initialise scene geometry, constant buffers and states
+// Initialise scene geometry, constant buffers and textures
 //--------------------------------------------------------------------------------------
 
 // Prepare the geometry required for the scene
 bool InitGeometry()
 {
-    // Load mesh geometry data
-    try 
-    {
-        gTeapotMesh = new Mesh("Teapot.x");
-        gCubeMesh   = new Mesh("Cube.x");
-        gCrateMesh  = new Mesh("CargoContainer.x");
-        gSphereMesh = new Mesh("Sphere.x");
-        gGroundMesh = new Mesh("Hills.x");
-        gLightMesh  = new Mesh("Light.x");
-        gPortalMesh = new Mesh("Portal.x");
-    }
-    catch (std::runtime_error e)
-    {
-        gLastError = e.what();
-        return false;
-    }
-
+    // Read the scene description. The first load of the text compiles it to a binary file, later loads read that
+    // instead while the text is unchanged
+    SceneDescription sceneDescription;
+    if (!LoadSceneFile(gSceneFileName, sceneDescription))  return false;
 
-    // Load the shaders required for the geometry used
-    if (!LoadShaders())
-    {
-        gLastError = "Error loading shaders";
-        return false;
-    }
 
-
-    // Create GPU-side constant buffers to receive the gPerFrameConstants and gPerModelConstants structures above
+    // Create GPU-side constant buffers to receive the gPerFrameConstants, gPerViewConstants and gPerModelConstants structures above
     gPerFrameConstantBuffer = CreateConstantBuffer(sizeof(gPerFrameConstants));
+    gPerViewConstantBuffer  = CreateConstantBuffer(sizeof(gPerViewConstants));
     gPerModelConstantBuffer = CreateConstantBuffer(sizeof(gPerModelConstants));
-    if (gPerFrameConstantBuffer == nullptr || gPerModelConstantBuffer == nullptr)
+    if (gPerFrameConstantBuffer == nullptr || gPerViewConstantBuffer == nullptr || gPerModelConstantBuffer == nullptr)
     {
         gLastError = "Error creating constant buffers";
         return false;
     }
 
 
-    //// Load / prepare textures on the GPU ////
+    // Load the meshes, textures and shaders, create the render targets, and add each material to the first view's render
+    // queue. The other views' queues use the same materials. Meshes and textures loading in the background are given to
+    // the queues as they arrive, see RenderScene
+    if (!gScene.Create(sceneDescription, gRenderQueues[0], gLoadAssetsInBackground))  return false;
+    for (int view = 1; view < NumSceneViews; ++view)  gRenderQueues[view].CopyMaterials(gRenderQueues[0]);
+    return true;
+}
+
+
+// Prepare the scene
+bool InitScene()
+{
+    //// Set up scene ////
 
-    // Load textures and create DirectX objects for them
-    if (!LoadTexture("MetalDiffuseSpecular.dds", &gTeapotDiffuseSpecularMap, &gTeapotDiffuseSpecularMapSRV) ||
-        !LoadTexture("StoneDiffuseSpecular.dds", &gCubeStoneDiffuseSpecularMap,   &gCubeStoneDiffuseSpecularMapSRV  ) ||
-        !LoadTexture("WoodDiffuseSpecular.dds",  &gCubeWoodDiffuseSpecularMap,    &gCubeWoodDiffuseSpecularMapSRV) ||
-        !LoadTexture("CargoA.dds",               &gCrateDiffuseSpecularMap,  &gCrateDiffuseSpecularMapSRV) ||
-        !LoadTexture("Brick1.jpg",               &gSphereDiffuseSpecularMap, &gSphereDiffuseSpecularMapSRV) ||
-        !LoadTexture("GrassDiffuseSpecular.dds", &gGroundDiffuseSpecularMap, &gGroundDiffuseSpecularMapSRV ) ||
-        !LoadTexture("Flare.jpg",                &gLightDiffuseMap,          &gLightDiffuseMapSRV ))
+    // The models and cameras are created from the scene file along with the geometry. Find the ones controlled here
+    gSphere = gScene.FindModel("Sphere");
+    gCube   = gScene.FindModel("Cube");
+    gLight1 = gScene.FindModel("Light1");
+    gLight2 = gScene.FindModel("Light2");
+    gPortal = gScene.FindModel("Portal");
+    gCamera       = gScene.FindCamera("Main");
+    gPortalCamera = gScene.FindCamera("Portal");
+    gPortalRenderTarget = gScene.FindRenderTarget("Portal");
+    if (!gSphere.IsValid() || !gCube.IsValid() || !gLight1.IsValid() || !gLight2.IsValid() || !gPortal.IsValid() ||
+        !gCamera.IsValid() || !gPortalCamera.IsValid() || !gPortalRenderTarget.IsValid())
     {
-        gLastError = "Error loading textures";
+        gLastError = gSceneFileName + " is missing a model, camera or render target used by the app";
         return false;
     }
 
+    // Light size depends on its strength
+    gScene.GetModel(gLight1).SetScale(pow(gLight1Strength, 0.7f));
+    gScene.GetModel(gLight2).SetScale(pow(gLight2MaxStrength, 0.7f));
+    gScene.SetModelColour(gLight1, gLight1Colour);
+    gScene.SetModelColour(gLight2, gLight2Colour);
 
+    // The portal is never rendered larger than its size in the scene file
+    gRenderDevice->RenderTargetSize(gScene.GetRenderTarget(gPortalRenderTarget), gPortalMaxWidth, gPortalMaxHeight);
+    gPortalRender = PortalRender();
 
+    // Start the worker threads, one fewer than the number of CPU cores as the main thread also runs jobs while it waits
+    if (gJobSystem == nullptr)
+    {
+        try
+        {
+            gJobSystem = new JobSystem();
+        }
+        catch (const std::runtime_error& e)
+        {
+            gLastError = e.what();
+            return false;
+        }
+    }
+
+    // A deferred context to record each view on. Not an error if the renderer can't create them, all views are then
+    // rendered on gRenderContext
+    bool contextsCreated = true;
+    for (auto& context : gViewContexts)
+    {
+        if (context == nullptr)  context = gRenderContext->CreateDeferredContext();
+        contextsCreated = contextsCreated && (context != nullptr);
+    }
+    if (!contextsCreated)
+    {
+        for (auto& context : gViewContexts)  { delete context;  context = nullptr; }
+    }
 
-    //**** Create Portal Texture ****//
-
-	// Using a helper function to load textures from files above
-	D3D11_TEXTURE2D_DESC portalDesc = {};
-	portalDesc.Width  = gPortalWidth;  // Size of the portal texture determines its quality
-	portalDesc.Height = gPortalHeight;
-	portalDesc.MipLevels = 1; // No mip-maps when rendering to textures
-	portalDesc.ArraySize = 1;
-	portalDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // RGBA texture (8-bits each)
-	portalDesc.SampleDesc.Count = 1;
-	portalDesc.SampleDesc.Quality = 0;
-	portalDesc.Usage = D3D11_USAGE_DEFAULT;
-	portalDesc.BindFlags = D3D10_BIND_RENDER_TARGET | D3D10_BIND_SHADER_RESOURCE;
-	portalDesc.CPUAccessFlags = 0;
-	portalDesc.MiscFlags = 0;
-	if (FAILED( gD3DDevice->CreateTexture2D(&portalDesc, NULL, &gPortalTexture) ))
-	{
-		gLastError = "Error creating portal texture";
-		return false;
-	}
-
-	if (FAILED( gD3DDevice->CreateRenderTargetView(gPortalTexture, NULL, &gPortalRenderTarget) ))
-	{
-		gLastError = "Error creating portal render target view";
-		return false;
-	}
-
-	// Create a shader-resource "view"
-	D3D11_SHADER_RESOURCE_VIEW_DESC srDesc = {};
-	srDesc.Format = portalDesc.Format;
-	srDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-	srDesc.Texture2D.MostDetailedMip = 0;
-	srDesc.Texture2D.MipLevels = 1;
-	if (FAILED( gD3DDevice->CreateShaderResourceView(gPortalTexture, &srDesc, &gPortalTextureSRV) ))
-	{
-		gLastError = "Error creating portal shader resource view";
-		return false;
-	}
-
-
-	//**** Create Portal Depth Buffer ****//
-
-    portalDesc = {};
-	portalDesc.Width  = gPortalWidth;
-	portalDesc.Height = gPortalHeight;
-	portalDesc.MipLevels = 1;
-	portalDesc.ArraySize = 1;
-	portalDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	portalDesc.SampleDesc.Count = 1;
-	portalDesc.SampleDesc.Quality = 0;
-	portalDesc.Usage = D3D11_USAGE_DEFAULT;
-	portalDesc.BindFlags = D3D10_BIND_DEPTH_STENCIL;
-	portalDesc.CPUAccessFlags = 0;
-	portalDesc.MiscFlags = 0;
-	if (FAILED(gD3DDevice->CreateTexture2D(&portalDesc, NULL, &gPortalDepthStencil) ))
-	{
-		gLastError = "Error creating portal depth stencil texture";
-		return false;
-	}
-
-	// Create the depth stencil view
-	D3D11_DEPTH_STENCIL_VIEW_DESC portalDescDSV = {};
-	portalDescDSV.Format = portalDesc.Format;
-	portalDescDSV.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	portalDescDSV.Texture2D.MipSlice = 0;
-    portalDescDSV.Flags = 0;
-	if (FAILED(gD3DDevice->CreateDepthStencilView(gPortalDepthStencil, &portalDescDSV, &gPortalDepthStencilView) ))
-	{
-		gLastError = "Error creating portal depth stencil view";
-		return false;
-	}
-
-    
-    //*****************************//
-    
-
-
-  	// Create all filtering modes, blending modes etc. used by the app
-	if (!CreateStates())
-	{
-		gLastError = "Error creating states";
-		return false;
-	}
-
-	return true;
+    return true;
 }
 
 
-// Prepare the scene
-bool InitScene()
+// Wait for the meshes and textures loading in the background and swap them in for their placeholders
+bool FinishLoading()
 {
-    //// Set up scene ////
-
-    gTeapot = new Model(gTeapotMesh);
-    gCube   = new Model(gCubeMesh);
-    gCrate  = new Model(gCrateMesh);
-    gSphere = new Model(gSphereMesh);
-    gGround = new Model(gGroundMesh);
-    gLight1 = new Model(gLightMesh);
-    gLight2 = new Model(gLightMesh);
-    gPortal = new Model(gPortalMesh);
-
-	// Initial positions
-    gTeapot->SetPosition({ 10,  0, 40 });
-	gCube->  SetPosition({  0, 15,  0 });
-	gSphere->SetPosition({ 30, 10,  0 });
-	gCrate-> SetPosition({-10,  0, 90 });
-	gCrate-> SetScale( 6.0f );
-	gCrate-> SetRotation({ 0.0f, ToRadians(40.0f), 0.0f });
-	gPortal->SetPosition({ 40, 20, 40 });
-	gPortal->SetRotation({ 0.0f, ToRadians(-130.0f), 0.0f });
-
-    gLight1->SetPosition({ 30, 10, 0 });
-    gLight1->SetScale(pow(gLight1Strength, 0.7f));
-    gLight2->SetPosition({ -20, 30, 40 });
-    gLight2->SetScale(pow(gLight2MaxStrength, 0.7f));
-
-    //// Set up cameras ////
-
-    gCamera = new Camera();
-    gCamera->SetPosition({ 40, 30, -90 });
-    gCamera->SetRotation({ ToRadians(8.0f), ToRadians(-18.0f), 0.0f });
-	gCamera->SetNearClip( 1.0f );
-	gCamera->SetFarClip( 1000.0f );
-
-
-  	// Set up portal
-	gPortalCamera = new Camera();
-	gPortalCamera->SetPosition({ 45, 45, 85 });
-	gPortalCamera->SetRotation({ ToRadians(20.0f), ToRadians(215.0f), 0 });
-
-
-    return true;
+    return gScene.FinishLoading(gRenderQueues, NumSceneViews);
 }
 
 
 // Release the geometry and scene resources created above
 void ReleaseResources()
 {
-    ReleaseStates();
-
-    if (gPortalDepthStencilView)  gPortalDepthStencilView->Release();
-    if (gPortalDepthStencil)      gPortalDepthStencil->Release();
-    if (gPortalTextureSRV)        gPortalTextureSRV->Release();
-    if (gPortalRenderTarget)      gPortalRenderTarget->Release();
-    if (gPortalTexture)           gPortalTexture->Release();
-
-    if (gLightDiffuseMapSRV)           gLightDiffuseMapSRV->Release();
-    if (gLightDiffuseMap)              gLightDiffuseMap->Release();
-    if (gGroundDiffuseSpecularMapSRV)  gGroundDiffuseSpecularMapSRV->Release();
-    if (gGroundDiffuseSpecularMap)     gGroundDiffuseSpecularMap->Release();
-    if (gSphereDiffuseSpecularMapSRV)  gSphereDiffuseSpecularMapSRV->Release();
-    if (gSphereDiffuseSpecularMap)     gSphereDiffuseSpecularMap->Release();
-    if (gCrateDiffuseSpecularMapSRV)   gCrateDiffuseSpecularMapSRV->Release();
-    if (gCrateDiffuseSpecularMap)      gCrateDiffuseSpecularMap->Release();
-    if (gTeapotDiffuseSpecularMapSRV)   gTeapotDiffuseSpecularMapSRV->Release();
-    if (gTeapotDiffuseSpecularMap)      gTeapotDiffuseSpecularMap->Release();
-    if (gCubeStoneDiffuseSpecularMapSRV)    gCubeStoneDiffuseSpecularMapSRV->Release();
-    if (gCubeStoneDiffuseSpecularMap)       gCubeStoneDiffuseSpecularMap->Release();
-    if (gCubeWoodDiffuseSpecularMapSRV)    gCubeWoodDiffuseSpecularMapSRV->Release();
-    if (gCubeWoodDiffuseSpecularMap)       gCubeWoodDiffuseSpecularMap->Release();
-
-    if (gPerModelConstantBuffer)  gPerModelConstantBuffer->Release();
-    if (gPerFrameConstantBuffer)  gPerFrameConstantBuffer->Release();
-
-    ReleaseShaders();
-
-    // Delete dynamically allocated objects not using unique_ptr
-    delete gCamera;        gCamera       = nullptr;
-    delete gPortalCamera;  gPortalCamera = nullptr;
-
-    delete gPortal;  gPortal = nullptr;
-    delete gLight1;  gLight1 = nullptr;
-    delete gLight2;  gLight2 = nullptr;
-    delete gGround;  gGround = nullptr;
-    delete gSphere;  gSphere = nullptr;
-    delete gCrate;   gCrate  = nullptr;
-    delete gCube;    gCube   = nullptr;
-    delete gTeapot;  gTeapot = nullptr;
-
-    delete gPortalMesh;  gPortalMesh = nullptr;
-    delete gLightMesh;   gLightMesh  = nullptr;
-    delete gGroundMesh;  gGroundMesh = nullptr;
-    delete gSphereMesh;  gSphereMesh = nullptr;
-    delete gCrateMesh;   gCrateMesh  = nullptr;
-    delete gCubeMesh;    gCubeMesh   = nullptr;
-    delete gTeapotMesh;  gTeapotMesh = nullptr;
+    // The render queues' materials use the scene's shaders and textures, so release them first
+    for (auto& renderQueue : gRenderQueues)  renderQueue.Release();
+    gScene.Release();
+    gRenderTargetPool.Clear();
+    gTextureCache.Clear();
+
+    for (auto& context : gViewContexts)  { delete context;  context = nullptr; }
+    delete gJobSystem;
+    gJobSystem = nullptr;
+
+    gRenderDevice->Release(gPerModelConstantBuffer);  gPerModelConstantBuffer = nullptr;
+    gRenderDevice->Release(gPerViewConstantBuffer);   gPerViewConstantBuffer  = nullptr;
+    gRenderDevice->Release(gPerFrameConstantBuffer);  gPerFrameConstantBuffer = nullptr;
 }
 
 
@@ -399,156 +303,433 @@ void ReleaseResources()
 //--------------------------------------------------------------------------------------
 
 
-// Render everything in the scene from the given camera
-void RenderSceneFromCamera(Camera* camera)
+// Models that aren't static are culled and submitted to the render queue in batches of this many, with a job for one or
+// more batches. The static models found visible by the BVH are submitted in batches of the same size
+const uint32_t CULL_BATCH_SIZE = 1024;
+
+// Bounding sphere of every model that isn't static (see SceneObjects::DynamicModels) in separate arrays for the batch
+// frustum test, updated once a frame by the jobs started in UpdateSceneBounds. Sized to the number of models when first
+// used. The static models' bounds are kept in the scene's BVH instead
+std::vector<float> gBoundsCentreX, gBoundsCentreY, gBoundsCentreZ, gBoundsRadius;
+JobCounter         gBoundsUpdated;
+
+// The results of culling the models for one view
+struct ViewCulling
 {
-    // Set camera matrices in the constant buffer and send over to GPU
-    gPerFrameConstants.viewMatrix           = camera->ViewMatrix();
-    gPerFrameConstants.projectionMatrix     = camera->ProjectionMatrix();
-    gPerFrameConstants.viewProjectionMatrix = camera->ViewProjectionMatrix();
-    UpdateConstantBuffer(gPerFrameConstantBuffer, gPerFrameConstants);
+    std::vector<uint32_t> visibleStatic; // Static models that may be seen, as positions in SceneObjects::StaticModels
+    std::vector<uint8_t>  visible;       // For each other model, whether it may be seen
+    std::vector<uint32_t> batchDrawn;    // Number of visible models in each batch, then the first draw of each batch
+    JobCounter            culled;        // Counts the culling jobs still running
+};
+ViewCulling gViewCulling[NumSceneViews];
 
-    // Indicate that the constant buffer is for use in the vertex shader (VS) and pixel shader (PS)
-    gD3DContext->VSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
-    gD3DContext->PSSetConstantBuffers(0, 1, &gPerFrameConstantBuffer);
-
-
-    //// Render lit models ////
-
-    // Select which shaders to use next
-    gD3DContext->VSSetShader(gPixelLightingVertexShader, nullptr, 0);
-    gD3DContext->PSSetShader(gPixelLightingPixelShader,  nullptr, 0);
-    
-    // States for non-unique objects
-    gD3DContext->OMSetBlendState(gNoBlendingState, nullptr, 0xffffff);
-    gD3DContext->OMSetDepthStencilState(gUseDepthBufferState, 0);
-    gD3DContext->RSSetState(gCullBackState);
-
-    // Select the approriate textures and sampler to use in the pixel shader
-    gD3DContext->PSSetShaderResources(0, 1, &gGroundDiffuseSpecularMapSRV);
-    gD3DContext->PSSetSamplers(0, 1, &gAnisotropic4xSampler);
-
-    // Render model
-    gGround->Render();
-
-    // Container render
-    gD3DContext->PSSetShaderResources(0, 1, &gCrateDiffuseSpecularMapSRV);
-    gCrate->Render();
-
-    // Teapot render
-    gD3DContext->PSSetShaderResources(0, 1, &gTeapotDiffuseSpecularMapSRV);
-    gTeapot->Render();
-
-    // Portal render
-    gD3DContext->PSSetShaderResources(0, 1, &gPortalTextureSRV);
-    gPortal->Render();
-
-    // Sphere render - change in shaders
-    gD3DContext->VSSetShader(gSphereModelVertexShader, nullptr, 0);
-    gD3DContext->PSSetShader(gSphereModelPixelShader, nullptr, 0);
-    gD3DContext->PSSetShaderResources(0, 1, &gSphereDiffuseSpecularMapSRV);
-    gSphere->Render();
-    
-    // Cube render - change in shaders, and two textures sent to buffers
-    gD3DContext->VSSetShader(gCubeModelVertexShader, nullptr, 0);
-    gD3DContext->PSSetShader(gCubeModelPixelShader, nullptr, 0);
-    gD3DContext->PSSetShaderResources(0, 1, &gCubeStoneDiffuseSpecularMapSRV); // Send two textures to the buffers for linear interpolation
-    gD3DContext->PSSetShaderResources(1, 1, &gCubeWoodDiffuseSpecularMapSRV);
-    gCube->Render();
-
-    //// Render lights ////
-    // Rendered with different shaders, textures, states from other models
-
-    gD3DContext->VSSetShader(gLightModelVertexShader, nullptr, 0);
-    gD3DContext->PSSetShader(gLightModelPixelShader,  nullptr, 0);
-
-    // Select the texture and sampler to use in the pixel shader
-    gD3DContext->PSSetShaderResources(0, 1, &gLightDiffuseMapSRV); 
-    gD3DContext->PSSetSamplers(0, 1, &gAnisotropic4xSampler);
-
-    // States - additive blending, read-only depth buffer and no culling 
-    gD3DContext->OMSetBlendState(gAdditiveBlendingState, nullptr, 0xffffff);
-    gD3DContext->OMSetDepthStencilState(gDepthReadOnlyState, 0);
-    gD3DContext->RSSetState(gCullNoneState);
-
-    // Render model, sets world matrix, vertex and index buffer and calls Draw on the GPU
-    gPerModelConstants.objectColour = gLight1Colour; // Set any per-model constants apart from the world matrix just before calling render
-    gLight1->Render();
-
-    gPerModelConstants.objectColour = gLight2Colour;
-    gLight2->Render();
+
+// Start jobs that update the bounding sphere of each model that isn't static from its world matrix. World matrices
+// must be up to date
+void UpdateSceneBounds()
+{
+    const std::vector<uint32_t>& dynamicModels = gScene.DynamicModels();
+    uint32_t numDynamic = static_cast<uint32_t>(dynamicModels.size());
+    gBoundsCentreX.resize(numDynamic);  gBoundsCentreY.resize(numDynamic);  gBoundsCentreZ.resize(numDynamic);
+    gBoundsRadius.resize(numDynamic);
+
+    gJobSystem->ParallelFor(numDynamic, CULL_BATCH_SIZE, [&dynamicModels](uint32_t first, uint32_t end)
+    {
+        for (uint32_t i = first; i < end; ++i)
+        {
+            CVector3 centre;
+            gScene.GetModel({ dynamicModels[i] }).WorldBoundingSphere(centre, gBoundsRadius[i]);
+            gBoundsCentreX[i] = centre.x;
+            gBoundsCentreY[i] = centre.y;
+            gBoundsCentreZ[i] = centre.z;
+        }
+    }, &gBoundsUpdated);
 }
 
 
+// Start jobs that find which models may be seen by the given camera. One job walks the static models' BVH with the
+// camera's frustum, testing the bounding box of groups of models and only looking inside groups that are partly in
+// view. The models that aren't static are culled once the bounds jobs are done: each batch has its bounding spheres
+// tested against the frustum together (four at a time with SIMD), then any that pass are given a second test with their
+// bounding box, which is a tighter fit for long or flat models. Sets culling.visibleStatic and culling.visible, and
+// counts the visible models in each batch
+void CullSceneModels(Camera& camera, ViewCulling& culling)
+{
+    const std::vector<uint32_t>& dynamicModels = gScene.DynamicModels();
+    uint32_t numDynamic = static_cast<uint32_t>(dynamicModels.size());
+    uint32_t numBatches = (numDynamic + CULL_BATCH_SIZE - 1) / CULL_BATCH_SIZE;
+    culling.visible.resize(numDynamic);
+    culling.batchDrawn.resize(numBatches);
+
+    // The camera rebuilds its matrices when read after moving, so get the frustum here rather than in the jobs
+    Frustum frustum = camera.ViewFrustum();
+    gJobSystem->Run([frustum, &culling]()
+    {
+        culling.visibleStatic.clear();
+        gScene.StaticBVH().FrustumQuery(frustum, culling.visibleStatic);
+    }, &culling.culled);
+
+    gJobSystem->ParallelFor(numBatches, 1, [frustum, numDynamic, &dynamicModels, &culling](uint32_t firstBatch, uint32_t endBatch)
+    {
+        for (uint32_t batch = firstBatch; batch < endBatch; ++batch)
+        {
+            uint32_t first = batch * CULL_BATCH_SIZE;
+            uint32_t end   = std::min(numDynamic, first + CULL_BATCH_SIZE);
+            SpheresInFrustum(frustum, &gBoundsCentreX[first], &gBoundsCentreY[first], &gBoundsCentreZ[first],
+                             &gBoundsRadius[first], end - first, &culling.visible[first]);
+
+            uint32_t drawn = 0;
+            for (uint32_t i = first; i < end; ++i)
+            {
+                if (culling.visible[i])
+                {
+                    CVector3 boundsMin, boundsMax;
+                    gScene.GetModel({ dynamicModels[i] }).WorldBounds(boundsMin, boundsMax);
+                    culling.visible[i] = AABBInFrustum(frustum, boundsMin, boundsMax);
+                    drawn += culling.visible[i];
+                }
+            }
+            culling.batchDrawn[batch] = drawn;
+        }
+    }, &culling.culled, &gBoundsUpdated);
+}
+
+
+// Render everything in the scene from the given camera, which is for the given view, to the given render target. The
+// commands are sent to the given render context: gRenderContext, or a deferred context when called from a job, in which
+// case the view's command list is finished and kept in gViewCommandLists. The constants for all views must have been
+// set in gPerViewConstants and this view's culling jobs started (see CullSceneModels). Models outside the camera's view
+// are skipped, the number drawn and skipped are added to the given stats. The CPU time taken is put in recordTime
+void RenderSceneFromCamera(Camera& camera, SceneView view, GpuRenderTarget* renderTarget, RenderContext& context,
+                           CullingStats& cullingStats, float& recordTime)
+{
+    // Wait for this view's culling jobs (started in RenderScene), then turn the number of visible models in each batch
+    // into the index of the batch's first draw, so each batch knows where to put its draws in the render queue. The
+    // visible static models are drawn first
+    ViewCulling& culling = gViewCulling[view];
+    gJobSystem->Wait(culling.culled);
+    uint32_t numStaticDrawn = static_cast<uint32_t>(culling.visibleStatic.size());
+    uint32_t numDrawn = numStaticDrawn;
+    for (uint32_t& batchDrawn : culling.batchDrawn)
+    {
+        uint32_t batchFirstDraw = numDrawn;
+        numDrawn  += batchDrawn;
+        batchDrawn = batchFirstDraw;
+    }
+    cullingStats.drawn  += numDrawn;
+    cullingStats.culled += gScene.NumModels() - numDrawn;
+
+    auto recordStart = std::chrono::steady_clock::now();
+
+    // Select the target for rendering, the viewport is set to match. Clear it to a fixed colour and its depth buffer to
+    // the far distance
+    context.SetRenderTarget(renderTarget);
+    context.Clear(renderTarget, gBackgroundColor);
+
+    // Select the lighting constants and this camera's constants for use in the vertex shader (VS) and pixel shader (PS).
+    // Each view selects everything it uses, as a deferred context starts with nothing selected. The camera constants
+    // have already been sent to the GPU along with the other views' if the renderer can select part of a constant
+    // buffer, otherwise send them now
+    context.SetConstantBuffer(0, gPerFrameConstantBuffer);
+    if (context.SupportsConstantBufferRanges())
+    {
+        context.SetConstantBufferRange(2, gPerViewConstantBuffer, view * sizeof(PerViewEntry), sizeof(PerViewConstants));
+    }
+    else
+    {
+        UpdateConstantBuffer(context, gPerViewConstantBuffer, gPerViewConstants[view].constants);
+        context.SetConstantBuffer(2, gPerViewConstantBuffer);
+    }
+
+    // Queue up the visible models, each with its material and colour. Each batch of models is submitted by a job, the
+    // static models first then the others
+    RenderQueue& renderQueue = gRenderQueues[view];
+    renderQueue.Begin(camera.FarClip());
+    renderQueue.Resize(numDrawn);
+    CVector3 cameraPosition = camera.Position();
+    auto submit = [&renderQueue, cameraPosition](int draw, ModelHandle model)
+    {
+        float distance = Length(gScene.GetModel(model).WorldPosition() - cameraPosition);
+        renderQueue.SubmitAt(draw, &gScene.GetModel(model), gScene.ModelMaterial(model), distance, gScene.ModelColour(model));
+    };
+
+    JobCounter submitted;
+    const std::vector<uint32_t>& staticModels = gScene.StaticModels();
+    gJobSystem->ParallelFor(numStaticDrawn, CULL_BATCH_SIZE, [&culling, &staticModels, &submit](uint32_t first, uint32_t end)
+    {
+        for (uint32_t i = first; i < end; ++i)  submit(i, { staticModels[culling.visibleStatic[i]] });
+    }, &submitted);
+
+    const std::vector<uint32_t>& dynamicModels = gScene.DynamicModels();
+    uint32_t numDynamic = static_cast<uint32_t>(dynamicModels.size());
+    gJobSystem->ParallelFor(static_cast<uint32_t>(culling.batchDrawn.size()), 1, [&culling, &dynamicModels, &submit, numDynamic](uint32_t firstBatch, uint32_t endBatch)
+    {
+        for (uint32_t batch = firstBatch; batch < endBatch; ++batch)
+        {
+            int draw = culling.batchDrawn[batch];
+            uint32_t end = std::min(numDynamic, (batch + 1) * CULL_BATCH_SIZE);
+            for (uint32_t i = batch * CULL_BATCH_SIZE; i < end; ++i)
+            {
+                if (culling.visible[i])  submit(draw++, { dynamicModels[i] });
+            }
+        }
+    }, &submitted);
+    gJobSystem->Wait(submitted);
+
+    // Draw opaque models grouped by shader and texture, then the lights back-to-front. The queue sets the shaders,
+    // textures and states for each model, but only when they change
+    renderQueue.Sort();
+    renderQueue.Execute(context);
+
+    // End the command list on a deferred context (there is no list on gRenderContext, this gives nullptr)
+    gViewCommandLists[view] = context.FinishCommandList();
+
+    recordTime = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - recordStart).count();
+}
+
+
+
+// Returns how many pixels across the portal appears from the given (main) camera, the larger of its width and height on
+// screen, or 0 if it is outside the camera's view so needn't be rendered at all. The portal's world matrix must be up
+// to date
+float PortalScreenSize(Camera& camera)
+{
+    CVector3 boundsMin, boundsMax;
+    gScene.GetModel(gPortal).WorldBounds(boundsMin, boundsMax);
+    if (!AABBInFrustum(camera.ViewFrustum(), boundsMin, boundsMax))  return 0;
+
+    // Project the corners of the portal's bounding box onto the screen and find the rectangle around them. The parts off
+    // screen still count - the whole texture is stretched over the portal, so that is the size it needs for one texel per
+    // pixel. If a corner is nearer than the near clip distance the projection is no use, but the portal is then close up,
+    // so return a size larger than any render target
+    CMatrix4x4 viewProjection = camera.ViewProjectionMatrix();
+    float minX = std::numeric_limits<float>::max(), maxX = -minX;
+    float minY = minX, maxY = -minX;
+    for (int corner = 0; corner < 8; ++corner)
+    {
+        CVector3 p = { (corner & 1) ? boundsMax.x : boundsMin.x,
+                       (corner & 2) ? boundsMax.y : boundsMin.y,
+                       (corner & 4) ? boundsMax.z : boundsMin.z };
+        float w = p.x * viewProjection.e03 + p.y * viewProjection.e13 + p.z * viewProjection.e23 + viewProjection.e33;
+        if (w < camera.NearClip())  return std::numeric_limits<float>::max();
+
+        float x = (p.x * viewProjection.e00 + p.y * viewProjection.e10 + p.z * viewProjection.e20 + viewProjection.e30) / w;
+        float y = (p.x * viewProjection.e01 + p.y * viewProjection.e11 + p.z * viewProjection.e21 + viewProjection.e31) / w;
+        minX = std::min(minX, x);  maxX = std::max(maxX, x);
+        minY = std::min(minY, y);  maxY = std::max(maxY, y);
+    }
+
+    // The projected coordinates are -1 to 1 across the screen
+    int screenWidth, screenHeight;
+    gRenderDevice->RenderTargetSize(gRenderDevice->BackBuffer(), screenWidth, screenHeight);
+    return std::max((maxX - minX) * 0.5f * screenWidth, (maxY - minY) * 0.5f * screenHeight);
+}
+
+
+// Dynamic resolution for the portal. Lowers gPortalResolutionScale quickly while the frame time, averaged over the last
+// few frames, is over gFrameTimeBudget, and raises it slowly while it is within budget, so the scale settles just below
+// the point where frames start taking too long. A frame locked to vsync takes the whole refresh period however little
+// work it does, so a frame time slightly over the budget counts as within it
+void UpdatePortalResolution(float frameTime)
+{
+    static float averageFrameTime = gFrameTimeBudget;
+    averageFrameTime += (frameTime - averageFrameTime) * 0.1f;
+
+    if (averageFrameTime > gFrameTimeBudget * 1.1f)
+    {
+        gPortalResolutionScale = std::max(PORTAL_MIN_RESOLUTION_SCALE, gPortalResolutionScale * 0.95f);
+    }
+    else if (averageFrameTime < gFrameTimeBudget * 1.02f)
+    {
+        gPortalResolutionScale = std::min(1.0f, gPortalResolutionScale * 1.01f);
+    }
+}
+
+
+// Returns true if the portal must be rendered this frame to the given render target, or false if its last render can be
+// kept: it was to the same target, the portal camera hasn't moved, none of the models it saw have moved, it
+// sees the same number of models (so none have come into view) and gPortalStillRefreshFrames haven't passed since. The
+// portal view's culling must be finished. If returning true, remembers what this render sees for next time
+bool PortalNeedsRender(Camera& portalCamera, GpuRenderTarget* renderTarget)
+{
+    const ViewCulling& culling = gViewCulling[PortalView];
+    uint32_t numSeen = static_cast<uint32_t>(culling.visibleStatic.size());
+    for (uint32_t batchDrawn : culling.batchDrawn)  numSeen += batchDrawn;
+
+    PortalRender& last = gPortalRender;
+    ++last.framesSinceRender;
+    if (renderTarget == last.renderTarget && !last.modelsSeenMoved && numSeen == last.numModelsSeen &&
+        portalCamera.NumViewUpdates() == last.cameraViewUpdates && portalCamera.NumProjectionUpdates() == last.cameraProjectionUpdates &&
+        last.framesSinceRender < gPortalStillRefreshFrames)
+    {
+        return false;
+    }
+
+    last.renderTarget = renderTarget;
+    last.cameraViewUpdates       = portalCamera.NumViewUpdates();
+    last.cameraProjectionUpdates = portalCamera.NumProjectionUpdates();
+    last.framesSinceRender = 0;
+    last.numModelsSeen     = numSeen;
+    last.modelsSeenMoved   = false;
+
+    last.modelsSeen.assign((gScene.NumModels() + 63) / 64, 0);
+    auto see = [&last](uint32_t model) { last.modelsSeen[model / 64] |= uint64_t(1) << (model % 64); };
+    const std::vector<uint32_t>& staticModels  = gScene.StaticModels();
+    const std::vector<uint32_t>& dynamicModels = gScene.DynamicModels();
+    for (uint32_t i : culling.visibleStatic)  see(staticModels[i]);
+    for (uint32_t i = 0; i < dynamicModels.size(); ++i)
+    {
+        if (culling.visible[i])  see(dynamicModels[i]);
+    }
+    return true;
+}
 
 
 // Main render function
 void RenderScene()
 {
+    Camera& camera       = gScene.GetCamera(gCamera);
+    Camera& portalCamera = gScene.GetCamera(gPortalCamera);
+
     //// Common settings for both main scene and portal scene ////
 
-    // Set up the light information in the constant buffer - this is the same for portal and main render
+    // Swap in the meshes and textures that have finished loading in the background since the last frame. One that fails
+    // to load keeps its placeholder. The portal must show the new assets even if nothing it saw has moved
+    if (!gScene.UpdateLoading(gRenderQueues, NumSceneViews))  DebugMessage(gLastError + "\n");
+    gFrameStats.assetsLoading = gScene.NumAssetsLoading();
+    if (gFrameStats.assetsCreated > 0)  gPortalRender.modelsSeenMoved = true;
+
+    // Rebuild the world matrices of all models moved by UpdateScene together, rather than one at a time as they are used,
+    // then start the jobs that update the models' bounds and cull them for each view. They run while the constants are
+    // set up below, each view waits for its own culling before it is drawn. The jobs read the world matrices without
+    // rebuilding them (see TransformStore.h), so no model may be moved from here until the views have been drawn. Whether anything the portal last saw has
+    // moved must be checked before the update
+    gPortalRender.modelsSeenMoved = gPortalRender.modelsSeenMoved || gScene.AnyModelMoved(gPortalRender.modelsSeen);
+    gScene.UpdateWorldMatrices(gJobSystem);
+    UpdateSceneBounds();
+
+    // The portal view is only rendered if the portal is in the main view
+    float portalScreenSize = PortalScreenSize(camera);
+    bool renderViews[NumSceneViews] = { portalScreenSize > 0, true };
+
+    Camera* viewCameras[NumSceneViews] = { &portalCamera, &camera };
+    for (int view = 0; view < NumSceneViews; ++view)
+    {
+        if (renderViews[view])  CullSceneModels(*viewCameras[view], gViewCulling[view]);
+    }
+
+    int frameUploadStart = gFrameStats.bytesUploaded;
+
+    // Set up the light information in the constant buffer - this is the same for portal and main render, so it is sent
+    // to the GPU once and selected for use in the vertex shader (VS) and pixel shader (PS) by both
     gPerFrameConstants.light1Colour   = gLight1Colour * gLight1Strength;
-    gPerFrameConstants.light1Position = gLight1->Position();
+    gPerFrameConstants.light1Position = gScene.GetModel(gLight1).WorldPosition();
     gPerFrameConstants.light2Colour   = gLight2Colour * gLight2Strength;
     gPerFrameConstants.light2Strength = gLight2Strength;
-    gPerFrameConstants.light2Position = gLight2->Position();
+    gPerFrameConstants.light2Position = gScene.GetModel(gLight2).WorldPosition();
     gPerFrameConstants.ambientColour  = gAmbientColour;
     gPerFrameConstants.specularPower  = gSpecularPower;
-    gPerFrameConstants.cameraPosition = gCamera->Position();
-
-    // Send time-based variable to constant buffer for use in pixel shader
-    gPerModelConstants.textureShiftFactor = textureShiftFactor;
-
-    //-------------------------------------------------------------------------
-
-
-    //// Portal scene rendering ////
-
-    // Set the portal texture and portal depth buffer as the targets for rendering
-    gD3DContext->OMSetRenderTargets(1, &gPortalRenderTarget, gPortalDepthStencilView);
+    UpdateConstantBuffer(gPerFrameConstantBuffer, gPerFrameConstants);
 
-    // Clear the portal texture to a fixed colour and the portal depth buffer to the far distance
-    gD3DContext->ClearRenderTargetView(gPortalRenderTarget, &gBackgroundColor.r);
-    gD3DContext->ClearDepthStencilView(gPortalDepthStencilView, D3D11_CLEAR_DEPTH, 1.0f, 0);
+    // Camera settings for each view. Each view uses its own camera's position for specular lighting
+    for (int view = 0; view < NumSceneViews; ++view)
+    {
+        PerViewConstants& constants = gPerViewConstants[view].constants;
+        constants.viewMatrix           = viewCameras[view]->ViewMatrix();
+        constants.projectionMatrix     = viewCameras[view]->ProjectionMatrix();
+        constants.viewProjectionMatrix = viewCameras[view]->ViewProjectionMatrix();
+        constants.cameraPosition       = viewCameras[view]->Position();
+    }
 
-    // Setup the viewport for the portal texture size
-    D3D11_VIEWPORT vp;
-    vp.Width  = static_cast<FLOAT>(gPortalWidth);
-    vp.Height = static_cast<FLOAT>(gPortalHeight);
-    vp.MinDepth = 0.0f;
-    vp.MaxDepth = 1.0f;
-    vp.TopLeftX = 0;
-    vp.TopLeftY = 0;
-    gD3DContext->RSSetViewports(1, &vp);
+    // Send all the views' camera settings together, each render selects its own (see RenderSceneFromCamera). The
+    // padding after the last entry isn't needed
+    if (gRenderContext->SupportsConstantBufferRanges())
+    {
+        gRenderContext->UpdateBuffer(gPerViewConstantBuffer, gPerViewConstants, sizeof(gPerViewConstants) - sizeof(PerViewEntry::padding));
+    }
 
-    // Render the scene for the portal
-    RenderSceneFromCamera(gPortalCamera);
+    // Send time-based variable to constant buffer for use in pixel shader
+    gPerModelConstants.textureShiftFactor = textureShiftFactor;
 
+    gFrameStats.uploads.frame = gFrameStats.bytesUploaded - frameUploadStart;
 
     //-------------------------------------------------------------------------
 
 
-    //// Main scene rendering ////
+    //// Portal and main scene rendering ////
 
-    // Set the back buffer as the target for rendering and select the main depth buffer.
-    gD3DContext->OMSetRenderTargets(1, &gBackBufferRenderTarget, gDepthStencil);
+    // If the portal is on screen, size its render target for how large it is there, scaled by the dynamic resolution
+    // scale. If the pool can't give a target of the new size the old one is kept. Then see whether it needs rendering
+    // again, and if so put its render target's texture in the portal model's material in case it has changed
+    GpuRenderTarget* portalTarget = gScene.GetRenderTarget(gPortalRenderTarget);
+    if (renderViews[PortalView])
+    {
+        float sizeScale = std::min(1.0f, portalScreenSize / std::max(gPortalMaxWidth, gPortalMaxHeight)) * gPortalResolutionScale;
+        gScene.ResizeRenderTarget(gPortalRenderTarget, static_cast<int>(gPortalMaxWidth  * sizeScale + 0.5f),
+                                                       static_cast<int>(gPortalMaxHeight * sizeScale + 0.5f));
+        portalTarget = gScene.GetRenderTarget(gPortalRenderTarget);
 
-    // Clear the back buffer to a fixed colour and the depth buffer to the far distance
-    gD3DContext->ClearRenderTargetView(gBackBufferRenderTarget, &gBackgroundColor.r);
-    gD3DContext->ClearDepthStencilView(gDepthStencil, D3D11_CLEAR_DEPTH, 1.0f, 0);
+        gJobSystem->Wait(gViewCulling[PortalView].culled);
+        renderViews[PortalView] = PortalNeedsRender(portalCamera, portalTarget);
+    }
+    if (renderViews[PortalView])
+    {
+        GpuTexture* portalTexture = gRenderDevice->RenderTargetTexture(portalTarget);
+        for (auto& renderQueue : gRenderQueues)  renderQueue.SetMaterialTexture(gScene.ModelMaterial(gPortal), 0, portalTexture);
 
-    // Setup the viewport to the size of the main window
-    vp.Width  = static_cast<FLOAT>(gViewportWidth);
-    vp.Height = static_cast<FLOAT>(gViewportHeight);
-    vp.MinDepth = 0.0f;
-    vp.MaxDepth = 1.0f;
-    vp.TopLeftX = 0;
-    vp.TopLeftY = 0;
-    gD3DContext->RSSetViewports(1, &vp);
+        int width, height;
+        gRenderDevice->RenderTargetSize(portalTarget, width, height);
+        gFrameStats.portalRenderSize = std::max(width, height);
+    }
+    else
+    {
+        ++gFrameStats.portalRendersSkipped;
+    }
+
+    // The portal view is rendered to the portal render target, with its own depth buffer. The main view is rendered to
+    // the back buffer and main depth buffer. Each view sets and clears its target, the viewport is set to match
+    GpuRenderTarget* viewTargets[NumSceneViews] = { portalTarget, gRenderDevice->BackBuffer() };
+    CullingStats*    viewCulling[NumSceneViews] = { &gFrameStats.portalCameraCulling, &gFrameStats.mainCameraCulling };
+    float*       viewRecordTimes[NumSceneViews] = { &gFrameStats.recordTimes.portal, &gFrameStats.recordTimes.main };
+    int*             viewUploads[NumSceneViews] = { &gFrameStats.uploads.portal, &gFrameStats.uploads.main };
 
-    // Render the scene for the main window
-    RenderSceneFromCamera(gCamera);
+    if (gRecordViewsInParallel && gViewContexts[0] != nullptr)
+    {
+        // Record all the views at once, each on its own deferred context in a job
+        JobCounter recorded;
+        for (int view = 0; view < NumSceneViews; ++view)
+        {
+            if (!renderViews[view])  continue;
+            gJobSystem->Run([view, &viewCameras, &viewTargets, &viewCulling, &viewRecordTimes]()
+            {
+                RenderSceneFromCamera(*viewCameras[view], static_cast<SceneView>(view), viewTargets[view], *gViewContexts[view],
+                                      *viewCulling[view], *viewRecordTimes[view]);
+            }, &recorded);
+        }
+        gJobSystem->Wait(recorded);
+
+        // Then run the command lists in view order - the portal texture must be rendered before the main view uses it.
+        // The buffer writes recorded in each list happen as it runs
+        for (int view = 0; view < NumSceneViews; ++view)
+        {
+            int uploadStart = gFrameStats.bytesUploaded;
+            if (gViewCommandLists[view] != nullptr)  gRenderContext->ExecuteCommandList(gViewCommandLists[view]);
+            gViewCommandLists[view] = nullptr;
+            *viewUploads[view] = gFrameStats.bytesUploaded - uploadStart;
+        }
+    }
+    else
+    {
+        // Render the views one after the other
+        for (int view = 0; view < NumSceneViews; ++view)
+        {
+            if (!renderViews[view])  continue;
+            int uploadStart = gFrameStats.bytesUploaded;
+            RenderSceneFromCamera(*viewCameras[view], static_cast<SceneView>(view), viewTargets[view], *gRenderContext,
+                                  *viewCulling[view], *viewRecordTimes[view]);
+            *viewUploads[view] = gFrameStats.bytesUploaded - uploadStart;
+        }
+    }
 
 
     //-------------------------------------------------------------------------
@@ -557,8 +738,18 @@ void RenderScene()
     //// Scene completion ////
 
     // When drawing to the off-screen back buffer is complete, we "present" the image to the front buffer (the screen)
-    // Set first parameter to 1 to lock to vsync (typically 60fps)
-    gSwapChain->Present(lockFPS ? 1 : 0, 0);
+    // Pass true to lock to vsync (typically 60fps)
+    gRenderContext->Present(lockFPS);
+
+    // Free the pooled render targets that haven't been used for a while
+    gRenderTargetPool.EndFrame();
+    gFrameStats.renderTargetMemory     = static_cast<int>(gRenderTargetPool.MemoryInUse());
+    gFrameStats.renderTargetMemoryKept = static_cast<int>(gRenderTargetPool.MemoryUnused());
+    gFrameStats.textureMemory          = static_cast<int>(gTextureCache.ResidentBytes());
+    gFrameStats.textureCacheHits       = gTextureCache.Hits();
+    gFrameStats.textureCacheMisses     = gTextureCache.Misses();
+    gFrameStats.indexMemory            = gScene.IndexMemory();
+    gFrameStats.indexMemorySaved       = gScene.IndexMemorySaved();
 }
 
 
@@ -569,17 +760,23 @@ void RenderScene()
 // Update models and camera. frameTime is the time passed since the last frame
 void UpdateScene(float frameTime)
 {
+    // A new frame starts here, keep the counters from the last one for display
+    BeginFrameStats();
+
+    // Adjust the portal's resolution to keep the frame time within budget
+    UpdatePortalResolution(frameTime);
+
 	// Control sphere (will update its world matrix)
-	gSphere->Control(frameTime, Key_I, Key_K, Key_J, Key_L, Key_U, Key_O, Key_Period, Key_Comma );
+	gScene.GetModel(gSphere).Control(frameTime, Key_I, Key_K, Key_J, Key_L, Key_U, Key_O, Key_Period, Key_Comma );
 
-    // Orbit the light
+    // Orbit the light. It is attached to the cube in the scene file, so its position is relative to the cube
 	static float rotate = 0.0f;
-	gLight1->SetPosition( gCube->Position() + CVector3{ cos(rotate) * gLightOrbit, 0.0f, sin(rotate) * gLightOrbit } );
+	gScene.GetModel(gLight1).SetPosition( CVector3{ cos(rotate) * gLightOrbit, 0.0f, sin(rotate) * gLightOrbit } );
 	rotate -= gLightOrbitSpeed * frameTime;
 
 
 	// Control camera 
-	gCamera->Control(frameTime, Key_Up, Key_Down, Key_Left, Key_Right, Key_W, Key_S, Key_A, Key_D );
+	gScene.GetCamera(gCamera).Control(frameTime, Key_Up, Key_Down, Key_Left, Key_Right, Key_W, Key_S, Key_A, Key_D );
 
 
     // Toggle FPS limiting
@@ -605,6 +802,7 @@ void UpdateScene(float frameTime)
     float b = 0.5f + 0.5f * sinf(effectTime * 0.8f);
 
     gLight1Colour = { r, g, b }; // assign values to vector before sending to GPU
+    gScene.SetModelColour(gLight1, gLight1Colour);
 
     // Static light pulsate on/off
     float gLight2PulseFactor = 0.5f + 0.5f * sinf(effectTime * gLight2PulseSpeed);
@@ -618,8 +816,9 @@ void UpdateScene(float frameTime)
         frameTimeMs.precision(2);
         frameTimeMs << std::fixed << avgFrameTime * 1000;
         std::string windowTitle = "CO2409 Assignment / Kyriacos Rediu - Frame Time: " + frameTimeMs.str() +
-                                  "ms, FPS: " + std::to_string(static_cast<int>(1 / avgFrameTime + 0.5f));
-        SetWindowTextA(gHWnd, windowTitle.c_str());
+                                  "ms, FPS: " + std::to_string(static_cast<int>(1 / avgFrameTime + 0.5f)) +
+                                  " - " + FrameStatsSummary(gLastFrameStats);
+        SetWindowTitle(windowTitle);
         fpsFrameTime = 0;
         frameCount = 0;
     }
@@ -6,6 +6,21 @@
 #ifndef _SCENE_H_INCLUDED_
 #define _SCENE_H_INCLUDED_
 
+#include <string>
+
+class JobSystem;
+
+// The scene file loaded by InitGeometry, can be changed before calling it (e.g. by tools loading a test scene)
+extern std::string gSceneFileName;
+
+// Worker threads used by the scene update and rendering, created by InitScene. Tools can replace it between frames,
+// e.g. to compare different numbers of threads
+extern JobSystem* gJobSystem;
+
+// Whether InitGeometry loads the meshes and textures in the background, so the scene is shown with placeholders until
+// they arrive (see AssetLoader.h). Set to false before InitGeometry to load everything first
+extern bool gLoadAssetsInBackground;
+
 //--------------------------------------------------------------------------------------
 // Scene Geometry and Layout
 //--------------------------------------------------------------------------------------
@@ -18,6 +33,10 @@ bool InitGeometry();
 // Returns true on success
 bool InitScene();
 
+// Wait for the meshes and textures InitGeometry started loading in the background to finish, then use them in place of
+// their placeholders. Otherwise they are used as they arrive, over the first frames. Returns false if any failed to load
+bool FinishLoading();
+
 // Release the geometry resources created above
 void ReleaseResources();
 
@@ -28,6 +47,13 @@ void ReleaseResources();
 
 void RenderScene();
 
+// Whether RenderScene records the portal and main views at the same time, each on its own deferred context, when the
+// renderer supports them (see Renderer.h). Set to false to record them one after the other on gRenderContext
+extern bool gRecordViewsInParallel;
+
+// Frame time in seconds the scene aims for. The portal is rendered at a lower resolution while frames take longer
+extern float gFrameTimeBudget;
+
 // frameTime is the time passed since the last frame
 void UpdateScene(float frameTime);
 
@@ -0,0 +1,581 @@
+//--------------------------------------------------------------------------------------
+// Scene description files
+//--------------------------------------------------------------------------------------
+// See SceneFile.h for a description of the text and binary formats
+
+#include "SceneFile.h"
+#include "MeshCache.h" // For HashFileContent
+#include "MappedFile.h"
+#include "MathHelpers.h"
+
+#include <unordered_map>
+#include <initializer_list>
+#include <memory>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+
+
+namespace
+{
+    const char SCENE_FILE_MAGIC[4] = { 'S', 'C', 'N', 'B' };
+
+    //--------------------------------------------------------------------------------------
+    // Text parsing helpers
+    //--------------------------------------------------------------------------------------
+
+    // Object names seen so far for each type of object, mapping to their index. Used to look up references while parsing
+    struct SceneNames
+    {
+        std::unordered_map<std::string, uint32_t> meshes, textures, renderTargets, vertexShaders, pixelShaders, materials, models, cameras;
+    };
+
+    // Add a null-terminated string to the scene's string data, returns its offset
+    uint32_t AddString(SceneDescription& scene, const char* text)
+    {
+        uint32_t offset = static_cast<uint32_t>(scene.strings.size());
+        scene.strings.insert(scene.strings.end(), text, text + std::strlen(text) + 1);
+        return offset;
+    }
+
+    // Read a number, returns false if the whole of the text isn't a number
+    bool ParseFloat(const char* text, float& value)
+    {
+        char* end;
+        value = std::strtof(text, &end);
+        return end != text && *end == '\0';
+    }
+
+    bool ParseUInt(const char* text, uint32_t& value)
+    {
+        char* end;
+        unsigned long number = std::strtoul(text, &end, 10);
+        value = static_cast<uint32_t>(number);
+        return end != text && *end == '\0' && text[0] != '-';
+    }
+
+    // Read a vector written as x,y,z. If allowSingle is set a single number can be given for all three
+    bool ParseVector(const char* text, float values[3], bool allowSingle = false)
+    {
+        char* end;
+        for (int i = 0; i < 3; ++i)
+        {
+            values[i] = std::strtof(text, &end);
+            if (end == text)  return false;
+            if (i == 0 && *end == '\0' && allowSingle)
+            {
+                values[1] = values[2] = values[0];
+                return true;
+            }
+            if (i < 2 && *end != ',')  return false;
+            text = end + 1;
+        }
+        return *end == '\0';
+    }
+
+    // Returns the position of the given text in a list of names, or -1 if it isn't in the list
+    int FindName(const char* text, std::initializer_list<const char*> names)
+    {
+        int index = 0;
+        for (const char* name : names)
+        {
+            if (std::strcmp(text, name) == 0)  return index;
+            ++index;
+        }
+        return -1;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Text scene files
+//--------------------------------------------------------------------------------------
+
+// Read scene text (the content of a text scene file). The file name is only used in error messages
+bool ParseSceneText(const char* text, size_t size, const std::string& fileName, SceneDescription& scene)
+{
+    scene = SceneDescription();
+    SceneNames names;
+
+    std::string line;
+    std::vector<char*> tokens;
+    const char* textEnd = text + size;
+    int lineNumber = 0;
+    while (text < textEnd)
+    {
+        // Copy out the next line, without any comment, so its tokens can be null-terminated in place
+        const char* lineEnd = static_cast<const char*>(std::memchr(text, '\n', textEnd - text));
+        if (lineEnd == nullptr)  lineEnd = textEnd;
+        const char* comment = static_cast<const char*>(std::memchr(text, '#', lineEnd - text));
+        line.assign(text, comment != nullptr ? comment : lineEnd);
+        text = lineEnd + 1;
+        ++lineNumber;
+
+        tokens.clear();
+        for (char* c = &line[0]; *c != '\0'; )
+        {
+            while (*c == ' ' || *c == '\t' || *c == '\r')  *c++ = '\0';
+            if (*c == '\0')  break;
+            tokens.push_back(c);
+            while (*c != '\0' && *c != ' ' && *c != '\t' && *c != '\r')  ++c;
+        }
+        if (tokens.empty())  continue;
+
+        auto error = [&](const std::string& message)
+        {
+            gLastError = fileName + "(" + std::to_string(lineNumber) + "): " + message;
+            return false;
+        };
+        if (tokens.size() < 2)  return error("Missing name after " + std::string(tokens[0]));
+
+        const char* type = tokens[0];
+        const char* name = tokens[1];
+
+        // Settings for this line, checked off as they are used so any left over can be reported
+        std::vector<std::pair<const char*, const char*>> settings;
+        for (size_t i = 2; i < tokens.size(); ++i)
+        {
+            char* equals = std::strchr(tokens[i], '=');
+            if (equals == nullptr)  return error("Expected key=value, found " + std::string(tokens[i]));
+            *equals = '\0';
+            settings.push_back({ tokens[i], equals + 1 });
+        }
+        std::vector<bool> used(settings.size(), false);
+
+        // Returns the value of a setting, or nullptr if it isn't given
+        auto setting = [&](const char* key) -> const char*
+        {
+            for (size_t i = 0; i < settings.size(); ++i)
+            {
+                if (std::strcmp(settings[i].first, key) == 0)
+                {
+                    used[i] = true;
+                    return settings[i].second;
+                }
+            }
+            return nullptr;
+        };
+
+        // Find the index of a named object of the given type, fails if it is required and not given or not declared yet
+        std::string refError;
+        auto reference = [&](const std::unordered_map<std::string, uint32_t>& table, const char* key, bool required,
+                             uint32_t& index)
+        {
+            index = SCENE_NO_INDEX;
+            const char* value = setting(key);
+            if (value == nullptr)
+            {
+                if (required)  refError = std::string("Missing ") + key;
+                return !required;
+            }
+            auto found = table.find(value);
+            if (found == table.end())
+            {
+                refError = std::string("Unknown ") + key + " " + value;
+                return false;
+            }
+            index = found->second;
+            return true;
+        };
+
+        // Name must be unique among objects of the same type
+        auto addName = [&](std::unordered_map<std::string, uint32_t>& table, size_t index)
+        {
+            return table.emplace(name, static_cast<uint32_t>(index)).second;
+        };
+
+        if (std::strcmp(type, "mesh") == 0)
+        {
+            SceneMeshRecord mesh = {};
+            const char* file     = setting("file");
+            const char* tangents = setting("tangents");
+            const char* quantize = setting("quantize");
+            const char* clusters = setting("clusters");
+            if (file == nullptr)  return error("Missing file");
+            if (tangents != nullptr && !ParseUInt(tangents, mesh.requireTangents))  return error("Invalid tangents");
+            if (quantize != nullptr && !ParseUInt(quantize, mesh.quantize))  return error("Invalid quantize");
+            if (clusters != nullptr && !ParseUInt(clusters, mesh.splitClusters))  return error("Invalid clusters");
+            if (!addName(names.meshes, scene.meshes.size()))  return error("Duplicate mesh " + std::string(name));
+            mesh.name = AddString(scene, name);
+            mesh.file = AddString(scene, file);
+            mesh.requireTangents = (mesh.requireTangents != 0) ? 1 : 0;
+            mesh.quantize        = (mesh.quantize != 0) ? 1 : 0;
+            mesh.splitClusters   = (mesh.splitClusters != 0) ? 1 : 0;
+            scene.meshes.push_back(mesh);
+        }
+        else if (std::strcmp(type, "texture") == 0)
+        {
+            const char* file = setting("file");
+            if (file == nullptr)  return error("Missing file");
+            if (!addName(names.textures, scene.textures.size()))  return error("Duplicate texture " + std::string(name));
+            scene.textures.push_back({ AddString(scene, name), AddString(scene, file) });
+        }
+        else if (std::strcmp(type, "rendertarget") == 0)
+        {
+            SceneRenderTargetRecord renderTarget = {};
+            const char* width  = setting("width");
+            const char* height = setting("height");
+            if (width  == nullptr || !ParseUInt(width,  renderTarget.width)  || renderTarget.width  == 0)  return error("Missing or invalid width");
+            if (height == nullptr || !ParseUInt(height, renderTarget.height) || renderTarget.height == 0)  return error("Missing or invalid height");
+            if (!addName(names.renderTargets, scene.renderTargets.size()))  return error("Duplicate render target " + std::string(name));
+            renderTarget.name = AddString(scene, name);
+            scene.renderTargets.push_back(renderTarget);
+        }
+        else if (std::strcmp(type, "vertexshader") == 0 || std::strcmp(type, "pixelshader") == 0)
+        {
+            // Vertex and pixel shaders share a table but not names, so a vertex and pixel shader pair can have the same name
+            const char* file = setting("file");
+            if (file == nullptr)  return error("Missing file");
+            SceneShaderType shaderType = (type[0] == 'v') ? SceneShaderType::Vertex : SceneShaderType::Pixel;
+            auto& shaderNames = (shaderType == SceneShaderType::Vertex) ? names.vertexShaders : names.pixelShaders;
+            if (!addName(shaderNames, scene.shaders.size()))  return error("Duplicate " + std::string(type) + " " + name);
+            scene.shaders.push_back({ AddString(scene, name), AddString(scene, file), shaderType });
+        }
+        else if (std::strcmp(type, "material") == 0)
+        {
+            SceneMaterialRecord material = {};
+            if (!reference(names.vertexShaders, "vs",  true,  material.vertexShader)          ||
+                !reference(names.vertexShaders, "ivs", false, material.instancedVertexShader) ||
+                !reference(names.pixelShaders,  "ps",  true,  material.pixelShader))
+            {
+                return error(refError);
+            }
+
+            // Textures can be loaded textures or render targets, which are numbered after the textures. Render targets
+            // are renumbered once all textures are known (below)
+            for (int slot = 0; slot < MAX_MATERIAL_TEXTURES; ++slot)
+            {
+                material.textures[slot] = SCENE_NO_INDEX;
+                std::string key = "texture" + std::to_string(slot);
+                const char* value = setting(key.c_str());
+                if (value == nullptr)  continue;
+
+                auto texture = names.textures.find(value);
+                auto renderTarget = names.renderTargets.find(value);
+                if      (texture      != names.textures.end())       material.textures[slot] = texture->second;
+                else if (renderTarget != names.renderTargets.end())  material.textures[slot] = 0x80000000 | renderTarget->second;
+                else  return error("Unknown " + key + " " + value);
+            }
+
+            const char* sampler = setting("sampler");
+            const char* blend   = setting("blend");
+            const char* depth   = setting("depth");
+            const char* cull    = setting("cull");
+            int samplerMode = sampler ? FindName(sampler, { "point", "trilinear", "anisotropic4x" })              : static_cast<int>(SamplerMode::Anisotropic4x);
+            int blendMode   = blend   ? FindName(blend,   { "none", "additive", "multiplicative", "alpha" })      : static_cast<int>(BlendMode::None);
+            int depthMode   = depth   ? FindName(depth,   { "readwrite", "readonly", "disabled" })                : static_cast<int>(DepthMode::ReadWrite);
+            int cullMode    = cull    ? FindName(cull,    { "back", "front", "none" })                            : static_cast<int>(CullMode::Back);
+            if (samplerMode < 0)  return error("Unknown sampler " + std::string(sampler));
+            if (blendMode   < 0)  return error("Unknown blend " + std::string(blend));
+            if (depthMode   < 0)  return error("Unknown depth " + std::string(depth));
+            if (cullMode    < 0)  return error("Unknown cull " + std::string(cull));
+            material.sampler   = static_cast<uint8_t>(samplerMode);
+            material.blendMode = static_cast<uint8_t>(blendMode);
+            material.depthMode = static_cast<uint8_t>(depthMode);
+            material.cullMode  = static_cast<uint8_t>(cullMode);
+
+            if (!addName(names.materials, scene.materials.size()))  return error("Duplicate material " + std::string(name));
+            material.name = AddString(scene, name);
+            scene.materials.push_back(material);
+        }
+        else if (std::strcmp(type, "model") == 0)
+        {
+            SceneModelRecord model = {};
+            if (!reference(names.meshes,    "mesh",     true,  model.mesh)     ||
+                !reference(names.materials, "material", true,  model.material) ||
+                !reference(names.models,    "parent",   false, model.parent))
+            {
+                return error(refError);
+            }
+
+            const char* position = setting("position");
+            const char* rotation = setting("rotation");
+            const char* scale    = setting("scale");
+            const char* colour   = setting("colour");
+            const char* isStatic = setting("static");
+            for (int i = 0; i < 3; ++i)  model.scale[i] = model.colour[i] = 1.0f;
+            if (position && !ParseVector(position, model.position))     return error("Invalid position");
+            if (rotation && !ParseVector(rotation, model.rotation))     return error("Invalid rotation");
+            if (scale    && !ParseVector(scale,    model.scale, true))  return error("Invalid scale");
+            if (colour   && !ParseVector(colour,   model.colour))       return error("Invalid colour");
+            if (isStatic && !ParseUInt(isStatic,   model.isStatic))     return error("Invalid static");
+            model.isStatic = (model.isStatic != 0) ? 1 : 0;
+            for (float& angle : model.rotation)  angle = ToRadians(angle);
+
+            if (!addName(names.models, scene.models.size()))  return error("Duplicate model " + std::string(name));
+            model.name = AddString(scene, name);
+            scene.models.push_back(model);
+        }
+        else if (std::strcmp(type, "camera") == 0)
+        {
+            SceneCameraRecord camera = {};
+            camera.fov      = 60.0f;
+            camera.nearClip = 0.1f;
+            camera.farClip  = 10000.0f;
+
+            const char* position = setting("position");
+            const char* rotation = setting("rotation");
+            const char* fov      = setting("fov");
+            const char* nearClip = setting("near");
+            const char* farClip  = setting("far");
+            if (position && !ParseVector(position, camera.position))  return error("Invalid position");
+            if (rotation && !ParseVector(rotation, camera.rotation))  return error("Invalid rotation");
+            if (fov      && !ParseFloat(fov,      camera.fov))        return error("Invalid fov");
+            if (nearClip && !ParseFloat(nearClip, camera.nearClip))   return error("Invalid near");
+            if (farClip  && !ParseFloat(farClip,  camera.farClip))    return error("Invalid far");
+            if (camera.nearClip <= 0 || camera.farClip <= camera.nearClip)  return error("Clip distances must be 0 < near < far");
+            for (float& angle : camera.rotation)  angle = ToRadians(angle);
+            camera.fov = ToRadians(camera.fov);
+
+            if (!addName(names.cameras, scene.cameras.size()))  return error("Duplicate camera " + std::string(name));
+            camera.name = AddString(scene, name);
+            scene.cameras.push_back(camera);
+        }
+        else
+        {
+            return error("Unknown object type " + std::string(type));
+        }
+
+        for (size_t i = 0; i < settings.size(); ++i)
+        {
+            if (!used[i])  return error("Unknown setting " + std::string(settings[i].first) + " for " + type);
+        }
+    }
+
+    // Render targets used as material textures are numbered after the textures
+    uint32_t numTextures = static_cast<uint32_t>(scene.textures.size());
+    for (auto& material : scene.materials)
+    {
+        for (auto& texture : material.textures)
+        {
+            if (texture != SCENE_NO_INDEX && (texture & 0x80000000))  texture = numTextures + (texture & 0x7fffffff);
+        }
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Binary scene files
+//--------------------------------------------------------------------------------------
+
+// Returns the name of the binary file a text scene file is compiled to
+std::string SceneBinaryFileName(const std::string& textFileName)
+{
+    return textFileName + ".bin";
+}
+
+
+// Write a binary scene file. Pass the hash of the text it was compiled from, or 0 if there isn't one
+bool SaveSceneBinary(const std::string& fileName, uint64_t sourceHash, const SceneDescription& scene)
+{
+    SceneFileHeader header = {};
+    std::memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC));
+    header.version          = SCENE_FILE_VERSION;
+    header.sourceHash       = sourceHash;
+    header.numMeshes        = static_cast<uint32_t>(scene.meshes.size());
+    header.numTextures      = static_cast<uint32_t>(scene.textures.size());
+    header.numRenderTargets = static_cast<uint32_t>(scene.renderTargets.size());
+    header.numShaders       = static_cast<uint32_t>(scene.shaders.size());
+    header.numMaterials     = static_cast<uint32_t>(scene.materials.size());
+    header.numModels        = static_cast<uint32_t>(scene.models.size());
+    header.numCameras       = static_cast<uint32_t>(scene.cameras.size());
+    header.stringsSize      = static_cast<uint32_t>(scene.strings.size());
+
+    std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        gLastError = "Cannot write scene file " + fileName;
+        return false;
+    }
+
+    // Each table is written as it is stored in memory
+    auto write = [&](const auto& table)
+    {
+        file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(table[0]));
+    };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write(scene.meshes);
+    write(scene.textures);
+    write(scene.renderTargets);
+    write(scene.shaders);
+    write(scene.materials);
+    write(scene.models);
+    write(scene.cameras);
+    write(scene.strings);
+    file.close();
+
+    if (file.fail())
+    {
+        std::remove(fileName.c_str()); // Don't leave a partial file behind
+        gLastError = "Error writing scene file " + fileName;
+        return false;
+    }
+    return true;
+}
+
+
+// Read binary scene file content. Fails if the source hash in the file doesn't match the given one, unless checkHash is false
+bool ReadSceneBinary(const unsigned char* data, size_t size, uint64_t sourceHash, bool checkHash, SceneDescription& scene)
+{
+    // Check the header
+    if (size < sizeof(SceneFileHeader))  { gLastError = "Scene file too small";  return false; }
+    SceneFileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC)) != 0 || header.version != SCENE_FILE_VERSION)
+    {
+        gLastError = "Not a scene file or from a different version";
+        return false;
+    }
+    if (checkHash && header.sourceHash != sourceHash)
+    {
+        gLastError = "Scene file is out of date";
+        return false;
+    }
+
+    // Check all the tables are inside the file, in case it was truncated
+    uint64_t expectedSize = sizeof(SceneFileHeader) +
+                            uint64_t(header.numMeshes)        * sizeof(SceneMeshRecord)         +
+                            uint64_t(header.numTextures)      * sizeof(SceneTextureRecord)      +
+                            uint64_t(header.numRenderTargets) * sizeof(SceneRenderTargetRecord) +
+                            uint64_t(header.numShaders)       * sizeof(SceneShaderRecord)       +
+                            uint64_t(header.numMaterials)     * sizeof(SceneMaterialRecord)     +
+                            uint64_t(header.numModels)        * sizeof(SceneModelRecord)        +
+                            uint64_t(header.numCameras)       * sizeof(SceneCameraRecord)       +
+                            header.stringsSize;
+    if (expectedSize != size)  { gLastError = "Scene file is the wrong size";  return false; }
+
+    // Copy each table out of the file. The records are plain data so this is a single copy per table
+    const unsigned char* position = data + sizeof(SceneFileHeader);
+    auto read = [&](auto& table, uint32_t count)
+    {
+        table.resize(count);
+        std::memcpy(table.data(), position, count * sizeof(table[0]));
+        position += count * sizeof(table[0]);
+    };
+    read(scene.meshes,        header.numMeshes);
+    read(scene.textures,      header.numTextures);
+    read(scene.renderTargets, header.numRenderTargets);
+    read(scene.shaders,       header.numShaders);
+    read(scene.materials,     header.numMaterials);
+    read(scene.models,        header.numModels);
+    read(scene.cameras,       header.numCameras);
+    read(scene.strings,       header.stringsSize);
+
+    // Check every reference is in range so a damaged file can't make the scene read outside its arrays
+    auto validString = [&](uint32_t offset)  { return offset < header.stringsSize; };
+    auto validIndex  = [](uint32_t index, uint32_t count, bool optional)  { return index < count || (optional && index == SCENE_NO_INDEX); };
+    bool valid = header.stringsSize > 0 && scene.strings.back() == '\0';
+    for (auto& mesh : scene.meshes)  valid = valid && validString(mesh.name) && validString(mesh.file);
+    for (auto& texture : scene.textures)  valid = valid && validString(texture.name) && validString(texture.file);
+    for (auto& renderTarget : scene.renderTargets)  valid = valid && validString(renderTarget.name) && renderTarget.width > 0 && renderTarget.height > 0;
+    for (auto& shader : scene.shaders)
+    {
+        valid = valid && validString(shader.name) && validString(shader.file) &&
+                (shader.type == SceneShaderType::Vertex || shader.type == SceneShaderType::Pixel);
+    }
+    for (auto& material : scene.materials)
+    {
+        valid = valid && validString(material.name) &&
+                validIndex(material.vertexShader, header.numShaders, false) &&
+                validIndex(material.instancedVertexShader, header.numShaders, true) &&
+                validIndex(material.pixelShader, header.numShaders, false) &&
+                scene.shaders[material.vertexShader].type == SceneShaderType::Vertex &&
+                scene.shaders[material.pixelShader].type  == SceneShaderType::Pixel  &&
+                (material.instancedVertexShader == SCENE_NO_INDEX ||
+                 scene.shaders[material.instancedVertexShader].type == SceneShaderType::Vertex) &&
+                material.sampler <= static_cast<uint8_t>(SamplerMode::Anisotropic4x) &&
+                material.blendMode <= static_cast<uint8_t>(BlendMode::Alpha) &&
+                material.depthMode <= static_cast<uint8_t>(DepthMode::Disabled) &&
+                material.cullMode  <= static_cast<uint8_t>(CullMode::None);
+        for (auto texture : material.textures)  valid = valid && validIndex(texture, header.numTextures + header.numRenderTargets, true);
+    }
+    for (uint32_t i = 0; i < header.numModels; ++i)
+    {
+        auto& model = scene.models[i];
+        valid = valid && validString(model.name) && validIndex(model.mesh, header.numMeshes, false) &&
+                validIndex(model.material, header.numMaterials, false) && validIndex(model.parent, i, true);
+    }
+    for (auto& camera : scene.cameras)  valid = valid && validString(camera.name);
+    if (!valid)
+    {
+        gLastError = "Scene file contains invalid data";
+        return false;
+    }
+
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Loading
+//--------------------------------------------------------------------------------------
+
+// Load a text or binary scene file. A text file is loaded from its binary file if that is up to date, otherwise the
+// text is read and compiled to a new binary file for next time. Optionally returns whether a binary file was read
+bool LoadSceneFile(const std::string& fileName, SceneDescription& scene, bool* loadedFromBinary /*= nullptr*/)
+{
+    std::unique_ptr<MappedFile> file;
+    try
+    {
+        file = std::make_unique<MappedFile>(fileName);
+    }
+    catch (const std::runtime_error&)
+    {
+        gLastError = "Cannot open scene file " + fileName;
+        return false;
+    }
+
+    // A binary file given directly is loaded whatever text it came from
+    if (file->Size() >= sizeof(SCENE_FILE_MAGIC) && std::memcmp(file->Data(), SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC)) == 0)
+    {
+        if (loadedFromBinary)  *loadedFromBinary = true;
+        if (!ReadSceneBinary(file->Data(), file->Size(), 0, false, scene))
+        {
+            gLastError = fileName + ": " + gLastError;
+            return false;
+        }
+        return true;
+    }
+
+    // Use the compiled file if it was made from this text
+    uint64_t sourceHash;
+    try
+    {
+        sourceHash = HashFileContent(fileName);
+    }
+    catch (const std::runtime_error& e)
+    {
+        gLastError = e.what();
+        return false;
+    }
+
+    std::string binaryFileName = SceneBinaryFileName(fileName);
+    try
+    {
+        MappedFile binaryFile(binaryFileName);
+        if (ReadSceneBinary(binaryFile.Data(), binaryFile.Size(), sourceHash, true, scene))
+        {
+            if (loadedFromBinary)  *loadedFromBinary = true;
+            return true;
+        }
+    }
+    catch (const std::runtime_error&)
+    {
+        // No binary file yet
+    }
+
+    const char* text = reinterpret_cast<const char*>(file->Data());
+    if (!ParseSceneText(text, file->Size(), fileName, scene))  return false;
+
+    std::string lastError = gLastError;
+    if (!SaveSceneBinary(binaryFileName, sourceHash, scene))
+    {
+        gLastError = lastError; // Failing to write the binary file is not an error, the text will be read again next time
+    }
+    if (loadedFromBinary)  *loadedFromBinary = false;
+    return true;
+}
@@ -0,0 +1,195 @@
+//--------------------------------------------------------------------------------------
+// Scene description files
+//--------------------------------------------------------------------------------------
+// The meshes, textures, render targets, shaders, materials, models and cameras in a scene are declared in a file
+// rather than in code, so objects can be added or moved without recompiling. The objects are created from the
+// description by SceneObjects (see SceneObjects.h).
+//
+// Scenes are written as text, one object per line. Each line is the type of object, its name, then its settings
+// as key=value pairs. Settings not given take the defaults shown below. Vectors are written x,y,z without spaces and
+// angles are in degrees. Objects can only refer to objects declared above them, by name. # starts a comment.
+//
+//   mesh         <name> file=<mesh file> [tangents=0|1] [quantize=0|1]      - quantized meshes need a matching vertex shader
+//                       [clusters=0|1]                                      - split large meshes for 16-bit indices
+//   texture      <name> file=<texture file>
+//   rendertarget <name> width=<pixels> height=<pixels>                      - can be used as a texture by materials
+//   vertexshader <name> file=<shader name without .cso>
+//   pixelshader  <name> file=<shader name without .cso>
+//   material     <name> vs=<vertex shader> ps=<pixel shader> [ivs=<instanced vertex shader>]
+//                       [texture0=<texture or render target>] [texture1=...]
+//                       [sampler=anisotropic4x|trilinear|point] [blend=none|additive|multiplicative|alpha]
+//                       [depth=readwrite|readonly|disabled] [cull=back|front|none]
+//   model        <name> mesh=<mesh> material=<material> [position=0,0,0] [rotation=0,0,0] [scale=1 or x,y,z]
+//                       [colour=1,1,1] [parent=<model>] [static=0|1]       - position etc. are relative to the parent
+//   camera       <name> [position=0,0,0] [rotation=0,0,0] [fov=60] [near=0.1] [far=10000]
+//
+// Reading text is slow for large scenes, so the first time a text file is loaded it is compiled to a binary file
+// next to it (e.g. Scene.scene.bin) and later loads read that instead while the text is unchanged, the same way as
+// the mesh cache (see MeshCache.h). The binary file is the records below written one table after another, so
+// loading it is little more than a copy:
+//   SceneFileHeader
+//   SceneMeshRecord[numMeshes], SceneTextureRecord[numTextures], ... in the order of the counts in the header
+//   string data (stringsSize bytes) - the null-terminated names, records refer to them by offset
+// A binary file can also be loaded directly, e.g. to ship a scene without its text.
+
+#ifndef _SCENE_FILE_H_INCLUDED_
+#define _SCENE_FILE_H_INCLUDED_
+
+#include "RenderQueue.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Scene records
+//--------------------------------------------------------------------------------------
+// Names and file names are offsets into the string data. Other objects are referred to by their index in their table
+
+// Value used for an index that refers to nothing, e.g. an unused material texture slot
+const uint32_t SCENE_NO_INDEX = 0xffffffff;
+
+struct SceneMeshRecord
+{
+    uint32_t name;
+    uint32_t file;
+    uint32_t requireTangents; // 1 to calculate tangents when importing
+    uint32_t quantize;        // 1 to store the vertices in fewer bytes (see MeshQuantization.h)
+    uint32_t splitClusters;   // 1 to split parts too large for 16-bit indices into clusters (see MeshClusters.h)
+};
+
+struct SceneTextureRecord
+{
+    uint32_t name;
+    uint32_t file;
+};
+
+struct SceneRenderTargetRecord
+{
+    uint32_t name;
+    uint32_t width;
+    uint32_t height;
+};
+
+enum class SceneShaderType : uint32_t
+{
+    Vertex,
+    Pixel,
+};
+
+struct SceneShaderRecord
+{
+    uint32_t        name;
+    uint32_t        file;
+    SceneShaderType type;
+};
+
+struct SceneMaterialRecord
+{
+    uint32_t name;
+    uint32_t vertexShader;          // Index into the shaders
+    uint32_t instancedVertexShader; // Index into the shaders, SCENE_NO_INDEX for none
+    uint32_t pixelShader;
+
+    // Index into the textures, or the number of textures plus an index into the render targets to use a render
+    // target's texture. SCENE_NO_INDEX for slots not used
+    uint32_t textures[MAX_MATERIAL_TEXTURES];
+
+    // States, stored as the values of the enums in Renderer.h
+    uint8_t  sampler;
+    uint8_t  blendMode;
+    uint8_t  depthMode;
+    uint8_t  cullMode;
+};
+
+struct SceneModelRecord
+{
+    uint32_t name;
+    uint32_t mesh;
+    uint32_t material;
+    uint32_t parent;      // Index into the models, always lower than this model's. SCENE_NO_INDEX for none
+    uint32_t isStatic;    // 1 if the model rarely moves, it is then culled using the scene's BVH (see SceneObjects.h)
+    float    position[3];
+    float    rotation[3]; // In radians
+    float    scale[3];
+    float    colour[3];   // Object colour passed to the shaders, e.g. to tint lights
+};
+
+struct SceneCameraRecord
+{
+    uint32_t name;
+    float    position[3];
+    float    rotation[3]; // In radians
+    float    fov;         // Horizontal field of view in radians
+    float    nearClip;
+    float    farClip;
+};
+
+
+// Everything declared in a scene file
+struct SceneDescription
+{
+    std::vector<SceneMeshRecord>         meshes;
+    std::vector<SceneTextureRecord>      textures;
+    std::vector<SceneRenderTargetRecord> renderTargets;
+    std::vector<SceneShaderRecord>       shaders;
+    std::vector<SceneMaterialRecord>     materials;
+    std::vector<SceneModelRecord>        models;
+    std::vector<SceneCameraRecord>       cameras;
+
+    std::vector<char> strings; // Null-terminated names, the records hold offsets into this
+
+    // Returns the name or file name at the given offset in the string data
+    const char* String(uint32_t offset) const  { return strings.data() + offset; }
+};
+
+
+//--------------------------------------------------------------------------------------
+// Binary scene file
+//--------------------------------------------------------------------------------------
+
+// Increase this whenever the records or file layout change so older binary files are rebuilt
+const uint32_t SCENE_FILE_VERSION = 5;
+
+struct SceneFileHeader
+{
+    char     magic[4];         // Always "SCNB"
+    uint32_t version;          // SCENE_FILE_VERSION when written
+    uint64_t sourceHash;       // Hash of the content of the text file compiled, see HashFileContent in MeshCache.h
+
+    uint32_t numMeshes;
+    uint32_t numTextures;
+    uint32_t numRenderTargets;
+    uint32_t numShaders;
+    uint32_t numMaterials;
+    uint32_t numModels;
+    uint32_t numCameras;
+    uint32_t stringsSize;
+};
+static_assert(sizeof(SceneFileHeader) == 48, "Scene file header layout must not change without changing SCENE_FILE_VERSION");
+
+
+//--------------------------------------------------------------------------------------
+// Scene file loading
+//--------------------------------------------------------------------------------------
+// These functions return false on failure and set gLastError to the reason (see Common.h)
+
+// Load a text or binary scene file. A text file is loaded from its binary file if that is up to date, otherwise the
+// text is read and compiled to a new binary file for next time. Optionally returns whether a binary file was read
+bool LoadSceneFile(const std::string& fileName, SceneDescription& scene, bool* loadedFromBinary = nullptr);
+
+// Read scene text (the content of a text scene file). The file name is only used in error messages
+bool ParseSceneText(const char* text, size_t size, const std::string& fileName, SceneDescription& scene);
+
+// Returns the name of the binary file a text scene file is compiled to
+std::string SceneBinaryFileName(const std::string& textFileName);
+
+// Write a binary scene file. Pass the hash of the text it was compiled from, or 0 if there isn't one
+bool SaveSceneBinary(const std::string& fileName, uint64_t sourceHash, const SceneDescription& scene);
+
+// Read binary scene file content. Fails if the source hash in the file doesn't match the given one, unless checkHash is false
+bool ReadSceneBinary(const unsigned char* data, size_t size, uint64_t sourceHash, bool checkHash, SceneDescription& scene);
+
+
+#endif //_SCENE_FILE_H_INCLUDED_
@@ -0,0 +1,481 @@
+//--------------------------------------------------------------------------------------
+// Scene objects created from a scene description
+//--------------------------------------------------------------------------------------
+
+#include "SceneObjects.h"
+#include "JobSystem.h"
+#include "FrameStats.h"
+#include "RenderTargetPool.h"
+#include "TextureCache.h"
+#include "MeshQuantization.h"
+#include "Common.h"
+
+#include <stdexcept>
+
+
+namespace
+{
+    // Index into mPlaceholderMeshes of the placeholder with the same vertex layout as the given mesh
+    int PlaceholderMeshIndex(const SceneMeshRecord& mesh)
+    {
+        return (mesh.requireTangents ? 1 : 0) + (mesh.quantize ? 2 : 0);
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Creation / destruction
+//--------------------------------------------------------------------------------------
+
+// Create everything in the given scene description, adding its materials to the given render queue. Returns false
+// on failure and sets gLastError, anything created so far is left for Release to free
+bool SceneObjects::Create(const SceneDescription& scene, RenderQueue& renderQueue, bool loadInBackground /*= false*/)
+{
+    // When loading in the background, request every mesh and texture first so the loading threads start on them while
+    // the rest is created
+    if (loadInBackground)
+    {
+        try
+        {
+            mLoader = std::make_unique<AssetLoader>();
+        }
+        catch (const std::runtime_error& e)
+        {
+            gLastError = e.what();
+            return false;
+        }
+        for (auto& mesh : scene.meshes)
+        {
+            mLoader->LoadMesh(scene.String(mesh.file), mesh.requireTangents != 0, mesh.quantize != 0, mesh.splitClusters != 0);
+        }
+        for (auto& texture : scene.textures)  mLoader->LoadTexture(scene.String(texture.file));
+    }
+
+    // Load mesh geometry data, or create the placeholders used until it is loaded
+    try
+    {
+        mMeshes.resize(scene.meshes.size());
+        for (size_t i = 0; i < scene.meshes.size(); ++i)
+        {
+            bool requireTangents = (scene.meshes[i].requireTangents != 0);
+            bool quantize        = (scene.meshes[i].quantize != 0);
+            bool splitClusters   = (scene.meshes[i].splitClusters != 0);
+            if (loadInBackground)
+            {
+                std::unique_ptr<Mesh>& placeholder = mPlaceholderMeshes[PlaceholderMeshIndex(scene.meshes[i])];
+                if (!placeholder)
+                {
+                    MeshData placeholderData = PlaceholderMeshData(requireTangents);
+                    if (quantize)  placeholderData = QuantizeMeshData(placeholderData);
+                    placeholder = std::make_unique<Mesh>(placeholderData, "placeholder");
+                    renderQueue.AddMesh(placeholder.get());
+                }
+                continue;
+            }
+
+            mMeshes[i] = std::make_unique<Mesh>(scene.String(scene.meshes[i].file), requireTangents, quantize, splitClusters);
+
+            // Number the mesh in the queue now, so draws can be submitted to it from several threads (see RenderQueue::SubmitAt)
+            renderQueue.AddMesh(mMeshes[i].get());
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        gLastError = e.what();
+        return false;
+    }
+
+    // Textures and render targets. Materials number render targets after the textures, so their textures are added to
+    // the same array
+    for (auto& texture : scene.textures)
+    {
+        mTextures.push_back(loadInBackground ? CreatePlaceholderTexture() : gTextureCache.Acquire(scene.String(texture.file)));
+        mTexturePlaceholders.push_back(loadInBackground);
+        ++mNumLoadedTextures;
+        if (mTextures.back() == nullptr)
+        {
+            if (loadInBackground)  gLastError = "Error creating placeholder texture";
+            return false;
+        }
+    }
+    for (auto& renderTarget : scene.renderTargets)
+    {
+        mRenderTargets.push_back(gRenderTargetPool.Acquire(renderTarget.width, renderTarget.height));
+        mRenderTargetNames.push_back(scene.String(renderTarget.name));
+        if (mRenderTargets.back() == nullptr)
+        {
+            gLastError = std::string("Error creating render target ") + scene.String(renderTarget.name);
+            return false;
+        }
+    }
+    for (auto renderTarget : mRenderTargets)  mTextures.push_back(gRenderDevice->RenderTargetTexture(renderTarget));
+
+    // Shaders are loaded by name without the extension, see the Load...Shader functions in Renderer.h
+    for (auto& shader : scene.shaders)
+    {
+        bool isVertex = (shader.type == SceneShaderType::Vertex);
+        mVertexShaders.push_back(isVertex ? gRenderDevice->LoadVertexShader(scene.String(shader.file)) : nullptr);
+        mPixelShaders .push_back(isVertex ? nullptr : gRenderDevice->LoadPixelShader(scene.String(shader.file)));
+        if (mVertexShaders.back() == nullptr && mPixelShaders.back() == nullptr)
+        {
+            gLastError = std::string("Error loading shader ") + scene.String(shader.file);
+            return false;
+        }
+    }
+
+    // Each scene material becomes one render queue material
+    std::vector<int>& queueMaterials = mQueueMaterials;
+    for (auto& sceneMaterial : scene.materials)
+    {
+        RenderMaterial material;
+        material.vertexShader = mVertexShaders[sceneMaterial.vertexShader];
+        material.pixelShader  = mPixelShaders [sceneMaterial.pixelShader];
+        if (sceneMaterial.instancedVertexShader != SCENE_NO_INDEX)
+        {
+            material.instancedVertexShader = mVertexShaders[sceneMaterial.instancedVertexShader];
+        }
+        for (int slot = 0; slot < MAX_MATERIAL_TEXTURES; ++slot)
+        {
+            if (sceneMaterial.textures[slot] != SCENE_NO_INDEX)  material.textures[slot] = mTextures[sceneMaterial.textures[slot]];
+        }
+        material.sampler   = static_cast<SamplerMode>(sceneMaterial.sampler);
+        material.blendMode = static_cast<BlendMode>  (sceneMaterial.blendMode);
+        material.depthMode = static_cast<DepthMode>  (sceneMaterial.depthMode);
+        material.cullMode  = static_cast<CullMode>   (sceneMaterial.cullMode);
+        queueMaterials.push_back(renderQueue.AddMaterial(material));
+    }
+
+    // Models and cameras, each type in a single array
+    mModels        .reserve(scene.models.size());
+    mModelMaterials.reserve(scene.models.size());
+    mModelColours  .reserve(scene.models.size());
+    mModelNames    .reserve(scene.models.size());
+    for (auto& sceneModel : scene.models)
+    {
+        // A parent is always declared before its children, so it has already been created
+        uint32_t parent = (sceneModel.parent != SCENE_NO_INDEX) ? mModels[sceneModel.parent].TransformIndex() : NO_PARENT_TRANSFORM;
+        uint32_t transform = mTransforms.Add(CVector3(sceneModel.position), CVector3(sceneModel.rotation), CVector3(sceneModel.scale), parent);
+        Mesh* mesh = mMeshes[sceneModel.mesh] ? mMeshes[sceneModel.mesh].get()
+                                              : mPlaceholderMeshes[PlaceholderMeshIndex(scene.meshes[sceneModel.mesh])].get();
+        mModels.emplace_back(mesh, mTransforms, transform);
+        mModelMeshes.push_back(sceneModel.mesh);
+
+        // Meshes that may be drawn instanced get their instanced layout now, as the draws may be recorded on several threads
+        if (scene.materials[sceneModel.material].instancedVertexShader != SCENE_NO_INDEX)
+        {
+            mesh->PrepareInstancing();
+            mMeshesInstanced.resize(mMeshes.size());
+            mMeshesInstanced[sceneModel.mesh] = true;
+        }
+        mModelMaterials.push_back(queueMaterials[sceneModel.material]);
+        mModelColours  .push_back(CVector3(sceneModel.colour));
+        mModelNames    .push_back(scene.String(sceneModel.name));
+
+        if (sceneModel.isStatic)  mStaticModels.push_back(static_cast<uint32_t>(mModels.size() - 1));
+        else                      mDynamicModels.push_back(static_cast<uint32_t>(mModels.size() - 1));
+    }
+
+    // Build the static models' BVH from their bounds where they start. The models' transforms are in the same order as
+    // the models, so the set of static transforms has the same bits as the static models
+    mStaticSet.assign((mModels.size() + 63) / 64, 0);
+    for (uint32_t model : mStaticModels)  mStaticSet[model / 64] |= uint64_t(1) << (model % 64);
+    mTransforms.UpdateWorldMatrices();
+    UpdateStaticBounds(nullptr);
+    mStaticBVH.Build(mStaticBounds.data(), static_cast<uint32_t>(mStaticBounds.size()));
+
+    // Kept to give the loaded textures to the materials using their placeholders
+    if (loadInBackground)  mSceneMaterials = scene.materials;
+
+    for (auto& sceneCamera : scene.cameras)
+    {
+        Camera camera(CVector3(sceneCamera.position), CVector3(sceneCamera.rotation), sceneCamera.fov);
+        camera.SetNearClip(sceneCamera.nearClip);
+        camera.SetFarClip (sceneCamera.farClip);
+        mCameras.push_back(camera);
+        mCameraNames.push_back(scene.String(sceneCamera.name));
+    }
+
+    return true;
+}
+
+
+// Release everything created. The render queue's materials use the shaders and textures, so release the queue first
+void SceneObjects::Release()
+{
+    // Wait for anything still loading, the loaded data is discarded
+    mLoader.reset();
+    mModelMeshes.clear();
+    mMeshesInstanced.clear();
+    mQueueMaterials.clear();
+    mSceneMaterials.clear();
+
+    mCameras.clear();
+    mModels.clear();
+    mTransforms.Clear();
+    mStaticModels.clear();
+    mDynamicModels.clear();
+    mStaticSet.clear();
+    mStaticBounds.clear();
+    mStaticBVH.Clear();
+    mModelMaterials.clear();
+    mModelColours.clear();
+    mModelNames.clear();
+    mCameraNames.clear();
+
+    for (auto shader : mVertexShaders)  if (shader != nullptr)  gRenderDevice->Release(shader);
+    for (auto shader : mPixelShaders)   if (shader != nullptr)  gRenderDevice->Release(shader);
+    mVertexShaders.clear();
+    mPixelShaders.clear();
+
+    // Only the loaded textures are released here, the render targets own their textures which follow them in mTextures.
+    // Loaded textures go back to the texture cache, which may keep them for reuse
+    for (size_t i = 0; i < mNumLoadedTextures; ++i)
+    {
+        if (mTextures[i] == nullptr)  continue;
+        if (mTexturePlaceholders[i])  gRenderDevice->Release(mTextures[i]);
+        else                          gTextureCache.Release(mTextures[i]);
+    }
+    mNumLoadedTextures = 0;
+    mTexturePlaceholders.clear();
+    for (auto renderTarget : mRenderTargets)  gRenderTargetPool.Release(renderTarget);
+    mTextures.clear();
+    mRenderTargets.clear();
+    mRenderTargetNames.clear();
+
+    mMeshes.clear();
+    for (auto& placeholder : mPlaceholderMeshes)  placeholder.reset();
+}
+
+
+// Create the meshes and textures that have finished loading since the last call, and give them to the models and
+// materials using their placeholders. Returns false and sets gLastError if an asset failed to load
+bool SceneObjects::UpdateLoading(RenderQueue* renderQueues, int numQueues)
+{
+    if (mLoader == nullptr)  return true;
+
+    std::vector<LoadedAsset> loaded;
+    if (mLoader->CreateLoaded(loaded) == 0)  return true;
+    gFrameStats.assetsCreated += static_cast<int>(loaded.size());
+
+    bool success = true;
+    bool meshesChanged = false;
+    uint32_t numMeshes = static_cast<uint32_t>(mMeshes.size());
+    for (auto& asset : loaded)
+    {
+        // Failed assets keep their placeholder, only the first error is reported
+        if (!asset.error.empty())
+        {
+            if (success)  gLastError = asset.error;
+            success = false;
+            continue;
+        }
+
+        if (asset.type == AssetType::Mesh)
+        {
+            uint32_t meshIndex = asset.id;
+            mMeshes[meshIndex] = std::move(asset.mesh);
+            Mesh* mesh = mMeshes[meshIndex].get();
+            if (meshIndex < mMeshesInstanced.size() && mMeshesInstanced[meshIndex])  mesh->PrepareInstancing();
+            for (int queue = 0; queue < numQueues; ++queue)  renderQueues[queue].AddMesh(mesh);
+
+            for (size_t model = 0; model < mModels.size(); ++model)
+            {
+                if (mModelMeshes[model] == meshIndex)  mModels[model].SetMesh(mesh);
+            }
+            meshesChanged = true;
+        }
+        else
+        {
+            uint32_t textureIndex = asset.id - numMeshes;
+            gRenderDevice->Release(mTextures[textureIndex]); // The placeholder
+            mTextures[textureIndex] = asset.texture;
+            mTexturePlaceholders[textureIndex] = false;
+
+            for (size_t material = 0; material < mSceneMaterials.size(); ++material)
+            {
+                for (int slot = 0; slot < MAX_MATERIAL_TEXTURES; ++slot)
+                {
+                    if (mSceneMaterials[material].textures[slot] != textureIndex)  continue;
+                    for (int queue = 0; queue < numQueues; ++queue)
+                    {
+                        renderQueues[queue].SetMaterialTexture(mQueueMaterials[material], slot, asset.texture);
+                    }
+                }
+            }
+        }
+    }
+
+    // The static models' bounds have changed with their meshes. While loading the BVH is refitted, which is quick, and
+    // it is rebuilt once everything has loaded since the boxes may have changed a lot from the placeholders. The bounds
+    // are read without rebuilding world matrices, so bring the static models' matrices up to date first
+    if (meshesChanged)
+    {
+        for (uint32_t model : mStaticModels)  mTransforms.WorldMatrix(mModels[model].TransformIndex());
+        UpdateStaticBounds(nullptr);
+        if (mLoader->NumPending() == 0)  mStaticBVH.Build(mStaticBounds.data(), static_cast<uint32_t>(mStaticBounds.size()));
+        else                             mStaticBVH.Refit(mStaticBounds.data());
+    }
+
+    // Finished, the placeholder meshes are only kept for models whose mesh failed to load
+    if (mLoader->NumPending() == 0)
+    {
+        mLoader.reset();
+        mSceneMaterials.clear();
+        for (auto& placeholder : mPlaceholderMeshes)
+        {
+            bool inUse = false;
+            for (auto& model : mModels)  inUse = inUse || (model.GetMesh() == placeholder.get());
+            if (!inUse)  placeholder.reset();
+        }
+    }
+    return success;
+}
+
+
+// Wait for every mesh and texture loading in the background then create them as UpdateLoading
+bool SceneObjects::FinishLoading(RenderQueue* renderQueues, int numQueues)
+{
+    if (mLoader == nullptr)  return true;
+
+    mLoader->WaitForAll();
+    return UpdateLoading(renderQueues, numQueues);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Data access
+//--------------------------------------------------------------------------------------
+
+// Rebuild the world matrices of all models that have moved since the last call, then refit the static models' BVH if
+// any of them moved. Returns the number of world matrices rebuilt
+int SceneObjects::UpdateWorldMatrices(JobSystem* jobs /*= nullptr*/)
+{
+    // Check before the update, which clears the flags. This includes static models moved by a parent that isn't static
+    bool staticModelsMoved = mTransforms.AnyDirty(mStaticSet);
+    int numUpdated = mTransforms.UpdateWorldMatrices(jobs);
+    if (staticModelsMoved)
+    {
+        UpdateStaticBounds(jobs);
+        mStaticBVH.Refit(mStaticBounds.data());
+        ++gFrameStats.staticBVHRefits;
+    }
+    return numUpdated;
+}
+
+namespace
+{
+    // Returns the handle of the object with the given name in a list of names, or an invalid handle if it isn't found
+    template <class Handle>
+    Handle FindName(const std::vector<std::string>& names, const std::string& name)
+    {
+        Handle handle;
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            if (names[i] == name)
+            {
+                handle.index = static_cast<uint32_t>(i);
+                break;
+            }
+        }
+        return handle;
+    }
+}
+
+ModelHandle SceneObjects::FindModel(const std::string& name)
+{
+    return FindName<ModelHandle>(mModelNames, name);
+}
+
+CameraHandle SceneObjects::FindCamera(const std::string& name)
+{
+    return FindName<CameraHandle>(mCameraNames, name);
+}
+
+RenderTargetHandle SceneObjects::FindRenderTarget(const std::string& name)
+{
+    return FindName<RenderTargetHandle>(mRenderTargetNames, name);
+}
+
+
+// Change the size of a render target, replacing it with one of the new size from the render target pool. Does nothing
+// if the new size rounds up to the current size
+bool SceneObjects::ResizeRenderTarget(RenderTargetHandle renderTarget, int width, int height)
+{
+    GpuRenderTarget*& current = mRenderTargets[renderTarget.index];
+    int currentWidth, currentHeight;
+    gRenderDevice->RenderTargetSize(current, currentWidth, currentHeight);
+    if (RenderTargetPool::BucketSize(width) == currentWidth && RenderTargetPool::BucketSize(height) == currentHeight)  return true;
+
+    GpuRenderTarget* resized = gRenderTargetPool.Acquire(width, height);
+    if (resized == nullptr)
+    {
+        gLastError = "Error creating render target " + mRenderTargetNames[renderTarget.index];
+        return false;
+    }
+    gRenderTargetPool.Release(current);
+    current = resized;
+    mTextures[mNumLoadedTextures + renderTarget.index] = gRenderDevice->RenderTargetTexture(resized);
+    return true;
+}
+
+
+// Bytes of the index buffers of the meshes loaded so far, placeholders aren't counted
+int SceneObjects::IndexMemory()
+{
+    int bytes = 0;
+    for (auto& mesh : mMeshes)
+    {
+        if (mesh)  bytes += mesh->IndexMemoryUsed();
+    }
+    return bytes;
+}
+
+// Bytes saved by the meshes loaded so far that use 16-bit indices
+int SceneObjects::IndexMemorySaved()
+{
+    int bytes = 0;
+    for (auto& mesh : mMeshes)
+    {
+        if (mesh)  bytes += mesh->IndexMemorySaved();
+    }
+    return bytes;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Private functions
+//--------------------------------------------------------------------------------------
+
+// Create a plain texture to use until a texture loading in the background is ready. Mid grey, so lighting still shows
+GpuTexture* SceneObjects::CreatePlaceholderTexture()
+{
+    const uint32_t grey = 0xff808080;
+    return gRenderDevice->CreateTexture(1, 1, &grey);
+}
+
+
+// Get the world bounding box of every static model into mStaticBounds. World matrices must be up to date. Pass a job
+// system to use several threads
+void SceneObjects::UpdateStaticBounds(JobSystem* jobs)
+{
+    mStaticBounds.resize(mStaticModels.size());
+    auto update = [this](uint32_t first, uint32_t end)
+    {
+        for (uint32_t i = first; i < end; ++i)
+        {
+            mModels[mStaticModels[i]].WorldBounds(mStaticBounds[i].min, mStaticBounds[i].max);
+        }
+    };
+
+    uint32_t numStatic = static_cast<uint32_t>(mStaticModels.size());
+    if (jobs != nullptr)
+    {
+        JobCounter updated;
+        jobs->ParallelFor(numStatic, 1024, update, &updated);
+        jobs->Wait(updated);
+    }
+    else
+    {
+        update(0, numStatic);
+    }
+}
@@ -0,0 +1,192 @@
+//--------------------------------------------------------------------------------------
+// Scene objects created from a scene description
+//--------------------------------------------------------------------------------------
+// Creates the meshes, GPU resources, render queue materials, models and cameras declared in a scene file (see
+// SceneFile.h) and owns them until Release. Objects of each type are stored together in one array, in the order they
+// were declared, so processing every model (e.g. culling) walks memory in order rather than following pointers.
+//
+// The scene code refers to objects by handle - their index in the array, wrapped in a type so a model handle can't be
+// used for a camera. Handles are found by name after creation and stay valid until Release.
+//
+// Models marked static in the scene file are also put in a bounding volume hierarchy (see BVH.h) when created, so they
+// can be culled a group at a time rather than one by one. They can still be moved, the BVH is refitted to their new
+// bounds in UpdateWorldMatrices, but that is much slower than moving a model that isn't static, so it should be rare.
+//
+// The meshes and textures can be loaded in the background (see AssetLoader.h), so the scene can be shown before they
+// have all loaded. Models are drawn with a placeholder box and materials with a plain grey texture until their own are
+// ready, UpdateLoading swaps them in as they arrive.
+
+#ifndef _SCENE_OBJECTS_H_INCLUDED_
+#define _SCENE_OBJECTS_H_INCLUDED_
+
+#include "SceneFile.h"
+#include "Mesh.h"
+#include "Model.h"
+#include "Camera.h"
+#include "TransformStore.h"
+#include "RenderQueue.h"
+#include "BVH.h"
+#include "AssetLoader.h"
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Handles
+//--------------------------------------------------------------------------------------
+
+// Index of an object in one of the arrays below. The tag type is only there to make each kind of handle a different type
+template <class Tag>
+struct SceneHandle
+{
+    uint32_t index = SCENE_NO_INDEX;
+
+    bool IsValid() const  { return index != SCENE_NO_INDEX; }
+};
+
+using ModelHandle        = SceneHandle<struct ModelHandleTag>;
+using CameraHandle       = SceneHandle<struct CameraHandleTag>;
+using RenderTargetHandle = SceneHandle<struct RenderTargetHandleTag>;
+
+
+//--------------------------------------------------------------------------------------
+// Scene objects class
+//--------------------------------------------------------------------------------------
+
+class SceneObjects
+{
+public:
+    //-------------------------------------
+    // Construction / Usage
+    //-------------------------------------
+
+    // Create everything in the given scene description, adding its materials to the given render queue. Returns false
+    // on failure and sets gLastError, anything created so far is left for Release to free.
+    // If loadInBackground is true, the meshes and textures are only requested from an asset loader and placeholders are
+    // used until UpdateLoading swaps them for the loaded ones. A missing mesh or texture file is then not a failure here,
+    // it is reported by UpdateLoading
+    bool Create(const SceneDescription& scene, RenderQueue& renderQueue, bool loadInBackground = false);
+
+    // Create the meshes and textures that have finished loading in the background since the last call, and give them to
+    // the models and materials using their placeholders. Meshes are added to the given render queues, which must all
+    // have the scene's materials (see RenderQueue::CopyMaterials). Call on the main thread, e.g. at the start of each
+    // frame, while no draws are being submitted. Returns false and sets gLastError if an asset failed to load, its
+    // placeholder is kept
+    bool UpdateLoading(RenderQueue* renderQueues, int numQueues);
+
+    // Wait for every mesh and texture loading in the background then create them as UpdateLoading
+    bool FinishLoading(RenderQueue* renderQueues, int numQueues);
+
+    // Number of meshes and textures still loading in the background
+    int NumAssetsLoading()  { return (mLoader != nullptr) ? mLoader->NumPending() : 0; }
+
+    // Release everything created. The render queue's materials use the shaders and textures, so release the queue first
+    void Release();
+
+
+    //-------------------------------------
+    // Data access
+    //-------------------------------------
+
+    // Find objects by the name given in the scene file. Returns an invalid handle if there is no such object
+    ModelHandle        FindModel       (const std::string& name);
+    CameraHandle       FindCamera      (const std::string& name);
+    RenderTargetHandle FindRenderTarget(const std::string& name);
+
+    // Rebuild the world matrices of all models that have moved since the last call, in one batch (see TransformStore.h),
+    // then refit the static models' BVH if any of them moved. Reading a moved model's world matrix before this rebuilds
+    // just that one. Pass a job system to use several threads. Returns the number of world matrices rebuilt
+    int UpdateWorldMatrices(JobSystem* jobs = nullptr);
+
+    // True if any model in the given set has moved since the last UpdateWorldMatrices, so call it before that. The set
+    // has a bit for each model, 64 to a word: bit (i % 64) of word (i / 64) for the model with handle index i
+    bool AnyModelMoved(const std::vector<uint64_t>& modelSet)  { return mTransforms.AnyDirty(modelSet); }
+
+    int NumModels()  { return static_cast<int>(mModels.size()); }
+    int NumMeshes()  { return static_cast<int>(mMeshes.size()); }
+
+    // Bytes of the index buffers of the meshes loaded so far, and the bytes saved by those using 16-bit indices
+    // rather than 32-bit ones (see Mesh.h)
+    int IndexMemory();
+    int IndexMemorySaved();
+
+    Model&   GetModel        (ModelHandle model)  { return mModels       [model.index]; }
+    int      ModelMaterial   (ModelHandle model)  { return mModelMaterials[model.index]; } // Material number in the render queue
+    CVector3 ModelColour     (ModelHandle model)  { return mModelColours  [model.index]; }
+    void     SetModelColour  (ModelHandle model, const CVector3& colour)  { mModelColours[model.index] = colour; }
+
+    // The static models' BVH refers to each model by its position in StaticModels. The other models are in DynamicModels
+    const BVH&                   StaticBVH()      { return mStaticBVH; }
+    const std::vector<uint32_t>& StaticModels()   { return mStaticModels; }
+    const std::vector<uint32_t>& DynamicModels()  { return mDynamicModels; }
+
+    Camera&          GetCamera      (CameraHandle camera)              { return mCameras[camera.index]; }
+    GpuRenderTarget* GetRenderTarget(RenderTargetHandle renderTarget)  { return mRenderTargets[renderTarget.index]; }
+
+    // Change the size of a render target. It is replaced with a target of the new size from the render target pool (see
+    // RenderTargetPool.h), so its size is rounded up to the pool's buckets and GetRenderTarget returns a different target
+    // after any change. Materials using its texture must be given the new one (see RenderQueue::SetMaterialTexture).
+    // Returns false on failure and sets gLastError, the target is then unchanged
+    bool ResizeRenderTarget(RenderTargetHandle renderTarget, int width, int height);
+
+
+    //-------------------------------------
+    // Private data / members
+    //-------------------------------------
+private:
+    // Get the world bounding box of every static model into mStaticBounds. World matrices must be up to date. Pass a
+    // job system to use several threads
+    void UpdateStaticBounds(JobSystem* jobs);
+
+    // Create a plain texture to use until a texture loading in the background is ready
+    GpuTexture* CreatePlaceholderTexture();
+
+    // Meshes own their GPU buffers and can't be copied, so they are allocated separately. They are few compared to models.
+    // A mesh loading in the background is null until it is ready
+    std::vector<std::unique_ptr<Mesh>> mMeshes;
+
+    std::vector<GpuTexture*>       mTextures;      // Loaded textures followed by the render targets' textures, as numbered by materials
+    size_t                         mNumLoadedTextures = 0;
+    std::vector<bool>              mTexturePlaceholders; // For each loaded texture, whether it is still a placeholder rather than from gTextureCache
+    std::vector<GpuRenderTarget*>  mRenderTargets; // From gRenderTargetPool
+    std::vector<GpuVertexShader*>  mVertexShaders; // Indexed by shader number in the scene, nullptr for pixel shaders
+    std::vector<GpuPixelShader*>   mPixelShaders;  // Indexed by shader number in the scene, nullptr for vertex shaders
+
+    // Models refer to their transform in the store by index. The models' transforms are in the same order as the models
+    TransformStore        mTransforms;
+    std::vector<Model>    mModels;
+    std::vector<int>      mModelMaterials;
+    std::vector<CVector3> mModelColours;
+    std::vector<Camera>   mCameras;
+
+    // Indices of the static and other models. The static models also have a bit set in mStaticSet, one bit for each
+    // model's transform (see TransformStore::AnyDirty). mStaticBounds is the box of each static model the BVH was last
+    // built or refitted with
+    std::vector<uint32_t>    mStaticModels;
+    std::vector<uint32_t>    mDynamicModels;
+    std::vector<uint64_t>    mStaticSet;
+    std::vector<BoundingBox> mStaticBounds;
+    BVH                      mStaticBVH;
+
+    // Assets loading in the background, only while loading. Mesh i is asset i and texture i is asset NumMeshes() + i.
+    // Until they are loaded models use a placeholder box with the same vertex layout, one for each combination of with
+    // or without tangents and quantized or not (see PlaceholderMeshIndex), and each texture is a placeholder of its own.
+    // What uses each mesh and texture is kept to swap them in later
+    std::unique_ptr<AssetLoader>     mLoader;
+    std::unique_ptr<Mesh>            mPlaceholderMeshes[4];
+    std::vector<uint32_t>            mModelMeshes;     // Scene mesh index of each model
+    std::vector<bool>                mMeshesInstanced; // Meshes used with an instanced material, that need PrepareInstancing
+    std::vector<int>                 mQueueMaterials;  // Render queue material number of each scene material
+    std::vector<SceneMaterialRecord> mSceneMaterials;  // For the textures used by each material
+
+    // Names from the scene file for lookups
+    std::vector<std::string> mModelNames;
+    std::vector<std::string> mCameraNames;
+    std::vector<std::string> mRenderTargetNames;
+};
+
+
+#endif //_SCENE_OBJECTS_H_INCLUDED_
@@ -0,0 +1,171 @@
+//--------------------------------------------------------------------------------------
+// Texture cache
+//--------------------------------------------------------------------------------------
+
+#include "TextureCache.h"
+#include "MeshCache.h" // For HashData
+#include "MappedFile.h"
+#include "Common.h"
+
+#include <stdexcept>
+#include <cassert>
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+TextureCache gTextureCache;
+
+
+//--------------------------------------------------------------------------------------
+// Construction / Usage
+//--------------------------------------------------------------------------------------
+
+// Returns the texture in the given file, loading it if the cache doesn't have it. Returns nullptr on failure
+GpuTexture* TextureCache::Acquire(const std::string& fileName)
+{
+    GpuTexture* texture = AcquireIfCached(fileName);
+    if (texture != nullptr)  return texture;
+
+    // The file is mapped rather than read into a buffer, the renderer creates the texture straight from the mapping
+    try
+    {
+        MappedFile file(fileName);
+        return AcquireFromMemory(fileName, file.Data(), file.Size(), HashData(file.Data(), file.Size()));
+    }
+    catch (const std::runtime_error& e)
+    {
+        gLastError = e.what();
+        return nullptr;
+    }
+}
+
+
+// Returns the texture in the given file only if the cache already has it under that name, otherwise nullptr
+GpuTexture* TextureCache::AcquireIfCached(const std::string& fileName)
+{
+    auto name = mNames.find(fileName);
+    if (name == mNames.end())  return nullptr;
+
+    ++mHits;
+    return AddReference(mEntries.at(name->second));
+}
+
+
+// Returns the texture from the content of a texture file already in memory, creating it only if the cache has no
+// texture of that name or content. Returns nullptr on failure
+GpuTexture* TextureCache::AcquireFromMemory(const std::string& fileName, const void* data, size_t size, uint64_t contentHash)
+{
+    GpuTexture* texture = AcquireIfCached(fileName);
+    if (texture != nullptr)  return texture;
+
+    // The same content under another name. Remember this name too so it is found without the hash next time
+    auto found = mEntries.find(contentHash);
+    if (found != mEntries.end())
+    {
+        ++mHits;
+        found->second.names.push_back(fileName);
+        mNames[fileName] = contentHash;
+        return AddReference(found->second);
+    }
+
+    texture = gRenderDevice->CreateTextureFromMemory(data, size, fileName);
+    if (texture == nullptr)
+    {
+        gLastError = "Error loading texture " + fileName;
+        return nullptr;
+    }
+    ++mMisses;
+
+    Entry& entry = mEntries[contentHash];
+    entry.texture    = texture;
+    entry.memory     = gRenderDevice->TextureMemory(texture);
+    entry.references = 1;
+    entry.names.push_back(fileName);
+    mNames[fileName]  = contentHash;
+    mTextures[texture] = contentHash;
+    mResidentBytes += entry.memory;
+
+    // Released textures may need freeing to make room for this one
+    Trim();
+    return texture;
+}
+
+
+// Give a texture back to the cache. It is kept for reuse until the cache is over budget
+void TextureCache::Release(GpuTexture* texture)
+{
+    if (texture == nullptr)  return;
+
+    auto found = mTextures.find(texture);
+    assert(found != mTextures.end() && "Texture not from this cache");
+    if (found == mTextures.end())  return;
+
+    Entry& entry = mEntries.at(found->second);
+    assert(entry.references > 0);
+    if (--entry.references == 0)
+    {
+        mUnused.push_front(found->second);
+        entry.unusedPosition = mUnused.begin();
+        Trim();
+    }
+}
+
+
+// Free all the textures. All acquired textures must have been released first
+void TextureCache::Clear()
+{
+    for (auto& entry : mEntries)
+    {
+        assert(entry.second.references == 0);
+        gRenderDevice->Release(entry.second.texture);
+    }
+    mEntries.clear();
+    mNames.clear();
+    mTextures.clear();
+    mUnused.clear();
+    mResidentBytes = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Data access
+//--------------------------------------------------------------------------------------
+
+void TextureCache::SetBudget(size_t budget)
+{
+    mBudget = budget;
+    Trim();
+}
+
+
+//--------------------------------------------------------------------------------------
+// Private functions
+//--------------------------------------------------------------------------------------
+
+// Add a reference to an entry, taking it out of the unused list if it was there
+GpuTexture* TextureCache::AddReference(Entry& entry)
+{
+    if (entry.references++ == 0)  mUnused.erase(entry.unusedPosition);
+    return entry.texture;
+}
+
+
+// Free released textures, least recently used first, until within the budget
+void TextureCache::Trim()
+{
+    while (mResidentBytes > mBudget && !mUnused.empty())
+    {
+        uint64_t contentHash = mUnused.back();
+        mUnused.pop_back();
+
+        Entry& entry = mEntries.at(contentHash);
+        for (auto& name : entry.names)  mNames.erase(name);
+        mTextures.erase(entry.texture);
+        gRenderDevice->Release(entry.texture);
+        mResidentBytes -= entry.memory;
+        mEntries.erase(contentHash);
+        ++mEvictions;
+    }
+}
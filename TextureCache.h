@@ -0,0 +1,127 @@
+//--------------------------------------------------------------------------------------
+// Texture cache
+//--------------------------------------------------------------------------------------
+// Loads each texture once however many times it is asked for. Textures are taken from the cache with Acquire and given
+// back with Release, and the cache counts the references to each so it knows which are still in use. All users of a
+// texture share the same GpuTexture.
+//
+// Textures are found by file name first, then by a hash of the file's content (see HashData in MeshCache.h), so the
+// same image under two names (e.g. a copy in another folder, or a different case of the name on Windows) is only loaded
+// to the GPU once. A texture whose name isn't known yet has to be read to get the hash, but not created.
+//
+// Released textures are not freed straight away, they are kept in case they are wanted again. Once the GPU memory of
+// all the cached textures is over the budget (SetBudget), released textures are freed, least recently used first.
+// Textures still in use are never freed, so the cache can be over budget if that many are in use.
+//
+// The cache counts hits (a texture found in the cache), misses (a texture created) and evictions (a released texture
+// freed to keep to the budget), and reports the memory of the textures it holds.
+
+#ifndef _TEXTURE_CACHE_H_INCLUDED_
+#define _TEXTURE_CACHE_H_INCLUDED_
+
+#include "Renderer.h"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Texture cache class
+//--------------------------------------------------------------------------------------
+
+class TextureCache
+{
+public:
+    //-------------------------------------
+    // Construction / Usage
+    //-------------------------------------
+
+    // Returns the texture in the given file (.dds, .jpg, .png etc.), loading it with gRenderDevice if the cache doesn't
+    // have it. Give it back with Release when done. Returns nullptr on failure
+    GpuTexture* Acquire(const std::string& fileName);
+
+    // Returns the texture in the given file only if the cache already has it under that name, otherwise nullptr. Used to
+    // skip reading a file the cache has already loaded (see AssetLoader.h)
+    GpuTexture* AcquireIfCached(const std::string& fileName);
+
+    // Returns the texture from the content of a texture file already in memory, e.g. read on another thread. The
+    // texture is only created if the cache has no texture of that name or content. Pass HashData of the content (see
+    // MeshCache.h). Returns nullptr on failure
+    GpuTexture* AcquireFromMemory(const std::string& fileName, const void* data, size_t size, uint64_t contentHash);
+
+    // Give a texture from one of the functions above back to the cache. It is kept for reuse until the cache is over
+    // budget. Passing nullptr is allowed and does nothing
+    void Release(GpuTexture* texture);
+
+    // Free all the textures. All acquired textures must have been released first. Call before the renderer is shut down
+    void Clear();
+
+
+    //-------------------------------------
+    // Data access
+    //-------------------------------------
+
+    // GPU memory in bytes the cache aims to keep its textures within (default 256MB). Released textures are freed when
+    // over this, a budget of 0 frees each texture as soon as it is released
+    size_t Budget()  { return mBudget; }
+    void   SetBudget(size_t budget);
+
+    // Estimated GPU memory in bytes of all the textures held, in use or kept for reuse (see RenderDevice::TextureMemory)
+    size_t ResidentBytes()  { return mResidentBytes; }
+
+    int NumTextures()  { return static_cast<int>(mEntries.size()); }
+
+    // Counts since the cache was created
+    int Hits()       { return mHits; }
+    int Misses()     { return mMisses; }
+    int Evictions()  { return mEvictions; }
+
+
+    //-------------------------------------
+    // Private data / members
+    //-------------------------------------
+private:
+    struct Entry
+    {
+        GpuTexture*              texture;
+        size_t                   memory;
+        int                      references;
+        std::vector<std::string> names;  // File names the texture has been asked for by, to remove them when it is freed
+        std::list<uint64_t>::iterator unusedPosition; // Position in mUnused while not referenced
+    };
+
+    // Add a reference to an entry, taking it out of the unused list if it was there
+    GpuTexture* AddReference(Entry& entry);
+
+    // Free released textures, least recently used first, until within the budget
+    void Trim();
+
+    // Textures by content hash, and the content hash of each file name and texture asked for
+    std::unordered_map<uint64_t, Entry>       mEntries;
+    std::unordered_map<std::string, uint64_t> mNames;
+    std::unordered_map<GpuTexture*, uint64_t> mTextures;
+
+    // Content hashes of the textures not referenced, most recently released first
+    std::list<uint64_t> mUnused;
+
+    size_t mBudget        = 256 * 1024 * 1024;
+    size_t mResidentBytes = 0;
+    int    mHits      = 0;
+    int    mMisses    = 0;
+    int    mEvictions = 0;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+// The textures of the scene (see SceneObjects.h) and any others loaded from files come from this cache
+extern TextureCache gTextureCache;
+
+
+#endif //_TEXTURE_CACHE_H_INCLUDED_
@@ -0,0 +1,369 @@
+//--------------------------------------------------------------------------------------
+// Asset load benchmark
+//--------------------------------------------------------------------------------------
+// Command line tool that loads the meshes and textures of the app's scene (Scene.scene) with the null renderer
+// (RendererNull.h), so no window or GPU is needed, and compares the startup time of:
+// - Serial loading: each file read, imported or decoded and created on the main thread one after another, which is how
+//   the app loads with gLoadAssetsInBackground set to false. Nothing can be shown until all have loaded
+// - Background loading with the asset loader (see AssetLoader.h): the files are read, imported and packed on the
+//   loader's threads while the main thread creates the assets as they finish, polling like a frame loop would. The first
+//   frame can be shown as soon as the loads are requested
+// Each is run several times and the fastest time is reported, with the texture cache (see TextureCache.h) emptied
+// before each run. The null renderer doesn't decode textures or copy data to a GPU, so the creation times here are lower
+// than with Direct3D.
+//
+// Afterwards the texture cache is checked: the textures are loaded again under different names, which the cache should
+// find by their content, then released with a budget of half their memory, which should free the least recently used.
+//
+// Only uses standard C++ and assimp, so it also builds on Linux, e.g. from the repository folder:
+//   g++ -std=c++17 -O2 -I. -IUtility -IMath -o AssetLoadBench Tools/AssetLoadBench/AssetLoadBench.cpp AssetLoader.cpp
+//       TextureCache.cpp SceneFile.cpp Mesh.cpp MeshData.cpp MeshCache.cpp RendererNull.cpp Utility/FrameStats.cpp
+//       Utility/MappedFile.cpp Utility/JobSystem.cpp MeshQuantization.cpp MeshClusters.cpp Math/*.cpp
+//       Tools/Common/ToolStubs.cpp -lassimp -lpthread
+//
+// Run it from the folder holding the media files and Scene.scene.
+//
+// Usage: AssetLoadBench [-copies <copies>] [-threads <threads>] [-repeats <repeats>] [-import <0 or 1>]
+//   -copies <copies>    Number of times the scene's asset list is loaded, to time a larger list (default 1). Meshes
+//                       are loaded for every copy, textures once since the later copies are found in the texture cache
+//   -threads <threads>  Number of loading threads, -1 for one fewer than the number of CPU cores (default -1)
+//   -repeats <repeats>  Number of times each method is run (default 5)
+//   -import <0 or 1>    Delete the mesh cache files before each run, so every mesh is imported with assimp as on the
+//                       app's first run (default 0, meshes are read from their cache files as on later runs)
+//
+// Returns 0 on success, 1 if an asset failed to load, the texture cache check failed or not all resources were released.
+
+#include "AssetLoader.h"
+#include "SceneFile.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "RendererNull.h"
+#include "Common.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+
+
+//--------------------------------------------------------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+double Milliseconds(Clock::duration time)
+{
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+
+// The meshes and textures to load
+struct AssetList
+{
+    std::vector<std::string> meshes;
+    std::vector<bool>        meshTangents;
+    std::vector<bool>        meshQuantize;
+    std::vector<bool>        meshClusters;
+    std::vector<std::string> textures;
+};
+
+// Times from one run of a loading method
+struct LoadTimes
+{
+    double firstFrameMs = 0; // Until the app could show its first frame
+    double allLoadedMs  = 0; // Until every asset was created
+    double mainThreadMs = 0; // Time the main thread spent loading or creating assets
+};
+
+// The assets created by a run, released before the next. The textures are freed too, so each run starts with an empty
+// texture cache
+struct CreatedAssets
+{
+    std::vector<std::unique_ptr<Mesh>> meshes;
+    std::vector<GpuTexture*>           textures;
+
+    void Release()
+    {
+        meshes.clear();
+        for (auto texture : textures)  gTextureCache.Release(texture);
+        textures.clear();
+        gTextureCache.Clear();
+    }
+};
+
+
+void DeleteMeshCaches(const AssetList& assets)
+{
+    for (size_t i = 0; i < assets.meshes.size(); ++i)
+    {
+        std::remove(MeshCacheFileName(assets.meshes[i], assets.meshTangents[i]).c_str());
+    }
+}
+
+
+// Load every asset on the main thread, one after another. Returns false on failure and sets gLastError
+bool LoadSerial(const AssetList& assets, CreatedAssets& created, LoadTimes& times)
+{
+    auto start = Clock::now();
+    try
+    {
+        for (size_t i = 0; i < assets.meshes.size(); ++i)
+        {
+            created.meshes.push_back(std::make_unique<Mesh>(assets.meshes[i], assets.meshTangents[i], assets.meshQuantize[i],
+                                                            assets.meshClusters[i]));
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        gLastError = e.what();
+        return false;
+    }
+
+    for (auto& texture : assets.textures)
+    {
+        created.textures.push_back(gTextureCache.Acquire(texture));
+        if (created.textures.back() == nullptr)  return false;
+    }
+
+    times.allLoadedMs  = Milliseconds(Clock::now() - start);
+    times.firstFrameMs = times.allLoadedMs;
+    times.mainThreadMs = times.allLoadedMs;
+    return true;
+}
+
+
+// Load every asset in the background, the main thread creating them as they finish. Returns false on failure and sets
+// gLastError
+bool LoadInBackground(const AssetList& assets, int numThreads, CreatedAssets& created, LoadTimes& times)
+{
+    auto start = Clock::now();
+    Clock::duration mainThreadTime = {};
+    bool success = true;
+    {
+        AssetLoader loader(numThreads);
+        for (size_t i = 0; i < assets.meshes.size(); ++i)
+        {
+            loader.LoadMesh(assets.meshes[i], assets.meshTangents[i], assets.meshQuantize[i], assets.meshClusters[i]);
+        }
+        for (auto& texture : assets.textures)  loader.LoadTexture(texture);
+        auto requested = Clock::now();
+        times.firstFrameMs = Milliseconds(requested - start);
+        mainThreadTime += requested - start;
+
+        // The app creates what has loaded once a frame. Here the main thread has nothing else to do, so it checks
+        // continually, giving the loading threads the CPU in between
+        std::vector<LoadedAsset> loaded;
+        while (loader.NumPending() > 0)
+        {
+            auto checkStart = Clock::now();
+            loaded.clear();
+            loader.CreateLoaded(loaded);
+            for (auto& asset : loaded)
+            {
+                if (!asset.error.empty())
+                {
+                    gLastError = asset.error;
+                    success = false;
+                }
+                if (asset.mesh)               created.meshes.push_back(std::move(asset.mesh));
+                if (asset.texture != nullptr) created.textures.push_back(asset.texture);
+            }
+            mainThreadTime += Clock::now() - checkStart;
+            if (loader.NumPending() > 0)  std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+    times.allLoadedMs  = Milliseconds(Clock::now() - start);
+    times.mainThreadMs = Milliseconds(mainThreadTime);
+    return success;
+}
+
+
+// Check the texture cache finds textures by content and frees released ones least recently used first. Prints the cache's
+// counts. Returns false on failure and sets gLastError
+bool CheckTextureCache(const std::vector<std::string>& textureFiles)
+{
+    // Copies of the files under other names, in the same folder so they keep any relative paths
+    std::vector<std::string> copyFiles;
+    for (size_t i = 0; i < textureFiles.size(); ++i)
+    {
+        const std::string& fileName = textureFiles[i];
+        std::string extension = fileName.substr(std::min(fileName.find_last_of('.'), fileName.size()));
+        copyFiles.push_back("AssetLoadBenchCopy" + std::to_string(i) + extension);
+
+        std::ifstream in(fileName, std::ios::in | std::ios::binary);
+        std::ofstream out(copyFiles.back(), std::ios::out | std::ios::binary | std::ios::trunc);
+        out << in.rdbuf();
+    }
+    auto deleteCopies = [&]() { for (auto& copyFile : copyFiles)  std::remove(copyFile.c_str()); };
+
+    int startHits = gTextureCache.Hits(), startMisses = gTextureCache.Misses(), startEvictions = gTextureCache.Evictions();
+    std::vector<GpuTexture*> textures;
+    for (auto& fileName : textureFiles)  textures.push_back(gTextureCache.Acquire(fileName));
+    for (auto& fileName : textureFiles)  textures.push_back(gTextureCache.Acquire(fileName));
+    for (auto& copyFile : copyFiles)     textures.push_back(gTextureCache.Acquire(copyFile));
+    deleteCopies();
+
+    bool success = true;
+    size_t numFiles = textureFiles.size();
+    for (size_t i = 0; i < textures.size() && success; ++i)
+    {
+        if (textures[i] == nullptr)  success = false;
+        else if (textures[i] != textures[i % numFiles])  { gLastError = "Same texture not shared";  success = false; }
+    }
+    int hits   = gTextureCache.Hits()   - startHits;
+    int misses = gTextureCache.Misses() - startMisses;
+    size_t resident = gTextureCache.ResidentBytes();
+    // Fewer textures than files if some files have the same content
+    std::cout << "Texture cache: " << numFiles << " files loaded twice then under other names: " << gTextureCache.NumTextures()
+              << " textures, " << resident / 1024.0 << "KB resident, " << hits << " hits, " << misses << " misses\n";
+
+    // Release in order with a budget of half the memory, the first released should be freed and the last kept
+    gTextureCache.SetBudget(resident / 2);
+    for (auto texture : textures)  gTextureCache.Release(texture);
+    int evictions = gTextureCache.Evictions() - startEvictions;
+    std::cout << "Released with a budget of " << resident / 2 / 1024.0 << "KB: " << evictions << " evicted, "
+              << gTextureCache.ResidentBytes() / 1024.0 << "KB resident\n";
+    if (success)
+    {
+        GpuTexture* last = gTextureCache.AcquireIfCached(textureFiles.back());
+        gTextureCache.Release(last);
+        if (gTextureCache.ResidentBytes() > gTextureCache.Budget() || last == nullptr)
+        {
+            gLastError = "Texture cache not trimmed to budget least recently used first";
+            success = false;
+        }
+        else if (hits + misses != static_cast<int>(numFiles * 3) || misses > static_cast<int>(numFiles))
+        {
+            gLastError = "Texture cache hits or misses not as expected";
+            success = false;
+        }
+    }
+
+    gTextureCache.Clear();
+    gTextureCache.SetBudget(256 * 1024 * 1024);
+    return success;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int  numCopies    = 1;
+    int  numThreads   = -1;
+    int  numRepeats   = 5;
+    bool importMeshes = false;
+    for (int arg = 1; arg + 1 < argc; arg += 2)
+    {
+        std::string argument = argv[arg];
+        if      (argument == "-copies")   numCopies  = std::max(1, std::stoi(argv[arg + 1]));
+        else if (argument == "-threads")  numThreads = std::stoi(argv[arg + 1]);
+        else if (argument == "-repeats")  numRepeats = std::max(1, std::stoi(argv[arg + 1]));
+        else if (argument == "-import")   importMeshes = (std::stoi(argv[arg + 1]) != 0);
+    }
+
+    NullRenderDevice device(gViewportWidth, gViewportHeight);
+    gRenderDevice = &device;
+
+
+    //-----------------------------------
+    // Asset list
+    //-----------------------------------
+
+    SceneDescription scene;
+    if (!LoadSceneFile("Scene.scene", scene))
+    {
+        std::cout << "Error: " << gLastError << "\n";
+        return 1;
+    }
+
+    AssetList assets;
+    for (int copy = 0; copy < numCopies; ++copy)
+    {
+        for (auto& mesh : scene.meshes)
+        {
+            assets.meshes.push_back(scene.String(mesh.file));
+            assets.meshTangents.push_back(mesh.requireTangents != 0);
+            assets.meshQuantize.push_back(mesh.quantize != 0);
+            assets.meshClusters.push_back(mesh.splitClusters != 0);
+        }
+        for (auto& texture : scene.textures)  assets.textures.push_back(scene.String(texture.file));
+    }
+
+    // Load once first so the files are in the OS's file cache for both methods, and the mesh caches exist if used
+    CreatedAssets created;
+    LoadTimes serial, background, times;
+    if (!LoadSerial(assets, created, times))
+    {
+        std::cout << "Error: " << gLastError << "\n";
+        created.Release();
+        return 1;
+    }
+    created.Release();
+
+
+    //-----------------------------------
+    // Time each method
+    //-----------------------------------
+
+    bool success = true;
+    for (int repeat = 0; repeat < numRepeats && success; ++repeat)
+    {
+        if (importMeshes)  DeleteMeshCaches(assets);
+        success = LoadSerial(assets, created, times);
+        created.Release();
+        if (repeat == 0 || times.allLoadedMs < serial.allLoadedMs)  serial = times;
+
+        if (importMeshes)  DeleteMeshCaches(assets);
+        success = success && LoadInBackground(assets, numThreads, created, times);
+        created.Release();
+        if (repeat == 0 || times.allLoadedMs < background.allLoadedMs)  background = times;
+    }
+    if (!success)
+    {
+        std::cout << "Error: " << gLastError << "\n";
+        return 1;
+    }
+
+
+    //-----------------------------------
+    // Report
+    //-----------------------------------
+
+    int loadingThreads = AssetLoader(numThreads).NumThreads();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << assets.meshes.size() << " meshes and " << assets.textures.size() << " textures, meshes "
+              << (importMeshes ? "imported" : "read from their cache files") << ", loader threads: " << loadingThreads << "; fastest of "
+              << numRepeats << " runs\n\n";
+    std::cout << "             First frame   All loaded   Main thread busy\n";
+    std::cout << "Serial:      " << std::setw(9) << serial.firstFrameMs << "ms " << std::setw(10) << serial.allLoadedMs
+              << "ms " << std::setw(16) << serial.mainThreadMs << "ms\n";
+    std::cout << "Background:  " << std::setw(9) << background.firstFrameMs << "ms " << std::setw(10) << background.allLoadedMs
+              << "ms " << std::setw(16) << background.mainThreadMs << "ms\n";
+    std::cout << "All loaded " << serial.allLoadedMs / std::max(background.allLoadedMs, 0.001) << "x as fast, main thread busy "
+              << serial.mainThreadMs / std::max(background.mainThreadMs, 0.001) << "x less\n";
+
+
+    std::cout << "\n";
+    if (!CheckTextureCache(std::vector<std::string>(assets.textures.begin(), assets.textures.begin() + scene.textures.size())))
+    {
+        std::cout << "Error: " << gLastError << "\n";
+        return 1;
+    }
+
+
+    //-----------------------------------
+    // Release
+    //-----------------------------------
+
+    if (device.LiveResources() != 0)
+    {
+        std::cout << "Error: " << device.LiveResources() << " GPU resources not released\n";
+        return 1;
+    }
+
+    return 0;
+}
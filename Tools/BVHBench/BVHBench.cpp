@@ -0,0 +1,278 @@
+//--------------------------------------------------------------------------------------
+// Bounding volume hierarchy benchmark
+//--------------------------------------------------------------------------------------
+// Command line tool that times building and refitting a BVH (BVH.h) over many boxes spread over a large flat area like
+// a level, and the three kinds of query: camera frustums, rays and boxes. Each query is also done by testing every box
+// in turn, which is how the scene culled models before the BVH, to show the speed-up and check the BVH finds exactly
+// the same boxes.
+//
+// The refit is timed after moving every box a short way. The queries are then timed again on the refitted tree, which
+// is less efficient than a tree built for the new positions, and the results checked again.
+//
+// Only uses standard C++, so it also builds on Linux, e.g. from the repository folder:
+//   g++ -std=c++17 -O2 -I. -IMath -o BVHBench Tools/BVHBench/BVHBench.cpp BVH.cpp Math/Frustum.cpp Math/CMatrix4x4.cpp
+//       Math/CVector3.cpp
+//
+// Usage: BVHBench [-boxes <boxes>] [-queries <queries>]
+//   -boxes <boxes>      Number of boxes (default 100000)
+//   -queries <queries>  Number of queries of each kind (default 1000)
+//
+// Returns 0 on success, 1 if any BVH query found different boxes from testing every box.
+
+#include "BVH.h"
+#include "Frustum.h"
+#include "CMatrix4x4.h"
+#include "MathHelpers.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+
+//--------------------------------------------------------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+double Microseconds(Clock::duration time)
+{
+    return std::chrono::duration<double, std::micro>(time).count();
+}
+
+
+// The frustum of a camera at the given position and rotation, built the same way as Camera.cpp with a 60 degree field
+// of view, 4:3 aspect ratio and clip distances of 1 and 1000
+Frustum CameraFrustum(const CVector3& position, const CVector3& rotation)
+{
+    CMatrix4x4 viewMatrix = InverseAffine(MatrixRotationX(rotation.x) * MatrixRotationY(rotation.y) * MatrixTranslation(position));
+
+    float nearClip = 1.0f, farClip = 1000.0f;
+    float scaleX   = 1.0f / std::tan(ToRadians(60.0f) * 0.5f);
+    float scaleY   = scaleX * 4.0f / 3.0f;
+    float scaleZa  = farClip / (farClip - nearClip);
+    CMatrix4x4 projectionMatrix = { scaleX,   0.0f,                 0.0f, 0.0f,
+                                      0.0f, scaleY,                 0.0f, 0.0f,
+                                      0.0f,   0.0f,              scaleZa, 1.0f,
+                                      0.0f,   0.0f, -nearClip * scaleZa, 0.0f };
+    return FrustumFromMatrix(viewMatrix * projectionMatrix);
+}
+
+
+// The queries done each run, made up front so the BVH and the box by box tests get the same ones
+struct Queries
+{
+    std::vector<Frustum>     frustums;
+    std::vector<CVector3>    rayOrigins, rayDirections;
+    std::vector<BoundingBox> boxes;
+};
+
+const float RAY_LENGTH = 2000.0f;
+
+
+// Time for each kind of query and the number of boxes found
+struct QueryTimes
+{
+    Clock::duration frustum = {}, ray = {}, box = {};
+    size_t frustumFound = 0, rayFound = 0, boxFound = 0;
+};
+
+
+// Run all the queries with the BVH. The results of each query are sorted and kept to compare
+QueryTimes QueryBVH(const BVH& bvh, const Queries& queries, std::vector<std::vector<uint32_t>>& results)
+{
+    QueryTimes times;
+    results.clear();
+    std::vector<uint32_t> found;
+    auto run = [&](Clock::duration& time, size_t& numFound, auto query)
+    {
+        found.clear();
+        auto start = Clock::now();
+        query();
+        time += Clock::now() - start;
+        numFound += found.size();
+        std::sort(found.begin(), found.end());
+        results.push_back(found);
+    };
+    for (auto& frustum : queries.frustums)
+    {
+        run(times.frustum, times.frustumFound, [&]() { bvh.FrustumQuery(frustum, found); });
+    }
+    for (size_t i = 0; i < queries.rayOrigins.size(); ++i)
+    {
+        run(times.ray, times.rayFound, [&]() { bvh.RayQuery(queries.rayOrigins[i], queries.rayDirections[i], RAY_LENGTH, found); });
+    }
+    for (auto& box : queries.boxes)
+    {
+        run(times.box, times.boxFound, [&]() { bvh.BoxQuery(box, found); });
+    }
+    return times;
+}
+
+
+// Run all the queries by testing every box in turn. Results are in box order, so already sorted
+QueryTimes QueryEveryBox(const std::vector<BoundingBox>& boxes, const Queries& queries, std::vector<std::vector<uint32_t>>& results)
+{
+    QueryTimes times;
+    results.clear();
+    std::vector<uint32_t> found;
+    uint32_t numBoxes = static_cast<uint32_t>(boxes.size());
+    auto run = [&](Clock::duration& time, size_t& numFound, auto test)
+    {
+        found.clear();
+        auto start = Clock::now();
+        for (uint32_t i = 0; i < numBoxes; ++i)  if (test(boxes[i]))  found.push_back(i);
+        time += Clock::now() - start;
+        numFound += found.size();
+        results.push_back(found);
+    };
+    for (auto& frustum : queries.frustums)
+    {
+        run(times.frustum, times.frustumFound, [&](const BoundingBox& box) { return AABBInFrustum(frustum, box.min, box.max); });
+    }
+    for (size_t i = 0; i < queries.rayOrigins.size(); ++i)
+    {
+        const CVector3& origin = queries.rayOrigins[i];
+        CVector3 direction = queries.rayDirections[i];
+        auto inverse = [](float d) { return 1.0f / (d != 0 ? d : 1e-30f); };
+        CVector3 invDirection = { inverse(direction.x), inverse(direction.y), inverse(direction.z) };
+        run(times.ray, times.rayFound, [&](const BoundingBox& box)
+        {
+            float t1x = (box.min.x - origin.x) * invDirection.x, t2x = (box.max.x - origin.x) * invDirection.x;
+            float t1y = (box.min.y - origin.y) * invDirection.y, t2y = (box.max.y - origin.y) * invDirection.y;
+            float t1z = (box.min.z - origin.z) * invDirection.z, t2z = (box.max.z - origin.z) * invDirection.z;
+            float enter = std::max({ std::min(t1x, t2x), std::min(t1y, t2y), std::min(t1z, t2z), 0.0f });
+            float leave = std::min({ std::max(t1x, t2x), std::max(t1y, t2y), std::max(t1z, t2z), RAY_LENGTH });
+            return enter <= leave;
+        });
+    }
+    for (auto& query : queries.boxes)
+    {
+        run(times.box, times.boxFound, [&](const BoundingBox& box)
+        {
+            return box.min.x <= query.max.x && box.max.x >= query.min.x && box.min.y <= query.max.y && box.max.y >= query.min.y &&
+                   box.min.z <= query.max.z && box.max.z >= query.min.z;
+        });
+    }
+    return times;
+}
+
+
+// Print the times per query for the BVH and every box, returns false if the results differ
+bool Report(const std::string& title, const QueryTimes& bvhTimes, const QueryTimes& everyTimes, const Queries& queries,
+            const std::vector<std::vector<uint32_t>>& bvhResults, const std::vector<std::vector<uint32_t>>& everyResults)
+{
+    int numDifferent = 0;
+    for (size_t i = 0; i < bvhResults.size(); ++i)  numDifferent += (bvhResults[i] != everyResults[i]);
+
+    auto row = [&](const char* name, Clock::duration bvh, Clock::duration every, size_t found, size_t count)
+    {
+        double bvhUs   = Microseconds(bvh)   / count;
+        double everyUs = Microseconds(every) / count;
+        std::cout << std::left << std::setw(10) << name << std::right << std::setw(12) << bvhUs << std::setw(14) << everyUs
+                  << std::setw(10) << everyUs / bvhUs << "x" << std::setw(15) << static_cast<double>(found) / count << "\n";
+    };
+    std::cout << "\n" << title << "\n";
+    std::cout << "us per query     BVH     Every box  Speed-up  Found per query\n";
+    row("Frustum", bvhTimes.frustum, everyTimes.frustum, bvhTimes.frustumFound, queries.frustums.size());
+    row("Ray",     bvhTimes.ray,     everyTimes.ray,     bvhTimes.rayFound,     queries.rayOrigins.size());
+    row("Box",     bvhTimes.box,     everyTimes.box,     bvhTimes.boxFound,     queries.boxes.size());
+    if (numDifferent > 0)  std::cout << "Error: " << numDifferent << " queries found different boxes with the BVH\n";
+    return numDifferent == 0;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int numBoxes   = 100000;
+    int numQueries = 1000;
+    for (int arg = 1; arg + 1 < argc; arg += 2)
+    {
+        std::string argument = argv[arg];
+        if      (argument == "-boxes")    numBoxes   = std::max(1, std::stoi(argv[arg + 1]));
+        else if (argument == "-queries")  numQueries = std::max(1, std::stoi(argv[arg + 1]));
+    }
+
+
+    //-----------------------------------
+    // Boxes and queries
+    //-----------------------------------
+
+    // Boxes of 1 to 20 units across spread over a 2000 x 200 x 2000 area
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> randomXZ(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> randomY(-100.0f, 100.0f);
+    std::uniform_real_distribution<float> randomSize(0.5f, 10.0f);
+    std::vector<BoundingBox> boxes(numBoxes);
+    for (auto& box : boxes)
+    {
+        CVector3 centre = { randomXZ(random), randomY(random), randomXZ(random) };
+        CVector3 size   = { randomSize(random), randomSize(random), randomSize(random) };
+        box = { centre - size, centre + size };
+    }
+
+    // Cameras looking across the area from anywhere in it, rays in any direction and boxes of 20 to 200 units across
+    Queries queries;
+    std::uniform_real_distribution<float> randomAngle(-PI, PI);
+    std::uniform_real_distribution<float> randomPitch(-0.3f, 0.3f);
+    std::uniform_real_distribution<float> randomUnit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> randomQuerySize(10.0f, 100.0f);
+    for (int i = 0; i < numQueries; ++i)
+    {
+        queries.frustums.push_back(CameraFrustum({ randomXZ(random), randomY(random), randomXZ(random) }, { randomPitch(random), randomAngle(random), 0 }));
+
+        queries.rayOrigins.push_back({ randomXZ(random), randomY(random), randomXZ(random) });
+        CVector3 direction = { randomUnit(random), randomUnit(random) * 0.1f, randomUnit(random) };
+        queries.rayDirections.push_back(direction * (1.0f / Length(direction)));
+
+        CVector3 centre = { randomXZ(random), randomY(random), randomXZ(random) };
+        CVector3 size   = { randomQuerySize(random), randomQuerySize(random), randomQuerySize(random) };
+        queries.boxes.push_back({ centre - size, centre + size });
+    }
+
+
+    //-----------------------------------
+    // Build and query
+    //-----------------------------------
+
+    BVH bvh;
+    auto buildStart = Clock::now();
+    bvh.Build(boxes.data(), numBoxes);
+    double buildMs = Microseconds(Clock::now() - buildStart) / 1000.0;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << numBoxes << " boxes, " << numQueries << " queries of each kind\n";
+    std::cout << "Build:  " << buildMs << "ms, " << bvh.NumNodes() << " nodes, " << bvh.MemoryUsed() / 1024.0 << "KB\n";
+
+    std::vector<std::vector<uint32_t>> bvhResults, everyResults;
+    QueryTimes bvhTimes   = QueryBVH(bvh, queries, bvhResults);
+    QueryTimes everyTimes = QueryEveryBox(boxes, queries, everyResults);
+    bool same = Report("Built tree", bvhTimes, everyTimes, queries, bvhResults, everyResults);
+
+
+    //-----------------------------------
+    // Refit and query
+    //-----------------------------------
+
+    // Move every box up to 20 units
+    std::uniform_real_distribution<float> randomMove(-20.0f, 20.0f);
+    for (auto& box : boxes)
+    {
+        CVector3 move = { randomMove(random), randomMove(random) * 0.1f, randomMove(random) };
+        box = { box.min + move, box.max + move };
+    }
+
+    auto refitStart = Clock::now();
+    bvh.Refit(boxes.data());
+    double refitMs = Microseconds(Clock::now() - refitStart) / 1000.0;
+    std::cout << "\nRefit after moving every box up to 20 units: " << refitMs << "ms (" << buildMs / refitMs << "x faster than building)\n";
+
+    bvhTimes   = QueryBVH(bvh, queries, bvhResults);
+    everyTimes = QueryEveryBox(boxes, queries, everyResults);
+    same = Report("Refitted tree", bvhTimes, everyTimes, queries, bvhResults, everyResults) && same;
+
+    return same ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+//--------------------------------------------------------------------------------------
+// Scene globals for the command line tools that don't build Scene.cpp
+//--------------------------------------------------------------------------------------
+// Scene.cpp defines these for the app. Tools that use models or render queues without the scene itself list this file
+// in their project along with Tools/Common/ToolStubs.cpp. Tools that build Scene.cpp must not list it.
+
+#include "Common.h"
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+PerModelConstants gPerModelConstants;
+GpuBuffer*        gPerModelConstantBuffer = nullptr;
+
+// Used by Model::Control and Camera::Control, which the tools don't call
+const float ROTATION_SPEED = 2.0f;
+const float MOVEMENT_SPEED = 50.0f;
@@ -0,0 +1,40 @@
+//--------------------------------------------------------------------------------------
+// App globals and platform functions for the command line tools
+//--------------------------------------------------------------------------------------
+// The tools build parts of the app without Main.cpp and Direct3DSetup.cpp, which define these. Each tool lists this
+// file in its project (and in its build line) rather than defining them itself. Tools that use the app's code without
+// Scene.cpp also need Tools/Common/SceneStubs.cpp.
+
+#include "Common.h"
+
+#include <iostream>
+#include <string>
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+int gViewportWidth  = 1280;
+int gViewportHeight = 960;
+
+std::string gLastError;
+
+// The tools point these at a null renderer or leave them unused (see RendererNull.h)
+RenderDevice*  gRenderDevice  = nullptr;
+RenderContext* gRenderContext = nullptr;
+
+
+//--------------------------------------------------------------------------------------
+// Platform functions used by the app code (see Common.h)
+//--------------------------------------------------------------------------------------
+
+// There is no window, the title is ignored
+void SetWindowTitle(const std::string& /*title*/)
+{
+}
+
+void DebugMessage(const std::string& message)
+{
+    std::cout << message;
+}
@@ -0,0 +1,247 @@
+//--------------------------------------------------------------------------------------
+// Job system scaling benchmark
+//--------------------------------------------------------------------------------------
+// Command line tool that runs the app's scene code (Scene.cpp) on a large generated scene with the null renderer
+// (RendererNull.h), so no window or GPU is needed, and times it with the job system (JobSystem.h) using from one
+// thread up to all the CPU's cores. The scene has the app's models and cameras plus many more models at random
+// positions, and a tenth of the models are turned each frame so their world matrices and bounds need updating.
+//
+// Each frame is UpdateScene and RenderScene. The world matrix update, bounds update, culling and render queue filling
+// are jobs, sorting the queue and sending the draws to the renderer are done on the main thread, so the time does not
+// fall in proportion to the number of threads. The culling and draw counts must be the same for every thread count.
+//
+// Only uses standard C++ and assimp, so it also builds on Linux, e.g. from the repository folder:
+//   g++ -std=c++17 -O2 -I. -IUtility -IMath -o JobBench Tools/JobBench/JobBench.cpp Scene.cpp SceneFile.cpp
+//       SceneObjects.cpp Mesh.cpp MeshData.cpp MeshCache.cpp Model.cpp TransformStore.cpp BVH.cpp RenderQueue.cpp
+//       Camera.cpp Shader.cpp RendererNull.cpp Utility/Input.cpp Utility/FrameStats.cpp Utility/GraphicsHelpers.cpp
+//       Utility/MappedFile.cpp Utility/JobSystem.cpp RenderTargetPool.cpp AssetLoader.cpp Tools/Common/ToolStubs.cpp
+//       TextureCache.cpp MeshQuantization.cpp MeshClusters.cpp Math/*.cpp -lassimp -lpthread
+//
+// Run it from the folder holding the media files (the meshes are loaded and texture files read, shaders are not). The
+// scene is written to JobBench.scene and JobBench.scene.bin in the same folder and deleted afterwards.
+//
+// Usage: JobBench [-models <models>] [-frames <frames>] [-threads <threads>]
+//   -models <models>    Number of models added to the scene (default 100000)
+//   -frames <frames>    Number of frames to run for each thread count (default 30)
+//   -threads <threads>  Largest number of threads to test (default: number of CPU cores)
+//
+// Returns 0 on success, 1 if the scene failed to load, the counts differed between thread counts, or not all resources
+// were released.
+
+#include "Scene.h"
+#include "SceneObjects.h"
+#include "JobSystem.h"
+#include "RendererNull.h"
+#include "Input.h"
+#include "Common.h"
+#include "FrameStats.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cstdio>
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+// The app globals and platform functions are defined in Tools/Common/ToolStubs.cpp
+
+// The scene's objects, defined in Scene.cpp
+extern SceneObjects gScene;
+
+
+//--------------------------------------------------------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+double Milliseconds(Clock::duration time)
+{
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+
+// Returns the text of Scene.scene with the given number of extra models at random positions in front of the main camera
+std::string GenerateSceneText(const std::string& appScene, int numModels)
+{
+    std::ostringstream text;
+    text << appScene << "\n# Added by JobBench\n";
+
+    const char* meshes[]    = { "Teapot", "Cube", "Crate", "Sphere" };
+    const char* materials[] = { "Teapot", "Crate", "Ground", "Portal" };
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int>    randomIndex(0, 3);
+    std::uniform_real_distribution<float> randomPosition(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> randomAngle(0.0f, 360.0f);
+    text << std::fixed << std::setprecision(2);
+    for (int i = 0; i < numModels; ++i)
+    {
+        text << "model Extra" << i << " mesh=" << meshes[randomIndex(random)] << " material=" << materials[randomIndex(random)]
+             << " position=" << randomPosition(random) << "," << randomPosition(random) * 0.1f << "," << randomPosition(random)
+             << " rotation=0," << randomAngle(random) << ",0\n";
+    }
+    return text.str();
+}
+
+
+// Counts from one run of frames, which must not depend on the number of threads
+struct RunCounts
+{
+    int      drawn    = 0;
+    int      culled   = 0;
+    int      commands = 0;
+    uint64_t indices  = 0;
+
+    bool operator==(const RunCounts& other) const
+    {
+        return drawn == other.drawn && culled == other.culled && commands == other.commands && indices == other.indices;
+    }
+};
+
+
+int main(int argc, char* argv[])
+{
+    int numModels     = 100000;
+    int numFrames     = 30;
+    int maxThreads    = std::max(1u, std::thread::hardware_concurrency());
+    for (int arg = 1; arg + 1 < argc; arg += 2)
+    {
+        std::string argument = argv[arg];
+        if      (argument == "-models")   numModels  = std::max(0, std::stoi(argv[arg + 1]));
+        else if (argument == "-frames")   numFrames  = std::max(1, std::stoi(argv[arg + 1]));
+        else if (argument == "-threads")  maxThreads = std::max(1, std::stoi(argv[arg + 1]));
+    }
+
+    NullRenderDevice  device(gViewportWidth, gViewportHeight);
+    NullRenderContext context;
+    gRenderDevice  = &device;
+    gRenderContext = &context;
+
+    InitInput();
+
+
+    //-----------------------------------
+    // Write and load the scene
+    //-----------------------------------
+
+    std::string appScene;
+    {
+        std::ifstream file("Scene.scene", std::ios::in | std::ios::binary);
+        std::ostringstream content;
+        content << file.rdbuf();
+        appScene = content.str();
+    }
+    if (appScene.empty())
+    {
+        std::cout << "Error: Scene.scene not found, run from the folder holding the media files\n";
+        return 1;
+    }
+
+    gSceneFileName = "JobBench.scene";
+    {
+        std::ofstream file(gSceneFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+        file << GenerateSceneText(appScene, numModels);
+    }
+    auto cleanUp = [&]()
+    {
+        std::remove(gSceneFileName.c_str());
+        std::remove((gSceneFileName + ".bin").c_str());
+    };
+
+    if (!InitGeometry() || !InitScene() || !FinishLoading())
+    {
+        std::cout << "Error: " << gLastError << "\n";
+        ReleaseResources();
+        cleanUp();
+        return 1;
+    }
+    int totalModels = gScene.NumModels();
+
+
+    //-----------------------------------
+    // Frames with each thread count
+    //-----------------------------------
+
+    // 1, 2, 4... threads, then the largest
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < maxThreads; threads *= 2)  threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << totalModels << " models, " << numFrames << " frames per run, a tenth of the models turned each frame\n\n";
+    std::cout << "Threads  ms per frame  Speed-up  Drawn per frame\n";
+
+    std::mt19937 random(5678);
+    std::uniform_int_distribution<int> randomModel(0, std::max(totalModels - 1, 0));
+    double oneThreadMs = 0;
+    RunCounts firstCounts;
+    bool sameCounts = true;
+    for (int threads : threadCounts)
+    {
+        delete gJobSystem;
+        gJobSystem = new JobSystem(threads - 1);
+
+        // A frame first to settle the render queue's buffer sizes, not timed
+        UpdateScene(1.0f / 60.0f);
+        RenderScene();
+        context.ResetCounts();
+
+        RunCounts counts;
+        Clock::duration time = {};
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            // The same models are turned by the same amount in every run, so every run draws the same
+            std::mt19937 frameRandom(frame);
+            for (int i = 0; i < totalModels / 10; ++i)
+            {
+                Model& model = gScene.GetModel({ uint32_t(randomModel(frameRandom)) });
+                CVector3 rotation = model.Rotation();
+                rotation.y = (frame % 2 == 0) ? rotation.y + 0.1f : rotation.y - 0.1f;
+                model.SetRotation(rotation);
+            }
+
+            auto start = Clock::now();
+            UpdateScene(1.0f / 60.0f);
+            RenderScene();
+            time += Clock::now() - start;
+
+            counts.drawn  += gFrameStats.mainCameraCulling.drawn  + gFrameStats.portalCameraCulling.drawn;
+            counts.culled += gFrameStats.mainCameraCulling.culled + gFrameStats.portalCameraCulling.culled;
+        }
+        counts.commands = context.TotalCommands();
+        counts.indices  = context.IndicesDrawn();
+
+        double frameMs = Milliseconds(time) / numFrames;
+        if (threads == 1)
+        {
+            oneThreadMs = frameMs;
+            firstCounts = counts;
+        }
+        sameCounts = sameCounts && (counts == firstCounts);
+        std::cout << std::setw(7) << threads << std::setw(14) << frameMs << std::setw(9) << oneThreadMs / frameMs << "x"
+                  << std::setw(17) << counts.drawn / numFrames << "\n";
+    }
+    if (!sameCounts)  std::cout << "Error: the culling or draw counts differ between thread counts\n";
+
+
+    //-----------------------------------
+    // Release
+    //-----------------------------------
+
+    ReleaseResources();
+    cleanUp();
+    if (device.LiveResources() != 0)
+    {
+        std::cout << "Error: " << device.LiveResources() << " GPU resources not released\n";
+        return 1;
+    }
+
+    return sameCounts ? 0 : 1;
+}
@@ -0,0 +1,268 @@
+//--------------------------------------------------------------------------------------
+// Maths test and benchmark tool
+//--------------------------------------------------------------------------------------
+// Command line tool that checks the SIMD versions of the CMatrix4x4 functions against the plain C++
+// reference versions, then times both and reports nanoseconds per operation.
+// Matrix multiply is plain C++ (see CMatrix4x4.h). The hand-written SSE multiply it replaced is kept here so the two
+// can still be checked and timed against each other. operator*= is checked against MultiplyScalar as it has its own
+// code to multiply in place.
+//
+// Usage: MathBench [-count <matrices>] [-runs <runs>]
+//   -count <matrices>  Number of random matrices to test and time with (default 4096)
+//   -runs <runs>       Number of times to run through all the matrices when timing (default 200)
+//
+// Returns 0 if every SIMD result is within tolerance of the reference result, 1 otherwise.
+
+#include "CMatrix4x4.h"
+#include "CVector3.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cfloat>
+
+#ifdef CMATRIX4X4_SSE
+#include <immintrin.h>
+#endif
+
+// Keeps a function out of line, so it is called like the CMatrix4x4 functions it is timed against
+#ifdef _MSC_VER
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+
+// Sum of results is printed so the compiler can't remove the timed code
+float gChecksum = 0;
+
+
+// Returns a random affine matrix with a rotation, scale and translation like those used for models and cameras
+CMatrix4x4 RandomAffineMatrix(std::mt19937& random)
+{
+    std::uniform_real_distribution<float> angle(-PI, PI);
+    std::uniform_real_distribution<float> scale(0.1f, 10.0f);
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+
+    return MatrixScaling({ scale(random), scale(random), scale(random) }) * MatrixRotationZ(angle(random)) *
+           MatrixRotationX(angle(random)) * MatrixRotationY(angle(random)) *
+           MatrixTranslation({ position(random), position(random), position(random) });
+}
+
+
+// Returns the condition number of the rotation and scale part of an affine matrix (largest axis scale over the
+// smallest). Rounding errors in the results of a matrix can grow by up to this much
+float Condition(const CMatrix4x4& m)
+{
+    CVector3 scale = m.GetScale();
+    return std::max(scale.x, std::max(scale.y, scale.z)) / std::min(scale.x, std::min(scale.y, scale.z));
+}
+
+
+// Compare two sets of floats, a matrix or vector, tracking the largest difference and whether all the values are
+// bit-for-bit identical. Each difference is relative to the largest value in its row (or in the vector): a value that
+// comes out small after larger values cancel can't be more accurate than the values it came from. The difference is
+// also divided by the given condition number of the matrices used (see Condition), so the error is in units that a
+// few float roundings (FLT_EPSILON each) should stay within
+struct Comparison
+{
+    float maxError  = 0;
+    bool  identical = true;
+
+    void Compare(const float* simd, const float* reference, int count, int rowSize, float condition)
+    {
+        for (int row = 0; row < count; row += rowSize)
+        {
+            float rowScale = 1.0f;
+            for (int i = row; i < row + rowSize; ++i)  rowScale = std::max(rowScale, std::abs(reference[i]));
+            for (int i = row; i < row + rowSize; ++i)
+            {
+                float error = std::abs(simd[i] - reference[i]) / rowScale / condition;
+                maxError = std::max(maxError, error);
+            }
+        }
+        if (std::memcmp(simd, reference, count * sizeof(float)) != 0)  identical = false;
+    }
+
+    // Prints the result, returns true if within the given tolerance
+    bool Report(const std::string& name, float tolerance)
+    {
+        bool pass = maxError <= tolerance;
+        std::cout << std::left << std::setw(18) << name << (pass ? "pass" : "FAIL") << "  max error "
+                  << std::scientific << std::setprecision(2) << maxError / FLT_EPSILON << " ulps x condition"
+                  << (identical ? " (bit-exact)\n" : "\n");
+        return pass;
+    }
+};
+
+
+#ifdef CMATRIX4X4_SSE
+// The hand-written SSE matrix multiply that operator* used to use. Each row of the result is the matching row of m1
+// used as weights to combine the rows of m2, which are kept in registers
+NOINLINE CMatrix4x4 MultiplySIMD(const CMatrix4x4& m1, const CMatrix4x4& m2)
+{
+    const float* a = &m1.e00;
+    const float* b = &m2.e00;
+    CMatrix4x4 mOut;
+    float* out = &mOut.e00;
+
+    __m128 b0 = _mm_loadu_ps(b + 0);
+    __m128 b1 = _mm_loadu_ps(b + 4);
+    __m128 b2 = _mm_loadu_ps(b + 8);
+    __m128 b3 = _mm_loadu_ps(b + 12);
+    for (int row = 0; row < 4; ++row)
+    {
+        __m128 aRow = _mm_loadu_ps(a + row * 4);
+        __m128 result =                   _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, 0x00), b0);
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, 0x55), b1));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, 0xAA), b2));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(aRow, aRow, 0xFF), b3));
+        _mm_storeu_ps(out + row * 4, result);
+    }
+    return mOut;
+}
+#endif
+
+
+// Returns the average time in nanoseconds for each call of the given function, which is called for each
+// matrix the given number of times
+template <class F>
+double TimeNs(size_t count, int runs, F function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int run = 0; run < runs; ++run)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            function(i);
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / (static_cast<double>(count) * runs);
+}
+
+
+int main(int argc, char* argv[])
+{
+    size_t count = 4096;
+    int    runs  = 200;
+    for (int arg = 1; arg + 1 < argc; arg += 2)
+    {
+        std::string argument = argv[arg];
+        if      (argument == "-count")  count = std::max(2, std::stoi(argv[arg + 1]));
+        else if (argument == "-runs")   runs  = std::max(1, std::stoi(argv[arg + 1]));
+    }
+
+#if defined(CMATRIX4X4_SSE)
+    std::cout << "CMatrix4x4 using SSE\n\n";
+#else
+    std::cout << "CMatrix4x4 using plain C++ only - SIMD results below are the scalar code\n\n";
+#endif
+
+    std::mt19937 random(2409);
+    std::uniform_real_distribution<float> coordinate(-100.0f, 100.0f);
+    std::vector<CMatrix4x4> matrices(count);
+    std::vector<CVector3>   points(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        matrices[i] = RandomAffineMatrix(random);
+        points[i]   = { coordinate(random), coordinate(random), coordinate(random) };
+    }
+
+
+    //-----------------------------------
+    // Accuracy
+    //-----------------------------------
+    // The SIMD code does the same operations in the same order as the scalar code, so results are usually identical.
+    // Compilers may fuse multiply-adds in one version and not the other (e.g. g++ with -mfma), which changes the
+    // rounding. Allow one rounding for each operation in the longest chain used for a result - InverseAffine's
+    // translation takes a cross product, the determinant, the multiply by its reciprocal and a dot product, about 8 -
+    // scaled by the condition of the matrices used as the errors in an inverse or product can grow by that much
+
+    Comparison multiplySIMD, multiplyAssign, inverse, transformPoint, transformVector;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const CMatrix4x4& m1 = matrices[i];
+        const CMatrix4x4& m2 = matrices[(i + 1) % count];
+        float condition  = Condition(m1);
+        float condition2 = condition * Condition(m2);
+
+        CMatrix4x4 reference = MultiplyScalar(m1, m2);
+#ifdef CMATRIX4X4_SSE
+        CMatrix4x4 product = MultiplySIMD(m1, m2);
+        multiplySIMD.Compare(&product.e00, &reference.e00, 16, 4, condition2);
+#endif
+
+        CMatrix4x4 assigned = m1;
+        assigned *= m2;
+        multiplyAssign.Compare(&assigned.e00, &reference.e00, 16, 4, condition2);
+
+        reference = InverseAffineScalar(m1);
+        CMatrix4x4 inverted = InverseAffine(m1);
+        inverse.Compare(&inverted.e00, &reference.e00, 16, 4, condition);
+
+        CVector3 referencePoint = TransformPointScalar(m1, points[i]);
+        CVector3 point = TransformPoint(m1, points[i]);
+        transformPoint.Compare(&point.x, &referencePoint.x, 3, 3, condition);
+
+        CVector3 referenceVector = TransformVectorScalar(m1, points[i]);
+        CVector3 vector = TransformVector(m1, points[i]);
+        transformVector.Compare(&vector.x, &referenceVector.x, 3, 3, condition);
+    }
+
+    const float tolerance = 8 * FLT_EPSILON;
+    bool pass = true;
+#ifdef CMATRIX4X4_SSE
+    pass &= multiplySIMD.Report("multiply SIMD", tolerance);
+#endif
+    pass &= multiplyAssign.Report("operator*=", tolerance);
+    pass &= inverse.Report("InverseAffine", tolerance);
+    pass &= transformPoint.Report("TransformPoint", tolerance);
+    pass &= transformVector.Report("TransformVector", tolerance);
+
+
+    //-----------------------------------
+    // Timing
+    //-----------------------------------
+
+    std::vector<CMatrix4x4> results(count);
+    auto report = [&](const std::string& name, double scalarNs, double simdNs)
+    {
+        std::cout << std::left << std::setw(18) << name << std::fixed << std::setprecision(2) << "scalar " << scalarNs
+                  << "ns, SIMD " << simdNs << "ns (" << scalarNs / simdNs << "x)\n";
+    };
+
+    std::cout << "\nTiming " << count << " matrices x " << runs << " runs\n";
+
+    // operator* is the plain C++ multiply, so it is timed against the hand-written SSE version above
+    double scalarNs = TimeNs(count, runs, [&](size_t i) { results[i] = matrices[i] * matrices[(i + 1) % count]; });
+    double simdNs   = 0;
+    gChecksum += results[count / 2].e00;
+#ifdef CMATRIX4X4_SSE
+    simdNs   = TimeNs(count, runs, [&](size_t i) { results[i] = MultiplySIMD(matrices[i], matrices[(i + 1) % count]); });
+    gChecksum += results[count / 2].e00;
+    report("operator*", scalarNs, simdNs);
+#else
+    std::cout << std::left << std::setw(18) << "operator*" << std::fixed << std::setprecision(2) << "scalar " << scalarNs << "ns\n";
+#endif
+
+    scalarNs = TimeNs(count, runs, [&](size_t i) { results[i] = InverseAffineScalar(matrices[i]); });
+    simdNs   = TimeNs(count, runs, [&](size_t i) { results[i] = InverseAffine(matrices[i]); });
+    gChecksum += results[count / 2].e00;
+    report("InverseAffine", scalarNs, simdNs);
+
+    std::vector<CVector3> transformed(count);
+    scalarNs = TimeNs(count, runs, [&](size_t i) { transformed[i] = TransformPointScalar(matrices[i], points[i]); });
+    simdNs   = TimeNs(count, runs, [&](size_t i) { transformed[i] = TransformPoint(matrices[i], points[i]); });
+    gChecksum += transformed[count / 2].x;
+    report("TransformPoint", scalarNs, simdNs);
+
+    std::cout << "(checksum " << gChecksum << ")\n";
+
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,312 @@
+//--------------------------------------------------------------------------------------
+// Mesh converter tool
+//--------------------------------------------------------------------------------------
+// Command line tool that imports mesh files with assimp and writes the binary mesh cache files
+// used by the Mesh class (see MeshCache.h), so the app never needs to run assimp at start-up.
+//
+// Usage: MeshConverter [-tangents] [-bench <runs>] [-quantize] [-clusters <size>] [-synthetic <parts>]
+//                      <mesh file> [<mesh file> ...]
+//   -tangents          Import with tangents (must match the requireTangents setting used by the app)
+//   -bench <runs>      Also time loading each mesh through assimp and through the cache, averaged over <runs>
+//   -quantize          Also quantize each mesh (see MeshQuantization.h) and report the memory saved and the largest
+//                      error in each vertex element after unpacking
+//   -clusters <size>   Also split each mesh into clusters using at most <size> vertices (see MeshClusters.h, 65536
+//                      for 16-bit indices), check them against the original and report the index memory saved
+//   -synthetic <parts> Write a test mesh (Synthetic<parts>.obj) made of <parts> cubes, each with its own
+//                      material, and convert it along with any other files given
+
+#include "MeshData.h"
+#include "MeshCache.h"
+#include "MeshQuantization.h"
+#include "MeshClusters.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+// Returns the average time in milliseconds taken by the given function over a number of runs
+template <class F>
+double AverageTimeMs(int runs, F function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int run = 0; run < runs; ++run)
+    {
+        function();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / runs;
+}
+
+
+// Write an OBJ file (plus its material library) containing a row of cubes, each using a different material,
+// so assimp imports one sub-mesh per cube. Returns the name of the OBJ file
+std::string WriteSyntheticMesh(int parts)
+{
+    std::string baseName = "Synthetic" + std::to_string(parts);
+    std::ofstream obj(baseName + ".obj");
+    std::ofstream mtl(baseName + ".mtl");
+    if (!obj.is_open() || !mtl.is_open())  throw std::runtime_error("Cannot write " + baseName + ".obj");
+
+    obj << "mtllib " << baseName << ".mtl\n";
+    for (int part = 0; part < parts; ++part)
+    {
+        // Each material needs a different colour or assimp will merge them (aiProcess_RemoveRedundantMaterials)
+        mtl << "newmtl Material" << part << "\nKd " << (part % 16) / 15.0f << " " << (part / 16 % 16) / 15.0f << " "
+            << (part / 256) / 15.0f << "\n";
+
+        float x = part * 3.0f;
+        for (int corner = 0; corner < 8; ++corner)
+        {
+            obj << "v " << x + (corner & 1 ? 1 : -1) << " " << (corner & 2 ? 1 : -1) << " " << (corner & 4 ? 1 : -1) << "\n";
+        }
+
+        int v = part * 8 + 1; // OBJ indices start at 1
+        obj << "g Part" << part << "\nusemtl Material" << part << "\n";
+        obj << "f " << v+0 << " " << v+2 << " " << v+3 << " " << v+1 << "\n"; // -z
+        obj << "f " << v+4 << " " << v+5 << " " << v+7 << " " << v+6 << "\n"; // +z
+        obj << "f " << v+0 << " " << v+1 << " " << v+5 << " " << v+4 << "\n"; // -y
+        obj << "f " << v+2 << " " << v+6 << " " << v+7 << " " << v+3 << "\n"; // +y
+        obj << "f " << v+0 << " " << v+4 << " " << v+6 << " " << v+2 << "\n"; // -x
+        obj << "f " << v+1 << " " << v+3 << " " << v+7 << " " << v+5 << "\n"; // +x
+    }
+    return baseName + ".obj";
+}
+
+
+// Print the sub-mesh table of a mesh, then compare the buffers and binds used by the shared buffers against giving
+// each sub-mesh its own vertex and index buffer. The sizes are the bytes of vertex and index data, any padding the
+// driver adds to each buffer isn't known here
+void ReportSubMeshes(const MeshData& meshData)
+{
+    size_t numSubMeshes = meshData.subMeshes.size();
+    for (size_t subMesh = 0; subMesh < numSubMeshes; ++subMesh)
+    {
+        auto& part = meshData.subMeshes[subMesh];
+        std::cout << "    sub-mesh " << subMesh << ": material " << part.materialIndex << ", " << part.indexCount / 3
+                  << " triangles, index offset " << part.indexOffset << ", base vertex " << part.baseVertex << "\n";
+    }
+
+    // Separate buffers would hold the same data split up, so the bytes are the same. What changes is the number of
+    // buffers to create and that every sub-mesh draw needs its own vertex and index buffer binds
+    size_t indexSize   = Fits16BitIndices(meshData) ? sizeof(uint16_t) : sizeof(uint32_t);
+    size_t vertexBytes = static_cast<size_t>(meshData.numVertices) * meshData.vertexSize;
+    size_t indexBytes  = static_cast<size_t>(meshData.numIndices) * indexSize;
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "    " << numSubMeshes << " sub-meshes, " << numSubMeshes << " draw calls, " << vertexBytes / 1024.0
+              << "KB vertices + " << indexBytes / 1024.0 << "KB indices. Shared buffers: 2 buffers, 2 binds. Separate buffers: "
+              << numSubMeshes * 2 << " buffers, " << numSubMeshes * 2 << " binds\n";
+}
+
+
+// Quantize a mesh and compare the unpacked vertices with the originals, printing the largest error of each vertex
+// element and the memory saved. Positions are measured as a distance, normals and tangents as an angle
+void ReportQuantization(const MeshData& meshData)
+{
+    MeshData quantized = QuantizeMeshData(meshData);
+
+    for (size_t elt = 0; elt < meshData.vertexElements.size(); ++elt)
+    {
+        const VertexElement& element = meshData.vertexElements[elt];
+        bool   isDirection = (element.semantic == VertexSemantic::Normal || element.semantic == VertexSemantic::Tangent);
+        double maxError = 0;
+        for (unsigned int vertex = 0; vertex < meshData.numVertices; ++vertex)
+        {
+            CVector3 original = ReadVertexElement(meshData, element, vertex);
+            CVector3 unpacked = ReadVertexElement(quantized, quantized.vertexElements[elt], vertex);
+            double error;
+            if (isDirection)
+            {
+                // Angle between the two, atan2 stays accurate for tiny angles where acos doesn't
+                if (Length(original) <= 0)  continue;
+                original = Normalise(original);
+                error = std::atan2(Length(Cross(original, unpacked)), Dot(original, unpacked)) * 180.0 / 3.14159265358979;
+            }
+            else
+            {
+                error = Length(unpacked - original);
+            }
+            maxError = std::max(maxError, error);
+        }
+
+        std::cout << std::setprecision(3) << std::defaultfloat;
+        switch (element.semantic)
+        {
+            case VertexSemantic::Position:
+                std::cout << "    position: max error " << maxError << " ("
+                          << maxError / Length(meshData.boundsMax - meshData.boundsMin) * 100 << "% of the bounding box diagonal)\n";
+                break;
+            case VertexSemantic::Normal:   std::cout << "    normal:   max error " << maxError << " degrees\n";  break;
+            case VertexSemantic::Tangent:  std::cout << "    tangent:  max error " << maxError << " degrees\n";  break;
+            case VertexSemantic::UV:
+                std::cout << "    uv:       max error " << maxError << " (" << maxError * 1024 << " texels of a 1024 texture)\n";
+                break;
+        }
+    }
+
+    size_t vertexBytes    = static_cast<size_t>(meshData.numVertices) * meshData.vertexSize;
+    size_t quantizedBytes = static_cast<size_t>(quantized.numVertices) * quantized.vertexSize;
+    std::cout << std::fixed << std::setprecision(1)
+              << "    quantized: " << meshData.vertexSize << " -> " << quantized.vertexSize << " bytes per vertex, vertex buffer "
+              << vertexBytes / 1024.0 << "KB -> " << quantizedBytes / 1024.0 << "KB ("
+              << 100.0 - 100.0 * quantizedBytes / vertexBytes << "% smaller)\n";
+}
+
+
+// Index buffer bytes of all the meshes converted
+struct IndexMemoryTotals
+{
+    size_t bytes32 = 0; // With 32-bit indices
+    size_t loaded  = 0; // As the Mesh class loads them, 16-bit indices when the mesh allows
+    size_t split   = 0; // Split into clusters first
+};
+
+// Split a mesh into clusters of at most the given number of vertices and check every triangle still uses the same
+// vertex data, then print the clusters made, the vertices copied into more than one cluster and the index memory of
+// the original and split meshes, adding it to the given totals
+void ReportClusters(const MeshData& meshData, uint32_t maxVertices, IndexMemoryTotals& totals)
+{
+    MeshData split = SplitMeshClusters(meshData, maxVertices);
+
+    // The split mesh has the same triangles in the same order, so compare the vertex each index refers to in both
+    auto vertexData = [](const MeshData& mesh, const SubMesh& part, uint32_t index)
+    {
+        return mesh.vertices + static_cast<size_t>(part.baseVertex + mesh.indices[part.indexOffset + index]) * mesh.vertexSize;
+    };
+    if (split.numIndices != meshData.numIndices)  throw std::runtime_error("Clusters don't have the same triangles");
+    size_t   cluster = 0;
+    uint32_t clusterIndex = 0;
+    for (auto& subMesh : meshData.subMeshes)
+    {
+        for (uint32_t index = 0; index < subMesh.indexCount; ++index)
+        {
+            while (clusterIndex == split.subMeshes[cluster].indexCount)  { ++cluster;  clusterIndex = 0; }
+            const SubMesh& part = split.subMeshes[cluster];
+            if (part.materialIndex != subMesh.materialIndex ||
+                std::memcmp(vertexData(meshData, subMesh, index), vertexData(split, part, clusterIndex++), meshData.vertexSize) != 0)
+            {
+                throw std::runtime_error("Cluster " + std::to_string(cluster) + " doesn't match the original mesh");
+            }
+        }
+    }
+
+    size_t bytes32       = meshData.numIndices * sizeof(uint32_t);
+    size_t originalBytes = Fits16BitIndices(meshData) ? meshData.numIndices * sizeof(uint16_t) : bytes32;
+    size_t splitBytes    = Fits16BitIndices(split)    ? split.numIndices    * sizeof(uint16_t) : bytes32;
+    std::cout << std::fixed << std::setprecision(1)
+              << "    clusters of " << maxVertices << " vertices: " << meshData.subMeshes.size() << " -> " << split.subMeshes.size()
+              << " sub-meshes, " << split.numVertices - meshData.numVertices << " vertices copied ("
+              << 100.0 * (split.numVertices - meshData.numVertices) / meshData.numVertices << "%), all triangles match\n"
+              << "    index buffer: 32-bit " << bytes32 / 1024.0 << "KB, as loaded " << originalBytes / 1024.0 << "KB ("
+              << (originalBytes < bytes32 ? "16" : "32") << "-bit), split " << splitBytes / 1024.0 << "KB ("
+              << (splitBytes < bytes32 ? "16" : "32") << "-bit)\n";
+
+    totals.bytes32 += bytes32;
+    totals.loaded  += originalBytes;
+    totals.split   += splitBytes;
+}
+
+
+int main(int argc, char* argv[])
+{
+    bool requireTangents = false;
+    bool quantize = false;
+    uint32_t clusterVertices = 0;
+    int  benchmarkRuns = 0;
+    std::vector<std::string> fileNames;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        std::string argument = argv[arg];
+        if (argument == "-tangents")
+        {
+            requireTangents = true;
+        }
+        else if (argument == "-bench" && arg + 1 < argc)
+        {
+            benchmarkRuns = std::max(1, std::stoi(argv[++arg]));
+        }
+        else if (argument == "-quantize")
+        {
+            quantize = true;
+        }
+        else if (argument == "-clusters" && arg + 1 < argc)
+        {
+            clusterVertices = static_cast<uint32_t>(std::max(3, std::stoi(argv[++arg])));
+        }
+        else if (argument == "-synthetic" && arg + 1 < argc)
+        {
+            fileNames.push_back(WriteSyntheticMesh(std::max(1, std::stoi(argv[++arg]))));
+        }
+        else
+        {
+            fileNames.push_back(argument);
+        }
+    }
+
+    if (fileNames.empty())
+    {
+        std::cout << "Usage: MeshConverter [-tangents] [-bench <runs>] [-quantize] [-clusters <size>] [-synthetic <parts>]\n"
+                     "                     <mesh file> [<mesh file> ...]\n";
+        return 1;
+    }
+
+
+    int failures = 0;
+    IndexMemoryTotals indexTotals;
+    for (auto& fileName : fileNames)
+    {
+        try
+        {
+            // Always import and rewrite the cache, the tool is used to refresh cache files
+            uint64_t     sourceHash    = HashFileContent(fileName);
+            unsigned int importFlags   = MeshImportFlags(requireTangents);
+            std::string  cacheFileName = MeshCacheFileName(fileName, requireTangents);
+
+            MeshData meshData = ImportMeshData(fileName, requireTangents);
+            if (!SaveMeshCache(cacheFileName, sourceHash, importFlags, requireTangents, meshData))
+            {
+                throw std::runtime_error("Cannot write " + cacheFileName);
+            }
+
+            std::cout << fileName << " -> " << cacheFileName << ": " << meshData.numVertices << " vertices, "
+                      << meshData.numIndices / 3 << " triangles, " << meshData.vertexSize << " bytes per vertex\n";
+            ReportSubMeshes(meshData);
+            if (quantize)  ReportQuantization(meshData);
+            if (clusterVertices > 0)  ReportClusters(meshData, clusterVertices, indexTotals);
+
+            if (benchmarkRuns > 0)
+            {
+                double assimpMs = AverageTimeMs(benchmarkRuns, [&]() { ImportMeshData(fileName, requireTangents); });
+                double cacheMs  = AverageTimeMs(benchmarkRuns, [&]() { LoadMeshData(fileName, requireTangents); });
+
+                std::cout << std::fixed << std::setprecision(3)
+                          << "    assimp import: " << assimpMs << "ms, cached load: " << cacheMs << "ms ("
+                          << std::setprecision(1) << assimpMs / cacheMs << "x faster)\n";
+            }
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cout << "Error: " << e.what() << "\n";
+            ++failures;
+        }
+    }
+
+    if (clusterVertices > 0 && indexTotals.bytes32 > 0)
+    {
+        std::cout << std::fixed << std::setprecision(1) << "Index buffers of all meshes: " << indexTotals.bytes32 / 1024.0
+                  << "KB with 32-bit indices, " << indexTotals.loaded / 1024.0 << "KB as loaded ("
+                  << (indexTotals.bytes32 - indexTotals.loaded) / 1024.0 << "KB saved), " << indexTotals.split / 1024.0
+                  << "KB split into clusters (" << (indexTotals.bytes32 - indexTotals.split) / 1024.0 << "KB saved)\n";
+    }
+
+    return failures == 0 ? 0 : 1;
+}
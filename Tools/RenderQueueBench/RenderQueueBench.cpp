@@ -0,0 +1,334 @@
+//--------------------------------------------------------------------------------------
+// Render queue benchmark
+//--------------------------------------------------------------------------------------
+// Command line tool that submits many models to the render queue (RenderQueue.h) each frame and draws them with
+// the null renderer (RendererNull.h), so no window or GPU is needed. The models use random meshes and materials
+// and are submitted in a random order. Each frame is run three times: drawn in submission order, sorted, and sorted
+// on a renderer without constant buffer ranges (like Direct3D 11.0, where each model's constants need their own
+// buffer map). The time taken to submit, sort and draw is reported along with the state changes and buffer maps
+// needed each frame.
+// A second test draws many copies of one mesh with one material, first one model at a time then instanced, and
+// reports the draw calls, buffer maps and time needed for each.
+//
+// Only uses standard C++ and assimp, so it also builds on Linux, e.g. from the repository folder:
+//   g++ -std=c++17 -O2 -I. -IUtility -IMath -o RenderQueueBench Tools/RenderQueueBench/RenderQueueBench.cpp
+//       RenderQueue.cpp Mesh.cpp MeshData.cpp MeshCache.cpp Model.cpp TransformStore.cpp RendererNull.cpp Utility/Input.cpp
+//       Utility/FrameStats.cpp Utility/GraphicsHelpers.cpp Utility/MappedFile.cpp Utility/JobSystem.cpp Math/*.cpp
+//       MeshQuantization.cpp MeshClusters.cpp Tools/Common/ToolStubs.cpp Tools/Common/SceneStubs.cpp -lassimp -lpthread
+//
+// Run it from the folder holding the media files (the meshes are loaded, textures and shaders are not).
+//
+// Usage: RenderQueueBench [-draws <draws>] [-instances <instances>] [-frames <frames>]
+//   -draws <draws>          Number of models submitted each frame (default 10000)
+//   -instances <instances>  Number of copies of one mesh submitted each frame in the instancing test (default 1000)
+//   -frames <frames>        Number of frames to run (default 100)
+//
+// Returns 0 on success, 1 if the meshes failed to load, the sorted frames needed more state changes than the
+// unsorted ones, constant buffer ranges or instancing did not reduce the buffer maps or draw calls, or not all
+// resources were released.
+
+#include "RenderQueue.h"
+#include "RendererNull.h"
+#include "Model.h"
+#include "Mesh.h"
+#include "Common.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <initializer_list>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <stdexcept>
+
+
+//--------------------------------------------------------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+double Microseconds(Clock::duration time)
+{
+    return std::chrono::duration<double, std::micro>(time).count();
+}
+
+
+// Totals over all frames for one way of drawing (sorted or unsorted)
+struct RunTotals
+{
+    Clock::duration  submitTime = {}, sortTime = {}, executeTime = {};
+    RenderQueueStats changes;
+    int              commands = 0;
+    int              bufferMaps = 0;
+};
+
+
+// Number of buffer maps (Map/Unmap in Direct3D) made since the counts were last reset
+int BufferMaps(NullRenderContext& context)
+{
+    return context.CommandCount(RenderCommandType::UpdateBuffer) + context.CommandCount(RenderCommandType::UpdateBufferRange);
+}
+
+
+int main(int argc, char* argv[])
+{
+    int numDraws     = 10000;
+    int numInstances = 1000;
+    int numFrames    = 100;
+    for (int arg = 1; arg + 1 < argc; arg += 2)
+    {
+        std::string argument = argv[arg];
+        if      (argument == "-draws")      numDraws     = std::max(1, std::stoi(argv[arg + 1]));
+        else if (argument == "-instances")  numInstances = std::max(1, std::stoi(argv[arg + 1]));
+        else if (argument == "-frames")     numFrames    = std::max(1, std::stoi(argv[arg + 1]));
+    }
+
+    NullRenderDevice  device(gViewportWidth, gViewportHeight);
+    NullRenderContext context;
+    gRenderDevice  = &device;
+    gRenderContext = &context;
+
+
+    //-----------------------------------
+    // Setup
+    //-----------------------------------
+
+    // The scene's meshes
+    std::vector<std::unique_ptr<Mesh>> meshes;
+    try
+    {
+        for (auto& fileName : { "Teapot.x", "Cube.x", "CargoContainer.x", "Sphere.x", "Hills.x", "Light.x", "Portal.x" })
+        {
+            meshes.push_back(std::make_unique<Mesh>(fileName));
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        std::cout << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    gPerModelConstantBuffer = device.CreateBuffer(BufferType::Constant, sizeof(gPerModelConstants), nullptr);
+
+    // Shaders and textures - the null renderer doesn't read the files so the names are only labels
+    const int NUM_SHADERS = 4, NUM_TEXTURES = 8;
+    std::vector<GpuVertexShader*> vertexShaders;
+    std::vector<GpuPixelShader*>  pixelShaders;
+    std::vector<GpuTexture*>      textures;
+    for (int i = 0; i < NUM_SHADERS; ++i)
+    {
+        vertexShaders.push_back(device.LoadVertexShader("VertexShader" + std::to_string(i)));
+        pixelShaders .push_back(device.LoadPixelShader ("PixelShader"  + std::to_string(i)));
+    }
+    for (int i = 0; i < NUM_TEXTURES; ++i)  textures.push_back(device.LoadTexture("Texture" + std::to_string(i)));
+
+    // A material for each shader and texture pair, plus a few additive ones like the scene's lights
+    RenderQueue queue;
+    std::vector<int> materials;
+    for (int shader = 0; shader < NUM_SHADERS; ++shader)
+    {
+        for (int texture = 0; texture < NUM_TEXTURES; ++texture)
+        {
+            RenderMaterial material;
+            material.vertexShader = vertexShaders[shader];
+            material.pixelShader  = pixelShaders[shader];
+            material.textures[0]  = textures[texture];
+            if (shader == NUM_SHADERS - 1 && texture < 2)
+            {
+                material.blendMode = BlendMode::Additive;
+                material.depthMode = DepthMode::ReadOnly;
+                material.cullMode  = CullMode::None;
+            }
+            materials.push_back(queue.AddMaterial(material));
+        }
+    }
+
+    // Models with random meshes, materials and positions. They are submitted in the order created
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<size_t> randomMesh(0, meshes.size() - 1);
+    std::uniform_int_distribution<size_t> randomMaterial(0, materials.size() - 1);
+    std::uniform_real_distribution<float> randomPosition(-500.0f, 500.0f);
+    TransformStore transforms;
+    std::vector<Model> models;
+    std::vector<int> modelMaterials;
+    for (int i = 0; i < numDraws; ++i)
+    {
+        CVector3 position = { randomPosition(random), randomPosition(random), randomPosition(random) };
+        models.emplace_back(meshes[randomMesh(random)].get(), transforms, transforms.Add(position));
+        modelMaterials.push_back(materials[randomMaterial(random)]);
+    }
+    transforms.UpdateWorldMatrices(); // The queue reads the world matrices without rebuilding them
+    const CVector3 cameraPosition = { 0, 0, -600 };
+    const float    maxDistance    = 2000.0f;
+
+
+    //-----------------------------------
+    // Frames
+    //-----------------------------------
+
+    const int NUM_RUNS = 3;
+    RunTotals runs[NUM_RUNS]; // Unsorted, sorted, then sorted without constant buffer ranges
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        for (int runIndex = 0; runIndex < NUM_RUNS; ++runIndex)
+        {
+            RunTotals& run = runs[runIndex];
+            bool sorted = (runIndex > 0);
+            context.SetConstantBufferRangeSupport(runIndex != 2);
+            context.ResetCounts();
+
+            auto start = Clock::now();
+            queue.Begin(maxDistance);
+            for (int i = 0; i < numDraws; ++i)
+            {
+                queue.Submit(&models[i], modelMaterials[i], Length(models[i].Position() - cameraPosition));
+            }
+            auto submitted = Clock::now();
+            if (sorted)  queue.Sort();
+            auto sortDone = Clock::now();
+            const RenderQueueStats& stats = queue.Execute(context);
+            auto executed = Clock::now();
+
+            run.submitTime  += submitted - start;
+            run.sortTime    += sortDone - submitted;
+            run.executeTime += executed - sortDone;
+            run.changes.draws          += stats.draws;
+            run.changes.shaderChanges  += stats.shaderChanges;
+            run.changes.textureChanges += stats.textureChanges;
+            run.changes.stateChanges   += stats.stateChanges;
+            run.changes.meshChanges    += stats.meshChanges;
+            run.commands               += context.TotalCommands();
+            run.bufferMaps             += BufferMaps(context);
+        }
+    }
+    context.SetConstantBufferRangeSupport(true);
+
+
+    //-----------------------------------
+    // Report
+    //-----------------------------------
+
+    auto perFrame = [&](double total) { return total / numFrames; };
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << numDraws << " draws per frame, " << materials.size() << " materials, " << meshes.size() << " meshes, "
+              << numFrames << " frames\n\n";
+    std::cout << "                    Unsorted      Sorted  Sorted 11.0\n";
+    auto row = [&](const char* label, std::initializer_list<double> values)
+    {
+        std::cout << std::left << std::setw(16) << label << std::right;
+        for (double value : values)  std::cout << std::setw(12) << value;
+        std::cout << "\n";
+    };
+    auto runRow = [&](const char* label, double (*value)(const RunTotals&))
+    {
+        row(label, { perFrame(value(runs[0])), perFrame(value(runs[1])), perFrame(value(runs[2])) });
+    };
+    runRow("Submit (us)",     [](const RunTotals& run) { return Microseconds(run.submitTime);  });
+    runRow("Sort (us)",       [](const RunTotals& run) { return Microseconds(run.sortTime);    });
+    runRow("Execute (us)",    [](const RunTotals& run) { return Microseconds(run.executeTime); });
+    runRow("Shader changes",  [](const RunTotals& run) { return double(run.changes.shaderChanges);  });
+    runRow("Texture changes", [](const RunTotals& run) { return double(run.changes.textureChanges); });
+    runRow("State changes",   [](const RunTotals& run) { return double(run.changes.stateChanges);   });
+    runRow("Mesh changes",    [](const RunTotals& run) { return double(run.changes.meshChanges);    });
+    runRow("Buffer maps",     [](const RunTotals& run) { return double(run.bufferMaps); });
+    runRow("Commands",        [](const RunTotals& run) { return double(run.commands);   });
+
+    bool fewerChanges = runs[1].changes.shaderChanges  <= runs[0].changes.shaderChanges  &&
+                        runs[1].changes.textureChanges <= runs[0].changes.textureChanges &&
+                        runs[1].changes.stateChanges   <= runs[0].changes.stateChanges;
+    if (!fewerChanges)  std::cout << "Error: sorting did not reduce state changes\n";
+
+    // With constant buffer ranges all the models' constants are sent with one map
+    bool fewerMaps = runs[1].bufferMaps < runs[2].bufferMaps || numDraws == 1;
+    if (!fewerMaps)  std::cout << "Error: constant buffer ranges did not reduce buffer maps\n";
+
+
+    //-----------------------------------
+    // Instancing
+    //-----------------------------------
+
+    // Copies of the light mesh drawn with the same shaders, using two materials that differ only in having an
+    // instanced vertex shader. The first draws each model with its own constant buffer update and draw call
+    GpuVertexShader* instancedVertexShader = device.LoadVertexShader("InstancedVertexShader");
+    RenderMaterial singleMaterial;
+    singleMaterial.vertexShader = vertexShaders[0];
+    singleMaterial.pixelShader  = pixelShaders[0];
+    singleMaterial.textures[0]  = textures[0];
+    RenderMaterial instancedMaterial = singleMaterial;
+    instancedMaterial.instancedVertexShader = instancedVertexShader;
+    int instancingMaterials[2] = { queue.AddMaterial(singleMaterial), queue.AddMaterial(instancedMaterial) };
+
+    std::vector<Model> instances;
+    for (int i = 0; i < numInstances; ++i)
+    {
+        CVector3 position = { randomPosition(random), randomPosition(random), randomPosition(random) };
+        instances.emplace_back(meshes[5].get(), transforms, transforms.Add(position));
+    }
+    transforms.UpdateWorldMatrices(); // The queue reads the world matrices without rebuilding them
+
+    struct InstancingTotals
+    {
+        Clock::duration time = {};
+        int drawCalls = 0, gpuDraws = 0, bufferMaps = 0;
+        uint64_t bytesUploaded = 0;
+    };
+    InstancingTotals instancing[2]; // Per-model then instanced
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        for (int instanced = 0; instanced < 2; ++instanced)
+        {
+            InstancingTotals& run = instancing[instanced];
+            context.ResetCounts();
+
+            auto start = Clock::now();
+            queue.Begin(maxDistance);
+            for (auto& model : instances)
+            {
+                queue.Submit(&model, instancingMaterials[instanced], Length(model.Position() - cameraPosition));
+            }
+            queue.Sort();
+            const RenderQueueStats& stats = queue.Execute(context);
+            run.time += Clock::now() - start;
+
+            run.drawCalls     += stats.drawCalls;
+            run.gpuDraws      += context.CommandCount(RenderCommandType::DrawIndexed) +
+                                 context.CommandCount(RenderCommandType::DrawIndexedInstanced);
+            run.bufferMaps    += BufferMaps(context);
+            run.bytesUploaded += context.BytesUploaded();
+        }
+    }
+
+    std::cout << "\n" << numInstances << " copies of one mesh per frame\n\n";
+    std::cout << "                   Per-model   Instanced\n";
+    row("Total (us)",     { perFrame(Microseconds(instancing[0].time)),      perFrame(Microseconds(instancing[1].time)) });
+    row("Draw calls",     { perFrame(instancing[0].gpuDraws),                perFrame(instancing[1].gpuDraws) });
+    row("Buffer maps",    { perFrame(instancing[0].bufferMaps),              perFrame(instancing[1].bufferMaps) });
+    row("Uploaded (KB)",  { perFrame(instancing[0].bytesUploaded / 1024.0),  perFrame(instancing[1].bytesUploaded / 1024.0) });
+
+    bool fewerDrawCalls = numInstances == 1 || instancing[1].drawCalls < instancing[0].drawCalls;
+    if (!fewerDrawCalls)  std::cout << "Error: instancing did not reduce draw calls\n";
+
+
+    //-----------------------------------
+    // Release
+    //-----------------------------------
+
+    queue.Release();
+    instances.clear();
+    models.clear();
+    meshes.clear();
+    for (auto texture : textures)  device.Release(texture);
+    for (auto shader : vertexShaders)  device.Release(shader);
+    for (auto shader : pixelShaders)   device.Release(shader);
+    device.Release(instancedVertexShader);
+    device.Release(gPerModelConstantBuffer);
+    if (device.LiveResources() != 0)
+    {
+        std::cout << "Error: " << device.LiveResources() << " GPU resources not released\n";
+        return 1;
+    }
+
+    return (fewerChanges && fewerMaps && fewerDrawCalls) ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+//--------------------------------------------------------------------------------------
+// Headless scene benchmark
+//--------------------------------------------------------------------------------------
+// Command line tool that runs the app's scene (Scene.cpp) with the null renderer (RendererNull.h), so no
+// window or GPU is needed. Loads the meshes, sets up the scene, then runs a fixed number of frames of
+// UpdateScene and RenderScene and reports the CPU time of each along with the commands sent to the renderer.
+//
+// Only uses standard C++ and assimp, so it also builds on Linux, e.g. from the repository folder:
+//   g++ -std=c++17 -O2 -I. -IUtility -IMath -o SceneBench Tools/SceneBench/SceneBench.cpp Scene.cpp SceneFile.cpp
+//       SceneObjects.cpp Mesh.cpp MeshData.cpp MeshCache.cpp Model.cpp TransformStore.cpp BVH.cpp RenderQueue.cpp
+//       Camera.cpp Shader.cpp RendererNull.cpp Utility/Input.cpp Utility/FrameStats.cpp Utility/GraphicsHelpers.cpp
+//       Utility/MappedFile.cpp Utility/JobSystem.cpp RenderTargetPool.cpp AssetLoader.cpp Tools/Common/ToolStubs.cpp
+//       TextureCache.cpp MeshQuantization.cpp MeshClusters.cpp Math/*.cpp -lassimp -lpthread
+//
+// Run it from the folder holding the media files and Scene.scene (the meshes are loaded and texture files read, shaders are not).
+// The scene load time includes waiting for the meshes loading in the background.
+// For the time taken to load larger scenes see Tools/SceneLoadBench.
+//
+// Usage: SceneBench [-frames <frames>] [-dt <seconds>] [-budget <seconds>] [-ranges <0 or 1>] [-parallel <0 or 1>]
+//   -frames <frames>    Number of frames to run (default 1000)
+//   -dt <seconds>       Frame time passed to UpdateScene each frame (default 1/60)
+//   -budget <seconds>   Frame time budget the portal's dynamic resolution aims for (default 1/60). Use a dt over the
+//                       budget to see the portal's resolution lowered
+//   -ranges <0 or 1>    Whether the renderer supports constant buffer ranges like Direct3D 11.1 (default 1)
+//   -parallel <0 or 1>  Whether the views are recorded at the same time on deferred contexts (default 1). The commands
+//                       counted are those run on the immediate context, so recording in parallel adds one
+//                       ExecuteCommandList per view
+//
+// After the timed frames, runs some more with the cameras moved or their projection changed on some frames and not
+// others, checking each camera recalculates each of its matrices exactly once in a frame where it changed and not at all
+// in a frame where it didn't, however many times the scene reads them (see Camera::UpdateMatrices).
+//
+// Returns 0 on success, 1 if the scene failed to load, a camera recalculated its matrices the wrong number of times or
+// the scene did not release all of its resources.
+
+#include "Scene.h"
+#include "SceneObjects.h"
+#include "RendererNull.h"
+#include "Input.h"
+#include "Common.h"
+#include "FrameStats.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <algorithm>
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+// The app globals and platform functions are defined in Tools/Common/ToolStubs.cpp
+
+// The scene's objects, defined in Scene.cpp
+extern SceneObjects gScene;
+
+
+//--------------------------------------------------------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+double Milliseconds(Clock::duration time)
+{
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+
+// Run frames with the main and portal cameras changed in different combinations, checking how many times each camera
+// recalculated its view and projection matrices in each frame. The main camera is moved with its controls as a user
+// would, the portal camera is turned directly. Either camera's field of view is also changed on some frames. Prints
+// each mismatch and returns the number of them
+int CheckCameraUpdates(int numFrames, float frameTime)
+{
+    const int numCameras = 2;
+    const char* names[numCameras]   = { "Main", "Portal" };
+    Camera*     cameras[numCameras] = { &gScene.GetCamera(gScene.FindCamera("Main")), &gScene.GetCamera(gScene.FindCamera("Portal")) };
+
+    int failures = 0;
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        // Different periods for each change so every combination of them comes up
+        bool moved[numCameras]              = { frame % 3 == 0, frame % 4 == 1 };
+        bool projectionChanged[numCameras]  = { frame % 5 == 2, frame % 7 == 3 };
+        float turn = (frame % 2 == 0) ? 0.01f : -0.01f;
+
+        int viewUpdates[numCameras], projectionUpdates[numCameras];
+        for (int i = 0; i < numCameras; ++i)
+        {
+            viewUpdates[i]       = cameras[i]->NumViewUpdates();
+            projectionUpdates[i] = cameras[i]->NumProjectionUpdates();
+        }
+
+        if (moved[0])  KeyDownEvent(Key_W);
+        UpdateScene(frameTime);
+        if (moved[0])  KeyUpEvent(Key_W);
+        if (moved[1])  cameras[1]->SetRotation(cameras[1]->Rotation() + CVector3{ 0, turn, 0 });
+        for (int i = 0; i < numCameras; ++i)
+        {
+            if (projectionChanged[i])  cameras[i]->SetFOV(cameras[i]->FOV() + turn);
+        }
+        RenderScene();
+
+        for (int i = 0; i < numCameras; ++i)
+        {
+            viewUpdates[i]       = cameras[i]->NumViewUpdates()       - viewUpdates[i];
+            projectionUpdates[i] = cameras[i]->NumProjectionUpdates() - projectionUpdates[i];
+            if (viewUpdates[i] != (moved[i] ? 1 : 0) || projectionUpdates[i] != (projectionChanged[i] ? 1 : 0))
+            {
+                std::cout << "Error: frame " << frame << ", " << names[i] << " camera recalculated its view/projection matrices "
+                          << viewUpdates[i] << "/" << projectionUpdates[i] << " times, expected " << (moved[i] ? 1 : 0) << "/"
+                          << (projectionChanged[i] ? 1 : 0) << "\n";
+                ++failures;
+            }
+        }
+    }
+    return failures;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int   numFrames = 1000;
+    float frameTime = 1.0f / 60.0f;
+    bool  constantBufferRanges = true;
+    for (int arg = 1; arg + 1 < argc; arg += 2)
+    {
+        std::string argument = argv[arg];
+        if      (argument == "-frames")    numFrames = std::max(1, std::stoi(argv[arg + 1]));
+        else if (argument == "-dt")        frameTime = std::stof(argv[arg + 1]);
+        else if (argument == "-budget")    gFrameTimeBudget = std::stof(argv[arg + 1]);
+        else if (argument == "-ranges")    constantBufferRanges = (std::stoi(argv[arg + 1]) != 0);
+        else if (argument == "-parallel")  gRecordViewsInParallel = (std::stoi(argv[arg + 1]) != 0);
+    }
+
+    NullRenderDevice  device(gViewportWidth, gViewportHeight);
+    NullRenderContext context;
+    context.SetConstantBufferRangeSupport(constantBufferRanges);
+    gRenderDevice  = &device;
+    gRenderContext = &context;
+
+    InitInput();
+
+
+    //-----------------------------------
+    // Load
+    //-----------------------------------
+
+    auto loadStart = Clock::now();
+    if (!InitGeometry() || !InitScene() || !FinishLoading())
+    {
+        std::cout << "Error: " << gLastError << "\n";
+        ReleaseResources();
+        return 1;
+    }
+    double loadMs = Milliseconds(Clock::now() - loadStart);
+
+
+    //-----------------------------------
+    // Frames
+    //-----------------------------------
+
+    Clock::duration updateTime = {}, renderTime = {};
+    double slowestFrameMs = 0;
+    CullingStats mainCulling, portalCulling; // Totals over all frames
+    int bufferMaps = 0;
+    int staticBVHRefits = 0;
+    int portalRendersSkipped = 0;
+    double portalRenderSize = 0;
+    int renderTargetsCreated = 0, renderTargetsReused = 0, renderTargetsFreed = 0;
+    int peakRenderTargetMemory = 0;
+    UploadStats uploads;
+    RecordTimes recordTimes;
+    for (int frame = 0; frame < numFrames; ++frame)
+    {
+        auto start = Clock::now();
+        UpdateScene(frameTime);
+        auto updated = Clock::now();
+        RenderScene();
+        auto rendered = Clock::now();
+
+        updateTime += updated - start;
+        renderTime += rendered - updated;
+        slowestFrameMs = std::max(slowestFrameMs, Milliseconds(rendered - start));
+
+        // UpdateScene clears the frame stats, so they hold this frame's counts until the next update
+        mainCulling.drawn    += gFrameStats.mainCameraCulling.drawn;
+        mainCulling.culled   += gFrameStats.mainCameraCulling.culled;
+        portalCulling.drawn  += gFrameStats.portalCameraCulling.drawn;
+        portalCulling.culled += gFrameStats.portalCameraCulling.culled;
+        bufferMaps           += gFrameStats.bufferMaps;
+        staticBVHRefits      += gFrameStats.staticBVHRefits;
+        portalRendersSkipped += gFrameStats.portalRendersSkipped;
+        portalRenderSize     += gFrameStats.portalRenderSize;
+        renderTargetsCreated += gFrameStats.renderTargetsCreated;
+        renderTargetsReused  += gFrameStats.renderTargetsReused;
+        renderTargetsFreed   += gFrameStats.renderTargetsFreed;
+        peakRenderTargetMemory = std::max(peakRenderTargetMemory, gFrameStats.renderTargetMemory + gFrameStats.renderTargetMemoryKept);
+        uploads.frame        += gFrameStats.uploads.frame;
+        uploads.portal       += gFrameStats.uploads.portal;
+        uploads.main         += gFrameStats.uploads.main;
+        recordTimes.portal   += gFrameStats.recordTimes.portal;
+        recordTimes.main     += gFrameStats.recordTimes.main;
+    }
+
+    double updateUs = Milliseconds(updateTime) * 1000.0 / numFrames;
+    double renderUs = Milliseconds(renderTime) * 1000.0 / numFrames;
+    auto perFrame = [&](double total) { return total / numFrames; };
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Scene load:         " << loadMs << "ms, " << device.LiveResources() << " GPU resources, "
+              << device.BufferMemory() / 1024.0 << "KB of buffers\n";
+    std::cout << "Frames:             " << numFrames << " (dt " << frameTime * 1000.0f << "ms)\n";
+    std::cout << "UpdateScene:        " << updateUs << "us per frame\n";
+    std::cout << "RenderScene:        " << renderUs << "us per frame\n";
+    std::cout << "Slowest frame:      " << slowestFrameMs * 1000.0 << "us\n";
+    std::cout << "Commands per frame: " << perFrame(context.TotalCommands())
+              << " (" << perFrame(context.CommandCount(RenderCommandType::DrawIndexed)) << " draws, "
+              << perFrame(context.CommandCount(RenderCommandType::DrawIndexedInstanced)) << " instanced draws, "
+              << perFrame(bufferMaps) << " buffer maps)\n";
+    std::cout << "Indices per frame:  " << perFrame(static_cast<double>(context.IndicesDrawn())) << "\n";
+    std::cout << "Uploads per frame:  " << perFrame(static_cast<double>(context.BytesUploaded())) << " bytes (frame constants "
+              << perFrame(uploads.frame) << ", portal pass " << perFrame(uploads.portal) << ", main pass " << perFrame(uploads.main) << ")\n";
+    std::cout << "Record per view:    portal " << perFrame(recordTimes.portal) << "us, main " << perFrame(recordTimes.main)
+              << "us (" << (gRecordViewsInParallel ? "in parallel on deferred contexts" : "one after the other") << ")\n";
+    std::cout << "Models per frame:   main " << perFrame(mainCulling.drawn) << " drawn, " << perFrame(mainCulling.culled)
+              << " culled; portal " << perFrame(portalCulling.drawn) << " drawn, " << perFrame(portalCulling.culled) << " culled\n";
+    std::cout << "Portal renders:     " << numFrames - portalRendersSkipped << " rendered, " << portalRendersSkipped << " skipped, average size "
+              << portalRenderSize / std::max(1, numFrames - portalRendersSkipped) << " pixels\n";
+    std::cout << "Render target pool: " << renderTargetsCreated << " created, " << renderTargetsReused << " reused, " << renderTargetsFreed
+              << " freed; " << gFrameStats.renderTargetMemory / 1024.0 << "KB in use and " << gFrameStats.renderTargetMemoryKept / 1024.0
+              << "KB kept at the end, peak " << peakRenderTargetMemory / 1024.0 << "KB\n";
+    std::cout << "Texture cache:      " << gFrameStats.textureMemory / 1024.0 << "KB resident, " << gFrameStats.textureCacheHits
+              << " hits, " << gFrameStats.textureCacheMisses << " misses\n";
+    std::cout << "Index buffers:      " << gFrameStats.indexMemory / 1024.0 << "KB, " << gFrameStats.indexMemorySaved / 1024.0
+              << "KB saved by 16-bit indices\n";
+    std::cout << "Static models:      " << gScene.StaticModels().size() << " in the BVH, refitted " << staticBVHRefits << " times\n";
+
+    const int numCheckFrames = 60;
+    int cameraFailures = CheckCameraUpdates(numCheckFrames, frameTime);
+    std::cout << "Camera updates:     " << numCheckFrames << " frames checked with the cameras changed on some, "
+              << cameraFailures << " mismatches\n";
+
+
+    //-----------------------------------
+    // Release
+    //-----------------------------------
+
+    ReleaseResources();
+    if (device.LiveResources() != 0)
+    {
+        std::cout << "Error: " << device.LiveResources() << " GPU resources not released\n";
+        return 1;
+    }
+
+    return cameraFailures == 0 ? 0 : 1;
+}
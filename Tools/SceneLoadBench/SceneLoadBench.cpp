@@ -0,0 +1,263 @@
+//--------------------------------------------------------------------------------------
+// Scene load benchmark
+//--------------------------------------------------------------------------------------
+// Command line tool that writes a large scene file (see SceneFile.h) using the app's meshes, textures and shaders with
+// many models at random positions, then times each stage of loading it with the null renderer (RendererNull.h), so no
+// window or GPU is needed:
+// - Reading the text
+// - Writing the compiled binary file
+// - Loading the text file when its binary file is out of date (hash, read text and write binary), as on the first run
+// - Loading the text file from its binary file, as on later runs
+// - Creating the scene objects (meshes, GPU resources, materials, models and cameras) from the description
+// Each stage is run several times and the fastest time is reported.
+//
+// Only uses standard C++ and assimp, so it also builds on Linux, e.g. from the repository folder:
+//   g++ -std=c++17 -O2 -I. -IUtility -IMath -o SceneLoadBench Tools/SceneLoadBench/SceneLoadBench.cpp SceneFile.cpp
+//       SceneObjects.cpp RenderQueue.cpp Mesh.cpp MeshData.cpp MeshCache.cpp Model.cpp TransformStore.cpp BVH.cpp
+//       Camera.cpp RendererNull.cpp Utility/Input.cpp Utility/FrameStats.cpp Utility/GraphicsHelpers.cpp
+//       Utility/MappedFile.cpp Utility/JobSystem.cpp RenderTargetPool.cpp AssetLoader.cpp Tools/Common/ToolStubs.cpp
+//       Tools/Common/SceneStubs.cpp
+//       TextureCache.cpp MeshQuantization.cpp MeshClusters.cpp Math/*.cpp -lassimp -lpthread
+//
+// Run it from the folder holding the media files (the meshes and texture files are read, shaders are not loaded). The scene is
+// written to SceneLoadBench.scene and SceneLoadBench.scene.bin in the same folder and deleted afterwards.
+//
+// Usage: SceneLoadBench [-models <models>] [-repeats <repeats>]
+//   -models <models>    Number of models in the scene (default 10000)
+//   -repeats <repeats>  Number of times each stage is run (default 5)
+//
+// Returns 0 on success, 1 if the scene failed to load, the binary file did not give the same scene as the text, or
+// not all resources were released.
+
+#include "SceneFile.h"
+#include "SceneObjects.h"
+#include "RenderQueue.h"
+#include "RenderTargetPool.h"
+#include "TextureCache.h"
+#include "RendererNull.h"
+#include "Common.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <cstdio>
+
+
+//--------------------------------------------------------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+double Milliseconds(Clock::duration time)
+{
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+
+// Run the given function the given number of times and return the fastest time in milliseconds. Stops early and
+// returns a negative time if the function fails
+double FastestMs(int repeats, const std::function<bool()>& function)
+{
+    double fastest = 0;
+    for (int i = 0; i < repeats; ++i)
+    {
+        auto start = Clock::now();
+        if (!function())  return -1;
+        double time = Milliseconds(Clock::now() - start);
+        fastest = (i == 0) ? time : std::min(fastest, time);
+    }
+    return fastest;
+}
+
+
+// Returns the text of a scene with the app's meshes, textures, shaders and materials, the given number of models at
+// random positions and a camera
+std::string GenerateSceneText(int numModels)
+{
+    std::ostringstream text;
+    text << "# Generated by SceneLoadBench\n";
+
+    const char* meshes[] = { "Teapot", "Cube", "CargoContainer", "Sphere", "Hills", "Light", "Portal" };
+    for (auto mesh : meshes)  text << "mesh " << mesh << " file=" << mesh << ".x\n";
+
+    const char* textures[] = { "MetalDiffuseSpecular.dds", "StoneDiffuseSpecular.dds", "WoodDiffuseSpecular.dds", "CargoA.dds",
+                               "Brick1.dds", "GrassDiffuseSpecular.dds", "Flare.dds" };
+    for (int i = 0; i < 7; ++i)  text << "texture Texture" << i << " file=" << textures[i] << "\n";
+    text << "rendertarget Portal width=256 height=256\n";
+
+    text << "vertexshader PixelLighting file=PixelLighting_vs\n"
+            "vertexshader PixelLightingInstanced file=PixelLightingInstanced_vs\n"
+            "pixelshader  PixelLighting file=PixelLighting_ps\n"
+            "vertexshader LightModel file=LightModel_vs\n"
+            "vertexshader LightModelInstanced file=LightModelInstanced_vs\n"
+            "pixelshader  LightModel file=LightModel_ps\n";
+
+    // A lit material for each texture and the portal, plus the additive light material
+    const int NUM_LIT_MATERIALS = 8;
+    for (int i = 0; i < NUM_LIT_MATERIALS; ++i)
+    {
+        text << "material Lit" << i << " vs=PixelLighting ivs=PixelLightingInstanced ps=PixelLighting texture0="
+             << (i < 7 ? "Texture" + std::to_string(i) : std::string("Portal")) << "\n";
+    }
+    text << "material Light vs=LightModel ivs=LightModelInstanced ps=LightModel texture0=Texture6 blend=additive depth=readonly cull=none\n";
+
+    std::mt19937 random(1234);
+    std::uniform_int_distribution<int>    randomMesh(0, 6);
+    std::uniform_int_distribution<int>    randomMaterial(0, NUM_LIT_MATERIALS);
+    std::uniform_real_distribution<float> randomPosition(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> randomAngle(0.0f, 360.0f);
+    std::uniform_real_distribution<float> randomScale(0.5f, 2.0f);
+    text << std::fixed << std::setprecision(2);
+    for (int i = 0; i < numModels; ++i)
+    {
+        int material = randomMaterial(random);
+        text << "model Model" << i << " mesh=" << meshes[randomMesh(random)] << " material="
+             << (material < NUM_LIT_MATERIALS ? "Lit" + std::to_string(material) : std::string("Light"))
+             << " position=" << randomPosition(random) << "," << randomPosition(random) << "," << randomPosition(random)
+             << " rotation=0," << randomAngle(random) << ",0 scale=" << randomScale(random) << "\n";
+    }
+
+    text << "camera Main position=0,50,-600 rotation=5,0,0 near=1 far=2000\n";
+    return text.str();
+}
+
+
+// Returns true if two scene descriptions hold the same data
+bool SameScene(const SceneDescription& a, const SceneDescription& b)
+{
+    auto same = [](const auto& tableA, const auto& tableB)
+    {
+        return tableA.size() == tableB.size() &&
+               (tableA.empty() || std::memcmp(tableA.data(), tableB.data(), tableA.size() * sizeof(tableA[0])) == 0);
+    };
+    return same(a.meshes, b.meshes) && same(a.textures, b.textures) && same(a.renderTargets, b.renderTargets) &&
+           same(a.shaders, b.shaders) && same(a.materials, b.materials) && same(a.models, b.models) &&
+           same(a.cameras, b.cameras) && same(a.strings, b.strings);
+}
+
+
+int main(int argc, char* argv[])
+{
+    int numModels  = 10000;
+    int numRepeats = 5;
+    for (int arg = 1; arg + 1 < argc; arg += 2)
+    {
+        std::string argument = argv[arg];
+        if      (argument == "-models")   numModels  = std::max(1, std::stoi(argv[arg + 1]));
+        else if (argument == "-repeats")  numRepeats = std::max(1, std::stoi(argv[arg + 1]));
+    }
+
+    NullRenderDevice  device(gViewportWidth, gViewportHeight);
+    NullRenderContext context;
+    gRenderDevice  = &device;
+    gRenderContext = &context;
+
+
+    //-----------------------------------
+    // Write the scene
+    //-----------------------------------
+
+    const std::string sceneFileName  = "SceneLoadBench.scene";
+    const std::string binaryFileName = SceneBinaryFileName(sceneFileName);
+    std::string sceneText = GenerateSceneText(numModels);
+    {
+        std::ofstream file(sceneFileName, std::ios::out | std::ios::binary | std::ios::trunc);
+        file << sceneText;
+    }
+    auto cleanUp = [&]()
+    {
+        std::remove(sceneFileName.c_str());
+        std::remove(binaryFileName.c_str());
+    };
+    auto fail = [&]()
+    {
+        std::cout << "Error: " << gLastError << "\n";
+        cleanUp();
+        return 1;
+    };
+
+
+    //-----------------------------------
+    // Time each stage
+    //-----------------------------------
+
+    SceneDescription parsed, loaded;
+    double parseMs = FastestMs(numRepeats, [&]() { return ParseSceneText(sceneText.data(), sceneText.size(), sceneFileName, parsed); });
+    if (parseMs < 0)  return fail();
+
+    double saveMs = FastestMs(numRepeats, [&]() { return SaveSceneBinary(binaryFileName, 0, parsed); });
+    if (saveMs < 0)  return fail();
+
+    // Without the binary file each of these loads reads the text and compiles it again
+    bool fromBinary = true;
+    double compileLoadMs = FastestMs(numRepeats, [&]()
+    {
+        std::remove(binaryFileName.c_str());
+        return LoadSceneFile(sceneFileName, loaded, &fromBinary) && !fromBinary;
+    });
+    if (compileLoadMs < 0)  return fail();
+
+    double binaryLoadMs = FastestMs(numRepeats, [&]() { return LoadSceneFile(sceneFileName, loaded, &fromBinary) && fromBinary; });
+    if (binaryLoadMs < 0)  return fail();
+
+    bool sameScene = SameScene(parsed, loaded);
+    if (!sameScene)  std::cout << "Error: the binary file does not hold the same scene as the text\n";
+
+    // Meshes are loaded from their cache files after the first creation, the same as later runs of the app. Textures are
+    // found in the texture cache after the first creation
+    RenderQueue queue;
+    SceneObjects objects;
+    double createMs = FastestMs(numRepeats, [&]()
+    {
+        queue.Release();
+        objects.Release();
+        return objects.Create(loaded, queue);
+    });
+    if (createMs < 0)  return fail();
+    int createdModels = objects.NumModels();
+
+    size_t binarySize = 0;
+    {
+        std::ifstream binaryFile(binaryFileName, std::ios::in | std::ios::binary | std::ios::ate);
+        binarySize = static_cast<size_t>(binaryFile.tellg());
+    }
+
+
+    //-----------------------------------
+    // Report
+    //-----------------------------------
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << numModels << " models, " << loaded.meshes.size() << " meshes, " << loaded.materials.size() << " materials; text "
+              << sceneText.size() / 1024.0 << "KB, binary " << binarySize / 1024.0 << "KB; fastest of " << numRepeats << " runs\n\n";
+    std::cout << "Read text:                   " << parseMs       << "ms\n";
+    std::cout << "Write binary:                " << saveMs        << "ms\n";
+    std::cout << "Load text and compile:       " << compileLoadMs << "ms (first run)\n";
+    std::cout << "Load from binary:            " << binaryLoadMs  << "ms (later runs)\n";
+    std::cout << "Create scene objects:        " << createMs      << "ms (" << createdModels << " models)\n";
+    std::cout << "Binary load is " << compileLoadMs / std::max(binaryLoadMs, 0.001) << "x faster than compiling\n";
+
+
+    //-----------------------------------
+    // Release
+    //-----------------------------------
+
+    queue.Release();
+    objects.Release();
+    gRenderTargetPool.Clear(); // The scene's render targets and textures are kept for reuse until cleared
+    gTextureCache.Clear();
+    cleanUp();
+    if (device.LiveResources() != 0)
+    {
+        std::cout << "Error: " << device.LiveResources() << " GPU resources not released\n";
+        return 1;
+    }
+
+    return sameScene ? 0 : 1;
+}
@@ -0,0 +1,713 @@
+//--------------------------------------------------------------------------------------
+// Block compression
+//--------------------------------------------------------------------------------------
+
+#include "BlockCompression.h"
+#include "CMatrix4x4.h" // For CMATRIX4X4_SSE
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cfloat>
+
+#ifdef CMATRIX4X4_SSE
+#include <immintrin.h>
+#endif
+
+
+namespace
+{
+    const int BLOCK_PIXELS = 16;
+
+    // A block's pixels as floats, an array for each channel (r, g, b, a) so four pixels load into an SSE register at once
+    struct Block
+    {
+        alignas(16) float channel[4][BLOCK_PIXELS];
+    };
+
+    void LoadBlock(const uint8_t* pixels, Block& block)
+    {
+        for (int i = 0; i < BLOCK_PIXELS; ++i)
+        {
+            for (int c = 0; c < 4; ++c)  block.channel[c][i] = pixels[i * 4 + c];
+        }
+    }
+
+
+    //-----------------------------------
+    // Shared encoding steps
+    //-----------------------------------
+
+    // For each pixel, the index of the nearest palette colour comparing the first numChannels channels. Returns the
+    // total squared error. The first of equally near colours is chosen
+    float SelectIndices(const Block& block, const float (*palette)[4], int numColours, int numChannels, uint8_t* indices)
+    {
+        float totalError = 0;
+#ifdef CMATRIX4X4_SSE
+        for (int first = 0; first < BLOCK_PIXELS; first += 4)
+        {
+            __m128 pixel[4];
+            for (int c = 0; c < numChannels; ++c)  pixel[c] = _mm_load_ps(block.channel[c] + first);
+
+            __m128  bestError = _mm_set1_ps(FLT_MAX);
+            __m128i bestIndex = _mm_setzero_si128();
+            for (int i = 0; i < numColours; ++i)
+            {
+                __m128 error = _mm_setzero_ps();
+                for (int c = 0; c < numChannels; ++c)
+                {
+                    __m128 difference = _mm_sub_ps(pixel[c], _mm_set1_ps(palette[i][c]));
+                    error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+                }
+                __m128i nearer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+                bestIndex = _mm_or_si128(_mm_and_si128(nearer, _mm_set1_epi32(i)), _mm_andnot_si128(nearer, bestIndex));
+                bestError = _mm_min_ps(error, bestError);
+            }
+
+            alignas(16) int32_t index[4];
+            alignas(16) float   error[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(index), bestIndex);
+            _mm_store_ps(error, bestError);
+            for (int p = 0; p < 4; ++p)
+            {
+                indices[first + p] = static_cast<uint8_t>(index[p]);
+                totalError += error[p];
+            }
+        }
+#else
+        for (int p = 0; p < BLOCK_PIXELS; ++p)
+        {
+            float bestError = FLT_MAX;
+            for (int i = 0; i < numColours; ++i)
+            {
+                float error = 0;
+                for (int c = 0; c < numChannels; ++c)
+                {
+                    float difference = block.channel[c][p] - palette[i][c];
+                    error += difference * difference;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    indices[p] = static_cast<uint8_t>(i);
+                }
+            }
+            totalError += bestError;
+        }
+#endif
+        return totalError;
+    }
+
+
+    // The mean of the block's first numChannels channels, and the direction they vary most along (the principal axis
+    // of their covariance, found by power iteration). The axis is a unit vector, or zero if the pixels are all the same
+    void PrincipalAxis(const Block& block, int numChannels, float* mean, float* axis)
+    {
+        for (int c = 0; c < numChannels; ++c)
+        {
+            mean[c] = 0;
+            for (int p = 0; p < BLOCK_PIXELS; ++p)  mean[c] += block.channel[c][p];
+            mean[c] /= BLOCK_PIXELS;
+        }
+
+        float covariance[4][4] = {};
+        for (int p = 0; p < BLOCK_PIXELS; ++p)
+        {
+            for (int i = 0; i < numChannels; ++i)
+            {
+                for (int j = i; j < numChannels; ++j)
+                {
+                    covariance[i][j] += (block.channel[i][p] - mean[i]) * (block.channel[j][p] - mean[j]);
+                }
+            }
+        }
+        for (int i = 0; i < numChannels; ++i)  for (int j = 0; j < i; ++j)  covariance[i][j] = covariance[j][i];
+
+        // Start from the channel that varies most, which is close to the answer for most blocks
+        int largest = 0;
+        for (int c = 1; c < numChannels; ++c)  if (covariance[c][c] > covariance[largest][largest])  largest = c;
+        for (int c = 0; c < numChannels; ++c)  axis[c] = covariance[largest][c];
+
+        const int ITERATIONS = 8;
+        for (int iteration = 0; iteration < ITERATIONS; ++iteration)
+        {
+            float next[4] = {};
+            float largestComponent = 0;
+            for (int i = 0; i < numChannels; ++i)
+            {
+                for (int j = 0; j < numChannels; ++j)  next[i] += covariance[i][j] * axis[j];
+                largestComponent = std::max(largestComponent, std::abs(next[i]));
+            }
+            if (largestComponent < 1e-6f)  break;
+            for (int c = 0; c < numChannels; ++c)  axis[c] = next[c] / largestComponent;
+        }
+
+        float length = 0;
+        for (int c = 0; c < numChannels; ++c)  length += axis[c] * axis[c];
+        length = std::sqrt(length);
+        for (int c = 0; c < numChannels; ++c)  axis[c] = (length > 1e-6f) ? axis[c] / length : 0.0f;
+    }
+
+
+    // End-points at the ends of the block's colours along their principal axis
+    void AxisEndpoints(const Block& block, int numChannels, float* endpoint0, float* endpoint1)
+    {
+        float mean[4], axis[4];
+        PrincipalAxis(block, numChannels, mean, axis);
+
+        float minDistance = FLT_MAX, maxDistance = -FLT_MAX;
+        for (int p = 0; p < BLOCK_PIXELS; ++p)
+        {
+            float distance = 0;
+            for (int c = 0; c < numChannels; ++c)  distance += (block.channel[c][p] - mean[c]) * axis[c];
+            minDistance = std::min(minDistance, distance);
+            maxDistance = std::max(maxDistance, distance);
+        }
+        for (int c = 0; c < numChannels; ++c)
+        {
+            endpoint0[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxDistance));
+            endpoint1[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minDistance));
+        }
+    }
+
+
+    // The end-points that best fit the block's pixels (least squares) given how much of the first end-point makes up
+    // each pixel. Returns false if there is no single best fit, e.g. if every pixel uses the same index
+    bool FitEndpoints(const Block& block, const float* weights, int numChannels, float* endpoint0, float* endpoint1)
+    {
+        float aa = 0, ab = 0, bb = 0;
+        float ax[4] = {}, bx[4] = {};
+        for (int p = 0; p < BLOCK_PIXELS; ++p)
+        {
+            float a = weights[p];
+            float b = 1.0f - a;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (int c = 0; c < numChannels; ++c)
+            {
+                ax[c] += a * block.channel[c][p];
+                bx[c] += b * block.channel[c][p];
+            }
+        }
+
+        float determinant = aa * bb - ab * ab;
+        if (std::abs(determinant) < 1e-6f)  return false;
+        for (int c = 0; c < numChannels; ++c)
+        {
+            endpoint0[c] = std::min(255.0f, std::max(0.0f, (bb * ax[c] - ab * bx[c]) / determinant));
+            endpoint1[c] = std::min(255.0f, std::max(0.0f, (aa * bx[c] - ab * ax[c]) / determinant));
+        }
+        return true;
+    }
+
+
+    // Writes and reads the bit fields of a BC7 block, least significant bit of the first byte first
+    struct BitWriter
+    {
+        uint8_t* data;
+        int      position = 0;
+
+        void Write(uint32_t value, int bits)
+        {
+            for (int bit = 0; bit < bits; ++bit, ++position)
+            {
+                if ((value >> bit) & 1)  data[position >> 3] |= static_cast<uint8_t>(1 << (position & 7));
+            }
+        }
+    };
+
+    struct BitReader
+    {
+        const uint8_t* data;
+        int            position = 0;
+
+        uint32_t Read(int bits)
+        {
+            uint32_t value = 0;
+            for (int bit = 0; bit < bits; ++bit, ++position)  value |= ((data[position >> 3] >> (position & 7)) & 1u) << bit;
+            return value;
+        }
+    };
+
+
+    //-----------------------------------
+    // BC1 colour blocks
+    //-----------------------------------
+    // Two 565 end-points then a 2-bit index for each pixel, first pixel in the lowest bits. If the first end-point is
+    // greater the block has 4 colours: the end-points and two thirds of the way between. Otherwise it has 3 colours (the
+    // end-points and half way) and transparent black. The encoder only writes 4 colour blocks
+
+    uint16_t Pack565(const float* colour)
+    {
+        int r = static_cast<int>(colour[0] * 31.0f / 255.0f + 0.5f);
+        int g = static_cast<int>(colour[1] * 63.0f / 255.0f + 0.5f);
+        int b = static_cast<int>(colour[2] * 31.0f / 255.0f + 0.5f);
+        return static_cast<uint16_t>((std::min(r, 31) << 11) | (std::min(g, 63) << 5) | std::min(b, 31));
+    }
+
+    void ColourPalette(uint16_t colour0, uint16_t colour1, bool allowThreeColours, int (*palette)[4])
+    {
+        const uint16_t colours[2] = { colour0, colour1 };
+        for (int i = 0; i < 2; ++i)
+        {
+            int r = (colours[i] >> 11) & 31, g = (colours[i] >> 5) & 63, b = colours[i] & 31;
+            palette[i][0] = (r << 3) | (r >> 2);
+            palette[i][1] = (g << 2) | (g >> 4);
+            palette[i][2] = (b << 3) | (b >> 2);
+            palette[i][3] = 255;
+        }
+        bool fourColours = (colour0 > colour1) || !allowThreeColours;
+        for (int c = 0; c < 4; ++c)
+        {
+            if (fourColours)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+            else
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                palette[3][c] = 0;
+            }
+        }
+    }
+
+    // Write a colour block with the given end-points. Returns the squared error and the indices chosen
+    float EncodeColourEndpoints(const Block& block, uint16_t colour0, uint16_t colour1, uint8_t* out, uint8_t* indices)
+    {
+        // 4 colour blocks need the first end-point greater. If they are equal every pixel uses the first
+        if (colour0 < colour1)  std::swap(colour0, colour1);
+
+        int   palette[4][4];
+        float floatPalette[4][4];
+        ColourPalette(colour0, colour1, false, palette);
+        for (int i = 0; i < 4; ++i)  for (int c = 0; c < 4; ++c)  floatPalette[i][c] = static_cast<float>(palette[i][c]);
+        float error = SelectIndices(block, floatPalette, 4, 3, indices);
+
+        uint32_t indexBits = 0;
+        for (int p = 0; p < BLOCK_PIXELS; ++p)  indexBits |= static_cast<uint32_t>(indices[p]) << (p * 2);
+        std::memcpy(out,     &colour0,   2);
+        std::memcpy(out + 2, &colour1,   2);
+        std::memcpy(out + 4, &indexBits, 4);
+        return error;
+    }
+
+    void EncodeColourBlock(const Block& block, uint8_t* out)
+    {
+        float endpoint0[4], endpoint1[4];
+        AxisEndpoints(block, 3, endpoint0, endpoint1);
+        uint8_t indices[BLOCK_PIXELS];
+        float bestError = EncodeColourEndpoints(block, Pack565(endpoint0), Pack565(endpoint1), out, indices);
+
+        // Refit the end-points to the pixels using each palette colour. Stops when it doesn't help
+        const float INDEX_WEIGHTS[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+        const int REFINEMENTS = 2;
+        for (int refinement = 0; refinement < REFINEMENTS && bestError > 0; ++refinement)
+        {
+            float weights[BLOCK_PIXELS];
+            for (int p = 0; p < BLOCK_PIXELS; ++p)  weights[p] = INDEX_WEIGHTS[indices[p]];
+            if (!FitEndpoints(block, weights, 3, endpoint0, endpoint1))  break;
+
+            uint8_t trial[8], trialIndices[BLOCK_PIXELS];
+            float error = EncodeColourEndpoints(block, Pack565(endpoint0), Pack565(endpoint1), trial, trialIndices);
+            if (error >= bestError)  break;
+            bestError = error;
+            std::memcpy(out, trial, sizeof(trial));
+            std::memcpy(indices, trialIndices, sizeof(indices));
+        }
+    }
+
+    void DecodeColourBlock(const uint8_t* in, bool allowThreeColours, uint8_t* pixels)
+    {
+        uint16_t colour0, colour1;
+        uint32_t indexBits;
+        std::memcpy(&colour0,   in,     2);
+        std::memcpy(&colour1,   in + 2, 2);
+        std::memcpy(&indexBits, in + 4, 4);
+
+        int palette[4][4];
+        ColourPalette(colour0, colour1, allowThreeColours, palette);
+        for (int p = 0; p < BLOCK_PIXELS; ++p)
+        {
+            int index = (indexBits >> (p * 2)) & 3;
+            for (int c = 0; c < 4; ++c)  pixels[p * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+        }
+    }
+
+
+    //-----------------------------------
+    // BC3 alpha blocks
+    //-----------------------------------
+    // Two 8-bit end-points then a 3-bit index for each pixel. If the first end-point is greater the block has 8 alpha
+    // values: the end-points and six evenly between. Otherwise it has 6 (the end-points and four between) plus 0 and 255
+
+    void AlphaPalette(int alpha0, int alpha1, int* palette)
+    {
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        if (alpha0 > alpha1)
+        {
+            for (int i = 2; i < 8; ++i)  palette[i] = ((8 - i) * alpha0 + (i - 1) * alpha1) / 7;
+        }
+        else
+        {
+            for (int i = 2; i < 6; ++i)  palette[i] = ((6 - i) * alpha0 + (i - 1) * alpha1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    // Write an alpha block with the given end-points. Returns the squared error
+    int EncodeAlphaEndpoints(const uint8_t* alpha, int alpha0, int alpha1, uint8_t* out)
+    {
+        int palette[8];
+        AlphaPalette(alpha0, alpha1, palette);
+
+        int totalError = 0;
+        uint64_t indexBits = 0;
+        for (int p = 0; p < BLOCK_PIXELS; ++p)
+        {
+            int bestIndex = 0, bestError = INT32_MAX;
+            for (int i = 0; i < 8; ++i)
+            {
+                int error = (alpha[p] - palette[i]) * (alpha[p] - palette[i]);
+                if (error < bestError)
+                {
+                    bestError = error;
+                    bestIndex = i;
+                }
+            }
+            totalError += bestError;
+            indexBits |= static_cast<uint64_t>(bestIndex) << (p * 3);
+        }
+
+        out[0] = static_cast<uint8_t>(alpha0);
+        out[1] = static_cast<uint8_t>(alpha1);
+        for (int i = 0; i < 6; ++i)  out[2 + i] = static_cast<uint8_t>(indexBits >> (i * 8));
+        return totalError;
+    }
+
+    void EncodeAlphaBlock(const uint8_t* pixels, uint8_t* out)
+    {
+        uint8_t alpha[BLOCK_PIXELS];
+        int minAlpha = 255, maxAlpha = 0;
+        int minInner = 255, maxInner = 0; // Ignoring 0 and 255
+        for (int p = 0; p < BLOCK_PIXELS; ++p)
+        {
+            alpha[p] = pixels[p * 4 + 3];
+            minAlpha = std::min<int>(minAlpha, alpha[p]);
+            maxAlpha = std::max<int>(maxAlpha, alpha[p]);
+            if (alpha[p] != 0 && alpha[p] != 255)
+            {
+                minInner = std::min<int>(minInner, alpha[p]);
+                maxInner = std::max<int>(maxInner, alpha[p]);
+            }
+        }
+
+        // 8 values across the whole range, or if the block has fully transparent or opaque pixels try 6 values across
+        // the others plus exact 0 and 255, e.g. at the edge of a particle
+        int error = EncodeAlphaEndpoints(alpha, maxAlpha, minAlpha, out);
+        if ((minAlpha == 0 || maxAlpha == 255) && minInner <= maxInner && error > 0)
+        {
+            uint8_t trial[8];
+            if (EncodeAlphaEndpoints(alpha, minInner, maxInner, trial) < error)  std::memcpy(out, trial, sizeof(trial));
+        }
+    }
+
+    void DecodeAlphaBlock(const uint8_t* in, uint8_t* pixels)
+    {
+        int palette[8];
+        AlphaPalette(in[0], in[1], palette);
+        uint64_t indexBits = 0;
+        for (int i = 0; i < 6; ++i)  indexBits |= static_cast<uint64_t>(in[2 + i]) << (i * 8);
+        for (int p = 0; p < BLOCK_PIXELS; ++p)  pixels[p * 4 + 3] = static_cast<uint8_t>(palette[(indexBits >> (p * 3)) & 7]);
+    }
+
+
+    //-----------------------------------
+    // BC7 mode 6 blocks
+    //-----------------------------------
+    // Mode number as a unary code (six 0 bits then a 1), RGBA end-points of 7 bits per channel, a p-bit for each
+    // end-point that is the low bit of all its channels, then a 4-bit index for each pixel. The first pixel's index
+    // has only 3 bits, its top bit is always 0 (the encoder swaps the end-points to make it so)
+
+    const int BC7_MODE = 6;
+    const int BC7_WEIGHTS[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    struct Mode6Endpoint
+    {
+        int channel[4]; // 7 bits each
+        int pBit;
+
+        int Value(int c) const  { return (channel[c] << 1) | pBit; }
+    };
+
+    // Quantise an end-point to 7 bits per channel plus the p-bit that gives the lower error
+    Mode6Endpoint QuantiseMode6(const float* endpoint)
+    {
+        Mode6Endpoint best = {};
+        float bestError = FLT_MAX;
+        for (int pBit = 0; pBit < 2; ++pBit)
+        {
+            Mode6Endpoint quantised;
+            quantised.pBit = pBit;
+            float error = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                int value = static_cast<int>((endpoint[c] - pBit) * 0.5f + 0.5f);
+                quantised.channel[c] = std::min(127, std::max(0, value));
+                float difference = static_cast<float>(quantised.Value(c)) - endpoint[c];
+                error += difference * difference;
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                best = quantised;
+            }
+        }
+        return best;
+    }
+
+    void Mode6Palette(const Mode6Endpoint& endpoint0, const Mode6Endpoint& endpoint1, int (*palette)[4])
+    {
+        for (int i = 0; i < 16; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                palette[i][c] = ((64 - BC7_WEIGHTS[i]) * endpoint0.Value(c) + BC7_WEIGHTS[i] * endpoint1.Value(c) + 32) >> 6;
+            }
+        }
+    }
+
+    float SelectMode6Indices(const Block& block, const Mode6Endpoint& endpoint0, const Mode6Endpoint& endpoint1, uint8_t* indices)
+    {
+        int   palette[16][4];
+        float floatPalette[16][4];
+        Mode6Palette(endpoint0, endpoint1, palette);
+        for (int i = 0; i < 16; ++i)  for (int c = 0; c < 4; ++c)  floatPalette[i][c] = static_cast<float>(palette[i][c]);
+        return SelectIndices(block, floatPalette, 16, 4, indices);
+    }
+
+    void EncodeMode6Block(const Block& block, uint8_t* out)
+    {
+        float endpoint0[4], endpoint1[4];
+        AxisEndpoints(block, 4, endpoint0, endpoint1);
+        Mode6Endpoint quantised0 = QuantiseMode6(endpoint0);
+        Mode6Endpoint quantised1 = QuantiseMode6(endpoint1);
+        uint8_t indices[BLOCK_PIXELS];
+        float bestError = SelectMode6Indices(block, quantised0, quantised1, indices);
+
+        const int REFINEMENTS = 2;
+        for (int refinement = 0; refinement < REFINEMENTS && bestError > 0; ++refinement)
+        {
+            float weights[BLOCK_PIXELS];
+            for (int p = 0; p < BLOCK_PIXELS; ++p)  weights[p] = 1.0f - BC7_WEIGHTS[indices[p]] / 64.0f;
+            if (!FitEndpoints(block, weights, 4, endpoint0, endpoint1))  break;
+
+            Mode6Endpoint trial0 = QuantiseMode6(endpoint0);
+            Mode6Endpoint trial1 = QuantiseMode6(endpoint1);
+            uint8_t trialIndices[BLOCK_PIXELS];
+            float error = SelectMode6Indices(block, trial0, trial1, trialIndices);
+            if (error >= bestError)  break;
+            bestError  = error;
+            quantised0 = trial0;
+            quantised1 = trial1;
+            std::memcpy(indices, trialIndices, sizeof(indices));
+        }
+
+        // The weights are symmetrical, so swapping the end-points and reversing the indices gives the same colours
+        if (indices[0] & 8)
+        {
+            std::swap(quantised0, quantised1);
+            for (auto& index : indices)  index = static_cast<uint8_t>(15 - index);
+        }
+
+        std::memset(out, 0, 16);
+        BitWriter bits = { out };
+        bits.Write(1u << BC7_MODE, BC7_MODE + 1);
+        for (int c = 0; c < 4; ++c)
+        {
+            bits.Write(quantised0.channel[c], 7);
+            bits.Write(quantised1.channel[c], 7);
+        }
+        bits.Write(quantised0.pBit, 1);
+        bits.Write(quantised1.pBit, 1);
+        bits.Write(indices[0], 3);
+        for (int p = 1; p < BLOCK_PIXELS; ++p)  bits.Write(indices[p], 4);
+    }
+
+    void DecodeBC7(const uint8_t* in, uint8_t* pixels)
+    {
+        BitReader bits = { in };
+        int mode = 0;
+        while (mode < 8 && bits.Read(1) == 0)  ++mode;
+        if (mode != BC7_MODE)
+        {
+            const uint8_t MAGENTA[4] = { 255, 0, 255, 255 };
+            for (int p = 0; p < BLOCK_PIXELS; ++p)  std::memcpy(pixels + p * 4, MAGENTA, 4);
+            return;
+        }
+
+        Mode6Endpoint endpoint0, endpoint1;
+        for (int c = 0; c < 4; ++c)
+        {
+            endpoint0.channel[c] = static_cast<int>(bits.Read(7));
+            endpoint1.channel[c] = static_cast<int>(bits.Read(7));
+        }
+        endpoint0.pBit = static_cast<int>(bits.Read(1));
+        endpoint1.pBit = static_cast<int>(bits.Read(1));
+
+        int palette[16][4];
+        Mode6Palette(endpoint0, endpoint1, palette);
+        for (int p = 0; p < BLOCK_PIXELS; ++p)
+        {
+            int index = static_cast<int>(bits.Read(p == 0 ? 3 : 4));
+            for (int c = 0; c < 4; ++c)  pixels[p * 4 + c] = static_cast<uint8_t>(palette[index][c]);
+        }
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Formats
+//--------------------------------------------------------------------------------------
+
+int BlockBytes(BlockFormat format)
+{
+    return (format == BlockFormat::BC1) ? 8 : 16;
+}
+
+size_t CompressedSize(BlockFormat format, int width, int height)
+{
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * BlockBytes(format);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Blocks
+//--------------------------------------------------------------------------------------
+
+void EncodeBC1Block(const uint8_t* pixels, uint8_t* block)
+{
+    Block floatBlock;
+    LoadBlock(pixels, floatBlock);
+    EncodeColourBlock(floatBlock, block);
+}
+
+void EncodeBC3Block(const uint8_t* pixels, uint8_t* block)
+{
+    Block floatBlock;
+    LoadBlock(pixels, floatBlock);
+    EncodeAlphaBlock(pixels, block);
+    EncodeColourBlock(floatBlock, block + 8);
+}
+
+void EncodeBC7Block(const uint8_t* pixels, uint8_t* block)
+{
+    Block floatBlock;
+    LoadBlock(pixels, floatBlock);
+    EncodeMode6Block(floatBlock, block);
+}
+
+
+void DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* pixels)
+{
+    switch (format)
+    {
+    case BlockFormat::BC1:
+        DecodeColourBlock(block, true, pixels);
+        break;
+
+    case BlockFormat::BC3:
+        DecodeColourBlock(block + 8, false, pixels);
+        DecodeAlphaBlock(block, pixels);
+        break;
+
+    case BlockFormat::BC7:
+        DecodeBC7(block, pixels);
+        break;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Images
+//--------------------------------------------------------------------------------------
+
+// Compress an image. Blocks over the right or bottom edge repeat the edge pixels. If a job system is given the rows of
+// blocks are shared between its threads
+std::vector<uint8_t> CompressImage(BlockFormat format, const uint8_t* pixels, int width, int height, JobSystem* jobs /*= nullptr*/)
+{
+    int blocksX    = (width  + 3) / 4;
+    int blocksY    = (height + 3) / 4;
+    int blockBytes = BlockBytes(format);
+    std::vector<uint8_t> blocks(CompressedSize(format, width, height));
+
+    auto encodeRows = [&](uint32_t firstRow, uint32_t endRow)
+    {
+        uint8_t blockPixels[BLOCK_PIXELS * 4];
+        for (uint32_t row = firstRow; row < endRow; ++row)
+        {
+            for (int column = 0; column < blocksX; ++column)
+            {
+                for (int y = 0; y < 4; ++y)
+                {
+                    int sourceY = std::min(static_cast<int>(row) * 4 + y, height - 1);
+                    for (int x = 0; x < 4; ++x)
+                    {
+                        int sourceX = std::min(column * 4 + x, width - 1);
+                        std::memcpy(blockPixels + (y * 4 + x) * 4, pixels + (static_cast<size_t>(sourceY) * width + sourceX) * 4, 4);
+                    }
+                }
+
+                uint8_t* block = blocks.data() + (static_cast<size_t>(row) * blocksX + column) * blockBytes;
+                switch (format)
+                {
+                case BlockFormat::BC1:  EncodeBC1Block(blockPixels, block);  break;
+                case BlockFormat::BC3:  EncodeBC3Block(blockPixels, block);  break;
+                case BlockFormat::BC7:  EncodeBC7Block(blockPixels, block);  break;
+                }
+            }
+        }
+    };
+
+    if (jobs != nullptr)
+    {
+        JobCounter encoded;
+        jobs->ParallelFor(static_cast<uint32_t>(blocksY), 1, encodeRows, &encoded);
+        jobs->Wait(encoded);
+    }
+    else
+    {
+        encodeRows(0, static_cast<uint32_t>(blocksY));
+    }
+    return blocks;
+}
+
+
+// Decompress an image compressed with CompressImage
+std::vector<uint8_t> DecompressImage(BlockFormat format, const uint8_t* blocks, int width, int height)
+{
+    int blocksX    = (width  + 3) / 4;
+    int blocksY    = (height + 3) / 4;
+    int blockBytes = BlockBytes(format);
+    std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+
+    uint8_t blockPixels[BLOCK_PIXELS * 4];
+    for (int row = 0; row < blocksY; ++row)
+    {
+        for (int column = 0; column < blocksX; ++column)
+        {
+            DecodeBlock(format, blocks + (static_cast<size_t>(row) * blocksX + column) * blockBytes, blockPixels);
+            for (int y = 0; y < 4 && row * 4 + y < height; ++y)
+            {
+                for (int x = 0; x < 4 && column * 4 + x < width; ++x)
+                {
+                    std::memcpy(pixels.data() + (static_cast<size_t>(row * 4 + y) * width + column * 4 + x) * 4, blockPixels + (y * 4 + x) * 4, 4);
+                }
+            }
+        }
+    }
+    return pixels;
+}
@@ -0,0 +1,73 @@
+//--------------------------------------------------------------------------------------
+// Block compression
+//--------------------------------------------------------------------------------------
+// Encodes RGBA images into the block-compressed formats that GPUs sample directly, so they stay compressed in GPU
+// memory. Each format stores 4x4 pixel blocks as two end-point colours and an index per pixel choosing a colour between
+// them:
+// - BC1 (DXT1): 8 bytes per block, RGB with 565 end-points and 4 colours per block. No alpha
+// - BC3 (DXT5): 16 bytes per block, BC1 colour plus a separate alpha block with 8 alpha values
+// - BC7: 16 bytes per block, RGBA. Only mode 6 is written: 7-bit end-points plus a shared low bit each (a "p-bit") and
+//   16 colours per block. It is much better than BC1 on smooth gradients, but the partitioned modes, which help blocks
+//   holding two or three distinct colours, are not searched
+//
+// End-points are found with the principal axis of the block's colours, then improved with a least squares fit to the
+// chosen indices. The index search, which is most of the work, uses SSE to test four pixels at once where available
+// (see CMATRIX4X4_SSE in CMatrix4x4.h).
+//
+// Decoding is provided to measure the error of the encoded images (see TextureCooker.cpp).
+
+#ifndef _BLOCK_COMPRESSION_H_INCLUDED_
+#define _BLOCK_COMPRESSION_H_INCLUDED_
+
+#include "JobSystem.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Formats
+//--------------------------------------------------------------------------------------
+
+enum class BlockFormat
+{
+    BC1,
+    BC3,
+    BC7,
+};
+
+// Size in bytes of one 4x4 block
+int BlockBytes(BlockFormat format);
+
+// Size in bytes of an image, partial blocks at the right and bottom edges take a whole block
+size_t CompressedSize(BlockFormat format, int width, int height);
+
+
+//--------------------------------------------------------------------------------------
+// Blocks
+//--------------------------------------------------------------------------------------
+// Pixels are 16 RGBA pixels (64 bytes), row by row
+
+void EncodeBC1Block(const uint8_t* pixels, uint8_t* block);
+void EncodeBC3Block(const uint8_t* pixels, uint8_t* block);
+void EncodeBC7Block(const uint8_t* pixels, uint8_t* block);
+
+// BC7 blocks in modes other than 6 decode to magenta
+void DecodeBlock(BlockFormat format, const uint8_t* block, uint8_t* pixels);
+
+
+//--------------------------------------------------------------------------------------
+// Images
+//--------------------------------------------------------------------------------------
+// Pixels are RGBA, row by row with no padding
+
+// Compress an image. Blocks over the right or bottom edge repeat the edge pixels. If a job system is given the rows of
+// blocks are shared between its threads
+std::vector<uint8_t> CompressImage(BlockFormat format, const uint8_t* pixels, int width, int height, JobSystem* jobs = nullptr);
+
+// Decompress an image compressed with CompressImage
+std::vector<uint8_t> DecompressImage(BlockFormat format, const uint8_t* blocks, int width, int height);
+
+
+#endif //_BLOCK_COMPRESSION_H_INCLUDED_
@@ -0,0 +1,656 @@
+//--------------------------------------------------------------------------------------
+// Texture cooker tool
+//--------------------------------------------------------------------------------------
+// Command line tool that converts .jpg and .png textures into block-compressed .dds files with a full mip chain, so the
+// app loads them with the DDS loader (CreateDDSTextureFromFile) rather than WIC. WIC decodes the image on the CPU every
+// time the app starts, then keeps it uncompressed on the GPU (RGBA8, 4 bytes per pixel) with mip-maps generated there.
+// A cooked texture is decoded once, here, and stays compressed on the GPU: BC1 is 0.5 bytes per pixel, BC3 and BC7 are 1.
+//
+// Mip-maps are made by averaging each 2x2 block of pixels (3 pixels wide or high with partial weights across an odd
+// width or height) in linear light rather than on the sRGB values stored in the image. Averaging sRGB values directly
+// darkens the smaller mips, most visibly on high contrast textures. The .dds files are written as UNORM formats by
+// default, like the textures WIC loads, so the app's shaders see the same values. Use -srgb for the _SRGB formats if
+// the shaders expect the GPU to convert textures to linear.
+//
+// The block compression (see BlockCompression.h) uses SSE and shares the rows of blocks between the job system's
+// threads (see JobSystem.h).
+//
+// Images are decoded with WIC on Windows, the same as the app, and with libjpeg and libpng elsewhere. The tool builds on
+// Linux, e.g. from the repository folder:
+//   g++ -std=c++17 -O2 -I. -IUtility -IMath -ITools/TextureCooker -o TextureCooker Tools/TextureCooker/TextureCooker.cpp
+//       Tools/TextureCooker/BlockCompression.cpp Utility/JobSystem.cpp -ljpeg -lpng -lpthread
+//
+// Usage: TextureCooker [-format <format>] [-srgb] [-threads <threads>] [-bench <runs>] <image file> [<image file> ...]
+//   -format <format>    bc1, bc3, bc7, or auto for BC1 if the image is opaque and BC3 if not (default auto)
+//   -srgb               Write the _SRGB versions of the formats
+//   -threads <threads>  Number of threads compressing, -1 for one for each CPU core (default -1)
+//   -bench <runs>       Also compare loading each texture with WIC (read and decode the image) against loading the .dds
+//                       (read the file and find the mips), averaged over <runs>, and the GPU memory each uses
+//
+// Each image is written to a .dds file of the same name in the same folder. Returns 0 on success, 1 if any file failed.
+
+#include "BlockCompression.h"
+#include "JobSystem.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <stdexcept>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+    #include <wincodec.h>
+#else
+    #include <cstdio>
+    #include <csetjmp>
+    #include <jpeglib.h>
+    #include <png.h>
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// Images
+//--------------------------------------------------------------------------------------
+
+// RGBA pixels, row by row with no padding
+struct Image
+{
+    int width  = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+
+std::vector<uint8_t> ReadFile(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file.is_open())  throw std::runtime_error("Cannot open " + fileName);
+
+    std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    if (!file)  throw std::runtime_error("Cannot read " + fileName);
+    return data;
+}
+
+
+#ifdef _WIN32
+
+// Decode a .jpg, .png or any other image WIC supports from the file's content
+Image DecodeImage(const std::vector<uint8_t>& file)
+{
+    // The factory is kept for the whole run, as the app keeps it
+    static IWICImagingFactory* factory = nullptr;
+    if (factory == nullptr)
+    {
+        CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        if (FAILED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory))))
+        {
+            throw std::runtime_error("Cannot create WIC factory");
+        }
+    }
+
+    IWICStream*            stream    = nullptr;
+    IWICBitmapDecoder*     decoder   = nullptr;
+    IWICBitmapFrameDecode* frame     = nullptr;
+    IWICBitmapSource*      converted = nullptr;
+    Image image;
+
+    HRESULT hr = factory->CreateStream(&stream);
+    if (SUCCEEDED(hr))  hr = stream->InitializeFromMemory(const_cast<BYTE*>(file.data()), static_cast<DWORD>(file.size()));
+    if (SUCCEEDED(hr))  hr = factory->CreateDecoderFromStream(stream, nullptr, WICDecodeMetadataCacheOnDemand, &decoder);
+    if (SUCCEEDED(hr))  hr = decoder->GetFrame(0, &frame);
+    if (SUCCEEDED(hr))  hr = WICConvertBitmapSource(GUID_WICPixelFormat32bppRGBA, frame, &converted);
+    UINT width = 0, height = 0;
+    if (SUCCEEDED(hr))  hr = converted->GetSize(&width, &height);
+    if (SUCCEEDED(hr))
+    {
+        image.width  = static_cast<int>(width);
+        image.height = static_cast<int>(height);
+        image.pixels.resize(static_cast<size_t>(width) * height * 4);
+        hr = converted->CopyPixels(nullptr, width * 4, static_cast<UINT>(image.pixels.size()), image.pixels.data());
+    }
+
+    if (converted != nullptr)  converted->Release();
+    if (frame     != nullptr)  frame->Release();
+    if (decoder   != nullptr)  decoder->Release();
+    if (stream    != nullptr)  stream->Release();
+    if (FAILED(hr))  throw std::runtime_error("Cannot decode image");
+    return image;
+}
+
+#else
+
+// libjpeg reports errors through a callback that must not return, so it jumps back to the decode function
+struct JpegError
+{
+    jpeg_error_mgr manager;
+    jmp_buf        jump;
+};
+
+void JpegErrorExit(j_common_ptr info)
+{
+    longjmp(reinterpret_cast<JpegError*>(info->err)->jump, 1);
+}
+
+void DecodeJpeg(const std::vector<uint8_t>& file, Image& image)
+{
+    jpeg_decompress_struct info;
+    JpegError error;
+    info.err = jpeg_std_error(&error.manager);
+    error.manager.error_exit = JpegErrorExit;
+    if (setjmp(error.jump))
+    {
+        jpeg_destroy_decompress(&info);
+        throw std::runtime_error("Cannot decode JPEG");
+    }
+
+    jpeg_create_decompress(&info);
+    jpeg_mem_src(&info, const_cast<unsigned char*>(file.data()), static_cast<unsigned long>(file.size()));
+    jpeg_read_header(&info, TRUE);
+    info.out_color_space = JCS_RGB;
+    jpeg_start_decompress(&info);
+
+    // Each row is decoded as RGB into the start of its space in the image, then spread out to RGBA from the end back
+    image.width  = static_cast<int>(info.output_width);
+    image.height = static_cast<int>(info.output_height);
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height * 4);
+    while (info.output_scanline < info.output_height)
+    {
+        JSAMPROW row = image.pixels.data() + static_cast<size_t>(info.output_scanline) * image.width * 4;
+        jpeg_read_scanlines(&info, &row, 1);
+        for (int x = image.width - 1; x >= 0; --x)
+        {
+            row[x * 4 + 3] = 255;
+            row[x * 4 + 2] = row[x * 3 + 2];
+            row[x * 4 + 1] = row[x * 3 + 1];
+            row[x * 4 + 0] = row[x * 3 + 0];
+        }
+    }
+
+    jpeg_finish_decompress(&info);
+    jpeg_destroy_decompress(&info);
+}
+
+void DecodePng(const std::vector<uint8_t>& file, Image& image)
+{
+    png_image png;
+    std::memset(&png, 0, sizeof(png));
+    png.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_memory(&png, file.data(), file.size()))  throw std::runtime_error("Cannot decode PNG");
+
+    png.format   = PNG_FORMAT_RGBA;
+    image.width  = static_cast<int>(png.width);
+    image.height = static_cast<int>(png.height);
+    image.pixels.resize(PNG_IMAGE_SIZE(png));
+    if (!png_image_finish_read(&png, nullptr, image.pixels.data(), 0, nullptr))
+    {
+        png_image_free(&png);
+        throw std::runtime_error("Cannot decode PNG");
+    }
+}
+
+// Decode a .jpg or .png from the file's content, recognised by its first bytes rather than the file name
+Image DecodeImage(const std::vector<uint8_t>& file)
+{
+    Image image;
+    const uint8_t JPEG_START[2] = { 0xFF, 0xD8 };
+    const uint8_t PNG_START[4]  = { 0x89, 'P', 'N', 'G' };
+    if      (file.size() >= 2 && std::memcmp(file.data(), JPEG_START, 2) == 0)  DecodeJpeg(file, image);
+    else if (file.size() >= 4 && std::memcmp(file.data(), PNG_START,  4) == 0)  DecodePng (file, image);
+    else    throw std::runtime_error("Not a JPEG or PNG image");
+    return image;
+}
+
+#endif
+
+
+bool IsOpaque(const Image& image)
+{
+    for (size_t i = 3; i < image.pixels.size(); i += 4)  if (image.pixels[i] != 255)  return false;
+    return true;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Mip-maps
+//--------------------------------------------------------------------------------------
+
+float SRGBToLinear(float value)
+{
+    return (value <= 0.04045f) ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+}
+
+float LinearToSRGB(float value)
+{
+    return (value <= 0.0031308f) ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+}
+
+
+// The source texels and weights averaged into each texel along one axis of the next mip down. Even sizes average each
+// pair. Odd sizes (2m+1 texels down to m) take three texels for each, weighted by how much of each one the mip texel
+// covers, so every texel counts equally and the last row or column isn't dropped. A size of 1 stays 1
+struct MipTaps
+{
+    int   texel[3];
+    float weight[3];
+    int   count;
+};
+
+std::vector<MipTaps> MipFilterTaps(int size)
+{
+    int mipSize = std::max(1, size / 2);
+    std::vector<MipTaps> taps(mipSize);
+    for (int i = 0; i < mipSize; ++i)
+    {
+        if (size == 1)
+        {
+            taps[i] = { { 0 }, { 1.0f }, 1 };
+        }
+        else if (size % 2 == 0)
+        {
+            taps[i] = { { i * 2, i * 2 + 1 }, { 0.5f, 0.5f }, 2 };
+        }
+        else
+        {
+            float n = static_cast<float>(size);
+            taps[i] = { { i * 2, i * 2 + 1, i * 2 + 2 }, { (mipSize - i) / n, mipSize / n, (i + 1) / n }, 3 };
+        }
+    }
+    return taps;
+}
+
+
+// The image followed by each smaller mip down to 1x1. Colour is averaged in linear light, alpha as it is. Each mip is
+// made from the full precision linear version of the one above, so rounding doesn't build up down the chain
+std::vector<Image> BuildMipChain(const Image& image)
+{
+    float toLinear[256];
+    for (int i = 0; i < 256; ++i)  toLinear[i] = SRGBToLinear(i / 255.0f);
+
+    int width = image.width, height = image.height;
+    std::vector<float> linear(image.pixels.size());
+    for (size_t i = 0; i < image.pixels.size(); ++i)
+    {
+        linear[i] = ((i & 3) == 3) ? image.pixels[i] / 255.0f : toLinear[image.pixels[i]];
+    }
+
+    std::vector<Image> mips = { image };
+    while (width > 1 || height > 1)
+    {
+        // Each mip texel is a weighted sum of up to 3x3 texels of the one above (see MipFilterTaps)
+        std::vector<MipTaps> xTaps = MipFilterTaps(width);
+        std::vector<MipTaps> yTaps = MipFilterTaps(height);
+        int mipWidth  = static_cast<int>(xTaps.size());
+        int mipHeight = static_cast<int>(yTaps.size());
+        std::vector<float> mipLinear(static_cast<size_t>(mipWidth) * mipHeight * 4);
+        Image mip;
+        mip.width  = mipWidth;
+        mip.height = mipHeight;
+        mip.pixels.resize(mipLinear.size());
+        for (int y = 0; y < mipHeight; ++y)
+        {
+            const MipTaps& yTap = yTaps[y];
+            for (int x = 0; x < mipWidth; ++x)
+            {
+                const MipTaps& xTap = xTaps[x];
+                for (int c = 0; c < 4; ++c)
+                {
+                    float value = 0;
+                    for (int ty = 0; ty < yTap.count; ++ty)
+                    {
+                        for (int tx = 0; tx < xTap.count; ++tx)
+                        {
+                            size_t source = (static_cast<size_t>(yTap.texel[ty]) * width + xTap.texel[tx]) * 4 + c;
+                            value += linear[source] * yTap.weight[ty] * xTap.weight[tx];
+                        }
+                    }
+                    size_t i = (static_cast<size_t>(y) * mipWidth + x) * 4 + c;
+                    mipLinear[i] = value;
+                    float encoded = (c == 3) ? value : LinearToSRGB(value);
+                    mip.pixels[i] = static_cast<uint8_t>(std::min(255.0f, std::max(0.0f, encoded * 255.0f + 0.5f)));
+                }
+            }
+        }
+        mips.push_back(std::move(mip));
+        linear.swap(mipLinear);
+        width  = mipWidth;
+        height = mipHeight;
+    }
+    return mips;
+}
+
+
+//--------------------------------------------------------------------------------------
+// DDS files
+//--------------------------------------------------------------------------------------
+// A DDS file is "DDS " followed by a header and, for formats newer than DirectX 9 such as BC7, a DX10 header with the
+// DXGI format. BC1 and BC3 can be written with the older DXT1 and DXT5 codes, which every DDS loader reads. The mips
+// follow, largest first
+
+struct DDSPixelFormat
+{
+    uint32_t size;
+    uint32_t flags;
+    uint32_t fourCC;
+    uint32_t rgbBitCount;
+    uint32_t rBitMask, gBitMask, bBitMask, aBitMask;
+};
+
+struct DDSHeader
+{
+    uint32_t       size;
+    uint32_t       flags;
+    uint32_t       height;
+    uint32_t       width;
+    uint32_t       pitchOrLinearSize;
+    uint32_t       depth;
+    uint32_t       mipMapCount;
+    uint32_t       reserved1[11];
+    DDSPixelFormat pixelFormat;
+    uint32_t       caps, caps2, caps3, caps4;
+    uint32_t       reserved2;
+};
+
+struct DDSHeaderDX10
+{
+    uint32_t dxgiFormat;
+    uint32_t resourceDimension;
+    uint32_t miscFlag;
+    uint32_t arraySize;
+    uint32_t miscFlags2;
+};
+
+static_assert(sizeof(DDSHeader) == 124 && sizeof(DDSHeaderDX10) == 20, "DDS headers must match the file layout");
+
+constexpr uint32_t FourCC(char a, char b, char c, char d)
+{
+    return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+
+const uint32_t DDS_MAGIC = FourCC('D', 'D', 'S', ' ');
+
+// Header flags
+const uint32_t DDSD_CAPS        = 0x1;
+const uint32_t DDSD_HEIGHT      = 0x2;
+const uint32_t DDSD_WIDTH       = 0x4;
+const uint32_t DDSD_PIXELFORMAT = 0x1000;
+const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+const uint32_t DDSD_LINEARSIZE  = 0x80000;
+const uint32_t DDPF_FOURCC      = 0x4;
+const uint32_t DDSCAPS_COMPLEX  = 0x8;
+const uint32_t DDSCAPS_TEXTURE  = 0x1000;
+const uint32_t DDSCAPS_MIPMAP   = 0x400000;
+const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+
+// DXGI_FORMAT values (dxgiformat.h), the sRGB version of each is one more
+const uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+const uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+const uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+
+
+// Write a .dds file holding the given compressed mips of an image of the given size
+void WriteDDS(const std::string& fileName, BlockFormat format, bool srgb, int width, int height,
+              const std::vector<std::vector<uint8_t>>& mips)
+{
+    DDSHeader header = {};
+    header.size              = sizeof(DDSHeader);
+    header.flags             = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_LINEARSIZE;
+    header.height            = static_cast<uint32_t>(height);
+    header.width             = static_cast<uint32_t>(width);
+    header.pitchOrLinearSize = static_cast<uint32_t>(mips[0].size());
+    header.mipMapCount       = static_cast<uint32_t>(mips.size());
+    header.pixelFormat.size  = sizeof(DDSPixelFormat);
+    header.pixelFormat.flags = DDPF_FOURCC;
+    header.caps              = DDSCAPS_TEXTURE | (mips.size() > 1 ? DDSCAPS_COMPLEX | DDSCAPS_MIPMAP : 0);
+
+    DDSHeaderDX10 headerDX10 = {};
+    bool useDX10 = srgb || format == BlockFormat::BC7;
+    if (useDX10)
+    {
+        uint32_t dxgiFormat = (format == BlockFormat::BC1) ? DXGI_FORMAT_BC1_UNORM :
+                              (format == BlockFormat::BC3) ? DXGI_FORMAT_BC3_UNORM : DXGI_FORMAT_BC7_UNORM;
+        header.pixelFormat.fourCC    = FourCC('D', 'X', '1', '0');
+        headerDX10.dxgiFormat        = dxgiFormat + (srgb ? 1 : 0);
+        headerDX10.resourceDimension = DDS_DIMENSION_TEXTURE2D;
+        headerDX10.arraySize         = 1;
+    }
+    else
+    {
+        header.pixelFormat.fourCC = (format == BlockFormat::BC1) ? FourCC('D', 'X', 'T', '1') : FourCC('D', 'X', 'T', '5');
+    }
+
+    std::ofstream file(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())  throw std::runtime_error("Cannot write " + fileName);
+    file.write(reinterpret_cast<const char*>(&DDS_MAGIC), sizeof(DDS_MAGIC));
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (useDX10)  file.write(reinterpret_cast<const char*>(&headerDX10), sizeof(headerDX10));
+    for (auto& mip : mips)  file.write(reinterpret_cast<const char*>(mip.data()), mip.size());
+    if (!file)  throw std::runtime_error("Cannot write " + fileName);
+}
+
+
+// A .dds file written by this tool, read back
+struct DDSTexture
+{
+    int         width  = 0;
+    int         height = 0;
+    BlockFormat format = BlockFormat::BC1;
+    std::vector<const uint8_t*> mips; // Points into the file data
+};
+
+// Check a .dds file's headers and find where each mip starts, which is all the DDS loader does on the CPU before
+// creating the texture. Only reads the formats this tool writes
+DDSTexture ParseDDS(const std::vector<uint8_t>& file)
+{
+    DDSHeader header;
+    if (file.size() < 4 + sizeof(header) || std::memcmp(file.data(), &DDS_MAGIC, 4) != 0)  throw std::runtime_error("Not a DDS file");
+    std::memcpy(&header, file.data() + 4, sizeof(header));
+    size_t offset = 4 + sizeof(header);
+
+    DDSTexture texture;
+    texture.width  = static_cast<int>(header.width);
+    texture.height = static_cast<int>(header.height);
+    uint32_t fourCC = header.pixelFormat.fourCC;
+    if      (fourCC == FourCC('D', 'X', 'T', '1'))  texture.format = BlockFormat::BC1;
+    else if (fourCC == FourCC('D', 'X', 'T', '5'))  texture.format = BlockFormat::BC3;
+    else if (fourCC == FourCC('D', 'X', '1', '0'))
+    {
+        DDSHeaderDX10 headerDX10;
+        if (file.size() < offset + sizeof(headerDX10))  throw std::runtime_error("DDS file too short");
+        std::memcpy(&headerDX10, file.data() + offset, sizeof(headerDX10));
+        offset += sizeof(headerDX10);
+
+        uint32_t unorm = headerDX10.dxgiFormat & ~1u; // The sRGB formats are one more than the UNORM formats (all odd)
+        if      (unorm == DXGI_FORMAT_BC1_UNORM)      texture.format = BlockFormat::BC1;
+        else if (unorm == DXGI_FORMAT_BC3_UNORM)      texture.format = BlockFormat::BC3;
+        else if (unorm == DXGI_FORMAT_BC7_UNORM)      texture.format = BlockFormat::BC7;
+        else    throw std::runtime_error("Unsupported DDS format");
+    }
+    else
+    {
+        throw std::runtime_error("Unsupported DDS format");
+    }
+
+    int width = texture.width, height = texture.height;
+    for (uint32_t mip = 0; mip < std::max(1u, header.mipMapCount); ++mip)
+    {
+        size_t mipSize = CompressedSize(texture.format, width, height);
+        if (file.size() < offset + mipSize)  throw std::runtime_error("DDS file too short");
+        texture.mips.push_back(file.data() + offset);
+        offset += mipSize;
+        width  = std::max(1, width  / 2);
+        height = std::max(1, height / 2);
+    }
+    return texture;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Measurements
+//--------------------------------------------------------------------------------------
+
+// Returns the average time in milliseconds taken by the given function over a number of runs
+template <class F>
+double AverageTimeMs(int runs, F function)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int run = 0; run < runs; ++run)
+    {
+        function();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count() / runs;
+}
+
+
+// Peak signal to noise ratio in dB between two images of the same size, higher is closer. Compares alpha too if asked
+double PSNR(const std::vector<uint8_t>& original, const std::vector<uint8_t>& compressed, bool includeAlpha)
+{
+    double squaredError = 0;
+    size_t count = 0;
+    for (size_t i = 0; i < original.size(); ++i)
+    {
+        if ((i & 3) == 3 && !includeAlpha)  continue;
+        double difference = static_cast<double>(original[i]) - compressed[i];
+        squaredError += difference * difference;
+        ++count;
+    }
+    if (squaredError == 0)  return 99.0;
+    return 10.0 * std::log10(255.0 * 255.0 / (squaredError / count));
+}
+
+
+std::string FormatName(BlockFormat format)
+{
+    return (format == BlockFormat::BC1) ? "BC1" : (format == BlockFormat::BC3) ? "BC3" : "BC7";
+}
+
+
+int main(int argc, char* argv[])
+{
+    std::string formatName = "auto";
+    bool srgb          = false;
+    int  numThreads    = -1;
+    int  benchmarkRuns = 0;
+    std::vector<std::string> fileNames;
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        std::string argument = argv[arg];
+        if (argument == "-format" && arg + 1 < argc)
+        {
+            formatName = argv[++arg];
+        }
+        else if (argument == "-srgb")
+        {
+            srgb = true;
+        }
+        else if (argument == "-threads" && arg + 1 < argc)
+        {
+            numThreads = std::stoi(argv[++arg]);
+        }
+        else if (argument == "-bench" && arg + 1 < argc)
+        {
+            benchmarkRuns = std::max(1, std::stoi(argv[++arg]));
+        }
+        else
+        {
+            fileNames.push_back(argument);
+        }
+    }
+
+    if (fileNames.empty() || (formatName != "auto" && formatName != "bc1" && formatName != "bc3" && formatName != "bc7"))
+    {
+        std::cout << "Usage: TextureCooker [-format <bc1|bc3|bc7|auto>] [-srgb] [-threads <threads>] [-bench <runs>] <image file> [<image file> ...]\n";
+        return 1;
+    }
+
+    // The calling thread compresses too, so it is one fewer worker than threads
+    JobSystem jobs(numThreads < 0 ? -1 : std::max(0, numThreads - 1));
+
+
+    int failures = 0;
+    for (auto& fileName : fileNames)
+    {
+        try
+        {
+            std::vector<uint8_t> fileData = ReadFile(fileName);
+            Image image = DecodeImage(fileData);
+
+            bool opaque = IsOpaque(image);
+            BlockFormat format = (formatName == "bc1") ? BlockFormat::BC1 :
+                                 (formatName == "bc3") ? BlockFormat::BC3 :
+                                 (formatName == "bc7") ? BlockFormat::BC7 : (opaque ? BlockFormat::BC1 : BlockFormat::BC3);
+
+            auto cookStart = std::chrono::high_resolution_clock::now();
+            std::vector<Image> mips = BuildMipChain(image);
+            auto mipsEnd = std::chrono::high_resolution_clock::now();
+            std::vector<std::vector<uint8_t>> compressed;
+            for (auto& mip : mips)  compressed.push_back(CompressImage(format, mip.pixels.data(), mip.width, mip.height, &jobs));
+            auto cookEnd = std::chrono::high_resolution_clock::now();
+            double mipsMs     = std::chrono::duration<double, std::milli>(mipsEnd - cookStart).count();
+            double compressMs = std::chrono::duration<double, std::milli>(cookEnd - mipsEnd).count();
+
+            std::string ddsFileName = fileName.substr(0, fileName.find_last_of('.')) + ".dds";
+            WriteDDS(ddsFileName, format, srgb, image.width, image.height, compressed);
+
+            // Read the file back to check it and measure the error of the largest mip
+            std::vector<uint8_t> ddsData = ReadFile(ddsFileName);
+            DDSTexture texture = ParseDDS(ddsData);
+            std::vector<uint8_t> decoded = DecompressImage(texture.format, texture.mips[0], texture.width, texture.height);
+            double psnr = PSNR(image.pixels, decoded, format != BlockFormat::BC1);
+
+            size_t uncompressedBytes = 0, compressedBytes = 0;
+            for (size_t mip = 0; mip < mips.size(); ++mip)
+            {
+                uncompressedBytes += mips[mip].pixels.size();
+                compressedBytes   += compressed[mip].size();
+            }
+
+            std::cout << std::fixed << std::setprecision(1)
+                      << fileName << " -> " << ddsFileName << ": " << image.width << "x" << image.height << ", "
+                      << mips.size() << " mips, " << FormatName(format) << (srgb ? " sRGB" : "") << (opaque ? ", opaque" : ", with alpha")
+                      << ", PSNR " << psnr << "dB" << (format != BlockFormat::BC1 ? " (RGBA)" : " (RGB)") << "\n"
+                      << std::setprecision(2)
+                      << "    mips " << mipsMs << "ms, compression " << compressMs << "ms on " << jobs.NumThreads() << " threads\n";
+
+            if (benchmarkRuns > 0)
+            {
+                // WIC reads and decodes the image, then the GPU generates the mips. The DDS loader reads the file and
+                // finds the mips, then copies them to the GPU. The copies to the GPU aren't timed
+                double decodeMs = AverageTimeMs(benchmarkRuns, [&]() { DecodeImage(ReadFile(fileName)); });
+                double ddsMs    = AverageTimeMs(benchmarkRuns, [&]() { std::vector<uint8_t> data = ReadFile(ddsFileName);  ParseDDS(data); });
+
+                // Compression of the largest mip alone on the calling thread, to compare with the time using all threads
+                double singleThreadMs = AverageTimeMs(benchmarkRuns, [&]() { CompressImage(format, image.pixels.data(), image.width, image.height); });
+                double threadsMs      = AverageTimeMs(benchmarkRuns, [&]() { CompressImage(format, image.pixels.data(), image.width, image.height, &jobs); });
+
+                std::cout << "    load: read + decode (WIC path) " << decodeMs << "ms, read .dds " << ddsMs << "ms ("
+                          << std::setprecision(1) << decodeMs / std::max(ddsMs, 0.001) << "x faster)\n"
+                          << "    GPU memory: RGBA8 with mips (WIC path) " << uncompressedBytes / 1024 << "KB, .dds "
+                          << compressedBytes / 1024 << "KB (" << static_cast<double>(uncompressedBytes) / compressedBytes << "x smaller)\n"
+                          << std::setprecision(2) << "    compress largest mip: 1 thread " << singleThreadMs << "ms, "
+                          << jobs.NumThreads() << " threads " << threadsMs << "ms (" << std::setprecision(1)
+                          << singleThreadMs / std::max(threadsMs, 0.001) << "x faster)\n";
+            }
+        }
+        catch (const std::runtime_error& e)
+        {
+            std::cout << "Error: " << fileName << ": " << e.what() << "\n";
+            ++failures;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,364 @@
+//--------------------------------------------------------------------------------------
+// Transform benchmark
+//--------------------------------------------------------------------------------------
+// Command line tool that times rebuilding the world matrices of many models each frame:
+// - Per-object: each model is a separately allocated object holding its own position, rotation, scale, world matrix
+//   and dirty flag, and rebuilds its matrix on its own. This is how Model worked before the transform store
+// - Store, scalar: the transform store (TransformStore.h) rebuilding one dirty matrix at a time
+// - Store, SIMD: the store's batch update, four matrices at a time
+// - Store, SIMD threads: the batch update split into jobs on the job system (JobSystem.h)
+// Three cases are run: every model moved, a tenth of the models moved in one block, and a tenth moved scattered at
+// random. Only the matrix rebuild is timed, not moving the models. The matrices from the SIMD update are checked
+// against the scalar ones.
+//
+// Then the same for hierarchies of transforms, where each transform is relative to its parent. Two shapes of tree are
+// tested, deep (chains of 1000 transforms, each the child of the one before) and wide (one root with all the other
+// transforms as its children). Each is timed with all the roots moved (so every world matrix changes), 100 different
+// random transforms moved (with their subtrees) and nothing moved. The store is compared with a full pass that rebuilds
+// every world matrix from its parent's each frame, which is what is needed without dirty flags.
+//
+// Only uses standard C++, so it also builds on Linux, e.g. from the repository folder:
+//   g++ -std=c++17 -O2 -I. -IUtility -IMath -o TransformBench Tools/TransformBench/TransformBench.cpp TransformStore.cpp
+//       Utility/FrameStats.cpp Utility/JobSystem.cpp Math/CMatrix4x4.cpp Math/CVector3.cpp -lpthread
+//
+// Usage: TransformBench [-transforms <transforms>] [-nodes <nodes>] [-frames <frames>] [-threads <threads>]
+//   -transforms <transforms>  Number of models (default 100000)
+//   -nodes <nodes>            Number of transforms in each hierarchy (default 100000)
+//   -frames <frames>          Number of frames to run for each case (default 100)
+//   -threads <threads>        Threads used by the threaded update (default: number of CPU cores)
+//
+// Returns 0 on success, 1 if the SIMD matrices differ from the scalar ones, or the hierarchy matrices from the full
+// pass, by more than a small tolerance.
+
+#include "TransformStore.h"
+#include "JobSystem.h"
+#include "FrameStats.h"
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+#include <cmath>
+
+
+//--------------------------------------------------------------------------------------
+
+using Clock = std::chrono::steady_clock;
+
+double Microseconds(Clock::duration time)
+{
+    return std::chrono::duration<double, std::micro>(time).count();
+}
+
+
+// A model's transform as Model held it before the transform store: all its values together in one object, with the
+// matrix rebuilt when the object is asked for it
+struct PerObjectTransform
+{
+    CVector3   position;
+    CVector3   rotation;
+    CVector3   scale;
+    CMatrix4x4 worldMatrix;
+    bool       dirty = true;
+
+    void SetRotation(const CVector3& newRotation)  { rotation = newRotation;  dirty = true; }
+
+    void UpdateWorldMatrix()
+    {
+        if (!dirty)  return;
+        worldMatrix = ComposeWorldMatrix(position, rotation, scale);
+        dirty = false;
+    }
+};
+
+
+// One case: which models move each frame
+struct MoveCase
+{
+    const char*           name;
+    std::vector<uint32_t> moved; // Indices of the models moved each frame
+};
+
+
+// A transform in a hierarchy for the full pass, which rebuilds every world matrix in index order each frame
+struct HierarchyNode
+{
+    uint32_t   parent;
+    CVector3   position;
+    CVector3   rotation;
+    CVector3   scale;
+    CMatrix4x4 worldMatrix;
+};
+
+
+// Times updating a hierarchy given the parent of each node (parents before children). Prints a line for each case and
+// returns the largest difference between the store's world matrices and the full pass's, relative to the size of the
+// values (positions far down a deep chain are large)
+float HierarchyBench(const char* name, const std::vector<uint32_t>& parents, int numFrames, std::mt19937& random)
+{
+    uint32_t numNodes = static_cast<uint32_t>(parents.size());
+
+    // Small offsets and turns from each parent, so deep chains curl up rather than heading off into the distance
+    std::uniform_real_distribution<float> randomOffset(-2.0f, 2.0f);
+    std::uniform_real_distribution<float> randomAngle(-0.1f, 0.1f);
+    std::vector<HierarchyNode> nodes(numNodes);
+    TransformStore storeScalar, storeSIMD;
+    for (uint32_t i = 0; i < numNodes; ++i)
+    {
+        HierarchyNode& node = nodes[i];
+        node.parent   = parents[i];
+        node.position = { randomOffset(random), randomOffset(random), randomOffset(random) };
+        node.rotation = { randomAngle(random), randomAngle(random), randomAngle(random) };
+        node.scale    = { 1, 1, 1 };
+        for (auto store : { &storeScalar, &storeSIMD })  store->Add(node.position, node.rotation, node.scale, node.parent);
+    }
+    storeScalar.UpdateWorldMatricesScalar();
+    storeSIMD.UpdateWorldMatrices();
+
+    std::vector<uint32_t> roots;
+    for (uint32_t i = 0; i < numNodes; ++i)  if (parents[i] == NO_PARENT_TRANSFORM)  roots.push_back(i);
+    std::vector<uint32_t> nodeOrder(numNodes);
+    std::iota(nodeOrder.begin(), nodeOrder.end(), 0);
+    uint32_t numRandomMoved = std::min(100u, numNodes);
+
+    const char* caseNames[3] = { "roots moved", "100 moved", "none moved" };
+    float maxError = 0;
+    for (int caseIndex = 0; caseIndex < 3; ++caseIndex)
+    {
+        Clock::duration total[3] = {};
+        int numBuilt = 0;
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            // Turn the moved transforms. Not timed
+            std::vector<uint32_t> moved;
+            if      (caseIndex == 0)  moved = roots;
+            else if (caseIndex == 1)
+            {
+                // 100 different transforms, the start of a partial shuffle of all of them
+                for (uint32_t i = 0; i < numRandomMoved; ++i)
+                {
+                    std::uniform_int_distribution<uint32_t> randomNode(i, numNodes - 1);
+                    std::swap(nodeOrder[i], nodeOrder[randomNode(random)]);
+                }
+                moved.assign(nodeOrder.begin(), nodeOrder.begin() + numRandomMoved);
+            }
+            for (uint32_t i : moved)
+            {
+                nodes[i].rotation.y += 0.01f;
+                for (auto store : { &storeScalar, &storeSIMD })  store->SetRotation(i, nodes[i].rotation);
+            }
+
+            auto start = Clock::now();
+            for (auto& node : nodes)
+            {
+                node.worldMatrix = ComposeWorldMatrix(node.position, node.rotation, node.scale);
+                if (node.parent != NO_PARENT_TRANSFORM)  node.worldMatrix *= nodes[node.parent].worldMatrix;
+            }
+            auto fullDone = Clock::now();
+            storeScalar.UpdateWorldMatricesScalar();
+            auto scalarDone = Clock::now();
+            numBuilt += storeSIMD.UpdateWorldMatrices();
+            auto simdDone = Clock::now();
+
+            total[0] += fullDone   - start;
+            total[1] += scalarDone - fullDone;
+            total[2] += simdDone   - scalarDone;
+        }
+
+        std::cout << std::left << std::setw(5) << name << std::setw(12) << caseNames[caseIndex] << std::right;
+        for (auto time : total)  std::cout << std::setw(12) << Microseconds(time) / numFrames;
+        std::cout << std::setw(14) << numBuilt / numFrames << "\n";
+
+        for (uint32_t i = 0; i < numNodes; ++i)
+        {
+            const float* full   = &nodes[i].worldMatrix.e00;
+            const float* scalar = &storeScalar.WorldMatrix(i).e00;
+            const float* simd   = &storeSIMD.WorldMatrix(i).e00;
+            for (int e = 0; e < 16; ++e)
+            {
+                float size = std::max(1.0f, std::abs(full[e]));
+                maxError = std::max(maxError, std::abs(full[e] - scalar[e]) / size);
+                maxError = std::max(maxError, std::abs(full[e] - simd[e])   / size);
+            }
+        }
+    }
+    return maxError;
+}
+
+
+int main(int argc, char* argv[])
+{
+    int numTransforms = 100000;
+    int numNodes      = 100000;
+    int numFrames     = 100;
+    int numThreads    = std::max(1u, std::thread::hardware_concurrency());
+    for (int arg = 1; arg + 1 < argc; arg += 2)
+    {
+        std::string argument = argv[arg];
+        if      (argument == "-transforms")  numTransforms = std::max(1, std::stoi(argv[arg + 1]));
+        else if (argument == "-nodes")       numNodes      = std::max(2, std::stoi(argv[arg + 1]));
+        else if (argument == "-frames")      numFrames     = std::max(1, std::stoi(argv[arg + 1]));
+        else if (argument == "-threads")     numThreads    = std::max(1, std::stoi(argv[arg + 1]));
+    }
+
+
+    //-----------------------------------
+    // Setup
+    //-----------------------------------
+
+    // Random transforms. Each per-object transform is allocated on its own, as the models were
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> randomPosition(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> randomAngle(-3.14159f, 3.14159f);
+    std::uniform_real_distribution<float> randomScale(0.5f, 2.0f);
+
+    TransformStore storeScalar, storeSIMD, storeThreaded;
+    std::vector<std::unique_ptr<PerObjectTransform>> objects;
+    for (int i = 0; i < numTransforms; ++i)
+    {
+        CVector3 position = { randomPosition(random), randomPosition(random), randomPosition(random) };
+        CVector3 rotation = { randomAngle(random), randomAngle(random), randomAngle(random) };
+        float    scale    = randomScale(random);
+
+        auto object = std::make_unique<PerObjectTransform>();
+        object->position = position;
+        object->rotation = rotation;
+        object->scale    = { scale, scale, scale };
+        objects.push_back(std::move(object));
+
+        for (auto store : { &storeScalar, &storeSIMD, &storeThreaded })  store->Add(position, rotation, { scale, scale, scale });
+    }
+    for (auto& object : objects)  object->UpdateWorldMatrix();
+    storeScalar.UpdateWorldMatricesScalar();
+    storeSIMD.UpdateWorldMatrices();
+    JobSystem jobs(numThreads - 1); // The main thread makes up the last
+    storeThreaded.UpdateWorldMatrices(&jobs);
+
+    // The cases
+    MoveCase cases[3] = { { "All moved", {} }, { "10% in a block", {} }, { "10% scattered", {} } };
+    for (int i = 0; i < numTransforms; ++i)  cases[0].moved.push_back(i);
+    int tenth = std::max(1, numTransforms / 10);
+    for (int i = 0; i < tenth; ++i)  cases[1].moved.push_back(numTransforms / 2 - tenth / 2 + i);
+    std::vector<uint32_t> shuffled = cases[0].moved;
+    std::shuffle(shuffled.begin(), shuffled.end(), random);
+    cases[2].moved.assign(shuffled.begin(), shuffled.begin() + tenth);
+    std::sort(cases[2].moved.begin(), cases[2].moved.end());
+
+
+    //-----------------------------------
+    // Frames
+    //-----------------------------------
+
+    const int NUM_METHODS = 4;
+    double times[3][NUM_METHODS] = {}; // Microseconds per frame for each case and method
+    float maxError = 0;
+    for (int caseIndex = 0; caseIndex < 3; ++caseIndex)
+    {
+        const std::vector<uint32_t>& moved = cases[caseIndex].moved;
+        Clock::duration total[NUM_METHODS] = {};
+        for (int frame = 0; frame < numFrames; ++frame)
+        {
+            // Turn each moved model a little. Not timed
+            float turn = 0.01f * (frame + 1);
+            for (uint32_t i : moved)
+            {
+                CVector3 rotation = objects[i]->rotation;
+                rotation.y += turn;
+                objects[i]->SetRotation(rotation);
+                for (auto store : { &storeScalar, &storeSIMD, &storeThreaded })  store->SetRotation(i, rotation);
+            }
+
+            // Each method in turn
+            auto start = Clock::now();
+            for (auto& object : objects)  object->UpdateWorldMatrix();
+            auto perObjectDone = Clock::now();
+            storeScalar.UpdateWorldMatricesScalar();
+            auto scalarDone = Clock::now();
+            storeSIMD.UpdateWorldMatrices();
+            auto simdDone = Clock::now();
+            storeThreaded.UpdateWorldMatrices(&jobs);
+            auto threadedDone = Clock::now();
+
+            total[0] += perObjectDone - start;
+            total[1] += scalarDone    - perObjectDone;
+            total[2] += simdDone      - scalarDone;
+            total[3] += threadedDone  - simdDone;
+        }
+        for (int method = 0; method < NUM_METHODS; ++method)  times[caseIndex][method] = Microseconds(total[method]) / numFrames;
+
+        // Compare the batch results with the one-at-a-time results
+        for (uint32_t i : moved)
+        {
+            const float* scalar   = &storeScalar.WorldMatrix(i).e00;
+            const float* simd     = &storeSIMD.WorldMatrix(i).e00;
+            const float* threaded = &storeThreaded.WorldMatrix(i).e00;
+            for (int e = 0; e < 16; ++e)
+            {
+                maxError = std::max(maxError, std::abs(scalar[e] - simd[e]));
+                maxError = std::max(maxError, std::abs(scalar[e] - threaded[e]));
+            }
+        }
+    }
+
+
+    //-----------------------------------
+    // Report
+    //-----------------------------------
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << numTransforms << " transforms, " << numFrames << " frames per case, " << numThreads << " threads"
+#ifdef CMATRIX4X4_SSE
+              << ", SSE\n\n";
+#else
+              << ", no SIMD\n\n";
+#endif
+    std::cout << "us per frame      Per-object  Store scalar  Store SIMD  SIMD threads\n";
+    for (int caseIndex = 0; caseIndex < 3; ++caseIndex)
+    {
+        std::cout << std::left << std::setw(16) << cases[caseIndex].name << std::right;
+        for (int method = 0; method < NUM_METHODS; ++method)  std::cout << std::setw(12 + (method == 1 ? 2 : 0)) << times[caseIndex][method];
+        std::cout << "\n";
+    }
+    std::cout << "Speed-up of SIMD over per-object, all moved: " << std::setprecision(2)
+              << times[0][0] / std::max(times[0][2], 0.001) << "x (threads " << times[0][0] / std::max(times[0][3], 0.001) << "x)\n";
+    std::cout << std::scientific << "Largest difference from scalar matrices: " << maxError << "\n";
+
+
+    //-----------------------------------
+    // Hierarchies
+    //-----------------------------------
+
+    // Deep: chains of 1000, each transform the child of the one before. Wide: all children of the first transform
+    const uint32_t CHAIN_LENGTH = 1000;
+    std::vector<uint32_t> deepParents(numNodes), wideParents(numNodes);
+    for (uint32_t i = 0; i < static_cast<uint32_t>(numNodes); ++i)
+    {
+        deepParents[i] = (i % CHAIN_LENGTH == 0) ? NO_PARENT_TRANSFORM : i - 1;
+        wideParents[i] = (i == 0)                ? NO_PARENT_TRANSFORM : 0;
+    }
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "\n" << numNodes << " node hierarchies, deep is chains of " << CHAIN_LENGTH << "\n\n";
+    std::cout << "us per frame       Full pass  Store scalar  Store SIMD  Matrices built\n";
+    float hierarchyError = HierarchyBench("Deep", deepParents, numFrames, random);
+    hierarchyError = std::max(hierarchyError, HierarchyBench("Wide", wideParents, numFrames, random));
+    std::cout << std::scientific << "Largest relative difference from full pass matrices: " << hierarchyError << "\n";
+
+    // Matrix elements are at most about the largest scale (2) or position (500). The SIMD sin/cos are accurate to a few
+    // units in the last place, positions are copied exactly. Hierarchies are compared relative to the size of each
+    // value, as the small differences build up down a chain of 1000 multiplies
+    const float TOLERANCE = 1e-5f;
+    const float HIERARCHY_TOLERANCE = 1e-3f;
+    if (maxError > TOLERANCE || hierarchyError > HIERARCHY_TOLERANCE)
+    {
+        std::cout << "Error: matrices differ from the reference by more than the tolerance\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,475 @@
+//--------------------------------------------------------------------------------------
+// Transform store
+//--------------------------------------------------------------------------------------
+
+#include "TransformStore.h"
+#include "JobSystem.h"
+#include "FrameStats.h"
+
+#include <atomic>
+#include <initializer_list>
+#include <algorithm>
+#include <cmath>
+
+#ifdef CMATRIX4X4_SSE
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// World matrix building
+//--------------------------------------------------------------------------------------
+
+// Returns the world matrix for the given position, rotation (Euler angles in radians) and scale. Same result as
+// MatrixScaling(scale) * MatrixRotationZ(z) * MatrixRotationX(x) * MatrixRotationY(y) * MatrixTranslation(position)
+CMatrix4x4 ComposeWorldMatrix(const CVector3& position, const CVector3& rotation, const CVector3& scale)
+{
+    // The rotation part of the multiplies above works out to the terms below, each row of the rotation is then scaled
+    // and the position goes in the bottom row. Avoids four full 4x4 matrix multiplies
+    float sX = std::sin(rotation.x);  float cX = std::cos(rotation.x);
+    float sY = std::sin(rotation.y);  float cY = std::cos(rotation.y);
+    float sZ = std::sin(rotation.z);  float cZ = std::cos(rotation.z);
+
+    CMatrix4x4 m;
+    m.e00 = (cZ*cY + sZ*sX*sY) * scale.x;
+    m.e01 = (sZ*cX)            * scale.x;
+    m.e02 = (sZ*sX*cY - cZ*sY) * scale.x;
+    m.e03 = 0;
+
+    m.e10 = (cZ*sX*sY - sZ*cY) * scale.y;
+    m.e11 = (cZ*cX)            * scale.y;
+    m.e12 = (sZ*sY + cZ*sX*cY) * scale.y;
+    m.e13 = 0;
+
+    m.e20 = (cX*sY)            * scale.z;
+    m.e21 = -sX                * scale.z;
+    m.e22 = (cX*cY)            * scale.z;
+    m.e23 = 0;
+
+    m.e30 = position.x;
+    m.e31 = position.y;
+    m.e32 = position.z;
+    m.e33 = 1;
+    return m;
+}
+
+
+namespace
+{
+    // Returns the position of the lowest set bit in a non-zero value
+    uint32_t LowestBit(uint64_t bits)
+    {
+#ifdef _MSC_VER
+        // The 64-bit version of this intrinsic is only available on x64
+        unsigned long index;
+        if (_BitScanForward(&index, static_cast<unsigned long>(bits)))  return index;
+        _BitScanForward(&index, static_cast<unsigned long>(bits >> 32));
+        return index + 32;
+#else
+        return __builtin_ctzll(bits);
+#endif
+    }
+}
+
+
+#ifdef CMATRIX4X4_SSE
+namespace
+{
+    // Sine and cosine of four angles at once. Same method as the Cephes maths library's sinf/cosf: the angle is reduced
+    // to the range -PI/4 to PI/4 by subtracting a multiple of PI/2 (in three parts for accuracy), then one of two
+    // polynomials gives the sine or cosine of the reduced angle. Accurate to a few units in the last place for angles up
+    // to several thousand radians
+    void SinCos4(__m128 x, __m128& sinOut, __m128& cosOut)
+    {
+        const __m128  signMask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+        const __m128i one      = _mm_set1_epi32(1);
+        const __m128i two      = _mm_set1_epi32(2);
+        const __m128i four     = _mm_set1_epi32(4);
+
+        // Work with the absolute angle, sin(-x) = -sin(x)
+        __m128 sinSign = _mm_and_ps(x, signMask);
+        x = _mm_andnot_ps(signMask, x);
+
+        // Number of eighths of a turn, rounded up to an even number: the multiple of PI/4 to subtract
+        __m128i octant = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f))); // 4/PI
+        octant = _mm_and_si128(_mm_add_epi32(octant, one), _mm_set1_epi32(~1));
+        __m128 y = _mm_cvtepi32_ps(octant);
+
+        // Sign changes and which polynomial gives which result, from the octant
+        __m128 sinSwap  = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(octant, four), 29));
+        __m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(octant, two), _mm_setzero_si128()));
+        __m128 cosSign  = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(octant, two), four), 29));
+        sinSign = _mm_xor_ps(sinSign, sinSwap);
+
+        // Reduced angle
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+        x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+        __m128 z = _mm_mul_ps(x, x);
+
+        // Cosine polynomial
+        __m128 cosPoly = _mm_set1_ps(2.443315711809948e-5f);
+        cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(-1.388731625493765e-3f));
+        cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(4.166664568298827e-2f));
+        cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+        cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+        // Sine polynomial
+        __m128 sinPoly = _mm_set1_ps(-1.9515295891e-4f);
+        sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(8.3321608736e-3f));
+        sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(-1.6666654611e-1f));
+        sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+        // Pick each result from the polynomial for its octant and apply the signs
+        __m128 sinResult = _mm_or_ps(_mm_and_ps(polyMask, sinPoly), _mm_andnot_ps(polyMask, cosPoly));
+        __m128 cosResult = _mm_or_ps(_mm_and_ps(polyMask, cosPoly), _mm_andnot_ps(polyMask, sinPoly));
+        sinOut = _mm_xor_ps(sinResult, sinSign);
+        cosOut = _mm_xor_ps(cosResult, cosSign);
+    }
+
+
+    // Build four world matrices from transforms first to first + 3 of the given arrays. Each SIMD register holds the same
+    // matrix element for the four transforms, which are then transposed into four rows of four matrices to be stored
+    void ComposeWorldMatrices4(const float* positionX, const float* positionY, const float* positionZ,
+                               const float* rotationX, const float* rotationY, const float* rotationZ,
+                               const float* scaleX,    const float* scaleY,    const float* scaleZ,
+                               CMatrix4x4* matrices)
+    {
+        __m128 sX, cX, sY, cY, sZ, cZ;
+        SinCos4(_mm_loadu_ps(rotationX), sX, cX);
+        SinCos4(_mm_loadu_ps(rotationY), sY, cY);
+        SinCos4(_mm_loadu_ps(rotationZ), sZ, cZ);
+        __m128 scX = _mm_loadu_ps(scaleX);
+        __m128 scY = _mm_loadu_ps(scaleY);
+        __m128 scZ = _mm_loadu_ps(scaleZ);
+
+        // Same terms as ComposeWorldMatrix above
+        __m128 sXsY = _mm_mul_ps(sX, sY);
+        __m128 sXcY = _mm_mul_ps(sX, cY);
+        __m128 row0[4], row1[4], row2[4], row3[4];
+        row0[0] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cZ, cY), _mm_mul_ps(sZ, sXsY)), scX);
+        row0[1] = _mm_mul_ps(_mm_mul_ps(sZ, cX), scX);
+        row0[2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sZ, sXcY), _mm_mul_ps(cZ, sY)), scX);
+        row0[3] = _mm_setzero_ps();
+
+        row1[0] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cZ, sXsY), _mm_mul_ps(sZ, cY)), scY);
+        row1[1] = _mm_mul_ps(_mm_mul_ps(cZ, cX), scY);
+        row1[2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sZ, sY), _mm_mul_ps(cZ, sXcY)), scY);
+        row1[3] = _mm_setzero_ps();
+
+        row2[0] = _mm_mul_ps(_mm_mul_ps(cX, sY), scZ);
+        row2[1] = _mm_mul_ps(_mm_xor_ps(sX, _mm_set1_ps(-0.0f)), scZ);
+        row2[2] = _mm_mul_ps(_mm_mul_ps(cX, cY), scZ);
+        row2[3] = _mm_setzero_ps();
+
+        row3[0] = _mm_loadu_ps(positionX);
+        row3[1] = _mm_loadu_ps(positionY);
+        row3[2] = _mm_loadu_ps(positionZ);
+        row3[3] = _mm_set1_ps(1.0f);
+
+        // After transposing, register i holds the row for matrix i
+        _MM_TRANSPOSE4_PS(row0[0], row0[1], row0[2], row0[3]);
+        _MM_TRANSPOSE4_PS(row1[0], row1[1], row1[2], row1[3]);
+        _MM_TRANSPOSE4_PS(row2[0], row2[1], row2[2], row2[3]);
+        _MM_TRANSPOSE4_PS(row3[0], row3[1], row3[2], row3[3]);
+        for (int i = 0; i < 4; ++i)
+        {
+            float* m = &matrices[i].e00;
+            _mm_storeu_ps(m + 0,  row0[i]);
+            _mm_storeu_ps(m + 4,  row1[i]);
+            _mm_storeu_ps(m + 8,  row2[i]);
+            _mm_storeu_ps(m + 12, row3[i]);
+        }
+    }
+}
+#endif
+
+
+//--------------------------------------------------------------------------------------
+// Construction / Usage
+//--------------------------------------------------------------------------------------
+
+// Add a transform, returns its index. Its world matrix is built on the next update or read. The parent, if given,
+// must already have been added. The position, rotation and scale are then relative to the parent
+uint32_t TransformStore::Add(const CVector3& position, const CVector3& rotation, const CVector3& scale, uint32_t parent /*= NO_PARENT_TRANSFORM*/)
+{
+    uint32_t index = mSize++;
+
+    // Grow the arrays four at a time, the new padding entries are identity transforms without a parent
+    if (index >= mPositionX.size())
+    {
+        size_t newSize = mPositionX.size() + 4;
+        for (auto array : { &mPositionX, &mPositionY, &mPositionZ, &mRotationX, &mRotationY, &mRotationZ })
+        {
+            array->resize(newSize, 0.0f);
+        }
+        for (auto array : { &mScaleX, &mScaleY, &mScaleZ })  array->resize(newSize, 1.0f);
+        for (auto array : { &mParents, &mFirstChildren, &mNextSiblings })  array->resize(newSize, NO_PARENT_TRANSFORM);
+        mWorldMatrices.resize(newSize, MatrixIdentity());
+        mLocalMatrices.resize(newSize, MatrixIdentity());
+        mDirty    .resize((newSize + 63) / 64, 0);
+        mHasParent.resize((newSize + 63) / 64, 0);
+    }
+
+    mPositionX[index] = position.x;  mPositionY[index] = position.y;  mPositionZ[index] = position.z;
+    mRotationX[index] = rotation.x;  mRotationY[index] = rotation.y;  mRotationZ[index] = rotation.z;
+    mScaleX[index]    = scale.x;     mScaleY[index]    = scale.y;     mScaleZ[index]    = scale.z;
+    SetParent(index, parent); // Leaves the transform without a parent if the parent hasn't been added
+    MarkDirty(index);
+    return index;
+}
+
+
+// Remove all transforms
+void TransformStore::Clear()
+{
+    mSize = 0;
+    for (auto array : { &mPositionX, &mPositionY, &mPositionZ, &mRotationX, &mRotationY, &mRotationZ, &mScaleX, &mScaleY, &mScaleZ })
+    {
+        array->clear();
+    }
+    for (auto array : { &mParents, &mFirstChildren, &mNextSiblings, &mStack })  array->clear();
+    mWorldMatrices.clear();
+    mLocalMatrices.clear();
+    mDirty.clear();
+    mHasParent.clear();
+}
+
+
+void TransformStore::SetPosition(uint32_t index, const CVector3& position)
+{
+    mPositionX[index] = position.x;  mPositionY[index] = position.y;  mPositionZ[index] = position.z;
+    MarkDirty(index);
+}
+
+void TransformStore::SetRotation(uint32_t index, const CVector3& rotation)
+{
+    mRotationX[index] = rotation.x;  mRotationY[index] = rotation.y;  mRotationZ[index] = rotation.z;
+    MarkDirty(index);
+}
+
+void TransformStore::SetScale(uint32_t index, const CVector3& scale)
+{
+    mScaleX[index] = scale.x;  mScaleY[index] = scale.y;  mScaleZ[index] = scale.z;
+    MarkDirty(index);
+}
+
+
+// Attach a transform to a parent, or pass NO_PARENT_TRANSFORM to detach it. The parent must have a lower index, to
+// keep parents before their children. Returns false and leaves the transform unchanged if it doesn't
+bool TransformStore::SetParent(uint32_t index, uint32_t parent)
+{
+    if (parent != NO_PARENT_TRANSFORM && parent >= index)  return false;
+
+    // Remove from the old parent's list of children
+    uint32_t oldParent = mParents[index];
+    if (oldParent != NO_PARENT_TRANSFORM)
+    {
+        uint32_t* link = &mFirstChildren[oldParent];
+        while (*link != index)  link = &mNextSiblings[*link];
+        *link = mNextSiblings[index];
+        mNextSiblings[index] = NO_PARENT_TRANSFORM;
+    }
+
+    // Add to the front of the new parent's list
+    mParents[index] = parent;
+    uint64_t bit = uint64_t(1) << (index % 64);
+    if (parent != NO_PARENT_TRANSFORM)
+    {
+        mNextSiblings[index] = mFirstChildren[parent];
+        mFirstChildren[parent] = index;
+        mHasParent[index / 64] |= bit;
+    }
+    else
+    {
+        mHasParent[index / 64] &= ~bit;
+    }
+
+    MarkDirty(index);
+    return true;
+}
+
+
+// True if any of the transforms in the given set has changed since its world matrix was last built
+bool TransformStore::AnyDirty(const std::vector<uint64_t>& set)
+{
+    size_t numWords = std::min(set.size(), mDirty.size());
+    for (size_t word = 0; word < numWords; ++word)
+    {
+        if (set[word] & mDirty[word])  return true;
+    }
+    return false;
+}
+
+
+// Mark a transform and all of its descendants dirty
+void TransformStore::MarkDirty(uint32_t index)
+{
+    // The descendants of a dirty transform are always dirty too, so there is nothing to do if this one is already
+    if (IsDirty(index))  return;
+    mDirty[index / 64] |= uint64_t(1) << (index % 64);
+    if (mFirstChildren[index] == NO_PARENT_TRANSFORM)  return;
+
+    // Visit the descendants without recursion, a chain of transforms can be very deep
+    mStack.clear();
+    mStack.push_back(index);
+    while (!mStack.empty())
+    {
+        uint32_t parent = mStack.back();
+        mStack.pop_back();
+        for (uint32_t child = mFirstChildren[parent]; child != NO_PARENT_TRANSFORM; child = mNextSiblings[child])
+        {
+            if (IsDirty(child))  continue;
+            mDirty[child / 64] |= uint64_t(1) << (child % 64);
+            if (mFirstChildren[child] != NO_PARENT_TRANSFORM)  mStack.push_back(child);
+        }
+    }
+}
+
+
+// Rebuild a single world matrix and clear its dirty flag. Any dirty parents are rebuilt first
+void TransformStore::UpdateWorldMatrix(uint32_t index)
+{
+    // Collect the transform and its dirty parents. A clean parent has a clean parent too (or its children would be
+    // dirty), so this stops at the first clean one
+    mStack.clear();
+    for (uint32_t transform = index; transform != NO_PARENT_TRANSFORM && IsDirty(transform); transform = mParents[transform])
+    {
+        mStack.push_back(transform);
+    }
+
+    // Rebuild from the top down so each parent is ready for its child
+    while (!mStack.empty())
+    {
+        uint32_t transform = mStack.back();
+        mStack.pop_back();
+        mWorldMatrices[transform] = ComposeWorldMatrix(Position(transform), Rotation(transform), Scale(transform));
+        if (mParents[transform] != NO_PARENT_TRANSFORM)  mWorldMatrices[transform] *= mWorldMatrices[mParents[transform]];
+        mDirty[transform / 64] &= ~(uint64_t(1) << (transform % 64));
+        ++gFrameStats.worldMatricesBuilt;
+    }
+}
+
+
+// Rebuild the dirty matrices in the given range of dirty words. Finishes the transforms without a parent and clears
+// their flags, transforms with a parent are left for UpdateChildWorldMatrices. Returns the number rebuilt
+int TransformStore::UpdateDirtyWords(uint32_t firstWord, uint32_t endWord)
+{
+    int numBuilt = 0;
+    for (uint32_t word = firstWord; word < endWord; ++word)
+    {
+        uint64_t dirty = mDirty[word];
+        if (dirty == 0)  continue;
+        uint64_t hasParent = mHasParent[word];
+        mDirty[word] = dirty & hasParent;
+
+        // Four transforms at a time, any group of four with a dirty transform is rebuilt. Rebuilding the clean ones in
+        // the group gives the same matrix they already have (to within the accuracy of SinCos4). A group with any
+        // transforms with a parent is built into the local matrices instead, then only its dirty transforms without a
+        // parent are copied to their world matrices
+        for (uint32_t group = 0; group < 64 && (dirty >> group) != 0; group += 4)
+        {
+            uint64_t groupDirty = (dirty >> group) & 0xf;
+            if (groupDirty == 0)  continue;
+            uint32_t first = word * 64 + group;
+            if (first >= mSize)  break;
+
+            uint64_t groupHasParent = (hasParent >> group) & 0xf;
+            CMatrix4x4* matrices = (groupHasParent == 0) ? &mWorldMatrices[first] : &mLocalMatrices[first];
+#ifdef CMATRIX4X4_SSE
+            ComposeWorldMatrices4(&mPositionX[first], &mPositionY[first], &mPositionZ[first],
+                                  &mRotationX[first], &mRotationY[first], &mRotationZ[first],
+                                  &mScaleX[first],    &mScaleY[first],    &mScaleZ[first], matrices);
+#else
+            for (uint32_t i = 0; i < 4; ++i)
+            {
+                matrices[i] = ComposeWorldMatrix(Position(first + i), Rotation(first + i), Scale(first + i));
+            }
+#endif
+            if (groupHasParent != 0)
+            {
+                for (uint32_t i = 0; i < 4; ++i)
+                {
+                    if (((groupDirty & ~groupHasParent) >> i) & 1)  mWorldMatrices[first + i] = matrices[i];
+                }
+            }
+        }
+
+        // Count only the matrices that were dirty (popcount)
+        for (; dirty != 0; dirty &= dirty - 1)  ++numBuilt;
+    }
+    return numBuilt;
+}
+
+
+// Multiply the local matrices of dirty transforms with a parent by their parent's world matrix, in index order so
+// parents are done first, then clear their flags
+void TransformStore::UpdateChildWorldMatrices()
+{
+    for (uint32_t word = 0; word < mDirty.size(); ++word)
+    {
+        uint64_t dirty = mDirty[word];
+        if (dirty == 0)  continue;
+        mDirty[word] = 0;
+
+        // Only transforms with a parent are left dirty by UpdateDirtyWords. Visit each set bit, lowest first
+        for (; dirty != 0; dirty &= dirty - 1)
+        {
+            uint32_t index = word * 64 + LowestBit(dirty);
+            mWorldMatrices[index] = mLocalMatrices[index] * mWorldMatrices[mParents[index]];
+        }
+    }
+}
+
+
+// Rebuild the world matrices of all transforms that have changed since their matrix was last built. Uses SIMD
+// where available, and splits the work into jobs if given a job system and there are enough transforms to be worth
+// it. Returns the number of matrices rebuilt
+int TransformStore::UpdateWorldMatrices(JobSystem* jobs /*= nullptr*/)
+{
+    uint32_t numWords = static_cast<uint32_t>(mDirty.size());
+    int numBuilt = 0;
+    if (jobs == nullptr)
+    {
+        numBuilt = UpdateDirtyWords(0, numWords);
+    }
+    else
+    {
+        // Each job takes a separate range of whole dirty words, so no two jobs write to the same word or matrix. Taking
+        // a job costs more than rebuilding a few matrices, so each job has at least 64 words (4096 transforms)
+        const uint32_t MIN_WORDS_PER_JOB = 64;
+        std::atomic<int> jobsBuilt{ 0 };
+        JobCounter counter;
+        jobs->ParallelFor(numWords, MIN_WORDS_PER_JOB, [this, &jobsBuilt](uint32_t first, uint32_t end)
+        {
+            jobsBuilt += UpdateDirtyWords(first, end);
+        }, &counter);
+        jobs->Wait(counter);
+        numBuilt = jobsBuilt;
+    }
+
+    // Children need their parents' world matrices, so they are finished after all the jobs are done
+    UpdateChildWorldMatrices();
+
+    gFrameStats.worldMatricesBuilt += numBuilt;
+    return numBuilt;
+}
+
+
+// As UpdateWorldMatrices but one matrix at a time without SIMD or threads, the same as reading each dirty matrix in turn
+int TransformStore::UpdateWorldMatricesScalar()
+{
+    int numBuilt = 0;
+    for (uint32_t index = 0; index < mSize; ++index)
+    {
+        if (IsDirty(index))
+        {
+            UpdateWorldMatrix(index);
+            ++numBuilt;
+        }
+    }
+    return numBuilt;
+}
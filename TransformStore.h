@@ -0,0 +1,158 @@
+//--------------------------------------------------------------------------------------
+// Transform store
+//--------------------------------------------------------------------------------------
+// Holds the position, rotation and scale of many models, and the world matrices built from them. Rather than each
+// model holding its own values (which puts each model's data in a different place in memory), each value is kept in
+// its own array, e.g. all the x positions together, then all the y positions. Models refer to their transform by its
+// index (see Model.h).
+//
+// A transform can have a parent, its position, rotation and scale are then relative to the parent's world matrix, so
+// it moves with the parent (e.g. a light attached to a model). A parent always has a lower index than its children, so
+// the arrays are in an order where each parent comes before any of its children. World matrices can then be updated
+// in a single pass in index order, each parent's world matrix is ready before it is used by its children.
+//
+// Changing a transform marks it and all of its descendants dirty (stopping at any already dirty - their descendants
+// are dirty too). UpdateWorldMatrices then rebuilds the world matrices of all dirty transforms in one pass over the
+// arrays, using SIMD to build four local matrices at a time, and optionally splitting that work into jobs run on
+// several threads. Transforms with a parent have their local matrix multiplied by the parent's world matrix in a second
+// pass, which is not split as children depend on their parents. The dirty flags are bits in 64-bit words, so
+// unchanged transforms, including whole unchanged subtrees, are skipped a word at a time. A single world matrix can
+// still be read at any time - it is rebuilt on its own, along with any dirty parents, if it is dirty.
+//
+// Rebuilding a matrix on read changes the store, so WorldMatrix must only be used on one thread. Jobs running at the
+// same time must use CurrentWorldMatrix instead, which only reads. The world matrices must be brought up to date with
+// UpdateWorldMatrices before starting such jobs, and no transform may be changed until they have finished.
+
+#ifndef _TRANSFORM_STORE_H_INCLUDED_
+#define _TRANSFORM_STORE_H_INCLUDED_
+
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+
+#include <vector>
+#include <cstdint>
+#include <cassert>
+
+class JobSystem;
+
+
+//--------------------------------------------------------------------------------------
+// World matrix building
+//--------------------------------------------------------------------------------------
+
+// Value used for the parent of a transform that has no parent
+const uint32_t NO_PARENT_TRANSFORM = 0xffffffff;
+
+
+// Returns the world matrix for the given position, rotation (Euler angles in radians) and scale. Same result as
+// MatrixScaling(scale) * MatrixRotationZ(z) * MatrixRotationX(x) * MatrixRotationY(y) * MatrixTranslation(position)
+CMatrix4x4 ComposeWorldMatrix(const CVector3& position, const CVector3& rotation, const CVector3& scale);
+
+
+//--------------------------------------------------------------------------------------
+// Transform store class
+//--------------------------------------------------------------------------------------
+
+class TransformStore
+{
+public:
+    //-------------------------------------
+    // Construction / Usage
+    //-------------------------------------
+
+    // Add a transform, returns its index. Its world matrix is built on the next update or read. The parent, if given,
+    // must already have been added. The position, rotation and scale are then relative to the parent
+    uint32_t Add(const CVector3& position = { 0, 0, 0 }, const CVector3& rotation = { 0, 0, 0 }, const CVector3& scale = { 1, 1, 1 },
+                 uint32_t parent = NO_PARENT_TRANSFORM);
+
+    // Remove all transforms
+    void Clear();
+
+    // Rebuild the world matrices of all transforms that have changed since their matrix was last built. Uses SIMD
+    // where available, and splits the work into jobs if given a job system (see JobSystem.h) and there are enough
+    // transforms to be worth it. Returns the number of matrices rebuilt
+    int UpdateWorldMatrices(JobSystem* jobs = nullptr);
+
+    // As UpdateWorldMatrices but one matrix at a time without SIMD or threads, the same as reading each dirty matrix in turn.
+    // The results match UpdateWorldMatrices closely but not exactly (the SIMD sin/cos are approximations)
+    int UpdateWorldMatricesScalar();
+
+
+    //-------------------------------------
+    // Data access
+    //-------------------------------------
+
+    uint32_t Size()  { return mSize; }
+
+    CVector3 Position(uint32_t index)  { return { mPositionX[index], mPositionY[index], mPositionZ[index] }; }
+    CVector3 Rotation(uint32_t index)  { return { mRotationX[index], mRotationY[index], mRotationZ[index] }; }
+    CVector3 Scale   (uint32_t index)  { return { mScaleX[index],    mScaleY[index],    mScaleZ[index]    }; }
+
+    void SetPosition(uint32_t index, const CVector3& position);
+    void SetRotation(uint32_t index, const CVector3& rotation);
+    void SetScale   (uint32_t index, const CVector3& scale);
+
+    // Parent of a transform, NO_PARENT_TRANSFORM if it has none
+    uint32_t Parent(uint32_t index)  { return mParents[index]; }
+
+    // Attach a transform to a parent, or pass NO_PARENT_TRANSFORM to detach it. Its position, rotation and scale are
+    // kept, so it will move to the same place relative to the new parent. The parent must have a lower index, to keep
+    // parents before their children. Returns false and leaves the transform unchanged if it doesn't
+    bool SetParent(uint32_t index, uint32_t parent);
+
+    // World matrix of a transform, rebuilt first if it or any of its parents have changed. Not thread-safe
+    const CMatrix4x4& WorldMatrix(uint32_t index)  { if (IsDirty(index))  UpdateWorldMatrix(index);  return mWorldMatrices[index]; }
+
+    // World matrix of a transform that must already be up to date (see UpdateWorldMatrices). Only reads, so can be used
+    // from several jobs at once
+    const CMatrix4x4& CurrentWorldMatrix(uint32_t index) const  { assert(!IsDirty(index));  return mWorldMatrices[index]; }
+
+    bool IsDirty(uint32_t index) const  { return (mDirty[index / 64] >> (index % 64)) & 1; }
+
+    // True if any of the transforms in the given set has changed since its world matrix was last built. The set has a
+    // bit for each transform, 64 to a word, in the same way as the dirty flags, so 64 transforms are checked at a time
+    bool AnyDirty(const std::vector<uint64_t>& set);
+
+
+    //-------------------------------------
+    // Private data / members
+    //-------------------------------------
+private:
+    // Mark a transform and all of its descendants dirty
+    void MarkDirty(uint32_t index);
+
+    // Rebuild a single world matrix and clear its dirty flag. Any dirty parents are rebuilt first
+    void UpdateWorldMatrix(uint32_t index);
+
+    // Rebuild the dirty matrices in the given range of dirty words. Finishes the transforms without a parent and
+    // clears their flags, transforms with a parent are left for UpdateChildWorldMatrices. Returns the number rebuilt
+    int UpdateDirtyWords(uint32_t firstWord, uint32_t endWord);
+
+    // Multiply the local matrices of dirty transforms with a parent by their parent's world matrix, in index order
+    // so parents are done first, then clear their flags
+    void UpdateChildWorldMatrices();
+
+    uint32_t mSize = 0;
+
+    // Each value in its own array. The arrays are padded to a multiple of 4 with identity transforms so four
+    // transforms can always be processed together
+    std::vector<float> mPositionX, mPositionY, mPositionZ;
+    std::vector<float> mRotationX, mRotationY, mRotationZ;
+    std::vector<float> mScaleX,    mScaleY,    mScaleZ;
+
+    // The hierarchy. Each transform's children are a linked list: its first child, then each child's next sibling
+    std::vector<uint32_t> mParents;
+    std::vector<uint32_t> mFirstChildren;
+    std::vector<uint32_t> mNextSiblings;
+
+    std::vector<CMatrix4x4> mWorldMatrices;
+    std::vector<CMatrix4x4> mLocalMatrices; // Matrices of transforms with a parent before the parent's is applied
+
+    std::vector<uint64_t> mDirty;      // One bit for each transform, set when its world matrix needs rebuilding
+    std::vector<uint64_t> mHasParent;  // One bit for each transform, set if it has a parent
+
+    std::vector<uint32_t> mStack; // Working space for MarkDirty and UpdateWorldMatrix
+};
+
+
+#endif //_TRANSFORM_STORE_H_INCLUDED_
@@ -0,0 +1,46 @@
+//--------------------------------------------------------------------------------------
+// Per-frame statistics
+//--------------------------------------------------------------------------------------
+
+#include "FrameStats.h"
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+FrameStats gFrameStats;
+FrameStats gLastFrameStats;
+
+
+//--------------------------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------------------------
+
+// Call at the start of each frame. Copies the counters to gLastFrameStats then clears them
+void BeginFrameStats()
+{
+    gLastFrameStats = gFrameStats;
+    gFrameStats = FrameStats();
+}
+
+
+// Returns a short text summary of the given counters, suitable for the window title
+std::string FrameStatsSummary(const FrameStats& stats)
+{
+    return "World matrices: " + std::to_string(stats.worldMatricesBuilt) +
+           ", Camera view/proj: " + std::to_string(stats.cameraViewUpdates) + "/" + std::to_string(stats.cameraProjectionUpdates) +
+           ", Buffer maps: " + std::to_string(stats.bufferMaps) +
+           ", Upload bytes frame/portal/main: " + std::to_string(stats.uploads.frame) + "/" + std::to_string(stats.uploads.portal) +
+           "/" + std::to_string(stats.uploads.main) +
+           ", Record us portal/main: " + std::to_string(static_cast<int>(stats.recordTimes.portal)) + "/" +
+           std::to_string(static_cast<int>(stats.recordTimes.main)) +
+           ", Drawn/culled main: " + std::to_string(stats.mainCameraCulling.drawn) + "/" + std::to_string(stats.mainCameraCulling.culled) +
+           " portal: " + std::to_string(stats.portalCameraCulling.drawn) + "/" + std::to_string(stats.portalCameraCulling.culled) +
+           ", Portal: " + (stats.portalRendersSkipped > 0 ? std::string("skipped") : std::to_string(stats.portalRenderSize) + "px") +
+           ", Render target KB in use/kept: " + std::to_string(stats.renderTargetMemory / 1024) + "/" + std::to_string(stats.renderTargetMemoryKept / 1024) +
+           ", Texture KB: " + std::to_string(stats.textureMemory / 1024) + " hits/misses: " + std::to_string(stats.textureCacheHits) +
+           "/" + std::to_string(stats.textureCacheMisses) +
+           ", Index KB: " + std::to_string(stats.indexMemory / 1024) + " saved: " + std::to_string(stats.indexMemorySaved / 1024) +
+           (stats.assetsLoading > 0 ? ", Loading: " + std::to_string(stats.assetsLoading) : std::string());
+}
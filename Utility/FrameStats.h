@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------------------
+// Per-frame statistics
+//--------------------------------------------------------------------------------------
+// Counters that different parts of the app increase as they do work during a frame, e.g. how many
+// world matrices were rebuilt. The counters are cleared at the start of each frame after being copied
+// to gLastFrameStats, so the totals for the previous complete frame can be displayed.
+
+#ifndef _FRAME_STATS_H_INCLUDED_
+#define _FRAME_STATS_H_INCLUDED_
+
+#include <string>
+
+
+// Models drawn and skipped by one camera's render (see RenderSceneFromCamera in Scene.cpp)
+struct CullingStats
+{
+    int drawn  = 0; // Models that may be visible and were rendered
+    int culled = 0; // Models entirely outside the camera's view frustum, not rendered
+};
+
+// Bytes sent to constant and instance buffers by each part of a frame (see RenderScene in Scene.cpp)
+struct UploadStats
+{
+    int frame  = 0; // Lighting and camera constants, sent once before rendering from the cameras
+    int portal = 0; // Sent while rendering the view through the portal
+    int main   = 0; // Sent while rendering the main window
+};
+
+// CPU time in microseconds taken to record the rendering commands of each camera view (see RenderScene in Scene.cpp).
+// Views are recorded on different threads at once where possible, so these can add up to more than the frame time
+struct RecordTimes
+{
+    float portal = 0;
+    float main   = 0;
+};
+
+struct FrameStats
+{
+    int worldMatricesBuilt      = 0; // Model world matrices recalculated because the model moved (see TransformStore.h)
+    int cameraViewUpdates       = 0; // Camera view matrices recalculated, all cameras (see Camera::UpdateMatrices)
+    int cameraProjectionUpdates = 0; // Camera projection matrices recalculated, all cameras
+    int bufferMaps              = 0; // Constant and instance buffer writes, each a Map/Unmap in Direct3D (see RenderContext::UpdateBuffer)
+    int bytesUploaded           = 0; // Total size of the writes above
+    int staticBVHRefits         = 0; // Times the static models' BVH was refitted because one of them moved (see SceneObjects.h)
+    int portalRendersSkipped    = 0; // Portal views not rendered, being off screen or unchanged (see RenderScene in Scene.cpp)
+    int portalRenderSize        = 0; // Size in pixels of the portal render target rendered to, 0 if not rendered
+    int renderTargetsCreated    = 0; // Render targets created, reused and freed by the render target pool (see RenderTargetPool.h)
+    int renderTargetsReused     = 0;
+    int renderTargetsFreed      = 0;
+    int renderTargetMemory      = 0; // Bytes of the pool's targets in use at the end of the frame
+    int renderTargetMemoryKept  = 0; // Bytes of the pool's released targets kept for reuse
+    int assetsCreated           = 0; // Meshes and textures loaded in the background that were created this frame (see AssetLoader.h)
+    int assetsLoading           = 0; // Meshes and textures still loading in the background
+    int textureMemory           = 0; // Bytes of the textures held by the texture cache at the end of the frame (see TextureCache.h)
+    int textureCacheHits        = 0; // Textures found in and created by the texture cache since the app started
+    int textureCacheMisses      = 0;
+    int indexMemory             = 0; // Bytes of the loaded meshes' index buffers at the end of the frame (see Mesh.h)
+    int indexMemorySaved        = 0; // Bytes saved by the meshes using 16-bit indices
+
+    UploadStats uploads; // The bytes uploaded above split by which part of the frame sent them
+    RecordTimes recordTimes;
+
+    CullingStats mainCameraCulling;   // Models drawn/culled when rendering the main window
+    CullingStats portalCameraCulling; // Models drawn/culled when rendering the view through the portal
+};
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+extern FrameStats gFrameStats;     // Counters for the frame in progress
+extern FrameStats gLastFrameStats; // Counters for the previous complete frame
+
+
+//--------------------------------------------------------------------------------------
+// Functions
+//--------------------------------------------------------------------------------------
+
+// Call at the start of each frame. Copies the counters to gLastFrameStats then clears them
+void BeginFrameStats();
+
+// Returns a short text summary of the given counters, suitable for the window title
+std::string FrameStatsSummary(const FrameStats& stats);
+
+
+#endif //_FRAME_STATS_H_INCLUDED_
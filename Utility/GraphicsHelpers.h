@@ -6,9 +6,6 @@
 #ifndef _SCENE_HELPERS_H_INCLUDED_
 #define _SCENE_HELPERS_H_INCLUDED_
 
-#include <WICTextureLoader.h>
-#include <DDSTextureLoader.h>
-
 #include "CMatrix4x4.h"
 #include "../Common.h"
 
@@ -17,28 +14,21 @@
 // Constant buffers
 //--------------------------------------------------------------------------------------
 
-// Template function to update a constant buffer. Pass the DirectX constant buffer object and the C++ data structure
+// Template function to update a constant buffer. Pass the constant buffer object and the C++ data structure
 // you want to update it with. The structure will be copied in full over to the GPU constant buffer, where it will
 // be available to shaders. This is used to update model and camera positions, lighting data etc.
 template <class T>
-void UpdateConstantBuffer(ID3D11Buffer* buffer, const T& bufferData)
+void UpdateConstantBuffer(GpuBuffer* buffer, const T& bufferData)
 {
-    D3D11_MAPPED_SUBRESOURCE cb;
-    gD3DContext->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &cb);
-    memcpy(cb.pData, &bufferData, sizeof(T));
-    gD3DContext->Unmap(buffer, 0);
+    gRenderContext->UpdateBuffer(buffer, &bufferData, sizeof(T));
 }
 
-
-//--------------------------------------------------------------------------------------
-// Texture Loading
-//--------------------------------------------------------------------------------------
-
-// Using Microsoft's open source DirectX Tool Kit (DirectXTK) to simplify file loading
-// This function requires you to pass a ID3D11Resource* (e.g. &gTilesDiffuseMap), which manages the GPU memory for the
-// texture and also a ID3D11ShaderResourceView* (e.g. &gTilesDiffuseMapSRV), which allows us to use the texture in shaders
-// The function will fill in these pointers with usable data. Returns false on failure
-bool LoadTexture(std::string filename, ID3D11Resource** texture, ID3D11ShaderResourceView** textureSRV);
+// As above, sending the update with the given render context, e.g. a deferred context recording on another thread
+template <class T>
+void UpdateConstantBuffer(RenderContext& context, GpuBuffer* buffer, const T& bufferData)
+{
+    context.UpdateBuffer(buffer, &bufferData, sizeof(T));
+}
 
 
 //--------------------------------------------------------------------------------------
@@ -0,0 +1,221 @@
+//--------------------------------------------------------------------------------------
+// Job system
+//--------------------------------------------------------------------------------------
+
+#include "JobSystem.h"
+
+#include <stdexcept>
+#include <system_error>
+#include <algorithm>
+
+
+namespace
+{
+    // The job system the calling thread is a worker of, and the index of its queue there
+    thread_local JobSystem* tJobSystem = nullptr;
+    thread_local int        tQueue     = 0;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Construction / Usage
+//--------------------------------------------------------------------------------------
+
+// Start the given number of worker threads. Pass a negative number for one fewer than the number of CPU cores, the
+// creating thread makes up the last. Will throw a std::runtime_error exception on failure
+JobSystem::JobSystem(int numWorkers /*= -1*/)
+{
+    if (numWorkers < 0)  numWorkers = static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) - 1;
+
+    for (int queue = 0; queue <= numWorkers; ++queue)  mQueues.push_back(std::make_unique<JobQueue>());
+    try
+    {
+        for (int queue = 1; queue <= numWorkers; ++queue)  mWorkers.emplace_back(&JobSystem::Worker, this, queue);
+    }
+    catch (const std::system_error&)
+    {
+        StopWorkers();
+        throw std::runtime_error("Error starting job system worker threads");
+    }
+}
+
+
+// Runs any jobs not yet run then stops the workers
+JobSystem::~JobSystem()
+{
+    while (RunOneJob(ThreadQueue())) {}
+    StopWorkers();
+}
+
+
+// Start a job, which will be run on any thread. If a counter is given it counts the job until it finishes. If a
+// dependency is given the job won't start until that counter reaches zero
+void JobSystem::Run(JobFunction function, JobCounter* counter /*= nullptr*/, JobCounter* dependency /*= nullptr*/)
+{
+    if (counter != nullptr)  ++counter->mCount;
+    Job job = { std::move(function), counter };
+
+    // Counters are decremented while holding their mutex (see Finished), so the dependency can't finish between
+    // checking it and adding the job to its waiting list
+    if (dependency != nullptr)
+    {
+        std::lock_guard<std::mutex> lock(dependency->mMutex);
+        if (dependency->mCount.load() > 0)
+        {
+            dependency->mWaiting.push_back(std::move(job));
+            return;
+        }
+    }
+    Push(std::move(job));
+}
+
+
+// Split indices 0 to count - 1 into batches and start a job for each, calling the function with the range of its batch.
+// If the work fits in one batch and nothing needs waiting for, it is run immediately on the calling thread instead
+void JobSystem::ParallelFor(uint32_t count, uint32_t minBatchSize, const JobRangeFunction& function,
+                            JobCounter* counter /*= nullptr*/, JobCounter* dependency /*= nullptr*/)
+{
+    if (count == 0)  return;
+
+    // Around four batches per thread, so threads that finish early can take work left by slower ones
+    uint32_t maxBatches = static_cast<uint32_t>(NumThreads()) * 4;
+    uint32_t batchSize  = std::max({ minBatchSize, (count + maxBatches - 1) / maxBatches, 1u });
+    if (batchSize >= count && (dependency == nullptr || dependency->IsDone()))
+    {
+        function(0, count);
+        return;
+    }
+
+    // The batches share one copy of the function
+    auto sharedFunction = std::make_shared<JobRangeFunction>(function);
+    for (uint32_t first = 0; first < count; first += batchSize)
+    {
+        uint32_t end = std::min(count, first + batchSize);
+        Run([sharedFunction, first, end]() { (*sharedFunction)(first, end); }, counter, dependency);
+    }
+}
+
+
+// Wait until all jobs started with the given counter have finished. The calling thread runs jobs while it waits
+void JobSystem::Wait(JobCounter& counter)
+{
+    int queue = ThreadQueue();
+    while (counter.mCount.load() > 0)
+    {
+        if (!RunOneJob(queue))  std::this_thread::yield();
+    }
+
+    // The thread that finished the last job may still hold the counter's mutex, wait for it to let go before the
+    // caller is free to destroy the counter
+    std::lock_guard<std::mutex> lock(counter.mMutex);
+}
+
+
+//--------------------------------------------------------------------------------------
+// Private functions
+//--------------------------------------------------------------------------------------
+
+// Add a job that is ready to run to the calling thread's queue and wake a worker
+void JobSystem::Push(Job job)
+{
+    JobQueue& queue = *mQueues[ThreadQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(std::move(job));
+        ++mQueuedJobs;
+    }
+
+    // Take the wake mutex so a worker that has just found nothing to do is either still checking (and will see the new
+    // job) or already asleep (and will be woken)
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+    }
+    mWake.notify_one();
+}
+
+
+// Run one job, from the given thread's queue or stolen from another. Returns false if there were none
+bool JobSystem::RunOneJob(int queue)
+{
+    Job job;
+    bool found = false;
+    int numQueues = static_cast<int>(mQueues.size());
+    for (int i = 0; i < numQueues && !found; ++i)
+    {
+        // Own queue first, newest job. Then the oldest job of each other queue in turn
+        JobQueue& from = *mQueues[(queue + i) % numQueues];
+        std::lock_guard<std::mutex> lock(from.mutex);
+        if (from.jobs.empty())  continue;
+        if (i == 0)
+        {
+            job = std::move(from.jobs.back());
+            from.jobs.pop_back();
+        }
+        else
+        {
+            job = std::move(from.jobs.front());
+            from.jobs.pop_front();
+        }
+        --mQueuedJobs;
+        found = true;
+    }
+    if (!found)  return false;
+
+    job.function();
+    Finished(job.counter);
+    return true;
+}
+
+
+// Count a job as finished, starting any jobs waiting for its counter to reach zero
+void JobSystem::Finished(JobCounter* counter)
+{
+    if (counter == nullptr)  return;
+
+    std::vector<Job> ready;
+    {
+        std::lock_guard<std::mutex> lock(counter->mMutex);
+        if (--counter->mCount > 0)  return;
+        ready.swap(counter->mWaiting);
+    }
+
+    // The counter may be destroyed from here on, the jobs that were waiting for it are counted by their own counters
+    for (auto& job : ready)  Push(std::move(job));
+}
+
+
+// Index of the calling thread's queue: 0 for the creating thread (or any thread that isn't a worker)
+int JobSystem::ThreadQueue()
+{
+    return (tJobSystem == this) ? tQueue : 0;
+}
+
+
+// Worker thread function
+void JobSystem::Worker(int queue)
+{
+    tJobSystem = this;
+    tQueue     = queue;
+    while (true)
+    {
+        if (RunOneJob(queue))  continue;
+
+        // Sleep until there are jobs again
+        std::unique_lock<std::mutex> lock(mWakeMutex);
+        mWake.wait(lock, [this]() { return mStopping || mQueuedJobs.load() > 0; });
+        if (mStopping && mQueuedJobs.load() == 0)  return;
+    }
+}
+
+
+// Tell the workers to finish and wait for them
+void JobSystem::StopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mWakeMutex);
+        mStopping = true;
+    }
+    mWake.notify_all();
+    for (auto& worker : mWorkers)  worker.join();
+    mWorkers.clear();
+}
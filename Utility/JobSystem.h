@@ -0,0 +1,168 @@
+//--------------------------------------------------------------------------------------
+// Job system
+//--------------------------------------------------------------------------------------
+// A fixed pool of worker threads that run small pieces of work (jobs) handed to them, so work that can be split up,
+// such as updating thousands of world matrices or culling thousands of models, uses all the CPU's cores.
+//
+// Each worker has its own queue of jobs (a deque). A worker adds the jobs it creates to the back of its own queue and
+// takes its next job from the back too, so it works on what it has just created while that data is still in its cache.
+// When its queue is empty it steals a job from the front of another worker's queue - the oldest job there, which is
+// likely to be a large piece of work. Workers with nothing to do sleep until new jobs are added. The thread that
+// created the job system (normally the main thread) has a queue of its own, and runs jobs while it waits for them.
+//
+// Jobs are grouped with a JobCounter, which counts the jobs started with it that have not finished. Wait until a
+// counter reaches zero to know all of its jobs are done. A job can also be given a counter it depends on, it won't
+// start until that counter reaches zero, so chains of work can be set up without waiting in between, e.g. cull the
+// models once their bounds are updated. ParallelFor splits a range of indices into batches, one job for each.
+//
+// Jobs must not throw exceptions. Each queue is protected by its own mutex rather than being lock-free, jobs should be
+// large enough (thousands of models rather than one) that the cost of taking a job doesn't matter.
+
+#ifndef _JOB_SYSTEM_H_INCLUDED_
+#define _JOB_SYSTEM_H_INCLUDED_
+
+#include <functional>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+
+// Work for a job to do
+using JobFunction = std::function<void()>;
+
+// Work for a ParallelFor batch to do: the indices from first to end - 1
+using JobRangeFunction = std::function<void(uint32_t first, uint32_t end)>;
+
+class JobCounter;
+
+// A job and the counter counting it
+struct Job
+{
+    JobFunction function;
+    JobCounter* counter;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Job counter
+//--------------------------------------------------------------------------------------
+
+// Counts the unfinished jobs started with it. Must stay alive until those jobs are done (see JobSystem::Wait), and
+// shouldn't be used for more jobs while jobs that depend on it might still be starting
+class JobCounter
+{
+public:
+    JobCounter() = default;
+
+    // Prevent copying - jobs refer to their counter
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    // True if all jobs started with this counter have finished
+    bool IsDone()  { return mCount.load() == 0; }
+
+
+private:
+    friend class JobSystem;
+
+    std::atomic<int> mCount{ 0 };
+
+    // Jobs waiting for this counter to reach zero
+    std::mutex       mMutex;
+    std::vector<Job> mWaiting;
+};
+
+
+//--------------------------------------------------------------------------------------
+// Job system class
+//--------------------------------------------------------------------------------------
+
+class JobSystem
+{
+public:
+    //-------------------------------------
+    // Construction / Usage
+    //-------------------------------------
+
+    // Start the given number of worker threads. Pass a negative number for one fewer than the number of CPU cores, the
+    // creating thread makes up the last. With no workers, jobs are all run by the creating thread while it waits.
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors).
+    JobSystem(int numWorkers = -1);
+
+    // Runs any jobs not yet run then stops the workers
+    ~JobSystem();
+
+    // Prevent copying - the threads are owned by this object
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+
+    // Start a job, which will be run on any thread. If a counter is given it counts the job until it finishes. If a
+    // dependency is given the job won't start until that counter reaches zero
+    void Run(JobFunction function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+    // Split indices 0 to count - 1 into batches and start a job for each, calling the function with the range of its
+    // batch. Batches are at least minBatchSize indices, fewer and larger if there are many indices for the number of
+    // threads. Counter and dependency as Run. If the work fits in one batch and nothing needs waiting for, it is run
+    // immediately on the calling thread instead
+    void ParallelFor(uint32_t count, uint32_t minBatchSize, const JobRangeFunction& function,
+                     JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+    // Wait until all jobs started with the given counter have finished. The calling thread runs jobs while it waits
+    void Wait(JobCounter& counter);
+
+
+    //-------------------------------------
+    // Data access
+    //-------------------------------------
+
+    // Number of threads running jobs: the workers and the creating thread
+    int NumThreads()  { return static_cast<int>(mQueues.size()); }
+
+
+    //-------------------------------------
+    // Private data / members
+    //-------------------------------------
+private:
+    // A thread's jobs. Its owner uses the back, other threads steal from the front
+    struct JobQueue
+    {
+        std::mutex      mutex;
+        std::deque<Job> jobs;
+    };
+
+    // Add a job that is ready to run to the calling thread's queue and wake a worker
+    void Push(Job job);
+
+    // Run one job, from the given thread's queue or stolen from another. Returns false if there were none
+    bool RunOneJob(int queue);
+
+    // Count a job as finished, starting any jobs waiting for its counter to reach zero
+    void Finished(JobCounter* counter);
+
+    // Index of the calling thread's queue: 0 for the creating thread (or any thread that isn't a worker)
+    int ThreadQueue();
+
+    // Worker thread function
+    void Worker(int queue);
+
+    // Tell the workers to finish and wait for them
+    void StopWorkers();
+
+    std::vector<std::unique_ptr<JobQueue>> mQueues; // One for each thread, the creating thread's first
+    std::vector<std::thread>               mWorkers;
+
+    // Sleeping workers wait for this to signal new jobs or shutdown
+    std::mutex              mWakeMutex;
+    std::condition_variable mWake;
+    std::atomic<int>        mQueuedJobs{ 0 }; // Jobs in all the queues
+    bool                    mStopping = false;
+};
+
+
+#endif //_JOB_SYSTEM_H_INCLUDED_
@@ -0,0 +1,87 @@
+//--------------------------------------------------------------------------------------
+// Read-only memory mapped file
+//--------------------------------------------------------------------------------------
+
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+#ifdef _WIN32
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+
+// Map the given file into memory (read-only)
+// Will throw a std::runtime_error exception on failure (since constructors can't return errors).
+MappedFile::MappedFile(const std::string& fileName)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)  throw std::runtime_error("Cannot open file " + fileName);
+    mFile = file;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map empty file " + fileName);
+    }
+    mSize = static_cast<size_t>(fileSize.QuadPart);
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map file " + fileName);
+    }
+    mMapping = mapping;
+
+    mData = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (mData == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        throw std::runtime_error("Cannot map view of file " + fileName);
+    }
+#else
+    mFile = open(fileName.c_str(), O_RDONLY);
+    if (mFile < 0)  throw std::runtime_error("Cannot open file " + fileName);
+
+    struct stat fileInfo;
+    if (fstat(mFile, &fileInfo) != 0 || fileInfo.st_size == 0)
+    {
+        close(mFile);
+        throw std::runtime_error("Cannot map empty file " + fileName);
+    }
+    mSize = static_cast<size_t>(fileInfo.st_size);
+
+    void* data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, mFile, 0);
+    if (data == MAP_FAILED)
+    {
+        close(mFile);
+        throw std::runtime_error("Cannot map file " + fileName);
+    }
+    mData = static_cast<const unsigned char*>(data);
+#endif
+}
+
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    UnmapViewOfFile(mData);
+    CloseHandle(mMapping);
+    CloseHandle(mFile);
+#else
+    munmap(const_cast<unsigned char*>(mData), mSize);
+    close(mFile);
+#endif
+}
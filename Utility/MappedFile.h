@@ -0,0 +1,43 @@
+//--------------------------------------------------------------------------------------
+// Read-only memory mapped file
+//--------------------------------------------------------------------------------------
+// Maps an entire file into memory so its content can be used directly without copying it into
+// a buffer first. Used for the binary mesh cache files (see MeshCache.h)
+
+#ifndef _MAPPED_FILE_H_INCLUDED_
+#define _MAPPED_FILE_H_INCLUDED_
+
+#include <string>
+#include <cstddef>
+
+class MappedFile
+{
+public:
+    // Map the given file into memory (read-only)
+    // Will throw a std::runtime_error exception on failure (since constructors can't return errors).
+    MappedFile(const std::string& fileName);
+    ~MappedFile();
+
+    // Prevent copying - the mapping is owned by this object
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Access to the mapped file content
+    const unsigned char* Data() const  { return mData; }
+    size_t               Size() const  { return mSize; }
+
+
+private:
+#ifdef _WIN32
+    void* mFile    = nullptr; // Windows file and file mapping handles (HANDLE type, stored as void* to avoid including windows.h here)
+    void* mMapping = nullptr;
+#else
+    int   mFile    = -1;      // POSIX file descriptor
+#endif
+
+    const unsigned char* mData = nullptr;
+    size_t               mSize = 0;
+};
+
+
+#endif //_MAPPED_FILE_H_INCLUDED_
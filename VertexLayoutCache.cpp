@@ -0,0 +1,250 @@
+//--------------------------------------------------------------------------------------
+// Vertex layout cache
+//--------------------------------------------------------------------------------------
+// See VertexLayoutCache.h for a description of the signature file
+
+#include "VertexLayoutCache.h"
+
+#include <d3dcompiler.h>
+#include <map>
+#include <vector>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+VertexLayoutStats gVertexLayoutStats = {};
+
+
+namespace
+{
+    const char     SIGNATURE_FILE_NAME[] = "VertexLayouts.sigcache";
+    const char     SIGNATURE_FILE_MAGIC[4] = { 'V', 'L', 'S', 'C' };
+    const uint32_t SIGNATURE_FILE_VERSION = 1;
+
+    // Vertex layouts created so far, keyed by a string made from every field of the vertex description
+    std::map<std::string, ID3D11InputLayout*> gVertexLayouts;
+
+    // Compiled signatures keyed by the source of the signature shader, loaded from the signature file on first use
+    std::map<std::string, std::vector<char>> gSignatures;
+    bool gSignatureFileLoaded = false;
+
+
+    // Returns a string holding every field of a vertex description, two descriptions that give the same
+    // string can share a vertex layout
+    std::string VertexLayoutKey(const D3D11_INPUT_ELEMENT_DESC vertexLayout[], int numElements)
+    {
+        std::string key;
+        for (int elt = 0; elt < numElements; ++elt)
+        {
+            auto& element = vertexLayout[elt];
+            key += element.SemanticName;
+            key += ":" + std::to_string(element.SemanticIndex)     + ":" + std::to_string(element.Format) +
+                   ":" + std::to_string(element.InputSlot)         + ":" + std::to_string(element.AlignedByteOffset) +
+                   ":" + std::to_string(element.InputSlotClass)    + ":" + std::to_string(element.InstanceDataStepRate) + ";";
+        }
+        return key;
+    }
+
+
+    // Returns the source of the temporary shader compiled by CreateSignatureForVertexLayout below. Layouts that give
+    // the same source can share the same signature. Returns an empty string if the layout uses an unsupported format
+    std::string SignatureSourceForVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLayout[], int numElements)
+    {
+        std::string shaderSource = "float4 main(";
+        for (int elt = 0; elt < numElements; ++elt)
+        {
+            auto& format = vertexLayout[elt].Format;
+            // This list should be more complete for production use
+            if      (format == DXGI_FORMAT_R32G32B32A32_FLOAT) shaderSource += "float4";
+            else if (format == DXGI_FORMAT_R32G32B32_FLOAT)    shaderSource += "float3";
+            else if (format == DXGI_FORMAT_R32G32_FLOAT)       shaderSource += "float2";
+            else if (format == DXGI_FORMAT_R32_FLOAT)          shaderSource += "float";
+            else if (format == DXGI_FORMAT_R16G16B16A16_UNORM) shaderSource += "float4"; // Normalised formats are read as floats
+            else if (format == DXGI_FORMAT_R16G16_SNORM)       shaderSource += "float2";
+            else if (format == DXGI_FORMAT_R16G16_FLOAT)       shaderSource += "float2";
+            else return ""; // Unsupported type in layout
+
+            uint8_t index = static_cast<uint8_t>(vertexLayout[elt].SemanticIndex);
+            std::string semanticName = vertexLayout[elt].SemanticName;
+            semanticName += ('0' + index);
+
+            shaderSource += " ";
+            shaderSource += semanticName;
+            shaderSource += " : ";
+            shaderSource += semanticName;
+            if (elt != numElements - 1)  shaderSource += " , ";
+        }
+        shaderSource += ") : SV_Position {return 0;}";
+
+        return shaderSource;
+    }
+
+
+    // Very advanced topic: When creating a vertex layout for geometry, you need the signature (bytecode) of a shader
+    // that uses that vertex layout. This is an annoying requirement and tends to create unnecessary coupling between
+    // shaders and vertex buffers.
+    // This is a trick to simplify things - pass a vertex layout to this function and it will write and compile
+    // a temporary shader to match. You don't need to know about the actual shaders in use in the app.
+    // Release the signature (called a ID3DBlob!) after use. Returns nullptr on failure.
+    ID3DBlob* CreateSignatureForVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLayout[], int numElements)
+    {
+        std::string shaderSource = SignatureSourceForVertexLayout(vertexLayout, numElements);
+        if (shaderSource.empty())
+        {
+            return nullptr;
+        }
+
+        ID3DBlob* compiledShader;
+        HRESULT hr = D3DCompile(shaderSource.c_str(), shaderSource.length(), NULL, NULL, NULL, "main",
+            "vs_5_0", D3DCOMPILE_OPTIMIZATION_LEVEL0, 0, &compiledShader, NULL);
+        if (FAILED(hr))
+        {
+            return nullptr;
+        }
+
+        return compiledShader;
+    }
+
+
+    // Read a length followed by that many bytes from the signature file
+    bool ReadBlock(std::ifstream& file, std::vector<char>& block)
+    {
+        uint32_t size = 0;
+        file.read(reinterpret_cast<char*>(&size), sizeof(size));
+        if (!file || size > 1024 * 1024)  return false; // Signatures are tiny, anything larger means a damaged file
+        block.resize(size);
+        file.read(block.data(), size);
+        return !file.fail();
+    }
+
+    void WriteBlock(std::ofstream& file, const char* data, uint32_t size)
+    {
+        file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+        file.write(data, size);
+    }
+
+
+    // Load all the signatures in the signature file. A missing or damaged file is ignored, any signatures
+    // needed will be compiled again
+    void LoadSignatureFile()
+    {
+        gSignatureFileLoaded = true;
+
+        std::ifstream file(SIGNATURE_FILE_NAME, std::ios::in | std::ios::binary);
+        if (!file.is_open())  return;
+
+        char     magic[4] = {};
+        uint32_t version = 0;
+        uint32_t numSignatures = 0;
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char*>(&version), sizeof(version));
+        file.read(reinterpret_cast<char*>(&numSignatures), sizeof(numSignatures));
+        if (!file || std::memcmp(magic, SIGNATURE_FILE_MAGIC, sizeof(magic)) != 0 || version != SIGNATURE_FILE_VERSION)  return;
+
+        std::map<std::string, std::vector<char>> signatures;
+        for (uint32_t i = 0; i < numSignatures; ++i)
+        {
+            std::vector<char> source, signature;
+            if (!ReadBlock(file, source) || !ReadBlock(file, signature))  return;
+            signatures[std::string(source.begin(), source.end())] = std::move(signature);
+        }
+        gSignatures = std::move(signatures);
+    }
+
+
+    // Write all known signatures to the signature file. Failing to write the file is not an error, the
+    // signatures will be compiled again next time
+    void SaveSignatureFile()
+    {
+        std::ofstream file(SIGNATURE_FILE_NAME, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())  return;
+
+        uint32_t numSignatures = static_cast<uint32_t>(gSignatures.size());
+        file.write(SIGNATURE_FILE_MAGIC, sizeof(SIGNATURE_FILE_MAGIC));
+        file.write(reinterpret_cast<const char*>(&SIGNATURE_FILE_VERSION), sizeof(SIGNATURE_FILE_VERSION));
+        file.write(reinterpret_cast<const char*>(&numSignatures), sizeof(numSignatures));
+        for (auto& signature : gSignatures)
+        {
+            WriteBlock(file, signature.first.data(),  static_cast<uint32_t>(signature.first.size()));
+            WriteBlock(file, signature.second.data(), static_cast<uint32_t>(signature.second.size()));
+        }
+        file.close();
+
+        if (file.fail())  std::remove(SIGNATURE_FILE_NAME); // Don't leave a partial file behind
+    }
+
+
+    // Returns the compiled signature for the given vertex description, from memory, the signature file or
+    // by compiling it. Returns nullptr on failure
+    const std::vector<char>* GetSignature(const D3D11_INPUT_ELEMENT_DESC vertexLayout[], int numElements)
+    {
+        if (!gSignatureFileLoaded)  LoadSignatureFile();
+
+        std::string source = SignatureSourceForVertexLayout(vertexLayout, numElements);
+        if (source.empty())  return nullptr;
+
+        auto found = gSignatures.find(source);
+        if (found != gSignatures.end())
+        {
+            ++gVertexLayoutStats.signaturesReused;
+            return &found->second;
+        }
+
+        ID3DBlob* compiledSignature = CreateSignatureForVertexLayout(vertexLayout, numElements);
+        if (compiledSignature == nullptr)  return nullptr;
+        ++gVertexLayoutStats.signaturesCompiled;
+
+        const char* signatureData = static_cast<const char*>(compiledSignature->GetBufferPointer());
+        auto& signature = gSignatures[source];
+        signature.assign(signatureData, signatureData + compiledSignature->GetBufferSize());
+        compiledSignature->Release();
+
+        SaveSignatureFile();
+        return &signature;
+    }
+}
+
+
+//--------------------------------------------------------------------------------------
+// Cache access
+//--------------------------------------------------------------------------------------
+
+// Returns the vertex layout for the given vertex description, creating it the first time a description is
+// seen. The layout is owned by the cache - do not release it, call ReleaseVertexLayouts when quitting instead.
+// Returns nullptr on failure
+ID3D11InputLayout* GetVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLayout[], int numElements)
+{
+    ++gVertexLayoutStats.layoutRequests;
+
+    std::string key = VertexLayoutKey(vertexLayout, numElements);
+    auto found = gVertexLayouts.find(key);
+    if (found != gVertexLayouts.end())  return found->second;
+
+    const std::vector<char>* signature = GetSignature(vertexLayout, numElements);
+    if (signature == nullptr)  return nullptr;
+
+    ID3D11InputLayout* layout;
+    HRESULT hr = gD3DDevice->CreateInputLayout(vertexLayout, numElements, signature->data(), signature->size(), &layout);
+    if (FAILED(hr))  return nullptr;
+    ++gVertexLayoutStats.layoutsCreated;
+
+    gVertexLayouts[key] = layout;
+    return layout;
+}
+
+
+// Release all the vertex layouts created by the cache. Meshes using them must not be rendered afterwards
+void ReleaseVertexLayouts()
+{
+    for (auto& layout : gVertexLayouts)
+    {
+        layout.second->Release();
+    }
+    gVertexLayouts.clear();
+}
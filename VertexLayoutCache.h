@@ -0,0 +1,49 @@
+//--------------------------------------------------------------------------------------
+// Vertex layout cache
+//--------------------------------------------------------------------------------------
+// Creating a vertex layout (ID3D11InputLayout) needs the signature of a shader using that layout, which
+// is found by compiling a small shader that takes the layout as input. Most meshes use one of only
+// two or three layouts, so compiling a shader for every mesh wastes a lot of load time.
+//
+// Part of the Direct3D renderer (RendererD3D11.cpp), the rest of the app gets vertex layouts from gRenderDevice.
+// This cache hands out one shared vertex layout for each distinct D3D11_INPUT_ELEMENT_DESC array. The
+// compiled signatures are also written to a file (VertexLayouts.sigcache) so later runs don't compile at all:
+//   "VLSC", version, number of entries
+//   for each entry: length + signature shader source, length + compiled signature
+
+#ifndef _VERTEX_LAYOUT_CACHE_H_INCLUDED_
+#define _VERTEX_LAYOUT_CACHE_H_INCLUDED_
+
+#include "Common.h"
+#include <d3d11.h>
+
+
+//--------------------------------------------------------------------------------------
+// Global Variables
+//--------------------------------------------------------------------------------------
+
+// Counts of the work done by the cache since the app started, to check layouts are being shared
+struct VertexLayoutStats
+{
+    int layoutRequests;     // Calls to GetVertexLayout
+    int layoutsCreated;     // Distinct vertex layouts created
+    int signaturesCompiled; // Signature shaders compiled with D3DCompile
+    int signaturesReused;   // Signatures already compiled, in the signature file or earlier in this run
+};
+extern VertexLayoutStats gVertexLayoutStats;
+
+
+//--------------------------------------------------------------------------------------
+// Cache access
+//--------------------------------------------------------------------------------------
+
+// Returns the vertex layout for the given vertex description, creating it the first time a description is
+// seen. The layout is owned by the cache - do not release it, call ReleaseVertexLayouts when quitting instead.
+// Returns nullptr on failure
+ID3D11InputLayout* GetVertexLayout(const D3D11_INPUT_ELEMENT_DESC vertexLayout[], int numElements);
+
+// Release all the vertex layouts created by the cache. Meshes using them must not be rendered afterwards
+void ReleaseVertexLayouts();
+
+
+#endif //_VERTEX_LAYOUT_CACHE_H_INCLUDED_